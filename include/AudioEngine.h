@@ -1,14 +1,26 @@
 #pragma once
 #include <QObject>
-#include <QMediaPlayer>
-#include <QAudioOutput>
 #include <QMap>
+#include <QSet>
+#include <QJsonObject>
 #include <QDir>
+#include <QFileInfo>
+#include <QVector>
+#include <QThread>
+#include <QThreadPool>
+#include <QTimer>
+#include <atomic>
 #include <memory>
+#include "SampleDecoder.h"
+#include "SampleCache.h"
+
+class AudioMixer;
 
 /**
  * @brief Moteur audio pour la lecture des échantillons de batterie
  * Version sans limite - charge tous les fichiers disponibles
+ * Les samples sont décodés en parallèle sur un pool de threads et mixés par
+ * un AudioMixer sur un thread dédié
  */
 class AudioEngine : public QObject {
     Q_OBJECT
@@ -18,7 +30,11 @@ public:
     ~AudioEngine();
 
     // Configuration
+    // Démarre le chargement asynchrone : chaque instrument devient jouable
+    // dès que son propre sample est décodé (signal sampleLoaded)
     bool loadSamples(const QString& samplesPath = "samples/");
+    void cancelLoading();
+    bool isLoading() const { return m_loadDone < m_loadTotal; }
     void setVolume(float volume); // 0.0 - 1.0
     float getVolume() const { return m_volume; }
 
@@ -26,6 +42,16 @@ public:
     void playInstrument(int instrumentId);
     void playMultipleInstruments(const QList<int>& instruments);
 
+    // Transport du séquenceur, cadencé par l'horloge audio
+    void setPlaying(bool playing);
+    void setTempo(int bpm);
+    void setStepCount(int steps);
+    void setStepMask(int step, quint64 instrumentMask);
+    void resetTransport(int step = 0);
+    // Transport partagé : instants exprimés sur l'horloge monotone locale (ClockSync::nowUs)
+    void syncTransport(qint64 anchorUs, double anchorStep, int bpm);
+    double transportPosition(qint64 localUs) const;
+
     // Mapping des instruments
     void setInstrumentSample(int instrumentId, const QString& samplePath);
     QString getInstrumentName(int instrumentId) const;
@@ -39,17 +65,47 @@ public:
     void setMaxInstruments(int maxInstruments) { m_maxInstruments = maxInstruments; }
     int getMaxInstruments() const { return m_maxInstruments; }
 
+    // Nombre de voix en cours de lecture dans le mixeur
+    int getActiveVoiceCount() const;
+    // Occupation du pool de voix : {active, peak, capacity, stolen, choked} ;
+    // le pic couvre l'intervalle depuis l'appel précédent
+    QJsonObject voiceStats();
+
+    // Polyphonie par instrument (0 : pas de limite propre) et groupes
+    // d'étouffement (0 : aucun). Un groupe fixé ici n'est plus jamais modifié
+    // par les rechargements de samples.
+    void setInstrumentPolyphony(int instrumentId, int maxVoices);
+    void setInstrumentChokeGroup(int instrumentId, int group);
+    QVector<int> chokeGroups() const { return m_chokeGroups; } // Indexé par instrument
+    // Volume (1 : inchangé) et panoramique (-1 .. 1) d'un instrument
+    void setInstrumentMix(int instrumentId, float gain, float pan);
+
+    // Option : les instruments non configurés dont le nom désigne un
+    // charleston ("Hi-Hat", "Open Hat", "HH"...) partagent un groupe
+    void setAutoChokeHiHats(bool enabled);
+    bool autoChokeHiHats() const { return m_autoChokeHiHats; }
+    static int defaultChokeGroup(const QString& instrumentName);
+
+    // Table des samples indexée par instrument (nullptr = silencieux), telle que jouée par le mixeur
+    QVector<SampleBufferPtr> currentSamples() const;
+
+    // Fichiers audio d'un dossier, avec leur nom nettoyé, dans l'ordre des IDs d'instruments
+    static QList<QPair<QString, QFileInfo>> listSampleFiles(const QDir& dir);
+    static QString cleanFileName(const QString& fileName);
+
 signals:
     void sampleLoaded(int instrumentId, const QString& name);
     void loadingError(const QString& error);
     void instrumentCountChanged(int newCount);
     void maxInstrumentsReached(int maxCount, int totalFiles);
+    void loadingProgress(int loaded, int total);
+    void loadingFinished(int loaded, bool cancelled);
+    void stepAdvanced(int step);
 
 private:
     // Structure pour gérer un instrument
     struct InstrumentPlayer {
-        std::unique_ptr<QMediaPlayer> player;
-        std::unique_ptr<QAudioOutput> audioOutput;
+        SampleBufferPtr sample; // nullptr = instrument silencieux
         QString name;
         QString filePath;
 
@@ -59,21 +115,39 @@ private:
         // Désactiver la copie
         InstrumentPlayer(const InstrumentPlayer&) = delete;
         InstrumentPlayer& operator=(const InstrumentPlayer&) = delete;
-
-        // Activer le déplacement
-        InstrumentPlayer(InstrumentPlayer&&) = default;
-        InstrumentPlayer& operator=(InstrumentPlayer&&) = default;
     };
 
     void loadSample(int instrumentId, const QString& filePath, const QString& name);
     void createSilentInstrument(int instrumentId, const QString& name);
     QString findSamplesDirectory(const QString& basePath) const;
-    bool loadSamplesFromDirectory(const QString& dirPath);
-    void loadAllAvailableSamples(const QDir& dir);
-    QString cleanFileName(const QString& fileName) const;
-    void sortInstrumentsByName();
+    int loadAllAvailableSamples(const QDir& dir);
+    void startSampleJob(int instrumentId, const QString& filePath);
+    void onSampleDecoded(int generation, int instrumentId, const QString& filePath,
+                         SampleBufferPtr sample, const QString& errorString);
+    void clearInstruments();
+    void syncMixerSamples();
+    void applyDefaultChokeGroups();
+    void applyChokeGroup(int instrumentId, int group);
+    void pollMixer();
 
     QMap<int, InstrumentPlayer*> m_instruments;
+    QVector<int> m_chokeGroups;
+    QSet<int> m_configuredChokeGroups; // Fixés par setInstrumentChokeGroup
+    bool m_autoChokeHiHats = false;
+    AudioMixer* m_mixer;
+    QThread m_audioThread;
+    // Relève les retours du thread audio (steps joués, samples à libérer) pendant la lecture
+    QTimer m_mixerPollTimer;
+    bool m_playing = false;
+    SampleCache m_sampleCache;
+
+    // Chargement parallèle : une génération par appel à loadSamples,
+    // les résultats d'une génération annulée sont ignorés
+    QThreadPool m_loadPool;
+    std::shared_ptr<std::atomic<bool>> m_loadCancelled;
+    int m_loadGeneration = 0;
+    int m_loadTotal = 0;
+    int m_loadDone = 0;
     float m_volume;
     int m_maxInstruments; // 0 = illimité
 
@@ -82,4 +156,6 @@ private:
     static const QStringList DEFAULT_NAMES;
     static constexpr int MIN_INSTRUMENTS = 1;
     static constexpr int DEFAULT_MAX_INSTRUMENTS = 0; // Illimité par défaut
+    static constexpr int MIXER_POLL_INTERVAL_MS = 5;
+    static constexpr int HIHAT_CHOKE_GROUP = 1;
 };
@@ -0,0 +1,220 @@
+#pragma once
+#include <QIODevice>
+#include <QAudioFormat>
+#include <QVector>
+#include <array>
+#include <atomic>
+#include <vector>
+#include "SampleDecoder.h"
+#include "SpscQueue.h"
+
+class QAudioSink;
+
+/**
+ * @brief Mixeur logiciel en mode "pull" pour QAudioSink
+ * Vit sur le thread audio : QAudioSink appelle readData() à chaque période,
+ * toutes les voix actives sont mixées dans un seul buffer de sortie.
+ * Contient aussi le transport du séquenceur : les steps sont planifiés en
+ * frames audio et déclenchés à l'échantillon près pendant le rendu.
+ * Le thread GUI ne touche jamais l'état du rendu : ses appels deviennent des
+ * commandes préallouées dans une file sans verrou, vidée au début de chaque
+ * bloc. En retour, le thread audio publie les steps joués et rend les samples
+ * remplacés (libérés côté GUI) par deux autres files. Le rendu ne prend aucun
+ * verrou et n'alloue rien.
+ */
+class AudioMixer : public QIODevice {
+    Q_OBJECT
+
+public:
+    explicit AudioMixer(QObject* parent = nullptr);
+    ~AudioMixer();
+
+    // Appelés depuis le thread GUI (producteur unique de la file de commandes)
+    void trigger(int instrumentId);
+    void setSample(int instrumentId, SampleBufferPtr sample);
+    void setSamples(const QVector<SampleBufferPtr>& samples);
+    void setMasterGain(float gain);
+    int activeVoiceCount() const { return m_activeVoices.load(std::memory_order_relaxed); }
+
+    // Polyphonie propre à un instrument (0 : seulement la limite MAX_VOICES) ;
+    // au-delà, sa voix la plus ancienne s'éteint en fondu
+    void setPolyphony(int instrumentId, int maxVoices);
+    // Groupe d'étouffement (0 : aucun) : une frappe éteint en fondu toutes les
+    // voix du même groupe, y compris celles de l'instrument frappé
+    void setChokeGroup(int instrumentId, int group);
+    // Volume (0..2, 1 : inchangé) et panoramique (-1 gauche .. 1 droite) d'un
+    // instrument, figés dans chaque voix au déclenchement. Loi de balance : au
+    // centre, les deux canaux restent à l'unité.
+    void setInstrumentMix(int instrumentId, float gain, float pan);
+
+    // Occupation du pool de voix : pic depuis l'appel précédent (remis à zéro),
+    // voix remplacées (pool ou polyphonie pleins) et étouffées depuis le démarrage
+    int takePeakVoiceCount() { return m_peakVoices.exchange(0, std::memory_order_relaxed); }
+    quint64 stolenVoiceCount() const { return m_stolenVoices.load(std::memory_order_relaxed); }
+    quint64 chokedVoiceCount() const { return m_chokedVoices.load(std::memory_order_relaxed); }
+
+    // Transport du séquenceur (appelés depuis le thread GUI)
+    void setPlaying(bool playing);
+    void setTempo(double bpm);
+    void setStepCount(int steps);
+    void setStepMask(int step, quint64 instrumentMask);
+    void resetTransport(int step = 0);
+    // Ancre le transport sur l'horloge monotone locale (ClockSync::nowUs) : la
+    // position vaut `anchorStep` à `anchorUs` et avance au tempo `bpm`. Le
+    // rendu se recale sur l'ancre dès que l'écart dépasse DRIFT_TOLERANCE_FRAMES.
+    void syncTransport(qint64 anchorUs, double anchorStep, double bpm);
+    // Position du séquenceur (en steps depuis l'ancre ou le démarrage) à un instant local
+    double transportPosition(qint64 localUs) const;
+
+    // Retours du thread audio, à relever régulièrement depuis le thread GUI :
+    // dernier step joué (faux si aucun depuis le dernier appel) et samples à libérer
+    bool takeLatestStep(int& step);
+    void collectGarbage();
+    // Commandes perdues sur file pleine (sortie audio arrêtée, par exemple)
+    quint64 droppedCommands() const { return m_droppedCommands.load(std::memory_order_relaxed); }
+
+    // Sortie audio (exécutés sur le thread audio via invokeMethod)
+    Q_INVOKABLE void startOutput();
+    Q_INVOKABLE void stopOutput();
+
+    // Rendu d'un bloc de frames float stéréo entrelacées
+    void render(float* output, qint64 frames);
+
+    bool isSequential() const override { return true; }
+    qint64 bytesAvailable() const override;
+
+    static constexpr int PERIOD_FRAMES = 256;
+    static constexpr int PERIOD_COUNT = 2;
+    static constexpr int MAX_STEPS = 64;
+    static constexpr int MAX_INSTRUMENTS = 64; // Un bit par instrument dans les masques de step
+    static constexpr int MAX_VOICES = 128;     // Voix audibles ; au-delà, la plus ancienne s'éteint en fondu
+    static constexpr int FADE_RESERVE = 32;    // Emplacements en plus pour les voix en fondu
+    static constexpr int VOICE_SLOTS = MAX_VOICES + FADE_RESERVE;
+    static constexpr int FADE_FRAMES = 96;     // Fondu d'une voix étouffée ou remplacée (2 ms à 48 kHz)
+    static constexpr double DRIFT_TOLERANCE_FRAMES = 96.0; // 2 ms à 48 kHz
+
+signals:
+    void outputError(const QString& error);
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override;
+    qint64 writeData(const char* data, qint64 maxSize) override;
+
+private:
+    struct Command {
+        enum class Type : quint8 {
+            Trigger,
+            SetSample,
+            SetGain,
+            SetPlaying,
+            SetTempo,
+            SetStepCount,
+            SetStepMask,
+            SetPolyphony,
+            SetChokeGroup,
+            SetInstrumentMix,
+            ResetTransport,
+            SyncTransport
+        };
+        Type type = Type::Trigger;
+        int index = 0;        // Instrument, step ou nombre de steps
+        int amount = 0;       // Polyphonie ou groupe d'étouffement
+        bool flag = false;    // Lecture / ancre présente
+        quint64 mask = 0;
+        double value = 0.0;   // Gain (gauche pour un instrument) ou tempo
+        double step = 0.0;    // Position d'ancrage ou gain droit d'un instrument
+        qint64 timeUs = 0;    // Instant d'ancrage
+        SampleBufferPtr sample;
+    };
+
+    struct Voice {
+        const SampleBuffer* sample = nullptr; // Maintenu en vie par la table ou la liste de retrait
+        qint64 position = 0;
+        qint64 fadeRemaining = -1; // Frames avant extinction, -1 : pas de fondu
+        int instrumentId = -1;
+        int chokeGroup = 0;
+        float gainLeft = 1.0f;
+        float gainRight = 1.0f;
+
+        bool isFading() const { return fadeRemaining >= 0; }
+    };
+
+    // Côté GUI
+    bool post(Command&& command);
+    void countDroppedCommand();
+    void setAnchor(bool anchored, qint64 anchorUs, double anchorStep, double bpm);
+
+    // Côté audio
+    void drainCommands();
+    void applyCommand(Command& command);
+    void retireSample(SampleBufferPtr&& sample);
+    void releaseRetiredSamples();
+    bool isSamplePlaying(const SampleBuffer* sample) const;
+    void startVoice(int instrumentId);
+    int allocateVoice();
+    void fadeOut(Voice& voice);
+    void mixVoices(float* output, qint64 frames);
+    void fireStep();
+    void alignToAnchor(qint64 nowUs);
+    void publishTransport();
+    double anchorPosition(qint64 localUs) const;
+    double framesPerStep() const;
+
+    QAudioSink* m_sink = nullptr;
+    QAudioFormat m_format;
+
+    // Files entre les deux threads (tailles fixes, allouées avec le mixeur)
+    SpscQueue<Command, 4096> m_commands;          // GUI -> audio
+    SpscQueue<int, 256> m_stepEvents;             // audio -> GUI
+    SpscQueue<SampleBufferPtr, 256> m_garbage;    // audio -> GUI (libération hors du thread audio)
+    int m_samplesInFlight = 0;                    // SetSample envoyés dont le retour n'est pas relevé (GUI)
+    std::atomic<quint64> m_droppedCommands{0};
+
+    // Miroir GUI de l'ancre et du tempo envoyés (transportPosition, recalage au changement de tempo)
+    int m_publishedSampleCount = 0;
+    bool m_guiAnchored = false;
+    qint64 m_guiAnchorUs = 0;
+    double m_guiAnchorStep = 0.0;
+    double m_guiBpm = 120.0;
+
+    // État du rendu (thread audio uniquement)
+    std::array<SampleBufferPtr, MAX_INSTRUMENTS> m_samples;
+    std::array<SampleBufferPtr, MAX_INSTRUMENTS> m_retiring; // Remplacés, encore joués par une voix
+    std::array<Voice, VOICE_SLOTS> m_voices;
+    int m_voiceCount = 0;
+    std::array<int, MAX_INSTRUMENTS> m_polyphony{};
+    std::array<int, MAX_INSTRUMENTS> m_chokeGroups{};
+    std::array<float, MAX_INSTRUMENTS> m_gainLeft;
+    std::array<float, MAX_INSTRUMENTS> m_gainRight;
+    std::vector<float> m_mixBuffer;
+    float m_gain = 0.7f;
+    float m_appliedGain = 0.7f; // Gain atteint à la fin du bloc précédent (départ de la rampe)
+
+    std::array<quint64, MAX_STEPS> m_stepMasks{};
+    bool m_playing = false;
+    double m_bpm = 120.0;
+    int m_stepCount = 16;
+    int m_nextStep = 0;
+    qint64 m_nextStepIndex = 0;     // Index absolu (non bouclé) du prochain step
+    qint64 m_renderedFrames = 0;    // Horloge audio : frames rendues depuis le début
+    double m_nextStepFrame = 0.0;   // Position exacte (fractionnaire) du prochain step
+    qint64 m_renderClockUs = 0;     // Horloge locale au début du dernier bloc rendu
+
+    // Ancre de transport partagée (session réseau)
+    bool m_anchored = false;
+    qint64 m_anchorUs = 0;
+    double m_anchorStep = 0.0;
+
+    // Horloge audio publiée pour le thread GUI (verrou de séquence, sans attente côté audio)
+    std::atomic<quint32> m_transportSeq{0};
+    std::atomic<qint64> m_pubRenderedFrames{0};
+    std::atomic<qint64> m_pubRenderClockUs{0};
+    std::atomic<qint64> m_pubNextStepIndex{0};
+    std::atomic<double> m_pubNextStepFrame{0.0};
+    std::atomic<double> m_pubBpm{120.0};
+
+    std::atomic<int> m_activeVoices;
+    std::atomic<int> m_peakVoices{0};
+    std::atomic<quint64> m_stolenVoices{0};
+    std::atomic<quint64> m_chokedVoices{0};
+};
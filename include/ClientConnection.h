@@ -0,0 +1,143 @@
+#pragma once
+#include <QObject>
+#include <QTcpSocket>
+#include <QJsonObject>
+#include <QList>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QDeadlineTimer>
+#include <QHostAddress>
+#include "Protocol.h"
+#include "LinkStats.h"
+#include "FrameDecoder.h"
+
+class UdpChannel;
+
+/**
+ * @brief Budget de la file d'envoi d'une connexion
+ * Un client lent peut dépasser le budget le temps d'un à-coup ; au-delà de
+ * `overBudgetTimeoutMs`, ou de HARD_LIMIT_FACTOR fois le budget, il est coupé
+ * (il se resynchronisera par révision à la reconnexion).
+ */
+struct SendQueueLimits
+{
+    qint64 maxBytes = 1024 * 1024;
+    int maxMessages = 4096;
+    int overBudgetTimeoutMs = 5000;
+
+    static constexpr int HARD_LIMIT_FACTOR = 4;
+};
+
+/**
+ * @brief Connexion d'un client côté serveur
+ * Regroupe le socket, le découpage des trames, la session d'encodage, la file
+ * d'écriture et les mesures du lien. Les messages de transport (HELLO, PING,
+ * PONG, CLOCK_SYNC, USER_ALIAS) sont traités ici, les autres sont remontés au
+ * propriétaire. L'objet entier, socket compris, peut changer de thread : c'est
+ * ainsi qu'un client rejoint le fil de travail de son salon.
+ * Les trames d'un même tour de boucle sont regroupées en une seule écriture ;
+ * les messages de mesure (PING, PONG, CLOCK_SYNC) partent immédiatement.
+ * Si le client l'accepte, les messages éphémères passent par le canal UDP
+ * du serveur ; TCP reprend le relais dès que le canal perd des PONG.
+ */
+class ClientConnection : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int CLOSE_TIMEOUT_MS = 3000; // Délai laissé au pair pour acquitter la fermeture
+
+    ClientConnection(const QString &clientId, QTcpSocket *socket, QObject *parent = nullptr);
+    ~ClientConnection();
+
+    QString clientId() const { return m_clientId; }
+    bool isConnected() const;
+
+    // Table d'internement du propriétaire (une par thread) ; les alias sont redéfinis au besoin
+    void setOutgoingIdTable(std::shared_ptr<Protocol::UserIdTable> table);
+
+    void send(const QByteArray &message);
+    void send(OutgoingFrame &frame);
+
+    // Canal UDP proposé au client lors du HELLO (nul : TCP seul)
+    void setUdpChannel(UdpChannel *channel);
+    bool isUdpBound() const { return m_udpBound; }
+    // Datagramme reçu avec le jeton de cette connexion (appelé dans son thread)
+    void receiveDatagram(const QHostAddress &address, quint16 port, const QByteArray &frame);
+
+    void setSendQueueLimits(const SendQueueLimits &limits);
+    int queuedMessages() const { return int(m_writeQueue.size() - m_supersededFrames); }
+    qint64 queuedBytes() const { return m_queuedBytes; }
+    // Profondeur de file, pic, GRID_UPDATE fusionnés, durée de dépassement du budget
+    QJsonObject queueStats() const;
+
+    // Envoie un PING ; faux si le pair a manqué trop de PONG et doit être évincé.
+    // Contrôle aussi la durée de dépassement du budget d'envoi.
+    bool heartbeat(int maxMissedPongs);
+    const LinkStats &linkStats() const { return m_linkStats; }
+
+    // Migration : les trames reçues s'accumulent sans être traitées jusqu'à resume()
+    void pause();
+    void resume();
+
+    // Fermeture propre, sans bloquer : les données en attente partent, puis le pair a
+    // CLOSE_TIMEOUT_MS pour acquitter avant abort() ; `disconnected` signale la fin
+    void close();
+    // Arrêt du serveur : attente bornée de la fermeture lancée par close(), abort() au-delà
+    void waitForClosed(QDeadlineTimer deadline);
+    void abort();
+
+signals:
+    void messageReceived(MessageType type, const QJsonObject &content, const QByteArray &canonical);
+    void linkStatsChanged();
+    void disconnected();
+
+private slots:
+    void onReadyRead();
+
+private:
+    void processFrame(QByteArrayView frame);
+    void queueWrite(const QByteArray &bytes, int cellKey = -1, bool urgent = false);
+    void scheduleFlush();
+    void flushWrites();
+    void dropQueuedFrames(qsizetype count);
+    void checkSendBudget();
+    void scheduleDrop(const char *reason);
+    void handleTransportMessage(MessageType type, const QJsonObject &content);
+    void releaseUdp();
+
+    QString m_clientId;
+    QTcpSocket *m_socket;
+    FrameDecoder m_decoder{MAX_FRAME_SIZE};
+    bool m_decoding = false; // Garde contre la réentrance (waitForDisconnected dans un gestionnaire)
+    WireSession m_session;
+    struct QueuedFrame
+    {
+        QByteArray bytes; // Partagé : une seule copie par message diffusé
+        int cellKey;      // GRID_UPDATE fusionnable, -1 sinon
+    };
+    QList<QueuedFrame> m_writeQueue;
+    // Position absolue de la tête de file : les positions des cellules survivent aux envois
+    qint64 m_writeQueueBase = 0;
+    QHash<int, qint64> m_queuedCells; // cellKey -> position absolue du GRID_UPDATE en file
+    qsizetype m_supersededFrames = 0; // Trames remplacées, vidées en place jusqu'à leur envoi
+    qint64 m_queuedBytes = 0;
+    qint64 m_peakQueuedBytes = 0;
+    qint64 m_coalescedFrames = 0;
+    SendQueueLimits m_limits;
+    QElapsedTimer m_overBudgetTimer; // Valide tant que la file dépasse le budget
+    bool m_dropScheduled = false;
+    bool m_flushScheduled = false;
+    LinkStats m_linkStats;
+    bool m_paused = false;
+    UdpChannel *m_udpChannel = nullptr;
+    quint64 m_udpToken = 0;  // 0 : canal non proposé
+    QHostAddress m_udpAddress;
+    quint16 m_udpPort = 0;
+    bool m_udpBound = false; // Adresse UDP du client vérifiée par UDP_BIND
+
+    static constexpr int UDP_FALLBACK_MISSED_PONGS = 2; // Repli sur TCP au-delà
+
+    static constexpr qint64 WRITE_HIGH_WATER = 64 * 1024; // Octets confiés au socket au maximum
+    static constexpr quint32 MAX_FRAME_SIZE = 1024 * 1024;
+};
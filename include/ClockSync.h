@@ -0,0 +1,41 @@
+#pragma once
+#include <QtGlobal>
+#include <array>
+
+/**
+ * @brief Estimation du décalage entre l'horloge locale et l'horloge partagée
+ * L'horloge partagée est l'horloge monotone du serveur. Chaque échange
+ * CLOCK_SYNC fournit quatre instants (façon NTP) ; parmi les derniers
+ * échantillons, celui de plus faible aller-retour donne le décalage retenu,
+ * les échanges retardés par la file d'attente étant les moins fiables.
+ */
+class ClockSync {
+public:
+    static constexpr int WINDOW = 8;
+
+    // Horloge monotone locale en microsecondes
+    static qint64 nowUs();
+
+    void reset();
+    // t0 : envoi client, t1 : réception serveur, t2 : envoi serveur, t3 : réception client
+    void addSample(qint64 t0, qint64 t1, qint64 t2, qint64 t3);
+
+    bool isSynchronized() const { return m_count > 0; }
+    qint64 offsetUs() const { return m_offsetUs; } // Horloge partagée - horloge locale
+    qint64 rttUs() const { return m_rttUs; }
+
+    qint64 toSharedUs(qint64 localUs) const { return localUs + m_offsetUs; }
+    qint64 toLocalUs(qint64 sharedUs) const { return sharedUs - m_offsetUs; }
+
+private:
+    struct Sample {
+        qint64 offsetUs = 0;
+        qint64 rttUs = 0;
+    };
+
+    std::array<Sample, WINDOW> m_samples{};
+    int m_count = 0;
+    int m_next = 0;
+    qint64 m_offsetUs = 0;
+    qint64 m_rttUs = 0;
+};
@@ -1,7 +1,12 @@
 #pragma once
 #include "Protocol.h"
+#include "ClockSync.h"
+#include "LinkStats.h"
+#include "FrameDecoder.h"
 #include <QObject>
 #include <QTcpSocket>
+#include <QUdpSocket>
+#include <QHostAddress>
 #include <QTimer>
 #include <QJsonArray>
 #include <QJsonObject>
@@ -22,6 +27,16 @@ public:
     void requestRoomList();
     void requestRoomState(const QString& roomId);
 
+    // Horloge partagée (celle du serveur), estimée par échanges CLOCK_SYNC
+    const ClockSync& clock() const { return m_clock; }
+
+    // Battement de cœur : PING toutes les `intervalMs`, coupure après `maxMissedPongs` sans réponse
+    void setHeartbeat(int intervalMs, int maxMissedPongs);
+    const LinkStats& linkStats() const { return m_linkStats; }
+
+    // Vrai quand les messages éphémères (mesures, frappes en direct) passent par UDP
+    bool isUdpActive() const { return m_udpBound; }
+
 signals:
     void gridCellUpdated(const GridCell& cell);
     void connected();
@@ -31,6 +46,7 @@ signals:
     void errorOccurred(const QString& error);
     void roomListReceived(const QJsonArray& rooms);        // Signal pour la liste des salles
     void roomStateReceived(const QJsonObject& state);      // Signal pour l'état d'une salle
+    void linkStatsChanged();                               // Nouvelle mesure RTT/gigue/perte
 
 private slots:
     void onConnected();
@@ -38,13 +54,51 @@ private slots:
     void onDataReceived();
     void onSocketError(QAbstractSocket::SocketError error);
     void onPingTimer();
+    void onClockSyncTimer();
+    void flushOutgoing();
+    void onUdpDataReceived();
+    void onUdpBindTimer();
 
 private:
-    void processMessage(const QByteArray& data);
+    void processMessage(QByteArrayView data);
+    void openUdpChannel(const QJsonObject& helloReply);
+    void sendDatagram(const QByteArray& message);
+    void resetUdp();
 
     QTcpSocket* m_socket;
-    QByteArray m_buffer;
+    FrameDecoder m_decoder;
+    bool m_decoding = false;
+    WireSession m_session;
+    // Trames du tour de boucle en cours, écrites en un seul bloc (voir sendMessage)
+    QByteArray m_outgoing;
+    bool m_flushScheduled = false;
     QTimer* m_pingTimer;
+    QTimer* m_clockSyncTimer;
+    ClockSync m_clock;
+    int m_clockProbesSent = 0;
+    LinkStats m_linkStats;
+    int m_maxMissedPongs = DEFAULT_MAX_MISSED_PONGS;
     QString m_serverHost;
     quint16 m_serverPort;
+
+    // Canal UDP proposé par le serveur dans sa réponse HELLO ; TCP en attendant et en repli
+    QUdpSocket* m_udpSocket;
+    QTimer* m_udpBindTimer;
+    QHostAddress m_udpAddress;
+    quint16 m_udpPort = 0;
+    quint64 m_udpToken = 0;
+    int m_udpBindAttempts = 0;
+    bool m_udpBound = false;
+
+    static constexpr int UDP_BIND_INTERVAL_MS = 250;
+    static constexpr int UDP_BIND_ATTEMPTS = 8;
+    static constexpr int UDP_FALLBACK_MISSED_PONGS = 2;
+
+    // Rafale de sondes à la connexion, puis entretien périodique (dérive des horloges)
+    static constexpr int CLOCK_SYNC_BURST = 8;
+    static constexpr int CLOCK_SYNC_BURST_INTERVAL_MS = 50;
+    static constexpr int CLOCK_SYNC_INTERVAL_MS = 5000;
+
+    static constexpr int DEFAULT_HEARTBEAT_INTERVAL_MS = 2000;
+    static constexpr int DEFAULT_MAX_MISSED_PONGS = 5;
 };
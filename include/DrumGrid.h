@@ -1,11 +1,11 @@
 #pragma once
 #include <QWidget>
-#include <QTableWidget>
-#include <QTimer>
 #include <QColor>
 #include <QMap>
 #include <QScrollArea>
 #include "Protocol.h"
+#include "PatternModel.h"
+#include "PatternView.h"
 
 class DrumGrid : public QWidget {
     Q_OBJECT
@@ -17,17 +17,25 @@ public:
     void setupGrid(int instruments = 8, int steps = 16);
     void setInstrumentCount(int instrumentCount);
 
-    // Contrôle de lecture
+    // Contrôle de lecture (le transport est cadencé par l'AudioEngine)
     void setPlaying(bool playing);
     void setTempo(int bpm);
-    void setCurrentStep(int step);
+    bool isPlaying() const { return m_playing; }
+    int getTempo() const { return m_tempo; }
 
     // État de la grille
     bool isCellActive(int row, int col) const;
+    quint64 stepMask(int col) const; // Bit n = instrument n actif sur ce step
     void setCellActive(int row, int col, bool active, const QString& userId = QString());
     QJsonObject getGridState() const;
     void setGridState(const QJsonObject& state);
 
+    // Opérations sur une ligne entière : appliquées localement puis émises en un seul lot
+    void clearRow(int row);
+    void fillRow(int row, int interval = 4);
+    void copyRow(int row);
+    void pasteRow(int row);
+
     // Configuration des instruments
     void setInstrumentNames(const QStringList& names);
 
@@ -42,30 +50,44 @@ public:
 
     // Getters
     int getInstrumentCount() const { return m_instruments; }
+    PatternModel* model() const { return m_model; }
 
 signals:
     void cellClicked(int row, int col, bool active);
-    void stepTriggered(int step, const QList<int>& activeInstruments);
+    // Modification locale groupée (glisser, opérations de ligne), déjà appliquée ; userId vide
+    void batchEdited(const GridBatch& batch);
+    // Clic sur le nom d'un instrument : frappe jouée en direct, sans effet sur la grille
+    void instrumentTriggered(int instrument);
+    void playingChanged(bool playing);
+    void tempoChanged(int bpm);
+    void stepMaskChanged(int step, quint64 instrumentMask);
     void stepCountChanged(int newCount);
     void columnCountChanged(int newCount);
     void instrumentCountChanged(int newCount);
 
 private slots:
     void onCellClicked(int row, int column);
-    void onStepTimer();
+    void onCellDragged(int row, int column);
+    void onDragFinished();
+    void onRowMenuRequested(int row, const QPoint& globalPos);
 
 public slots:
     void applyGridUpdate(const GridCell& cell);
+    void applyGridBatch(const GridBatch& batch);
+    // Notification de step venant du transport audio : affichage uniquement
+    void setCurrentStep(int step);
 
 private:
-    void updateCellAppearance(int row, int col);
     void highlightCurrentStep();
     void updateTableSize();
     void resizeGridForInstruments();
+    void emitAllStepMasks();
+    void applyLocalBatch(const GridBatch& batch);
+    quint64 allStepsMask() const;
 
-    QTableWidget* m_table;
     QScrollArea* m_scrollArea;
-    QTimer* m_stepTimer;
+    PatternModel* m_model;
+    PatternView* m_view;
 
     int m_instruments;
     int m_steps;
@@ -74,14 +96,16 @@ private:
     bool m_playing;
 
     static constexpr int MIN_STEPS = 8;
-    static constexpr int MAX_STEPS = 64;
+    static constexpr int MAX_STEPS = PatternModel::MAX_STEPS;
     static constexpr int DEFAULT_STEPS = 16;
     static constexpr int MIN_INSTRUMENTS = 1;
-    static constexpr int MAX_INSTRUMENTS = 64;
+    static constexpr int MAX_INSTRUMENTS = PatternModel::MAX_INSTRUMENTS;
 
     QStringList m_instrumentNames;
-    QMap<QString, QColor> m_userColors;
 
-    // État des cellules [row][col] -> {active, userId}
-    QMap<QPair<int,int>, QPair<bool,QString>> m_cellStates;
+    // Tracé en cours : état peint et cellules à émettre au relâchement
+    bool m_strokeActive = false;
+    GridBatch m_stroke;
+    quint64 m_rowClipboard = 0;
+    bool m_hasRowClipboard = false;
 };
@@ -3,10 +3,27 @@
 #include <QTcpServer>
 #include <QTcpSocket>
 #include <QMap>
+#include <QHash>
+#include <QSet>
 #include <QTimer>
-#include "MainWindow.h"
+#include <QThread>
+#include <QVector>
 #include "RoomManager.h"
-
+#include "RoomState.h"
+#include "RoomWorker.h"
+#include "ClientConnection.h"
+#include "UdpChannel.h"
+#include "LinkStats.h"
+#include "Protocol.h"
+
+/**
+ * @brief Serveur TCP des sessions
+ * Le thread d'accueil (celui du DrumServer) accepte les connexions et traite
+ * le trafic de lobby avec le RoomManager. Chaque salon est confié à un fil de
+ * travail (RoomWorker, environ un par cœur) : après JOIN_ROOM, la connexion du
+ * client migre vers le thread de son salon, où ses opérations sont traitées
+ * sans attendre les autres salons.
+ */
 class DrumServer : public QObject
 {
     Q_OBJECT
@@ -16,13 +33,20 @@ public:
     explicit DrumServer(QObject *parent = nullptr);
     ~DrumServer();
     void setRoomManager(RoomManager* roomManager);
-    void setHostWindow(MainWindow* window);
+    void setHostUserId(const QString& userId);
+    // Nombre de fils de travail (pris en compte au prochain startListening, 0 : un par cœur)
+    void setWorkerCount(int count);
+    // Fil de travail qui porte le salon (-1 tant qu'aucun membre ne l'y a placé)
+    int workerIndexForRoom(const QString &roomId) const;
 
     bool startListening(quint16 port);
     void stopListening();
     bool isListening() const;
 
     void broadcastMessage(const QByteArray &message);
+    // Diffusion limitée aux membres d'un salon (repli sur broadcastMessage si roomId est vide)
+    // Les opérations de session y sont versionnées dans l'état du salon
+    void broadcastToRoom(const QString &roomId, const QByteArray &message);
     void sendMessageToClient(const QString &clientId, const QByteArray &message);
 
     QStringList getConnectedClients() const;
@@ -36,34 +60,100 @@ public:
 
     QString generateClientId() const;
 
+    // Battement de cœur : PING toutes les `intervalMs`, éviction après `maxMissedPongs` sans réponse
+    void setHeartbeat(int intervalMs, int maxMissedPongs);
+    LinkStats linkStats(const QString &clientId) const;
+    QJsonObject linkStatsJson() const; // clientId -> statistiques (lien et file d'envoi), pour les métriques
+
+    // Budget des files d'envoi : un client qui le dépasse plus de `overBudgetTimeoutMs` est coupé
+    void setSendQueueLimits(qint64 maxBytes, int maxMessages, int overBudgetTimeoutMs);
+    QJsonObject sendQueueStats(const QString &clientId) const; // Relevé du dernier battement de cœur
+
+    // Canal UDP des événements éphémères, sur le numéro de port TCP (pris en compte
+    // au prochain startListening) ; sans lui, tout passe par TCP
+    void setUdpEnabled(bool enabled);
+    bool isUdpEnabled() const { return m_udpEnabled; }
+
+    // État versionné du salon sous forme d'instantané (vide si le salon est inconnu)
+    QJsonObject roomSnapshot(const QString &roomId);
+
 signals:
     void clientConnected(const QString &clientId);
     void clientDisconnected(const QString &clientId);
     void messageReceived(const QByteArray &message, const QString &fromClientId);
     void errorOccurred(const QString &error);
+    void linkStatsUpdated(const QString &clientId);
+    void clientTimedOut(const QString &clientId);
+    // Diffusion destinée à l'utilisateur hôte embarqué (aucun en mode serveur dédié)
+    void hostMessageReceived(const QByteArray &message);
 
 private slots:
     void onNewConnection();
-    void onClientDisconnected();
-    void onClientDataReceived();
     void onPingTimer();
+    void onUserJoinedRoom(const QString &roomId, const User &user);
+    void onUserLeftRoom(const QString &roomId, const QString &userId);
+    void onRoomDeleted(const QString &roomId);
+    void onConnectionReleased(ClientConnection *connection);
+    void onWorkerConnectionClosed(const QString &clientId);
+    void onWorkerLobbyMessage(const QString &clientId, const QByteArray &canonical);
+    void onWorkerLinkStats(const QString &clientId, const LinkStats &stats);
+    void onWorkerQueueStats(const QString &clientId, const QJsonObject &stats);
 
 private:
-    MainWindow* m_hostWindow = nullptr;
-    void processClientMessage(QTcpSocket *client, const QByteArray &data);
-    QString getClientId(QTcpSocket *socket) const;
+    // Emplacement d'une connexion : lobby, en migration, ou index du fil de travail
+    static constexpr int HOME_LOBBY = -1;
+    static constexpr int HOME_TRANSIT = -2;
+
+    void startWorkers();
+    void stopWorkers(); // Lance l'arrêt de tous les fils sans attendre
+    void joinWorkers(); // Attend la fin des fils arrêtés
+    template <typename Func>
+    void onWorker(int index, Func &&func);
+
+    void processLobbyMessage(const QString &clientId, MessageType type, const QJsonObject &content);
+    void adoptLobbyConnection(ClientConnection *connection);
+    void placeConnection(ClientConnection *connection);
+    void rehome(const QString &clientId);
+    void releaseClientState(const QString &clientId);
+    int workerForRoom(const QString &roomId);
 
     void sendInitialRoomList(const QString& clientId);
+    void broadcastRoomList();
+    QString userIdForClient(const QString &clientId) const;
+    QString clientIdForUser(const QString &userId) const;
 
     QTcpServer *m_server;
-    QMap<QString, QTcpSocket *> m_clients;
-    QMap<QTcpSocket*, QByteArray> m_clientBuffers;
+    QHash<QString, ClientConnection *> m_lobby;     // Connexions restées sur le thread d'accueil
+    QHash<QString, int> m_home;                       // clientId -> HOME_* ou index du fil
+    QHash<QString, QList<QByteArray>> m_pendingSends; // Messages pour les connexions en migration
+    std::shared_ptr<Protocol::UserIdTable> m_outgoingIds; // Commune aux connexions du lobby
 
     QTimer *m_pingTimer;
+    UdpChannel *m_udpChannel;
+    bool m_udpEnabled = true;
+
+    QVector<QThread *> m_workerThreads;
+    QVector<RoomWorker *> m_workers;
+    QVector<int> m_workerRoomCounts;
+    QHash<QString, int> m_roomWorker;                 // roomId -> index du fil
+    int m_workerCount = 0;
 
     RoomManager* m_roomManager = nullptr;
-    QMap<QTcpSocket*, QString> m_socketToId;
 
     QMap<QString, QString> m_clientIdToUserId;
+    QHash<QString, QString> m_userIdToClientId;
+
+    // Index d'appartenance aux salons, tenu à jour par les signaux du RoomManager
+    QHash<QString, QString> m_userRoom;            // userId -> roomId
+    QHash<QString, QSet<QString>> m_roomUsers;     // roomId -> userIds
+    QString m_hostUserId;
+
+    QHash<QString, LinkStats> m_linkStats;         // clientId -> mesures du lien
+    int m_heartbeatIntervalMs = DEFAULT_HEARTBEAT_INTERVAL_MS;
+    int m_maxMissedPongs = DEFAULT_MAX_MISSED_PONGS;
+    QHash<QString, QJsonObject> m_queueStats;      // clientId -> profondeur de la file d'envoi
+    SendQueueLimits m_sendQueueLimits;
+    static constexpr int DEFAULT_HEARTBEAT_INTERVAL_MS = 2000;
+    static constexpr int DEFAULT_MAX_MISSED_PONGS = 5;
 
 };
@@ -0,0 +1,48 @@
+#pragma once
+#include <QtGlobal>
+#include <QByteArray>
+#include <QByteArrayView>
+
+class QIODevice;
+
+/**
+ * @brief Découpage des trames reçues sur un tampon circulaire
+ * Les octets du socket sont lus directement dans l'anneau ; chaque trame
+ * complète (préfixe de taille 32 bits big-endian compris) est rendue sous
+ * forme de vue, sans copie ni compactage du tampon. Seule une trame à cheval
+ * sur la fin de l'anneau est recopiée, dans un tampon contigu réutilisé.
+ * Une vue reste valide jusqu'au prochain readFrom(), append() ou clear().
+ */
+class FrameDecoder {
+public:
+    enum class Status {
+        Frame,     // `frame` contient une trame complète
+        NeedMore,  // Trame incomplète : attendre d'autres octets
+        Oversized  // Taille annoncée au-delà de maxFrameSize : flux à abandonner
+    };
+
+    explicit FrameDecoder(quint32 maxFrameSize = 1024 * 1024, qsizetype initialCapacity = 16 * 1024);
+
+    // Lit ce que le périphérique a de disponible, dans la limite d'une trame
+    // maximale en attente (4 + maxFrameSize) ; retourne le nombre d'octets lus.
+    // L'appelant extrait les trames puis relit tant qu'il reste des octets.
+    qint64 readFrom(QIODevice* device);
+    void append(QByteArrayView data);
+
+    Status next(QByteArrayView& frame);
+
+    qsizetype bufferedBytes() const { return qsizetype(m_tail - m_head); }
+    qsizetype capacity() const { return m_ring.size(); }
+    void clear();
+
+private:
+    void reserve(qsizetype needed);
+    void copyOut(qint64 position, char* out, qsizetype size) const;
+    qsizetype indexOf(qint64 position) const { return qsizetype(position & (m_ring.size() - 1)); }
+
+    QByteArray m_ring;    // Taille puissance de deux
+    QByteArray m_scratch; // Trames à cheval sur la fin de l'anneau
+    qint64 m_head = 0;    // Positions absolues de lecture et d'écriture
+    qint64 m_tail = 0;
+    quint32 m_maxFrameSize;
+};
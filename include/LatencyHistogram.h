@@ -0,0 +1,42 @@
+#pragma once
+#include <QtGlobal>
+#include <QJsonObject>
+#include <array>
+
+/**
+ * @brief Histogramme de latences à précision relative constante
+ * Chaque puissance de deux (en µs) est découpée en SUB_BUCKETS classes :
+ * l'erreur sur un percentile reste sous 1/SUB_BUCKETS de la valeur, de la
+ * microseconde à plusieurs jours, pour une taille fixe et sans allocation.
+ */
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 3;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr int MAX_EXPONENT = 40; // 2^40 µs, environ 12 jours
+
+    void record(qint64 valueUs);
+    void merge(const LatencyHistogram& other);
+    void reset();
+
+    quint64 count() const { return m_count; }
+    qint64 minUs() const { return m_count ? m_minUs : -1; }
+    qint64 maxUs() const { return m_count ? m_maxUs : -1; }
+    double meanUs() const { return m_count ? double(m_sumUs) / double(m_count) : 0.0; }
+    // Borne haute de la classe qui contient le percentile `p` (0 - 100), -1 si vide
+    qint64 percentileUs(double p) const;
+
+    QJsonObject toJson() const; // count, min, mean, p50, p90, p99, p99.9, max
+
+private:
+    static constexpr int BUCKETS = SUB_BUCKETS * (MAX_EXPONENT - SUB_BUCKET_BITS + 2);
+
+    static int bucketOf(quint64 valueUs);
+    static qint64 bucketUpperUs(int bucket);
+
+    std::array<quint64, BUCKETS> m_buckets{};
+    quint64 m_count = 0;
+    qint64 m_sumUs = 0;
+    qint64 m_minUs = 0;
+    qint64 m_maxUs = 0;
+};
@@ -0,0 +1,48 @@
+#pragma once
+#include <QtGlobal>
+#include <QJsonObject>
+#include <array>
+
+/**
+ * @brief Statistiques d'un lien mesurées par PING/PONG
+ * Fenêtre glissante des dernières sondes : aller-retour, gigue (lissage
+ * RFC 3550) et taux de perte. Le nombre de PING consécutifs restés sans
+ * réponse sert à détecter les pairs morts (connexions à moitié ouvertes).
+ */
+class LinkStats {
+public:
+    static constexpr int WINDOW = 32;
+
+    void reset();
+
+    // Enregistre l'envoi d'un PING et retourne son numéro de séquence
+    quint32 recordPing(qint64 nowUs);
+    // Faux si la séquence est inconnue (trop ancienne) ou déjà acquittée
+    bool recordPong(quint32 sequence, qint64 nowUs);
+
+    int missedPongs() const { return m_missed; } // PING consécutifs sans réponse
+    int answeredCount() const;
+    qint64 lastRttUs() const { return m_lastRttUs; } // -1 tant qu'aucune réponse
+    double meanRttUs() const;
+    double jitterUs() const { return m_jitterUs; }
+    double lossRatio() const; // 0.0 - 1.0, sur la fenêtre (hors PING en attente)
+
+    QJsonObject toJson() const;
+
+private:
+    struct Probe {
+        quint32 sequence = 0;
+        qint64 sentUs = 0;
+        qint64 rttUs = -1; // -1 : pas (encore) de réponse
+    };
+
+    int latestIndex() const { return (m_next + WINDOW - 1) % WINDOW; }
+
+    std::array<Probe, WINDOW> m_probes{};
+    int m_count = 0;
+    int m_next = 0;
+    quint32 m_nextSequence = 1;
+    int m_missed = 0;
+    qint64 m_lastRttUs = -1;
+    double m_jitterUs = 0.0;
+};
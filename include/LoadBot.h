@@ -0,0 +1,69 @@
+#pragma once
+#include <QObject>
+#include <QTimer>
+#include <QHash>
+#include <QBitArray>
+#include <QJsonArray>
+#include "DrumClient.h"
+#include "Protocol.h"
+
+/**
+ * @brief Client simulé de beebee-loadgen
+ * Un DrumClient sans interface : le meneur d'un groupe crée le salon, les
+ * autres le rejoignent dès qu'il apparaît dans la liste. Une fois dans le
+ * salon, le bot bascule des cellules à cadence fixe et horodate chaque envoi ;
+ * les GRID_UPDATE reçus sont remontés avec leur instant de réception. Tous les
+ * bots vivent dans le même processus : les horodatages sont comparables.
+ */
+class LoadBot : public QObject
+{
+    Q_OBJECT
+
+public:
+    LoadBot(int index, const QString &roomName, bool leader, int roomSize, QObject *parent = nullptr);
+
+    QString userId() const { return m_userId; }
+    bool isInRoom() const { return m_inRoom; }
+    bool isConnected() const { return m_client->isConnected(); }
+
+    void start(const QString &host, quint16 port);
+    void stop();
+
+    // Modifications par seconde ; la cadence démarre à l'entrée dans le salon
+    void setEditRate(double editsPerSecond);
+    void setGridSize(int rows, int cols);
+
+    // Instant d'envoi (µs, ClockSync::nowUs) de la dernière modification de la cellule, -1 si aucune
+    qint64 sentAtUs(int row, int col) const { return m_sentAtUs.value(row * GridCell::MAX_COLS + col, -1); }
+    quint64 editsSent() const { return m_editsSent; }
+
+signals:
+    void joinedRoom();
+    void gridUpdateReceived(const GridCell &cell, qint64 receivedUs);
+    void connectionLost();
+
+private slots:
+    void onConnected();
+    void onRoomListReceived(const QJsonArray &rooms);
+    void onRoomStateReceived(const QJsonObject &state);
+    void onGridCellUpdated(const GridCell &cell);
+    void onEditTimer();
+
+private:
+    void enterRoom();
+
+    DrumClient *m_client;
+    QTimer *m_editTimer;
+    int m_index;
+    QString m_userId;
+    QString m_roomName;
+    bool m_leader;
+    int m_roomSize;
+    bool m_roomRequested = false;
+    bool m_inRoom = false;
+    int m_rows = 8;
+    int m_cols = 16;
+    QBitArray m_active;               // État supposé des cellules, pour alterner
+    QHash<int, qint64> m_sentAtUs;    // row * MAX_COLS + col -> instant d'envoi
+    quint64 m_editsSent = 0;
+};
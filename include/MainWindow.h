@@ -50,10 +50,13 @@ private slots:
     void onRemoveColumnClicked();
     void onStepCountChanged(int newCount);
     void reloadAudioSamples();
+    void exportPatternToWav();
+    void exportStemsToWav();
 
     // Grille
     void onGridCellClicked(int row, int col, bool active);
-    void onStepTriggered(int step, const QList<int>& activeInstruments);
+    void onGridBatchEdited(const GridBatch &batch);
+    void onInstrumentTriggered(int instrument);
 
     // Gestion des salons
     void onCreateRoomRequested(const QString& name, const QString& password, int maxUsers);
@@ -74,6 +77,8 @@ private slots:
     void onConnectionEstablished();
     void onConnectionLost();
     void onNetworkError(const QString& error);
+    void onLinkStatsChanged();
+    void updateVoiceStats();
 
     // Méthode Utilitaire
     void centerWindow();
@@ -113,6 +118,8 @@ private:
     void updateRoomDisplay();
     void syncGridWithNetwork();
     void handleNetworkMessage(MessageType type, const QJsonObject& data);
+    void noteRoomRevision(const QJsonObject& data);
+    void applySharedTransport(const QJsonObject& data, int bpm);
     void switchToGameMode();
     void switchToLobbyMode();
 
@@ -152,9 +159,22 @@ private:
     QString m_currentRoomId;
     bool m_inGameMode;
 
+    // Dernière révision connue de l'état du salon (-1 : instantané complet requis)
+    QString m_revisionRoomId;
+    qint64 m_roomRevision = -1;
+    quint32 m_roomEpoch = 0;
+
+    // Délai entre l'envoi de PLAY_STATE et le step 0 : le message doit atteindre
+    // tous les participants avant l'instant de départ commun
+    static constexpr qint64 PLAY_START_LEAD_US = 150000;
+
     // Widgets pour les contrôles de colonnes et instruments
     QPushButton* m_addColumnBtn;
     QPushButton* m_removeColumnBtn;
     QLabel* m_stepCountLabel;
     QLabel* m_instrumentCountLabel;
+
+    // Occupation du pool de voix du mixeur (barre d'état)
+    QLabel* m_voiceStatsLabel = nullptr;
+    static constexpr int VOICE_STATS_INTERVAL_MS = 500;
 };
@@ -0,0 +1,30 @@
+#pragma once
+#include <QtGlobal>
+
+/**
+ * @brief Noyaux de calcul du mixeur (accumulation, gain/panoramique par voix,
+ * rampe de gain, conversion int16)
+ * Versions AVX2 et SSE2 choisies une fois au démarrage selon le processeur,
+ * version scalaire ailleurs. Aucun alignement n'est exigé. Les tampons sont
+ * des floats entrelacés ; `count` compte des échantillons, pas des frames.
+ */
+namespace MixKernels {
+
+// out[n] += in[n]
+void mix(float* out, const float* in, qint64 count);
+
+// Accumulation d'une voix stéréo avec ses gains gauche/droite (volume et
+// panoramique) : out[2f] += in[2f] * left, out[2f+1] += in[2f+1] * right
+void mixStereo(float* out, const float* in, qint64 frames, float left, float right);
+
+// Gain passant linéairement de `from` à `to` sur le bloc stéréo (pas de
+// "zipper" quand le volume change) ; gain constant si from == to
+void applyGainRamp(float* buffer, qint64 frames, float from, float to);
+
+// Conversion saturée vers int16 : [-1, 1] -> [-32767, 32767], troncature vers zéro
+void floatToInt16(qint16* out, const float* in, qint64 count);
+
+// "avx2", "sse2" ou "scalar"
+const char* implementationName();
+
+} // namespace MixKernels
@@ -36,9 +36,20 @@ public:
     // Communication
     void sendMessage(const QByteArray &message);
     void broadcastMessage(const QByteArray &message); // Serveur uniquement
+    void broadcastToRoom(const QString &roomId, const QByteArray &message); // Membres du salon uniquement
 
     // État - inline functions pour éviter les redéfinitions
     bool isServer() const { return m_isServer; }
+
+    // Horloge partagée (horloge monotone du serveur, en µs) : l'hôte la lit
+    // directement, un client applique le décalage estimé par son DrumClient
+    qint64 sharedClockUs() const;
+    qint64 sharedToLocalUs(qint64 sharedUs) const;
+    qint64 localToSharedUs(qint64 localUs) const;
+
+    // Mesures du lien (RTT, gigue, perte) : celles du serveur côté client,
+    // celles de chaque client (clientId -> mesures) côté hôte
+    QJsonObject linkStats() const;
     QString getUserId() const { return m_userId; }
     void setUserId(const QString &userId) { m_userId = userId; }
 
@@ -50,6 +61,7 @@ signals:
     void connectionEstablished();
     void connectionLost();
     void errorOccurred(const QString &error);
+    void linkStatsChanged();
 
 private:
     DrumServer *m_server;
@@ -0,0 +1,86 @@
+#pragma once
+#include <QJsonObject>
+#include <QString>
+#include <QVector>
+#include <array>
+#include "SampleDecoder.h"
+
+class QIODevice;
+
+/**
+ * @brief Rendu hors ligne d'un motif vers un fichier WAV
+ * Pilote un AudioMixer sans QAudioSink : les blocs sont rendus aussi vite
+ * que le processeur le permet, avec le même séquenceur et les mêmes samples
+ * que la lecture en direct. Le motif est l'état de DrumGrid::getGridState().
+ * En mode pistes séparées, chaque ligne de la grille est rendue dans son
+ * propre fichier, sur son propre thread ; les samples sont partagés en lecture.
+ */
+class OfflineRenderer {
+public:
+    enum class WavFormat { Int16, Int24, Float32 };
+
+    struct Result {
+        qint64 frames = 0;      // Frames écrites (boucles et queue des sons)
+        qint64 elapsedUs = 0;   // Durée du rendu et de l'écriture
+        double durationSeconds() const;
+        double realtimeFactor() const; // Secondes de son rendues par seconde de calcul
+    };
+
+    struct StemResult {
+        int instrumentId = -1;
+        QString filePath;
+        Result result;
+        QString errorString; // Vide si la piste a été écrite
+    };
+
+    void setSamples(const QVector<SampleBufferPtr>& samples) { m_samples = samples; }
+    // Groupes d'étouffement par instrument, comme en lecture (AudioEngine::chokeGroups)
+    void setChokeGroups(const QVector<int>& groups) { m_chokeGroups = groups; }
+    // Cellules, nombre de steps et tempo ; accepte aussi l'instantané compact du serveur
+    void setGridState(const QJsonObject& state);
+    void setTempo(double bpm);
+    void setLoops(int loops) { m_loops = qMax(1, loops); }
+    void setFormat(WavFormat format) { m_format = format; }
+    // Laisser sonner les voix encore actives après la dernière boucle
+    void setIncludeTail(bool includeTail) { m_includeTail = includeTail; }
+    void setGain(float gain) { m_gain = gain; }
+
+    double tempo() const { return m_bpm; }
+    int stepCount() const { return m_stepCount; }
+    qint64 loopFrames() const;
+
+    bool renderToFile(const QString& filePath, Result* result = nullptr, QString* errorString = nullptr) const;
+    // Le périphérique doit être ouvert en écriture et permettre de revenir à l'en-tête
+    bool render(QIODevice* device, Result* result = nullptr, QString* errorString = nullptr) const;
+
+    // Un WAV par ligne ayant au moins une cellule active, rendus en parallèle
+    // (un thread par piste, au plus un par cœur). `total` cumule les frames de
+    // toutes les pistes sur la durée de l'export : son débit global.
+    bool renderStems(const QString& directory, const QStringList& instrumentNames,
+                     QVector<StemResult>* stems = nullptr, Result* total = nullptr,
+                     QString* errorString = nullptr) const;
+
+    static bool parseFormat(const QString& name, WavFormat* format);
+    static QString stemFileName(int instrumentId, const QString& name);
+
+    static constexpr int MAX_STEPS = 64;
+    static constexpr int BLOCK_FRAMES = 4096;
+    static constexpr int MAX_TAIL_SECONDS = 10;
+
+private:
+    static QByteArray wavHeader(WavFormat format, qint64 dataBytes);
+    static int bytesPerSample(WavFormat format);
+    void encode(const float* input, qint64 frames, QByteArray& output) const;
+
+    QVector<SampleBufferPtr> m_samples;
+    QVector<int> m_chokeGroups;
+    std::array<quint64, MAX_STEPS> m_stepMasks{};
+    int m_stepCount = 16;
+    int m_instrumentCount = 0;
+    int m_soloInstrument = -1; // Piste séparée : seul cet instrument est rendu
+    double m_bpm = 120.0;
+    int m_loops = 1;
+    WavFormat m_format = WavFormat::Int16;
+    bool m_includeTail = true;
+    float m_gain = 0.7f;
+};
@@ -0,0 +1,93 @@
+#pragma once
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QtAlgorithms>
+#include <array>
+#include "Protocol.h"
+
+/**
+ * @brief Modèle du motif rythmique, indépendant de tout widget
+ * Un masque 64 bits par step (bit n = instrument n actif) : savoir quels
+ * instruments jouent sur un step est une simple lecture. Le propriétaire de
+ * chaque cellule active est stocké comme index dans une table d'identifiants
+ * internés plutôt que comme QString.
+ */
+class PatternModel : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int MAX_STEPS = 64;
+    static constexpr int MAX_INSTRUMENTS = 64;
+
+    explicit PatternModel(QObject* parent = nullptr);
+
+    // Dimensions ; les cellules hors limites sont effacées (sans signal, l'appelant rafraîchit)
+    void resize(int instruments, int steps);
+    void clear();
+    int instrumentCount() const { return m_instruments; }
+    int stepCount() const { return m_steps; }
+
+    bool isActive(int row, int col) const;
+    quint64 stepMask(int col) const;
+    quint64 rowMask(int row) const; // Bit n = step n actif pour cet instrument
+    QString owner(int row, int col) const;
+    void setCell(int row, int col, bool active, const QString& userId = QString());
+    // Modification groupée : un seul cellsChanged, stepMaskChanged par step modifié
+    void applyBatch(const GridBatch& batch);
+
+    // Appelle f(row, col) pour chaque cellule active appartenant à userId
+    template <typename F>
+    void forEachCellOwnedBy(const QString& userId, F f) const;
+
+    // Sérialisation des cellules actives : [{row, col, active, userId}, ...]
+    QJsonArray activeCellsToJson() const;
+    void loadCells(const QJsonArray& cells);
+    // Forme compacte : {"owners": [ids], "cells": [row | col << 6 | owner << 12, ...]}
+    // où owner est l'index dans "owners" plus un (0 = aucun propriétaire)
+    QJsonObject compactCellsToJson() const;
+    void loadCompactCells(const QJsonObject& compact);
+
+signals:
+    void cellChanged(int row, int col);
+    void cellsChanged(); // Plusieurs cellules à la fois (lot, chargement)
+    void stepMaskChanged(int step, quint64 instrumentMask);
+
+private:
+    quint16 internOwner(const QString& userId);
+    // Écrit une cellule sans notifier ; vrai si son apparence a changé
+    bool writeCell(int row, int col, bool active, quint16 owner);
+    // Exécute `writes` (appels à writeCell) puis notifie une seule fois
+    template <typename F>
+    void writeCells(F writes);
+    static int cellIndex(int row, int col) { return col * MAX_INSTRUMENTS + row; }
+    bool inRange(int row, int col) const {
+        return row >= 0 && row < m_instruments && col >= 0 && col < m_steps;
+    }
+
+    std::array<quint64, MAX_STEPS> m_masks{};
+    std::array<quint16, MAX_STEPS * MAX_INSTRUMENTS> m_owners{}; // 0 = aucun propriétaire
+    QStringList m_ownerIds;                  // Index n -> identifiant (n >= 1)
+    QHash<QString, quint16> m_ownerIndex;
+    int m_instruments;
+    int m_steps;
+};
+
+template <typename F>
+void PatternModel::forEachCellOwnedBy(const QString& userId, F f) const {
+    const quint16 owner = m_ownerIndex.value(userId, 0);
+    if (owner == 0) {
+        return;
+    }
+    for (int col = 0; col < m_steps; ++col) {
+        for (quint64 bits = m_masks[col]; bits; bits &= bits - 1) {
+            const int row = qCountTrailingZeroBits(bits);
+            if (m_owners[cellIndex(row, col)] == owner) {
+                f(row, col);
+            }
+        }
+    }
+}
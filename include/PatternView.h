@@ -0,0 +1,82 @@
+#pragma once
+#include <QWidget>
+#include <QPixmap>
+#include <QColor>
+#include <QFont>
+#include <QHash>
+#include <QMap>
+#include <QStringList>
+#include "PatternModel.h"
+
+/**
+ * @brief Vue de la grille peinte directement depuis le PatternModel
+ * Aucun objet par cellule : chaque état (vide, actif, actif sous la tête de
+ * lecture) est rendu une fois dans un pixmap mis en cache, puis recopié.
+ * Un changement de step ne repeint que l'ancienne et la nouvelle colonne.
+ * Un glisser bouton enfoncé peint les cellules survolées (cellDragged).
+ */
+class PatternView : public QWidget {
+    Q_OBJECT
+
+public:
+    static constexpr int CELL_SIZE = 40;
+    static constexpr int HEADER_WIDTH = 110;
+    static constexpr int HEADER_HEIGHT = 30;
+
+    explicit PatternView(PatternModel* model, QWidget* parent = nullptr);
+
+    // A appeler après un redimensionnement du modèle
+    void updateGeometryFromModel();
+    void setInstrumentNames(const QStringList& names);
+    void setUserColor(const QString& userId, const QColor& color);
+
+    // Tête de lecture : -1 si aucune colonne n'est mise en évidence
+    void setPlayhead(int step);
+    int playhead() const { return m_playhead; }
+
+    // Géométrie en coordonnées du widget (en-têtes compris)
+    QRect cellRect(int row, int col) const;
+    QRect columnRect(int col) const;
+
+    QSize sizeHint() const override;
+
+signals:
+    void cellClicked(int row, int col);
+    void cellDragged(int row, int col); // Nouvelle cellule survolée pendant le glisser
+    void dragFinished();
+    void rowMenuRequested(int row, const QPoint& globalPos); // Clic droit sur un nom d'instrument
+    void rowHeaderClicked(int row); // Clic gauche sur un nom d'instrument : frappe en direct
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void mousePressEvent(QMouseEvent* event) override;
+    void mouseMoveEvent(QMouseEvent* event) override;
+    void mouseReleaseEvent(QMouseEvent* event) override;
+    void contextMenuEvent(QContextMenuEvent* event) override;
+
+private:
+    enum class CellKind : quint8 {
+        Empty,
+        EmptyBeat,    // Premier step d'un temps (col % 4 == 0)
+        Active,
+        ActivePlaying // Cellule active sous la tête de lecture
+    };
+
+    void onCellChanged(int row, int col);
+    bool cellAt(const QPoint& pos, int& row, int& col) const;
+    int headerRowAt(const QPoint& pos) const; // -1 hors des noms d'instruments
+    const QPixmap& cellPixmap(CellKind kind, const QColor& color);
+    QPixmap renderCell(CellKind kind, const QColor& color) const;
+    QString instrumentName(int row) const;
+
+    PatternModel* m_model;
+    QStringList m_instrumentNames;
+    QMap<QString, QColor> m_userColors;
+    int m_playhead = -1;
+    int m_dragCell = -1; // row * MAX_STEPS + col de la dernière cellule peinte, -1 hors glisser
+
+    // Clé : (type de cellule << 32) | couleur ARGB ; vidé si le DPI change
+    QHash<quint64, QPixmap> m_pixmapCache;
+    qreal m_cacheRatio = 0.0;
+    QFont m_headerFont;
+};
@@ -5,6 +5,11 @@
     #include <QJsonArray>
     #include <QDateTime>
     #include <QString>
+    #include <QByteArrayView>
+    #include <QHash>
+    #include <QVector>
+    #include <QSet>
+    #include <memory>
 
     // Forward declarations
     struct User;
@@ -39,7 +44,28 @@
         USER_INFO,
 
         // Erreurs
-        ERROR_MESSAGE
+        ERROR_MESSAGE,
+
+        // Transport (ajoutés en fin : les valeurs numériques servent
+        // d'octet de type dans l'encodage binaire)
+        HELLO,
+        USER_ALIAS, // Définit l'index court d'un identifiant utilisateur sur une connexion
+        CLOCK_SYNC, // Échange d'horodatages pour estimer le décalage d'horloge
+        PING,       // Battement de cœur : mesure du lien et détection des pairs morts
+        PONG,
+
+        // Session de jeu (suite)
+        GRID_BATCH, // Modification groupée de cellules, appliquée d'un bloc
+
+        // Canal UDP (événements éphémères, voir UdpChannel)
+        UDP_BIND,   // Ouverture du canal : le client prouve qu'il reçoit à cette adresse
+        PAD_HIT     // Frappe jouée en direct sur un instrument, sans effet sur la grille
+    };
+
+    // Format d'encodage du corps des messages (le préfixe de taille est commun)
+    enum class WireFormat {
+        Json,   // Lisible, mode debug et compatibilité
+        Binary  // Octet magique 0xBB, type sur un octet, varints, CBOR en repli
     };
 
     struct GridCell {
@@ -57,6 +83,14 @@
             return obj;
         }
 
+        // Bornes de la grille (DrumGrid::MAX_INSTRUMENTS x DrumGrid::MAX_STEPS)
+        static constexpr int MAX_ROWS = 64;
+        static constexpr int MAX_COLS = 64;
+
+        bool isValid() const {
+            return row >= 0 && row < MAX_ROWS && col >= 0 && col < MAX_COLS;
+        }
+
         static GridCell fromJson(const QJsonObject& obj) {
             GridCell cell;
             cell.row = obj["row"].toInt();
@@ -67,10 +101,97 @@
         }
     };
 
+    /**
+     * @brief Modification groupée de la grille (message GRID_BATCH)
+     * Les masques sont appliqués d'abord, dans l'ordre (effacement puis
+     * activation), puis les cellules isolées. Les cellules activées
+     * appartiennent à `userId`. Une opération sur une ligne entière (effacer,
+     * remplir un pas sur quatre, coller) tient dans un seul masque.
+     */
+    struct GridBatch {
+        struct Mask {
+            bool column = false; // Vrai : bits = instruments du step `index` ; faux : bits = steps de la ligne `index`
+            int index = 0;
+            quint64 set = 0;
+            quint64 clear = 0;
+        };
+
+        QString userId;
+        QVector<quint16> cells; // row | col << 6 | active << 12
+        QVector<Mask> masks;
+
+        static constexpr int MAX_CELLS = GridCell::MAX_ROWS * GridCell::MAX_COLS;
+        static constexpr int MAX_MASKS = GridCell::MAX_ROWS + GridCell::MAX_COLS;
+
+        void addCell(int row, int col, bool active) {
+            cells.append(quint16(row | (col << 6) | (active ? 1 << 12 : 0)));
+        }
+        static int cellRow(quint16 packed) { return packed & 0x3F; }
+        static int cellCol(quint16 packed) { return (packed >> 6) & 0x3F; }
+        static bool cellActive(quint16 packed) { return packed & (1 << 12); }
+
+        bool isEmpty() const { return cells.isEmpty() && masks.isEmpty(); }
+        // {"userId", "cells": [packed], "masks": [{"row" | "col", "set", "clear"}]}
+        QJsonObject toJson() const;
+        // Faux si le contenu est mal formé ou hors des bornes de la grille
+        static bool fromJson(const QJsonObject& obj, GridBatch& batch);
+    };
+
     class Protocol {
     public:
+        // Table d'internement des identifiants utilisateur : les UUID de 38
+        // caractères deviennent de petits entiers, définis par USER_ALIAS
+        struct UserIdTable {
+            QHash<QString, quint32> indices;
+            QVector<QString> ids;
+
+            int intern(const QString& userId); // -1 si la table est pleine
+            bool define(quint32 index, const QString& userId);
+        };
+
+        static constexpr quint8 BINARY_MAGIC = 0xBB;
+        static constexpr int PROTOCOL_VERSION = 1;
+        static constexpr int MAX_INTERNED_USER_IDS = 4096;
+
+        // Encode dans le format par défaut du processus (voir defaultFormat)
         static QByteArray createMessage(MessageType type, const QJsonObject& data);
-        static bool parseMessage(const QByteArray& data, MessageType& type, QJsonObject& content);
+        static QByteArray encodeMessage(MessageType type, const QJsonObject& data,
+                                        WireFormat format, UserIdTable* outIds = nullptr);
+        // Détecte automatiquement JSON ou binaire ; `data` peut être une vue sur le
+        // tampon de réception (FrameDecoder), rien n'est copié avant le décodage
+        static bool parseMessage(QByteArrayView data, MessageType& type, QJsonObject& content,
+                                 const UserIdTable* inIds = nullptr);
+        static WireFormat frameFormat(QByteArrayView frame);
+        // Vrai si la trame binaire contient un identifiant utilisateur internable
+        static bool carriesUserId(QByteArrayView frame);
+        // Forme sans état d'une trame reçue, à conserver ou transmettre au-delà de la connexion
+        static QByteArray canonicalFrame(QByteArrayView frame, MessageType type, const QJsonObject& content);
+        // Vrai pour les messages de mesure (PING, PONG, CLOCK_SYNC) : envoyés sans
+        // attendre la fin du tour de boucle, leur horodatage ne doit pas vieillir
+        static bool isLatencyCritical(QByteArrayView frame);
+        // Vrai pour les messages qui peuvent passer par le canal UDP : mesures et
+        // frappes en direct, dont la perte est sans conséquence sur l'état partagé
+        static bool isTransient(QByteArrayView frame);
+
+        // Datagramme UDP : jeton de session (64 bits big-endian) suivi d'une trame
+        static constexpr qsizetype DATAGRAM_TOKEN_SIZE = 8;
+        static constexpr qsizetype MAX_DATAGRAM_SIZE = 1200; // Sous la MTU courante
+        static QByteArray createDatagram(quint64 token, const QByteArray& frame);
+        // Faux si le datagramme n'est pas exactement un jeton suivi d'une trame complète
+        static bool splitDatagram(QByteArrayView datagram, quint64& token, QByteArrayView& frame);
+
+        // Binaire par défaut ; BEEBEE_WIRE_FORMAT=json force le JSON (debug)
+        static WireFormat defaultFormat();
+        static void setDefaultFormat(WireFormat format);
+        static QString wireFormatToString(WireFormat format);
+        static bool wireFormatFromString(const QString& str, WireFormat& format);
+
+        // Négociation : le client annonce ses formats, le serveur répond avec son choix
+        static QByteArray createHelloMessage();
+        // `udpPort` et `udpToken` (0 = pas de canal UDP) ouvrent le canal d'événements éphémères
+        static QByteArray createHelloReplyMessage(WireFormat chosen, quint16 udpPort = 0, quint64 udpToken = 0);
+        static QByteArray createUserAliasMessage(quint32 index, const QString& userId);
+
         static QByteArray createRoomInfoRequestMessage(const QJsonObject& data);
 
         static QByteArray createColumnUpdateMessage(int columnCount);
@@ -90,10 +211,23 @@
         // Messages existants
         static QByteArray createJoinMessage(const QString& userName);
         static QByteArray createGridUpdateMessage(const GridCell& cell);
-        static QByteArray createTempoMessage(int bpm);
-        static QByteArray createPlayStateMessage(bool playing);
-        static QByteArray createSyncRequestMessage();
+        static QByteArray createGridBatchMessage(const GridBatch& batch);
+        // Transport partagé : `at` est un instant de l'horloge partagée (µs, -1 si absent)
+        // et `step` la position du séquenceur, en steps, à cet instant
+        static QByteArray createTempoMessage(int bpm, qint64 at = -1, double step = 0.0);
+        static QByteArray createPlayStateMessage(bool playing, qint64 at = -1, double step = 0.0);
+        // Sonde d'horloge (t0) et réponse du serveur (t0 renvoyé, t1 réception, t2 envoi)
+        static QByteArray createClockSyncRequestMessage(qint64 t0);
+        static QByteArray createClockSyncReplyMessage(qint64 t0, qint64 t1, qint64 t2);
+        static QByteArray createPingMessage(quint32 sequence);
+        static QByteArray createPongMessage(quint32 sequence);
+        static QByteArray createUdpBindMessage();
+        static QByteArray createPadHitMessage(int instrument, const QString& userId);
+        // Resynchronisation : révision et époque déjà connues (-1 = instantané complet)
+        static QByteArray createSyncRequestMessage(qint64 sinceRevision = -1, quint32 epoch = 0);
         static QByteArray createSyncResponseMessage(const QJsonObject& gridState);
+        // Fin d'un rattrapage par opérations : le client est à jour à `revision`
+        static QByteArray createSyncDeltaEndMessage(qint64 revision, quint32 epoch);
 
         // Nouveau message pour synchroniser les instruments
         static QByteArray createInstrumentSyncMessage(const QStringList& instrumentNames);
@@ -101,4 +235,72 @@
         // Fonctions utilitaires
         static QString messageTypeToString(MessageType type);
         static MessageType stringToMessageType(const QString& str);
+
+    private:
+        static QByteArray frameBody(const QByteArray& body);
+        static QByteArray encodeBinaryBody(MessageType type, const QJsonObject& data, UserIdTable* outIds);
+        static bool parseBinaryBody(const char* body, qsizetype size, MessageType& type,
+                                    QJsonObject& content, const UserIdTable* inIds);
+    };
+
+    /**
+     * @brief Message sortant partagé entre plusieurs destinataires
+     * Chaque variante d'encodage n'est produite qu'une seule fois ; les QByteArray
+     * (implicitement partagés) sont ensuite placés tels quels dans les files
+     * d'écriture de toutes les connexions.
+     */
+    class OutgoingFrame {
+    public:
+        explicit OutgoingFrame(const QByteArray& canonical) : m_canonical(canonical) {}
+
+        const QByteArray& canonical() const { return m_canonical; }
+        // En binaire, l'identifiant utilisateur est remplacé par son index dans
+        // `outIds` ; `userIdIndex` reçoit cet index (-1 si aucun)
+        QByteArray encoded(WireFormat format, Protocol::UserIdTable* outIds, int* userIdIndex = nullptr);
+        // Cellule visée par un GRID_UPDATE (row * MAX_COLS + col), -1 pour les autres messages
+        int gridCellKey();
+
+    private:
+        bool parse();
+
+        QByteArray m_canonical;
+        QByteArray m_json;
+        QByteArray m_binary;
+        Protocol::UserIdTable* m_binaryTable = nullptr;
+        int m_userIdIndex = -1;
+        int m_parseState = 0; // 0 = pas encore tenté, 1 = réussi, -1 = échec
+        MessageType m_type = MessageType::ERROR_MESSAGE;
+        QJsonObject m_content;
+    };
+
+    /**
+     * @brief État d'encodage d'une connexion
+     * Les messages sont créés sous forme canonique (Protocol::create*, sans état) ;
+     * la session les convertit au format négocié et gère l'internement des
+     * identifiants utilisateur dans chaque sens.
+     */
+    class WireSession {
+    public:
+        WireSession();
+
+        WireFormat format() const { return m_format; }
+        void setFormat(WireFormat format) { m_format = format; }
+        // Le serveur partage une seule table entre toutes ses connexions, ce qui
+        // permet d'encoder une diffusion une seule fois pour tous les destinataires
+        void setOutgoingIdTable(std::shared_ptr<Protocol::UserIdTable> table);
+
+        // Message canonique -> octets à écrire sur cette connexion
+        QByteArray encode(const QByteArray& frame);
+        // `definesAlias` : vrai si une définition USER_ALIAS précède le message
+        QByteArray encode(OutgoingFrame& frame, bool* definesAlias = nullptr);
+        // Octets reçus sur cette connexion -> message ; `canonical` reçoit une forme
+        // sans état, lisible par Protocol::parseMessage (pour les autres composants)
+        bool decode(QByteArrayView frame, MessageType& type, QJsonObject& content,
+                    QByteArray* canonical = nullptr);
+
+    private:
+        WireFormat m_format = WireFormat::Json; // JSON jusqu'à la fin de la négociation
+        std::shared_ptr<Protocol::UserIdTable> m_outIds;
+        QSet<quint32> m_sentAliases;             // Index déjà définis chez le pair
+        Protocol::UserIdTable m_inIds;
     };
@@ -7,7 +7,6 @@
 #include <QDateTime>
 #include <QJsonArray>
 #include <QList>
-#include <QColor>
 #include <QMap>
 #include <qjsonarray.h>
 
@@ -17,13 +16,13 @@ struct User {
     bool isHost;
     bool isOnline;
     QDateTime joinTime;
-    QColor color;
+    QString color; // "#rrggbb" : pas de QtGui, le serveur dédié n'en dépend pas
 
     QJsonObject toJson() const {
         QJsonObject obj;
         obj["id"] = id;
         obj["name"] = name;
-        obj["color"] = color.name();
+        obj["color"] = color;
         obj["isHost"] = isHost;
         obj["joinTime"] = joinTime.toString(Qt::ISODate);
         obj["isOnline"] = isOnline;
@@ -37,7 +36,7 @@ struct User {
         user.isHost = obj["isHost"].toBool();
         user.isOnline = obj["isOnline"].toBool();
         user.joinTime = QDateTime::fromString(obj["joinTime"].toString(), Qt::ISODate);
-        user.color = QColor(obj["color"].toString());
+        user.color = obj["color"].toString();
         return user;
     }
 
@@ -111,5 +110,5 @@ private:
     QDateTime m_createdTime;
     QMap<QString, User> m_users;
 
-    QColor generateUserColor() const;
+    QString generateUserColor() const;
 };
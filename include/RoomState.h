@@ -0,0 +1,70 @@
+#pragma once
+#include <QObject>
+#include <QByteArray>
+#include <QJsonObject>
+#include <QList>
+#include <QStringList>
+#include "Protocol.h"
+#include "PatternModel.h"
+
+/**
+ * @brief État versionné d'un salon, tenu par le serveur
+ * Chaque opération de session acceptée (cellule ou lot, colonnes, tempo, lecture,
+ * instruments) incrémente la révision et est conservée dans un journal borné,
+ * sous forme de trame prête à l'envoi. Un client qui se resynchronise reçoit
+ * les trames qui lui manquent, ou un instantané compact si le journal ne
+ * remonte plus jusqu'à sa révision.
+ */
+class RoomState : public QObject {
+    Q_OBJECT
+
+public:
+    static constexpr int MAX_LOG_OPS = 512;
+
+    explicit RoomState(QObject* parent = nullptr);
+
+    // Types de messages qui modifient l'état et passent par le journal
+    static bool isStateOp(MessageType type);
+    // Validation d'une opération reçue d'un client avant son entrée dans le journal
+    // (ou avant son relais, pour les frappes en direct qui n'y entrent pas) :
+    // cellules, masques et instruments doivent tomber dans la grille courante
+    bool isValidOp(MessageType type, const QJsonObject& content) const;
+
+    int instrumentCount() const { return m_pattern->instrumentCount(); }
+    int stepCount() const { return m_pattern->stepCount(); }
+
+    qint64 revision() const { return m_revision; }
+    // Change à chaque création : une révision n'a de sens que dans son époque
+    quint32 epoch() const { return m_epoch; }
+
+    // Applique l'opération et retourne la trame canonique estampillée ("rev")
+    QByteArray commit(MessageType type, const QJsonObject& content);
+    // Remplace tout l'état (instantané de l'hôte) ; le journal repart de zéro
+    void loadSnapshot(const QJsonObject& snapshot);
+
+    // Trames postérieures à `since` ; faux si le journal ne couvre plus cette révision
+    bool framesSince(qint64 since, quint32 epoch, QList<QByteArray>& frames) const;
+    QJsonObject snapshot() const;
+
+private:
+    struct LogEntry {
+        qint64 revision;
+        QByteArray frame;
+    };
+
+    void apply(MessageType type, const QJsonObject& content);
+    bool isInGrid(int row, int col) const;
+
+    PatternModel* m_pattern;
+    int m_tempo = 120;
+    bool m_playing = false;
+    QStringList m_instrumentNames;
+
+    // Dernière ancre de transport (horloge partagée), pour les arrivées en cours de lecture
+    qint64 m_transportAt = -1;
+    double m_transportStep = 0.0;
+
+    quint32 m_epoch;
+    qint64 m_revision = 0;
+    QList<LogEntry> m_log; // Révisions consécutives, la plus ancienne en tête
+};
@@ -0,0 +1,91 @@
+#pragma once
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+#include <QThread>
+#include "ClientConnection.h"
+#include "RoomState.h"
+#include "LinkStats.h"
+#include "Protocol.h"
+
+/**
+ * @brief Fil de travail d'un groupe de salons
+ * Vit dans son propre QThread. Il possède les connexions des membres de ses
+ * salons, leur état versionné, et traite lui-même leurs opérations de session
+ * (décodage, journal, diffusion). Le trafic de lobby reçu sur ces connexions
+ * est renvoyé à DrumServer, qui garde le RoomManager sur le thread d'accueil.
+ * Toutes les méthodes publiques s'appellent depuis le thread du fil
+ * (QMetaObject::invokeMethod en file d'attente depuis DrumServer).
+ */
+class RoomWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RoomWorker(QObject *parent = nullptr);
+
+    void start(int heartbeatIntervalMs, int maxMissedPongs);
+    void shutdown();
+
+    // Migration des connexions ; `connection` doit déjà appartenir au thread du fil
+    void adoptConnection(ClientConnection *connection, const QString &roomId);
+    void assignRoom(const QString &clientId, const QString &roomId);
+    void releaseConnection(const QString &clientId, QThread *target);
+
+    void sendToClient(const QString &clientId, const QByteArray &message);
+    void kickClient(const QString &clientId, const QString &reason);
+    void broadcastToAll(const QByteArray &message);
+    // Message de l'hôte embarqué : les opérations de session passent par l'état du salon
+    void broadcastToRoom(const QString &roomId, const QByteArray &message);
+
+    void setHostPresent(const QString &roomId, bool present);
+    void setHeartbeat(int intervalMs, int maxMissedPongs);
+    void setSendQueueLimits(const SendQueueLimits &limits);
+    void removeRoom(const QString &roomId);
+    // Instantané de l'état du salon ; vide si le salon est inconnu ou supprimé
+    QJsonObject roomSnapshot(const QString &roomId);
+
+signals:
+    void connectionReleased(ClientConnection *connection);
+    void connectionClosed(const QString &clientId);
+    // Trame canonique d'un message de lobby (salons, liste) à traiter par DrumServer
+    void lobbyMessage(const QString &clientId, const QByteArray &canonical);
+    void hostMessage(const QByteArray &message);
+    void linkStatsUpdated(const QString &clientId, const LinkStats &stats);
+    // Profondeur des files d'envoi, publiée à chaque battement de cœur
+    void queueStatsUpdated(const QString &clientId, const QJsonObject &stats);
+    void clientTimedOut(const QString &clientId);
+
+private slots:
+    void onPingTimer();
+
+private:
+    struct RoomSlot
+    {
+        RoomState *state = nullptr;
+        QSet<ClientConnection *> members;
+        bool hostPresent = false;
+    };
+
+    void onConnectionMessage(ClientConnection *connection, MessageType type,
+                             const QJsonObject &content, const QByteArray &canonical);
+    void detach(ClientConnection *connection);
+    void closeConnection(ClientConnection *connection);
+    void publishRoomOp(const QString &roomId, MessageType type, const QJsonObject &content);
+    void deliverToRoom(const QString &roomId, const QByteArray &message, ClientConnection *except = nullptr);
+    void sendRoomSync(ClientConnection *connection, const RoomState *state, const QJsonObject &request);
+    // Crée le salon (et son état) à l'arrivée de son premier membre ou de l'hôte
+    RoomSlot &openRoom(const QString &roomId);
+    // Nul pour un salon inconnu ou supprimé : jamais recréé après coup
+    RoomState *roomState(const QString &roomId) const;
+
+    QHash<QString, RoomSlot> m_rooms;
+    QHash<QString, ClientConnection *> m_connections; // clientId -> connexion
+    QHash<QString, QString> m_connectionRoom;         // clientId -> roomId
+    std::shared_ptr<Protocol::UserIdTable> m_outgoingIds; // Commune aux connexions du fil
+
+    QTimer *m_pingTimer;
+    int m_maxMissedPongs = 5;
+    SendQueueLimits m_sendQueueLimits;
+};
@@ -0,0 +1,46 @@
+#pragma once
+#include <QString>
+#include <QByteArray>
+#include "SampleDecoder.h"
+
+class QFileInfo;
+
+/**
+ * @brief Cache disque des samples décodés (PCM float 48 kHz stéréo)
+ * Chaque fichier source est décodé une seule fois ; le résultat est écrit
+ * dans un fichier de cache identifié par (chemin, date de modification, taille).
+ * Aux démarrages suivants, le fichier de cache est simplement mappé en mémoire.
+ */
+class SampleCache {
+public:
+    explicit SampleCache(const QString& cacheDir = QString());
+
+    // Retourne le sample mappé depuis le cache, ou le décode et remplit le cache
+    SampleBufferPtr load(const QString& filePath, QString* errorString = nullptr) const;
+
+    QString cacheDirectory() const { return m_cacheDir; }
+    void setEnabled(bool enabled) { m_enabled = enabled; }
+    bool isEnabled() const { return m_enabled; }
+
+private:
+    struct CacheHeader {
+        char magic[4];
+        quint32 version;
+        quint32 sampleRate;
+        quint32 channels;
+        qint64 frameCount;
+        qint64 sourceMtime;
+        qint64 sourceSize;
+    };
+
+    QString cacheFilePath(const QFileInfo& source) const;
+    SampleBufferPtr mapCacheFile(const QString& cachePath, const QFileInfo& source) const;
+    bool writeCacheFile(const QString& cachePath, const QFileInfo& source, const SampleBuffer& sample) const;
+
+    QString m_cacheDir;
+    bool m_enabled;
+
+    static constexpr char MAGIC[4] = {'B', 'B', 'P', 'C'};
+    static constexpr quint32 FORMAT_VERSION = 1;
+    static constexpr qint64 DATA_OFFSET = 64; // En-tête complété pour aligner les floats
+};
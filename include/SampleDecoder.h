@@ -0,0 +1,59 @@
+#pragma once
+#include <QString>
+#include <QVector>
+#include <QFile>
+#include <memory>
+
+class QAudioBuffer;
+class SampleBuffer;
+
+using SampleBufferPtr = std::shared_ptr<const SampleBuffer>;
+
+/**
+ * @brief Échantillon décodé (PCM float entrelacé stéréo)
+ * Toujours au format du mixeur : SAMPLE_RATE Hz, CHANNELS canaux.
+ * Les données viennent soit d'un décodage en RAM, soit d'un fichier de cache mappé.
+ */
+class SampleBuffer {
+public:
+    static constexpr int SAMPLE_RATE = 48000;
+    static constexpr int CHANNELS = 2;
+
+    static SampleBufferPtr fromPcm(const QString& filePath, QVector<float> pcm);
+    static SampleBufferPtr fromMappedFile(const QString& filePath, std::unique_ptr<QFile> file,
+                                          const float* data, qint64 frameCount);
+
+    QString filePath() const { return m_filePath; }
+    qint64 frameCount() const { return m_frameCount; }
+    const float* frames() const { return m_data; }
+    bool isMapped() const { return m_file != nullptr; }
+
+    ~SampleBuffer();
+
+    SampleBuffer(const SampleBuffer&) = delete;
+    SampleBuffer& operator=(const SampleBuffer&) = delete;
+
+private:
+    SampleBuffer() = default;
+
+    QString m_filePath;
+    QVector<float> m_pcm;          // Données possédées (décodage direct)
+    std::unique_ptr<QFile> m_file; // Fichier de cache maintenu ouvert pour le mapping (thread principal)
+    const float* m_data = nullptr;
+    qint64 m_frameCount = 0;
+};
+
+/**
+ * @brief Décodage bloquant d'un fichier audio vers un SampleBuffer
+ * Accepte tous les formats gérés par QAudioDecoder (wav, mp3, ogg...)
+ */
+class SampleDecoder {
+public:
+    static SampleBufferPtr decodeFile(const QString& filePath, QString* errorString = nullptr);
+
+private:
+    static void appendBuffer(const QAudioBuffer& buffer, QVector<float>& interleaved, int& sourceRate);
+    static QVector<float> resample(const QVector<float>& input, int sourceRate, int targetRate);
+
+    static constexpr int DECODE_TIMEOUT_MS = 30000;
+};
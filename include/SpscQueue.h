@@ -0,0 +1,56 @@
+#pragma once
+#include <QtGlobal>
+#include <array>
+#include <atomic>
+#include <utility>
+
+/**
+ * @brief File circulaire à producteur unique et consommateur unique, sans verrou
+ * Les emplacements sont alloués une fois pour toutes : push() et pop() ne
+ * prennent aucun verrou et n'allouent rien, ce qui permet de les appeler
+ * depuis le thread audio. Un seul thread pousse, un seul thread retire.
+ */
+template <typename T, int Capacity>
+class SpscQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity doit être une puissance de deux");
+
+public:
+    // Producteur : faux si la file est pleine (`value` est alors laissé intact)
+    bool push(T&& value) {
+        const quint32 tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == quint32(Capacity)) {
+            return false;
+        }
+        m_slots[tail & (Capacity - 1)] = std::move(value);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool push(const T& value) {
+        T copy = value;
+        return push(std::move(copy));
+    }
+
+    // Consommateur : l'emplacement libéré est laissé dans l'état "déplacé"
+    bool pop(T& out) {
+        const quint32 head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        out = std::move(m_slots[head & (Capacity - 1)]);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool isEmpty() const {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+    static constexpr int capacity() { return Capacity; }
+
+private:
+    // Lignes de cache séparées : producteur et consommateur ne se gênent pas
+    alignas(64) std::atomic<quint32> m_head{0}; // Écrit par le consommateur
+    alignas(64) std::atomic<quint32> m_tail{0}; // Écrit par le producteur
+    alignas(64) std::array<T, Capacity> m_slots{};
+};
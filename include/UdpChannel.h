@@ -0,0 +1,43 @@
+#pragma once
+#include <QObject>
+#include <QUdpSocket>
+#include <QHostAddress>
+#include <QHash>
+#include <QMutex>
+
+class ClientConnection;
+
+/**
+ * @brief Canal UDP du serveur pour les événements éphémères
+ * Un seul socket, sur le numéro de port TCP, sert toutes les connexions.
+ * Chaque datagramme commence par le jeton remis au client dans la réponse
+ * HELLO ; il est transmis à la connexion correspondante, dans son thread.
+ * Seuls les messages dont la perte est sans conséquence (mesures, frappes
+ * en direct) y circulent : l'appartenance aux salons et la grille restent
+ * sur TCP.
+ */
+class UdpChannel : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit UdpChannel(QObject *parent = nullptr);
+
+    bool bind(quint16 port);
+    void close();
+    bool isBound() const;
+    quint16 port() const;
+
+    // Appelables depuis n'importe quel thread
+    quint64 registerConnection(ClientConnection *connection); // Retourne le jeton attribué
+    void unregisterConnection(quint64 token);
+    void send(const QHostAddress &address, quint16 port, const QByteArray &datagram);
+
+private slots:
+    void onReadyRead();
+
+private:
+    QUdpSocket *m_socket;
+    mutable QMutex m_mutex; // Protège m_connections (enregistrements depuis les fils de travail)
+    QHash<quint64, ClientConnection *> m_connections;
+};
@@ -1,9 +1,11 @@
 #include "AudioEngine.h"
+#include "AudioMixer.h"
 #include <QDebug>
 #include <QStandardPaths>
 #include <QCoreApplication>
 #include <QFileInfo>
 #include <QCollator>
+#include <QRegularExpression>
 
 // Définition des constantes statiques
 const QStringList AudioEngine::SUPPORTED_EXTENSIONS = {
@@ -17,21 +19,133 @@ const QStringList AudioEngine::DEFAULT_NAMES = {
 
 AudioEngine::AudioEngine(QObject* parent)
     : QObject(parent)
+    , m_mixer(new AudioMixer())
     , m_volume(0.7f)
     , m_maxInstruments(DEFAULT_MAX_INSTRUMENTS) // 0 = illimité
 {
+    // Le mixeur et son QAudioSink vivent sur le thread audio
+    m_audioThread.setObjectName("AudioThread");
+    m_mixer->moveToThread(&m_audioThread);
+    connect(&m_audioThread, &QThread::finished, m_mixer, &QObject::deleteLater);
+    connect(m_mixer, &AudioMixer::outputError, this, &AudioEngine::loadingError);
+    m_audioThread.start(QThread::TimeCriticalPriority);
+
+    // Le thread audio n'émet aucun signal (allocation d'événements) : ses
+    // steps sont relevés ici, à une cadence bien supérieure à celle des steps
+    m_mixerPollTimer.setTimerType(Qt::PreciseTimer);
+    m_mixerPollTimer.setInterval(MIXER_POLL_INTERVAL_MS);
+    connect(&m_mixerPollTimer, &QTimer::timeout, this, &AudioEngine::pollMixer);
+
+    m_mixer->setMasterGain(m_volume);
+    m_loadPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+    QMetaObject::invokeMethod(m_mixer, "startOutput", Qt::QueuedConnection);
+
     qDebug() << "AudioEngine initialisé avec système illimité";
 }
 
 AudioEngine::~AudioEngine() {
-    // Nettoyer les instruments
+    // Aucune tâche de décodage ne doit survivre au moteur
+    if (m_loadCancelled) {
+        m_loadCancelled->store(true, std::memory_order_relaxed);
+    }
+    m_loadPool.clear();
+    m_loadPool.waitForDone();
+
+    QMetaObject::invokeMethod(m_mixer, "stopOutput", Qt::BlockingQueuedConnection);
+    m_audioThread.quit();
+    m_audioThread.wait();
+    m_mixer = nullptr; // Détruit par deleteLater à la fin du thread audio
+
+    qDeleteAll(m_instruments);
+    m_instruments.clear();
+}
+
+void AudioEngine::clearInstruments() {
     for (auto* instrument : m_instruments) {
         delete instrument;
     }
     m_instruments.clear();
+    m_mixer->setSamples({});
+}
+
+QVector<SampleBufferPtr> AudioEngine::currentSamples() const {
+    QVector<SampleBufferPtr> samples(m_instruments.isEmpty() ? 0 : m_instruments.lastKey() + 1);
+    for (auto it = m_instruments.begin(); it != m_instruments.end(); ++it) {
+        if (it.key() >= 0 && it.value()) {
+            samples[it.key()] = it.value()->sample;
+        }
+    }
+    return samples;
+}
+
+void AudioEngine::syncMixerSamples() {
+    // Les IDs peuvent changer (tri) : on republie la table complète
+    m_mixer->setSamples(currentSamples());
+    applyDefaultChokeGroups();
+}
+
+int AudioEngine::defaultChokeGroup(const QString& instrumentName) {
+    // Mots entiers seulement : "Shaker" ou "Shhaker" ne sont pas des charlestons
+    static const QSet<QString> hiHatWords = {"hat", "hats", "hh", "hihat", "hihats", "charleston"};
+    const QStringList words = instrumentName.toLower().split(QRegularExpression("[^a-z]+"), Qt::SkipEmptyParts);
+    for (const QString& word : words) {
+        if (hiHatWords.contains(word)) {
+            return HIHAT_CHOKE_GROUP;
+        }
+    }
+    return 0;
+}
+
+void AudioEngine::setAutoChokeHiHats(bool enabled) {
+    if (m_autoChokeHiHats == enabled) {
+        return;
+    }
+    m_autoChokeHiHats = enabled;
+    applyDefaultChokeGroups();
+}
+
+void AudioEngine::applyDefaultChokeGroups() {
+    // Les groupes fixés explicitement ne sont jamais écrasés
+    for (auto it = m_instruments.begin(); it != m_instruments.end(); ++it) {
+        if (m_configuredChokeGroups.contains(it.key())) {
+            continue;
+        }
+        const bool hiHat = m_autoChokeHiHats && it.value() && defaultChokeGroup(it.value()->name) > 0;
+        applyChokeGroup(it.key(), hiHat ? HIHAT_CHOKE_GROUP : 0);
+    }
+}
+
+void AudioEngine::setInstrumentPolyphony(int instrumentId, int maxVoices) {
+    m_mixer->setPolyphony(instrumentId, maxVoices);
+}
+
+void AudioEngine::setInstrumentMix(int instrumentId, float gain, float pan) {
+    m_mixer->setInstrumentMix(instrumentId, gain, pan);
+}
+
+void AudioEngine::setInstrumentChokeGroup(int instrumentId, int group) {
+    if (instrumentId < 0 || instrumentId >= AudioMixer::MAX_INSTRUMENTS) {
+        return;
+    }
+    m_configuredChokeGroups.insert(instrumentId);
+    applyChokeGroup(instrumentId, group);
+}
+
+void AudioEngine::applyChokeGroup(int instrumentId, int group) {
+    if (instrumentId < 0 || instrumentId >= AudioMixer::MAX_INSTRUMENTS) {
+        return;
+    }
+    if (instrumentId >= m_chokeGroups.size()) {
+        m_chokeGroups.resize(instrumentId + 1);
+    }
+    m_chokeGroups[instrumentId] = qMax(0, group);
+    m_mixer->setChokeGroup(instrumentId, group);
 }
 
 bool AudioEngine::loadSamples(const QString& samplesPath) {
+    // Un nouveau chargement remplace toujours le précédent
+    cancelLoading();
+
     QString samplesDir = findSamplesDirectory(samplesPath);
 
     if (samplesDir.isEmpty()) {
@@ -40,6 +154,8 @@ bool AudioEngine::loadSamples(const QString& samplesPath) {
         return false;
     }
 
+    clearInstruments();
+
     qDebug() << "Chargement des samples depuis:" << samplesDir;
     if (m_maxInstruments > 0) {
         qDebug() << "Limite d'instruments:" << m_maxInstruments;
@@ -47,21 +163,42 @@ bool AudioEngine::loadSamples(const QString& samplesPath) {
         qDebug() << "Aucune limite d'instruments";
     }
 
-    bool allLoaded = loadSamplesFromDirectory(samplesDir);
+    const int totalFiles = loadAllAvailableSamples(QDir(samplesDir));
 
-    // Si aucun fichier n'a été chargé, utiliser les instruments par défaut
+    // Si aucun fichier n'a été trouvé, utiliser les instruments par défaut
     if (m_instruments.isEmpty()) {
         qWarning() << "Aucun fichier audio trouvé - Utilisation d'instruments silencieux";
         setupDefaultInstruments();
         return false;
     }
 
-    // Trier les instruments par nom pour un affichage cohérent
-    sortInstrumentsByName();
-
-    qDebug() << "Instruments chargés:" << m_instruments.size();
+    // Les instruments existent déjà (silencieux) : la grille peut être dimensionnée
+    // immédiatement, les samples arrivent au fil des décodages
+    syncMixerSamples();
+    qDebug() << "Instruments en chargement:" << m_instruments.size();
     emit instrumentCountChanged(m_instruments.size());
-    return allLoaded;
+    emit loadingProgress(0, m_loadTotal);
+
+    if (totalFiles > m_instruments.size()) {
+        emit maxInstrumentsReached(m_maxInstruments, totalFiles);
+    }
+    return true;
+}
+
+void AudioEngine::cancelLoading() {
+    if (!isLoading()) {
+        return;
+    }
+
+    // Les décodages déjà démarrés se terminent mais leur résultat est ignoré
+    m_loadCancelled->store(true, std::memory_order_relaxed);
+    m_loadPool.clear();
+    ++m_loadGeneration;
+
+    const int loaded = m_loadDone;
+    m_loadTotal = m_loadDone;
+    qDebug() << "Chargement des samples annulé après" << loaded << "instruments";
+    emit loadingFinished(loaded, true);
 }
 
 QString AudioEngine::findSamplesDirectory(const QString& basePath) const {
@@ -82,47 +219,112 @@ QString AudioEngine::findSamplesDirectory(const QString& basePath) const {
     return QString();
 }
 
-bool AudioEngine::loadSamplesFromDirectory(const QString& dirPath) {
-    QDir dir(dirPath);
-    loadAllAvailableSamples(dir);
-    return !m_instruments.isEmpty();
+QList<QPair<QString, QFileInfo>> AudioEngine::listSampleFiles(const QDir& dir) {
+    QFileInfoList files = dir.entryInfoList(SUPPORTED_EXTENSIONS, QDir::Files, QDir::Name);
+
+    // Trier par nom nettoyé (tri naturel) avant d'attribuer les IDs :
+    // ils restent stables pendant que les décodages se terminent dans le désordre
+    QList<QPair<QString, QFileInfo>> sortedFiles;
+    for (const QFileInfo& fileInfo : files) {
+        sortedFiles.append({cleanFileName(fileInfo.baseName()), fileInfo});
+    }
+
+    QCollator collator;
+    collator.setNumericMode(true);
+    std::stable_sort(sortedFiles.begin(), sortedFiles.end(),
+                     [&collator](const QPair<QString, QFileInfo>& a,
+                                 const QPair<QString, QFileInfo>& b) {
+                         return collator.compare(a.first, b.first) < 0;
+                     });
+    return sortedFiles;
 }
 
-void AudioEngine::loadAllAvailableSamples(const QDir& dir) {
-    QFileInfoList files = dir.entryInfoList(SUPPORTED_EXTENSIONS, QDir::Files, QDir::Name);
+int AudioEngine::loadAllAvailableSamples(const QDir& dir) {
+    const QList<QPair<QString, QFileInfo>> sortedFiles = listSampleFiles(dir);
+    const int fileCount = sortedFiles.size();
 
-    qDebug() << "Fichiers audio trouvés:" << files.size();
+    qDebug() << "Fichiers audio trouvés:" << fileCount;
 
-    int instrumentId = 0;
-    int skippedFiles = 0;
+    int count = sortedFiles.size();
+    if (m_maxInstruments > 0 && count > m_maxInstruments) {
+        count = m_maxInstruments;
+        qWarning() << "Limite d'instruments atteinte (" << m_maxInstruments
+                   << "), " << (fileCount - count) << "fichiers ignorés";
+    }
 
-    for (const QFileInfo& fileInfo : files) {
-        // Vérifier la limite si elle est définie
-        if (m_maxInstruments > 0 && instrumentId >= m_maxInstruments) {
-            skippedFiles = files.size() - instrumentId;
-            qWarning() << "Limite d'instruments atteinte (" << m_maxInstruments
-                       << "), " << skippedFiles << "fichiers ignorés";
-            emit maxInstrumentsReached(m_maxInstruments, files.size());
-            break;
+    m_loadCancelled = std::make_shared<std::atomic<bool>>(false);
+    ++m_loadGeneration;
+    m_loadTotal = count;
+    m_loadDone = 0;
+
+    for (int instrumentId = 0; instrumentId < count; ++instrumentId) {
+        auto* instrument = new InstrumentPlayer();
+        instrument->name = sortedFiles[instrumentId].first;
+        instrument->filePath = sortedFiles[instrumentId].second.filePath();
+        m_instruments[instrumentId] = instrument;
+
+        startSampleJob(instrumentId, instrument->filePath);
+    }
+
+    qDebug() << count << "décodages lancés sur" << m_loadPool.maxThreadCount() << "threads";
+    return fileCount;
+}
+
+void AudioEngine::startSampleJob(int instrumentId, const QString& filePath) {
+    const int generation = m_loadGeneration;
+    const std::shared_ptr<std::atomic<bool>> cancelled = m_loadCancelled;
+    const SampleCache* cache = &m_sampleCache;
+
+    // Exécuté sur le pool ; le destructeur attend la fin des tâches, `this` reste valide
+    m_loadPool.start([this, cache, cancelled, generation, instrumentId, filePath]() {
+        if (cancelled->load(std::memory_order_relaxed)) {
+            return;
         }
 
-        QString cleanName = cleanFileName(fileInfo.baseName());
-        loadSample(instrumentId, fileInfo.filePath(), cleanName);
-        instrumentId++;
+        QString errorString;
+        SampleBufferPtr sample = cache->load(filePath, &errorString);
+        if (cancelled->load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        QMetaObject::invokeMethod(this, [=]() {
+            onSampleDecoded(generation, instrumentId, filePath, sample, errorString);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void AudioEngine::onSampleDecoded(int generation, int instrumentId, const QString& filePath,
+                                  SampleBufferPtr sample, const QString& errorString) {
+    if (generation != m_loadGeneration) {
+        return; // Chargement annulé ou remplacé entre-temps
     }
 
-    if (skippedFiles > 0) {
-        qDebug() << "Statistiques de chargement:";
-        qDebug() << "  - Fichiers trouvés:" << files.size();
-        qDebug() << "  - Fichiers chargés:" << instrumentId;
-        qDebug() << "  - Fichiers ignorés:" << skippedFiles;
-        qDebug() << "  - Limite actuelle:" << (m_maxInstruments > 0 ? QString::number(m_maxInstruments) : "Illimitée");
-    } else {
-        qDebug() << "Tous les" << instrumentId << "instruments chargés depuis" << files.size() << "fichiers trouvés";
+    auto it = m_instruments.find(instrumentId);
+    if (it != m_instruments.end() && it.value()->filePath == filePath) {
+        InstrumentPlayer* instrument = it.value();
+        instrument->sample = sample;
+        m_mixer->setSample(instrumentId, sample);
+
+        if (!sample) {
+            qWarning() << "Erreur instrument" << instrumentId << "(" << instrument->name << "):" << errorString;
+            emit loadingError(QString("Erreur instrument %1 (%2): %3")
+                                  .arg(instrumentId).arg(instrument->name).arg(errorString));
+        } else {
+            qDebug() << "Sample chargé:" << instrument->name << "pour l'instrument" << instrumentId;
+        }
+        emit sampleLoaded(instrumentId, instrument->name);
+    }
+
+    ++m_loadDone;
+    emit loadingProgress(m_loadDone, m_loadTotal);
+
+    if (m_loadDone == m_loadTotal) {
+        qDebug() << "Tous les" << m_loadDone << "instruments chargés";
+        emit loadingFinished(m_loadDone, false);
     }
 }
 
-QString AudioEngine::cleanFileName(const QString& fileName) const {
+QString AudioEngine::cleanFileName(const QString& fileName) {
     QString cleaned = fileName;
 
     // Enlever les underscores et les remplacer par des espaces
@@ -139,34 +341,11 @@ QString AudioEngine::cleanFileName(const QString& fileName) const {
     return words.join(' ');
 }
 
-void AudioEngine::sortInstrumentsByName() {
-    // Créer une liste temporaire pour trier
-    QList<QPair<QString, InstrumentPlayer*>> sortedInstruments;
-
-    for (auto it = m_instruments.begin(); it != m_instruments.end(); ++it) {
-        sortedInstruments.append({it.value()->name, it.value()});
-    }
-
-    // Trier par nom en utilisant QCollator pour un tri naturel
-    QCollator collator;
-    collator.setNumericMode(true);
-    std::sort(sortedInstruments.begin(), sortedInstruments.end(),
-              [&collator](const QPair<QString, InstrumentPlayer*>& a,
-                          const QPair<QString, InstrumentPlayer*>& b) {
-                  return collator.compare(a.first, b.first) < 0;
-              });
-
-    // Reconstruire la map avec les nouveaux IDs
-    m_instruments.clear();
-    for (int i = 0; i < sortedInstruments.size(); ++i) {
-        m_instruments[i] = sortedInstruments[i].second;
-    }
-}
-
 void AudioEngine::setupDefaultInstruments() {
     for (int i = 0; i < DEFAULT_NAMES.size(); ++i) {
         createSilentInstrument(i, DEFAULT_NAMES[i]);
     }
+    applyDefaultChokeGroups();
     emit instrumentCountChanged(DEFAULT_NAMES.size());
     qDebug() << "Instruments par défaut configurés (mode silencieux)";
 }
@@ -178,25 +357,21 @@ void AudioEngine::loadSample(int instrumentId, const QString& filePath, const QS
     }
 
     auto* instrument = new InstrumentPlayer();
-    instrument->player = std::make_unique<QMediaPlayer>(this);
-    instrument->audioOutput = std::make_unique<QAudioOutput>(this);
     instrument->name = name;
     instrument->filePath = filePath;
 
-    // Configuration du player
-    instrument->player->setAudioOutput(instrument->audioOutput.get());
-    instrument->player->setSource(QUrl::fromLocalFile(filePath));
-    instrument->audioOutput->setVolume(m_volume);
-
-    // Connexion pour gérer les erreurs
-    connect(instrument->player.get(), &QMediaPlayer::errorOccurred,
-            this, [this, instrumentId, name](QMediaPlayer::Error error, const QString& errorString) {
-                qWarning() << "Erreur instrument" << instrumentId << "(" << name << "):" << errorString;
-                emit loadingError(QString("Erreur instrument %1 (%2): %3")
-                                      .arg(instrumentId).arg(name).arg(errorString));
-            });
+    // PCM float mappé depuis le cache (décodage uniquement au premier chargement)
+    QString errorString;
+    instrument->sample = m_sampleCache.load(filePath, &errorString);
+    if (!instrument->sample) {
+        qWarning() << "Erreur instrument" << instrumentId << "(" << name << "):" << errorString;
+        emit loadingError(QString("Erreur instrument %1 (%2): %3")
+                              .arg(instrumentId).arg(name).arg(errorString));
+    }
 
     m_instruments[instrumentId] = instrument;
+    m_mixer->setSample(instrumentId, instrument->sample);
+    applyDefaultChokeGroups();
 
     qDebug() << "Sample chargé:" << name << "pour l'instrument" << instrumentId;
     emit sampleLoaded(instrumentId, name);
@@ -209,14 +384,10 @@ void AudioEngine::createSilentInstrument(int instrumentId, const QString& name)
     }
 
     auto* instrument = new InstrumentPlayer();
-    instrument->player = std::make_unique<QMediaPlayer>(this);
-    instrument->audioOutput = std::make_unique<QAudioOutput>(this);
     instrument->name = name;
 
-    instrument->player->setAudioOutput(instrument->audioOutput.get());
-    instrument->audioOutput->setVolume(m_volume);
-
     m_instruments[instrumentId] = instrument;
+    m_mixer->setSample(instrumentId, nullptr);
 
     qWarning() << "Instrument" << instrumentId << "(" << name << ") créé sans fichier audio (silencieux)";
     emit sampleLoaded(instrumentId, name);
@@ -225,13 +396,8 @@ void AudioEngine::createSilentInstrument(int instrumentId, const QString& name)
 void AudioEngine::setVolume(float volume) {
     m_volume = qBound(0.0f, volume, 1.0f);
 
-    // Appliquer le volume à tous les instruments
-    for (auto it = m_instruments.begin(); it != m_instruments.end(); ++it) {
-        InstrumentPlayer* instrument = it.value();
-        if (instrument && instrument->audioOutput) {
-            instrument->audioOutput->setVolume(m_volume);
-        }
-    }
+    // Gain global appliqué par le mixeur
+    m_mixer->setMasterGain(m_volume);
 }
 
 void AudioEngine::playInstrument(int instrumentId) {
@@ -242,22 +408,73 @@ void AudioEngine::playInstrument(int instrumentId) {
     }
 
     InstrumentPlayer* instrument = it.value();
-    if (!instrument || !instrument->player) {
-        qWarning() << "Instrument" << instrumentId << "non initialisé";
-        return;
+    if (!instrument || !instrument->sample) {
+        return; // Instrument silencieux
     }
 
-    // Vérifier si un fichier est chargé
-    if (instrument->filePath.isEmpty()) {
-        qDebug() << "Instrument" << instrumentId << "(" << instrument->name << ") en mode silencieux";
-        return;
+    // Nouvelle voix mixée dès la prochaine période audio, sans couper la précédente
+    m_mixer->trigger(instrumentId);
+}
+
+int AudioEngine::getActiveVoiceCount() const {
+    return m_mixer->activeVoiceCount();
+}
+
+QJsonObject AudioEngine::voiceStats() {
+    QJsonObject stats;
+    stats["active"] = m_mixer->activeVoiceCount();
+    stats["peak"] = m_mixer->takePeakVoiceCount();
+    stats["capacity"] = AudioMixer::MAX_VOICES;
+    stats["slots"] = AudioMixer::VOICE_SLOTS;
+    stats["stolen"] = qint64(m_mixer->stolenVoiceCount());
+    stats["choked"] = qint64(m_mixer->chokedVoiceCount());
+    return stats;
+}
+
+void AudioEngine::setPlaying(bool playing) {
+    m_playing = playing;
+    m_mixer->setPlaying(playing);
+    if (playing) {
+        m_mixerPollTimer.start();
     }
+}
+
+void AudioEngine::pollMixer() {
+    int step = 0;
+    if (m_mixer->takeLatestStep(step)) {
+        emit stepAdvanced(step);
+    }
+    m_mixer->collectGarbage();
+
+    // Après l'arrêt, un dernier relevé suffit ; les samples remplacés
+    // ensuite sont libérés au prochain setSample ou à la reprise
+    if (!m_playing) {
+        m_mixerPollTimer.stop();
+    }
+}
+
+void AudioEngine::setTempo(int bpm) {
+    m_mixer->setTempo(bpm);
+}
 
-    // Redémarrer la lecture depuis le début
-    instrument->player->setPosition(0);
-    instrument->player->play();
+void AudioEngine::setStepCount(int steps) {
+    m_mixer->setStepCount(steps);
+}
+
+void AudioEngine::setStepMask(int step, quint64 instrumentMask) {
+    m_mixer->setStepMask(step, instrumentMask);
+}
+
+void AudioEngine::resetTransport(int step) {
+    m_mixer->resetTransport(step);
+}
+
+void AudioEngine::syncTransport(qint64 anchorUs, double anchorStep, int bpm) {
+    m_mixer->syncTransport(anchorUs, anchorStep, bpm);
+}
 
-    qDebug() << "Lecture instrument" << instrumentId << ":" << instrument->name;
+double AudioEngine::transportPosition(qint64 localUs) const {
+    return m_mixer->transportPosition(localUs);
 }
 
 void AudioEngine::playMultipleInstruments(const QList<int>& instruments) {
@@ -0,0 +1,745 @@
+#include "AudioMixer.h"
+#include "ClockSync.h"
+#include "MixKernels.h"
+#include <QAudioSink>
+#include <QMediaDevices>
+#include <QAudioDevice>
+#include <QtAlgorithms>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+AudioMixer::AudioMixer(QObject* parent)
+    : QIODevice(parent)
+    , m_activeVoices(0)
+{
+    // Pré-allocation : le thread audio n'alloue jamais (voix et files de taille fixe)
+    m_mixBuffer.resize(PERIOD_FRAMES * SampleBuffer::CHANNELS);
+    m_gainLeft.fill(1.0f);
+    m_gainRight.fill(1.0f);
+}
+
+AudioMixer::~AudioMixer() {
+    stopOutput();
+}
+
+void AudioMixer::startOutput() {
+    if (m_sink) {
+        return;
+    }
+
+    const QAudioDevice device = QMediaDevices::defaultAudioOutput();
+    if (device.isNull()) {
+        qWarning() << "Aucun périphérique de sortie audio - Mode silencieux";
+        emit outputError("Aucun périphérique de sortie audio");
+        return;
+    }
+
+    // Format préféré : 48 kHz stéréo 16 bits, sinon float, sinon format natif
+    QAudioFormat format;
+    format.setSampleRate(SampleBuffer::SAMPLE_RATE);
+    format.setChannelCount(SampleBuffer::CHANNELS);
+    format.setSampleFormat(QAudioFormat::Int16);
+    if (!device.isFormatSupported(format)) {
+        format.setSampleFormat(QAudioFormat::Float);
+    }
+    if (!device.isFormatSupported(format)) {
+        format = device.preferredFormat();
+    }
+    if (format.sampleRate() != SampleBuffer::SAMPLE_RATE) {
+        qWarning() << "Fréquence de sortie" << format.sampleRate()
+                   << "Hz différente du mixeur (" << SampleBuffer::SAMPLE_RATE << "Hz)";
+    }
+
+    m_format = format;
+    m_sink = new QAudioSink(device, format, this);
+
+    // Tampon court : la latence de déclenchement reste de l'ordre d'une période
+    m_sink->setBufferSize(PERIOD_FRAMES * PERIOD_COUNT * format.bytesPerFrame());
+
+    open(QIODevice::ReadOnly);
+    m_sink->start(this);
+
+    qDebug() << "Sortie audio démarrée:" << device.description()
+             << format.sampleRate() << "Hz," << format.channelCount() << "canaux, tampon"
+             << m_sink->bufferSize() << "octets, noyaux de mixage" << MixKernels::implementationName();
+}
+
+void AudioMixer::stopOutput() {
+    if (m_sink) {
+        m_sink->stop();
+        delete m_sink;
+        m_sink = nullptr;
+    }
+    if (isOpen()) {
+        close();
+    }
+}
+
+bool AudioMixer::post(Command&& command) {
+    // File pleine : le thread audio ne vide plus (sortie arrêtée) ou le GUI
+    // inonde ; la commande est perdue plutôt que de bloquer qui que ce soit
+    if (!m_commands.push(std::move(command))) {
+        countDroppedCommand();
+        return false;
+    }
+    return true;
+}
+
+void AudioMixer::countDroppedCommand() {
+    const quint64 dropped = m_droppedCommands.fetch_add(1, std::memory_order_relaxed) + 1;
+    if ((dropped & (dropped - 1)) == 0) {
+        qWarning() << "File de commandes audio pleine," << dropped << "commandes perdues";
+    }
+}
+
+void AudioMixer::trigger(int instrumentId) {
+    if (instrumentId < 0 || instrumentId >= MAX_INSTRUMENTS) {
+        return;
+    }
+    Command command;
+    command.type = Command::Type::Trigger;
+    command.index = instrumentId;
+    post(std::move(command));
+}
+
+void AudioMixer::setSample(int instrumentId, SampleBufferPtr sample) {
+    if (instrumentId < 0 || instrumentId >= MAX_INSTRUMENTS) {
+        return;
+    }
+    // Chaque SetSample renvoie exactement une entrée dans m_garbage : en
+    // limiter le nombre en vol garantit au thread audio une place libre
+    collectGarbage();
+    if (m_samplesInFlight >= m_garbage.capacity()) {
+        countDroppedCommand();
+        return;
+    }
+
+    Command command;
+    command.type = Command::Type::SetSample;
+    command.index = instrumentId;
+    command.sample = std::move(sample);
+    if (post(std::move(command))) {
+        ++m_samplesInFlight;
+    }
+    m_publishedSampleCount = qMax(m_publishedSampleCount, instrumentId + 1);
+}
+
+void AudioMixer::setSamples(const QVector<SampleBufferPtr>& samples) {
+    if (samples.size() > MAX_INSTRUMENTS) {
+        qWarning() << "Mixeur limité à" << MAX_INSTRUMENTS << "instruments," << samples.size() << "fournis";
+    }
+
+    // Une commande par emplacement ; ceux au-delà de la nouvelle table sont vidés
+    const int count = qMin<int>(samples.size(), MAX_INSTRUMENTS);
+    const int previous = m_publishedSampleCount;
+    for (int i = 0; i < qMax(count, previous); ++i) {
+        setSample(i, i < count ? samples[i] : SampleBufferPtr());
+    }
+    m_publishedSampleCount = count;
+}
+
+void AudioMixer::setPolyphony(int instrumentId, int maxVoices) {
+    if (instrumentId < 0 || instrumentId >= MAX_INSTRUMENTS) {
+        return;
+    }
+    Command command;
+    command.type = Command::Type::SetPolyphony;
+    command.index = instrumentId;
+    command.amount = qBound(0, maxVoices, MAX_VOICES);
+    post(std::move(command));
+}
+
+void AudioMixer::setChokeGroup(int instrumentId, int group) {
+    if (instrumentId < 0 || instrumentId >= MAX_INSTRUMENTS) {
+        return;
+    }
+    Command command;
+    command.type = Command::Type::SetChokeGroup;
+    command.index = instrumentId;
+    command.amount = qMax(0, group);
+    post(std::move(command));
+}
+
+void AudioMixer::setInstrumentMix(int instrumentId, float gain, float pan) {
+    if (instrumentId < 0 || instrumentId >= MAX_INSTRUMENTS) {
+        return;
+    }
+    // Gains par canal calculés ici : le thread audio n'a plus qu'à les copier
+    gain = qBound(0.0f, gain, 2.0f);
+    pan = qBound(-1.0f, pan, 1.0f);
+    Command command;
+    command.type = Command::Type::SetInstrumentMix;
+    command.index = instrumentId;
+    command.value = gain * qMin(1.0f, 1.0f - pan);
+    command.step = gain * qMin(1.0f, 1.0f + pan);
+    post(std::move(command));
+}
+
+void AudioMixer::setMasterGain(float gain) {
+    Command command;
+    command.type = Command::Type::SetGain;
+    command.value = gain;
+    post(std::move(command));
+}
+
+bool AudioMixer::takeLatestStep(int& step) {
+    // Seul le dernier step compte pour l'affichage
+    bool found = false;
+    int value = 0;
+    while (m_stepEvents.pop(value)) {
+        step = value;
+        found = true;
+    }
+    return found;
+}
+
+void AudioMixer::collectGarbage() {
+    // Les samples remplacés sont détruits ici, jamais sur le thread audio
+    SampleBufferPtr sample;
+    while (m_garbage.pop(sample)) {
+        sample.reset();
+        --m_samplesInFlight;
+    }
+}
+
+qint64 AudioMixer::bytesAvailable() const {
+    // Flux infini : une période complète est toujours disponible
+    const int bytesPerFrame = m_format.isValid() ? m_format.bytesPerFrame() : 0;
+    return PERIOD_FRAMES * PERIOD_COUNT * bytesPerFrame + QIODevice::bytesAvailable();
+}
+
+qint64 AudioMixer::writeData(const char* data, qint64 maxSize) {
+    Q_UNUSED(data)
+    Q_UNUSED(maxSize)
+    return -1;
+}
+
+qint64 AudioMixer::readData(char* data, qint64 maxSize) {
+    const int bytesPerFrame = m_format.bytesPerFrame();
+    const int outChannels = m_format.channelCount();
+    if (bytesPerFrame <= 0 || outChannels <= 0) {
+        return 0;
+    }
+
+    const qint64 totalFrames = maxSize / bytesPerFrame;
+    const int bytesPerSample = m_format.bytesPerSample();
+    const QAudioFormat::SampleFormat sampleFormat = m_format.sampleFormat();
+    char* out = data;
+
+    qint64 done = 0;
+    while (done < totalFrames) {
+        const qint64 chunk = qMin<qint64>(PERIOD_FRAMES, totalFrames - done);
+        float* mix = m_mixBuffer.data();
+        render(mix, chunk);
+
+        // Cas courant (stéréo 16 bits) : conversion vectorisée d'un seul tenant
+        if (sampleFormat == QAudioFormat::Int16 && outChannels == SampleBuffer::CHANNELS) {
+            MixKernels::floatToInt16(reinterpret_cast<qint16*>(out), mix, chunk * SampleBuffer::CHANNELS);
+            out += chunk * bytesPerFrame;
+            done += chunk;
+            continue;
+        }
+
+        // Conversion float stéréo -> format du périphérique
+        for (qint64 frame = 0; frame < chunk; ++frame) {
+            const float left = mix[frame * 2];
+            const float right = mix[frame * 2 + 1];
+            for (int channel = 0; channel < outChannels; ++channel) {
+                float value = (outChannels == 1) ? 0.5f * (left + right)
+                                                 : ((channel % 2 == 0) ? left : right);
+                value = std::clamp(value, -1.0f, 1.0f);
+
+                switch (sampleFormat) {
+                case QAudioFormat::Int16:
+                    *reinterpret_cast<qint16*>(out) = qint16(value * 32767.0f);
+                    break;
+                case QAudioFormat::Int32:
+                    *reinterpret_cast<qint32*>(out) = qint32(value * 2147483647.0);
+                    break;
+                case QAudioFormat::UInt8:
+                    *reinterpret_cast<quint8*>(out) = quint8(128 + value * 127.0f);
+                    break;
+                case QAudioFormat::Float:
+                    *reinterpret_cast<float*>(out) = value;
+                    break;
+                default:
+                    std::memset(out, 0, bytesPerSample);
+                    break;
+                }
+                out += bytesPerSample;
+            }
+        }
+        done += chunk;
+    }
+
+    return totalFrames * bytesPerFrame;
+}
+
+void AudioMixer::render(float* output, qint64 frames) {
+    std::fill(output, output + frames * SampleBuffer::CHANNELS, 0.0f);
+
+    // Commandes du GUI appliquées d'un bloc, avant tout rendu
+    drainCommands();
+    releaseRetiredSamples();
+
+    m_renderClockUs = ClockSync::nowUs();
+    if (m_playing && m_anchored) {
+        alignToAnchor(m_renderClockUs);
+    }
+
+    // Découpage du bloc aux frontières de steps : chaque step démarre
+    // exactement sur sa frame, quel que soit le tempo
+    qint64 offset = 0;
+    while (offset < frames) {
+        qint64 segment = frames - offset;
+        if (m_playing) {
+            const qint64 stepFrame = qint64(std::ceil(m_nextStepFrame));
+            const qint64 untilStep = stepFrame - (m_renderedFrames + offset);
+            if (untilStep <= 0) {
+                fireStep();
+                continue;
+            }
+            segment = qMin(segment, untilStep);
+        }
+
+        mixVoices(output + offset * SampleBuffer::CHANNELS, segment);
+        offset += segment;
+    }
+    m_renderedFrames += frames;
+    m_activeVoices.store(m_voiceCount, std::memory_order_relaxed);
+    publishTransport();
+
+    // Un changement de volume est lissé sur le bloc au lieu de tomber d'un coup
+    MixKernels::applyGainRamp(output, frames, m_appliedGain, m_gain);
+    m_appliedGain = m_gain;
+}
+
+void AudioMixer::drainCommands() {
+    Command command;
+    while (m_commands.pop(command)) {
+        applyCommand(command);
+    }
+}
+
+void AudioMixer::applyCommand(Command& command) {
+    switch (command.type) {
+    case Command::Type::Trigger:
+        startVoice(command.index);
+        break;
+    case Command::Type::SetSample: {
+        SampleBufferPtr& slot = m_samples[command.index];
+        if (slot != command.sample) {
+            std::swap(slot, command.sample);
+        } else {
+            command.sample.reset(); // Jamais la dernière référence : la table garde le même sample
+        }
+        retireSample(std::move(command.sample)); // Même vide : le GUI compte un retour par SetSample
+        break;
+    }
+    case Command::Type::SetGain:
+        m_gain = float(command.value);
+        if (m_voiceCount == 0) {
+            m_appliedGain = m_gain; // Rien d'audible à lisser
+        }
+        break;
+    case Command::Type::SetPlaying:
+        if (m_playing == command.flag) {
+            break;
+        }
+        m_playing = command.flag;
+        if (!m_playing) {
+            m_anchored = false; // Une reprise locale repart de l'horloge audio
+        } else {
+            // Le premier step part au début de ce bloc
+            m_nextStepFrame = double(m_renderedFrames);
+        }
+        break;
+    case Command::Type::SetTempo: {
+        const double bpm = command.value;
+        if (bpm <= 0.0 || bpm == m_bpm) {
+            break;
+        }
+        // Transport ancré : nouvelle ancre calculée par le GUI à la position courante
+        if (m_anchored && command.flag) {
+            m_anchorUs = command.timeUs;
+            m_anchorStep = command.step;
+        }
+        // Conserver la phase : la fraction de step restante est remise à l'échelle
+        if (m_playing) {
+            const double remaining = m_nextStepFrame - double(m_renderedFrames);
+            m_nextStepFrame = double(m_renderedFrames) + remaining * (m_bpm / bpm);
+        }
+        m_bpm = bpm;
+        break;
+    }
+    case Command::Type::SetStepCount:
+        m_stepCount = qBound(1, command.index, MAX_STEPS);
+        if (m_nextStep >= m_stepCount) {
+            m_nextStep = 0;
+        }
+        break;
+    case Command::Type::SetStepMask:
+        m_stepMasks[command.index] = command.mask;
+        break;
+    case Command::Type::SetPolyphony:
+        m_polyphony[command.index] = command.amount;
+        break;
+    case Command::Type::SetChokeGroup:
+        m_chokeGroups[command.index] = command.amount;
+        break;
+    case Command::Type::SetInstrumentMix:
+        m_gainLeft[command.index] = float(command.value);
+        m_gainRight[command.index] = float(command.step);
+        break;
+    case Command::Type::ResetTransport:
+        m_nextStep = qBound(0, command.index, m_stepCount - 1);
+        m_nextStepIndex = m_nextStep;
+        m_nextStepFrame = double(m_renderedFrames);
+        m_anchored = false;
+        break;
+    case Command::Type::SyncTransport:
+        if (command.value > 0.0) {
+            m_bpm = command.value;
+        }
+        m_anchorUs = command.timeUs;
+        m_anchorStep = command.step;
+        m_anchored = true;
+        break;
+    }
+}
+
+bool AudioMixer::isSamplePlaying(const SampleBuffer* sample) const {
+    for (int i = 0; i < m_voiceCount; ++i) {
+        if (m_voices[i].sample == sample) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void AudioMixer::retireSample(SampleBufferPtr&& sample) {
+    // Encore joué : gardé jusqu'à la fin de ses voix (voir releaseRetiredSamples)
+    if (sample && isSamplePlaying(sample.get())) {
+        for (SampleBufferPtr& retiring : m_retiring) {
+            if (!retiring) {
+                retiring = std::move(sample);
+                return;
+            }
+        }
+
+        // Liste pleine (remplacements en rafale) : les voix de ce sample sont coupées
+        for (int i = 0; i < m_voiceCount;) {
+            if (m_voices[i].sample == sample.get()) {
+                m_voices[i] = m_voices[--m_voiceCount];
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    // Libération confiée au GUI ; setSample borne les SetSample en vol à la
+    // capacité de la file, la place est donc toujours là
+    const bool pushed = m_garbage.push(std::move(sample));
+    Q_ASSERT(pushed);
+    Q_UNUSED(pushed);
+}
+
+void AudioMixer::releaseRetiredSamples() {
+    for (SampleBufferPtr& retiring : m_retiring) {
+        if (retiring && !isSamplePlaying(retiring.get())) {
+            const bool pushed = m_garbage.push(std::move(retiring)); // Place réservée par setSample
+            Q_ASSERT(pushed);
+            Q_UNUSED(pushed);
+        }
+    }
+}
+
+void AudioMixer::publishTransport() {
+    // Verrou de séquence : impair pendant l'écriture, le lecteur recommence
+    const quint32 seq = m_transportSeq.load(std::memory_order_relaxed);
+    m_transportSeq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_pubRenderedFrames.store(m_renderedFrames, std::memory_order_relaxed);
+    m_pubRenderClockUs.store(m_renderClockUs, std::memory_order_relaxed);
+    m_pubNextStepIndex.store(m_nextStepIndex, std::memory_order_relaxed);
+    m_pubNextStepFrame.store(m_nextStepFrame, std::memory_order_relaxed);
+    m_pubBpm.store(m_bpm, std::memory_order_relaxed);
+    m_transportSeq.store(seq + 2, std::memory_order_release);
+}
+
+void AudioMixer::mixVoices(float* output, qint64 frames) {
+    for (int i = 0; i < m_voiceCount;) {
+        Voice& voice = m_voices[i];
+        const float* source = voice.sample->frames();
+        const qint64 remaining = voice.sample->frameCount() - voice.position;
+        qint64 count = qMin(frames, remaining);
+
+        const float* in = source + voice.position * SampleBuffer::CHANNELS;
+        if (!voice.isFading()) {
+            if (voice.gainLeft == 1.0f && voice.gainRight == 1.0f) {
+                MixKernels::mix(output, in, count * SampleBuffer::CHANNELS);
+            } else {
+                MixKernels::mixStereo(output, in, count, voice.gainLeft, voice.gainRight);
+            }
+        } else {
+            // Fondu linéaire (rare et court : boucle scalaire)
+            count = qMin(count, voice.fadeRemaining);
+            float gain = float(voice.fadeRemaining) / FADE_FRAMES;
+            const float step = 1.0f / FADE_FRAMES;
+            for (qint64 frame = 0; frame < count; ++frame) {
+                output[frame * 2] += in[frame * 2] * gain * voice.gainLeft;
+                output[frame * 2 + 1] += in[frame * 2 + 1] * gain * voice.gainRight;
+                gain -= step;
+            }
+            voice.fadeRemaining -= count;
+        }
+        voice.position += count;
+
+        // Voix terminée : retrait par échange avec la dernière (ordre sans importance)
+        if (voice.position >= voice.sample->frameCount() || voice.fadeRemaining == 0) {
+            m_voices[i] = m_voices[--m_voiceCount];
+        } else {
+            ++i;
+        }
+    }
+}
+
+void AudioMixer::fireStep() {
+    const int step = m_nextStep;
+    quint64 mask = m_stepMasks[step];
+    while (mask) {
+        const int instrumentId = qCountTrailingZeroBits(mask);
+        startVoice(instrumentId);
+        mask &= mask - 1;
+    }
+
+    // Accumulation en double : aucun arrondi cumulé, pas de dérive du tempo
+    m_nextStepFrame += framesPerStep();
+    m_nextStep = (step + 1) % m_stepCount;
+    ++m_nextStepIndex;
+
+    // Pour l'affichage ; file pleine (GUI bloqué) : le step est simplement omis
+    m_stepEvents.push(step);
+}
+
+double AudioMixer::anchorPosition(qint64 localUs) const {
+    return m_anchorStep + double(localUs - m_anchorUs) * m_bpm * 4.0 / 60e6;
+}
+
+void AudioMixer::alignToAnchor(qint64 nowUs) {
+    // Le début du bloc correspond à `nowUs` (la latence de sortie, identique
+    // d'un client à l'autre pour un même réglage de tampon, est ignorée)
+    const double position = anchorPosition(nowUs);
+    const double expected = double(m_renderedFrames) + (double(m_nextStepIndex) - position) * framesPerStep();
+    if (std::abs(expected - m_nextStepFrame) <= DRIFT_TOLERANCE_FRAMES) {
+        return;
+    }
+
+    // Recalage complet ; avant l'ancre, on attend le step d'ancrage (pas de pré-roll)
+    const qint64 index = qMax(qint64(std::ceil(position)), qint64(std::ceil(m_anchorStep)));
+    m_nextStepIndex = index;
+    m_nextStepFrame = double(m_renderedFrames) + (double(index) - position) * framesPerStep();
+    m_nextStep = int(((index % m_stepCount) + m_stepCount) % m_stepCount);
+}
+
+double AudioMixer::framesPerStep() const {
+    // Doubles-croches : 4 steps par temps
+    return SampleBuffer::SAMPLE_RATE * 60.0 / (m_bpm * 4.0);
+}
+
+void AudioMixer::setAnchor(bool anchored, qint64 anchorUs, double anchorStep, double bpm) {
+    m_guiAnchored = anchored;
+    m_guiAnchorUs = anchorUs;
+    m_guiAnchorStep = anchorStep;
+    if (bpm > 0.0) {
+        m_guiBpm = bpm;
+    }
+}
+
+void AudioMixer::setPlaying(bool playing) {
+    if (!playing) {
+        setAnchor(false, 0, 0.0, 0.0);
+    }
+    Command command;
+    command.type = Command::Type::SetPlaying;
+    command.flag = playing;
+    post(std::move(command));
+}
+
+void AudioMixer::setTempo(double bpm) {
+    if (bpm <= 0.0 || bpm == m_guiBpm) {
+        return;
+    }
+
+    Command command;
+    command.type = Command::Type::SetTempo;
+    command.value = bpm;
+
+    // Transport ancré : nouvelle ancre à la position courante, puis changement de tempo
+    if (m_guiAnchored) {
+        const qint64 now = ClockSync::nowUs();
+        setAnchor(true, now, m_guiAnchorStep + double(now - m_guiAnchorUs) * m_guiBpm * 4.0 / 60e6, bpm);
+        command.flag = true;
+        command.timeUs = m_guiAnchorUs;
+        command.step = m_guiAnchorStep;
+    }
+    m_guiBpm = bpm;
+    post(std::move(command));
+}
+
+void AudioMixer::setStepCount(int steps) {
+    Command command;
+    command.type = Command::Type::SetStepCount;
+    command.index = steps;
+    post(std::move(command));
+}
+
+void AudioMixer::setStepMask(int step, quint64 instrumentMask) {
+    if (step < 0 || step >= MAX_STEPS) {
+        return;
+    }
+    Command command;
+    command.type = Command::Type::SetStepMask;
+    command.index = step;
+    command.mask = instrumentMask;
+    post(std::move(command));
+}
+
+void AudioMixer::resetTransport(int step) {
+    setAnchor(false, 0, 0.0, 0.0);
+    Command command;
+    command.type = Command::Type::ResetTransport;
+    command.index = step;
+    post(std::move(command));
+}
+
+void AudioMixer::syncTransport(qint64 anchorUs, double anchorStep, double bpm) {
+    setAnchor(true, anchorUs, anchorStep, bpm);
+    Command command;
+    command.type = Command::Type::SyncTransport;
+    command.timeUs = anchorUs;
+    command.step = anchorStep;
+    command.value = bpm;
+    post(std::move(command));
+}
+
+double AudioMixer::transportPosition(qint64 localUs) const {
+    if (m_guiAnchored) {
+        return m_guiAnchorStep + double(localUs - m_guiAnchorUs) * m_guiBpm * 4.0 / 60e6;
+    }
+
+    // Sans ancre : position déduite de l'horloge audio du dernier bloc rendu
+    qint64 renderedFrames, renderClockUs, nextStepIndex;
+    double nextStepFrame, bpm;
+    quint32 seq;
+    do {
+        seq = m_transportSeq.load(std::memory_order_acquire);
+        renderedFrames = m_pubRenderedFrames.load(std::memory_order_relaxed);
+        renderClockUs = m_pubRenderClockUs.load(std::memory_order_relaxed);
+        nextStepIndex = m_pubNextStepIndex.load(std::memory_order_relaxed);
+        nextStepFrame = m_pubNextStepFrame.load(std::memory_order_relaxed);
+        bpm = m_pubBpm.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((seq & 1) || seq != m_transportSeq.load(std::memory_order_relaxed));
+
+    const double frame = double(renderedFrames) + double(localUs - renderClockUs) * SampleBuffer::SAMPLE_RATE / 1e6;
+    const double framesPerStep = SampleBuffer::SAMPLE_RATE * 60.0 / (bpm * 4.0);
+    return double(nextStepIndex) - (nextStepFrame - frame) / framesPerStep;
+}
+
+void AudioMixer::startVoice(int instrumentId) {
+    if (instrumentId < 0 || instrumentId >= MAX_INSTRUMENTS) {
+        return;
+    }
+    const SampleBuffer* sample = m_samples[instrumentId].get();
+    if (!sample || sample->frameCount() == 0) {
+        return; // Instrument silencieux
+    }
+
+    // Étouffement : toutes les voix du groupe s'éteignent (charleston ouvert coupé par le fermé)
+    const int group = m_chokeGroups[instrumentId];
+    if (group > 0) {
+        for (int i = 0; i < m_voiceCount; ++i) {
+            Voice& voice = m_voices[i];
+            if (voice.chokeGroup == group && !voice.isFading()) {
+                fadeOut(voice);
+                m_chokedVoices.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Polyphonie de l'instrument atteinte : sa voix la plus ancienne (la plus
+    // avancée ; à égalité, le plus petit indice) s'éteint
+    const int limit = m_polyphony[instrumentId];
+    if (limit > 0) {
+        int playing = 0;
+        int oldest = -1;
+        for (int i = 0; i < m_voiceCount; ++i) {
+            const Voice& voice = m_voices[i];
+            if (voice.instrumentId == instrumentId && !voice.isFading()) {
+                ++playing;
+                if (oldest < 0 || voice.position > m_voices[oldest].position) {
+                    oldest = i;
+                }
+            }
+        }
+        if (playing >= limit) {
+            fadeOut(m_voices[oldest]);
+            m_stolenVoices.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    Voice& voice = m_voices[allocateVoice()];
+    voice.sample = sample;
+    voice.position = 0;
+    voice.fadeRemaining = -1;
+    voice.instrumentId = instrumentId;
+    voice.chokeGroup = group;
+    voice.gainLeft = m_gainLeft[instrumentId];
+    voice.gainRight = m_gainRight[instrumentId];
+
+    if (m_voiceCount > m_peakVoices.load(std::memory_order_relaxed)) {
+        m_peakVoices.store(m_voiceCount, std::memory_order_relaxed);
+    }
+}
+
+int AudioMixer::allocateVoice() {
+    // Pool plein : la voix audible la plus ancienne (la plus avancée ; à égalité,
+    // le plus petit indice) s'éteint en fondu et la nouvelle prend un autre emplacement
+    int sounding = 0;
+    int oldest = -1;
+    for (int i = 0; i < m_voiceCount; ++i) {
+        const Voice& voice = m_voices[i];
+        if (!voice.isFading()) {
+            ++sounding;
+            if (oldest < 0 || voice.position > m_voices[oldest].position) {
+                oldest = i;
+            }
+        }
+    }
+    if (sounding >= MAX_VOICES) {
+        fadeOut(m_voices[oldest]);
+        m_stolenVoices.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (m_voiceCount < VOICE_SLOTS) {
+        return m_voiceCount++;
+    }
+
+    // Réserve épuisée (au moins FADE_RESERVE voix en fondu) : la voix la plus
+    // avancée dans son fondu, donc la plus faible, est remplacée
+    int slot = -1;
+    for (int i = 0; i < m_voiceCount; ++i) {
+        const Voice& voice = m_voices[i];
+        if (voice.isFading() && (slot < 0 || voice.fadeRemaining < m_voices[slot].fadeRemaining)) {
+            slot = i;
+        }
+    }
+    return slot;
+}
+
+void AudioMixer::fadeOut(Voice& voice) {
+    voice.fadeRemaining = FADE_FRAMES;
+}
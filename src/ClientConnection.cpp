@@ -0,0 +1,489 @@
+#include "ClientConnection.h"
+#include "ClockSync.h"
+#include "UdpChannel.h"
+#include <QTimer>
+#include <QDebug>
+
+ClientConnection::ClientConnection(const QString &clientId, QTcpSocket *socket, QObject *parent)
+    : QObject(parent), m_clientId(clientId), m_socket(socket)
+{
+    // Le socket suit la connexion lors des changements de thread
+    m_socket->setParent(this);
+    // Les écritures sont déjà regroupées par tour de boucle : Nagle ne ferait que retarder les PING
+    m_socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+
+    connect(m_socket, &QTcpSocket::readyRead, this, &ClientConnection::onReadyRead);
+    connect(m_socket, &QTcpSocket::bytesWritten, this, &ClientConnection::flushWrites);
+    connect(m_socket, &QTcpSocket::disconnected, this, &ClientConnection::disconnected);
+}
+
+ClientConnection::~ClientConnection()
+{
+    releaseUdp();
+}
+
+bool ClientConnection::isConnected() const
+{
+    return m_socket->state() == QAbstractSocket::ConnectedState;
+}
+
+void ClientConnection::setOutgoingIdTable(std::shared_ptr<Protocol::UserIdTable> table)
+{
+    m_session.setOutgoingIdTable(std::move(table));
+}
+
+void ClientConnection::send(const QByteArray &message)
+{
+    OutgoingFrame frame(message);
+    send(frame);
+}
+
+void ClientConnection::send(OutgoingFrame &frame)
+{
+    // Chaque variante n'est encodée qu'une fois pour l'ensemble des destinataires
+    bool definesAlias = false;
+    const QByteArray bytes = m_session.encode(frame, &definesAlias);
+
+    // Message éphémère : un datagramme, sans file ni regroupement
+    if (m_udpBound && Protocol::isTransient(frame.canonical()) &&
+        Protocol::DATAGRAM_TOKEN_SIZE + bytes.size() <= Protocol::MAX_DATAGRAM_SIZE)
+    {
+        m_udpChannel->send(m_udpAddress, m_udpPort, Protocol::createDatagram(m_udpToken, bytes));
+        return;
+    }
+
+    // Seules les trames qui attendent en file peuvent être fusionnées : la cellule
+    // n'est extraite que dans ce cas. Une trame qui définit un alias n'est jamais retirée.
+    const bool waits = queuedMessages() > 0 || m_socket->bytesToWrite() >= WRITE_HIGH_WATER;
+    queueWrite(bytes, (waits && !definesAlias) ? frame.gridCellKey() : -1,
+               Protocol::isLatencyCritical(frame.canonical()));
+}
+
+void ClientConnection::setUdpChannel(UdpChannel *channel)
+{
+    releaseUdp();
+    m_udpChannel = channel;
+}
+
+void ClientConnection::receiveDatagram(const QHostAddress &address, quint16 port, const QByteArray &frame)
+{
+    if (m_paused || !isConnected())
+    {
+        return; // Perdu comme tout datagramme : rien d'important n'y circule
+    }
+
+    MessageType type;
+    QJsonObject content;
+    if (!m_session.decode(frame, type, content))
+    {
+        return;
+    }
+
+    if (type == MessageType::UDP_BIND)
+    {
+        // Le client reçoit bien à cette adresse (NAT compris) : les messages éphémères y partent
+        const bool rebound = m_udpBound && (address != m_udpAddress || port != m_udpPort);
+        if (!m_udpBound || rebound)
+        {
+            qDebug() << "[SERVER] Canal UDP ouvert avec" << m_clientId << ":" << address.toString() << port;
+        }
+        m_udpAddress = address;
+        m_udpPort = port;
+        m_udpBound = true;
+        send(Protocol::createUdpBindMessage());
+        return;
+    }
+    if (!m_udpBound)
+    {
+        return;
+    }
+
+    switch (type)
+    {
+    case MessageType::PING:
+    case MessageType::PONG:
+    case MessageType::CLOCK_SYNC:
+        handleTransportMessage(type, content);
+        break;
+    case MessageType::PAD_HIT:
+        emit messageReceived(type, content, Protocol::canonicalFrame(frame, type, content));
+        break;
+    default:
+        // Les opérations de session n'ont ni ordre ni garantie de livraison en UDP
+        qWarning() << "[SERVER] Message" << Protocol::messageTypeToString(type) << "ignoré sur UDP de" << m_clientId;
+        break;
+    }
+}
+
+void ClientConnection::setSendQueueLimits(const SendQueueLimits &limits)
+{
+    m_limits = limits;
+    checkSendBudget();
+}
+
+QJsonObject ClientConnection::queueStats() const
+{
+    QJsonObject stats;
+    stats["queuedMessages"] = queuedMessages();
+    stats["queuedBytes"] = m_queuedBytes;
+    stats["socketBytes"] = m_socket->bytesToWrite();
+    stats["peakBytes"] = m_peakQueuedBytes;
+    stats["coalesced"] = m_coalescedFrames;
+    stats["overBudgetMs"] = m_overBudgetTimer.isValid() ? m_overBudgetTimer.elapsed() : 0;
+    return stats;
+}
+
+bool ClientConnection::heartbeat(int maxMissedPongs)
+{
+    checkSendBudget();
+    if (m_linkStats.missedPongs() >= maxMissedPongs)
+    {
+        return false;
+    }
+    // PONG perdus sur UDP : les messages éphémères repassent par TCP, avant l'éviction
+    if (m_udpBound && m_linkStats.missedPongs() >= qBound(1, maxMissedPongs - 1, UDP_FALLBACK_MISSED_PONGS))
+    {
+        m_udpBound = false;
+        qDebug() << "[SERVER] Canal UDP muet, repli sur TCP pour" << m_clientId;
+    }
+    send(Protocol::createPingMessage(m_linkStats.recordPing(ClockSync::nowUs())));
+    return true;
+}
+
+void ClientConnection::pause()
+{
+    m_paused = true;
+}
+
+void ClientConnection::resume()
+{
+    m_paused = false;
+    onReadyRead(); // Trames arrivées pendant la migration
+    flushWrites();
+}
+
+void ClientConnection::close()
+{
+    releaseUdp();
+    if (m_socket->state() == QTcpSocket::UnconnectedState)
+    {
+        return;
+    }
+    flushWrites(); // Les trames du tour en cours partent avant la fermeture
+    m_socket->disconnectFromHost();
+    if (m_socket->state() != QTcpSocket::UnconnectedState)
+    {
+        // Pair qui n'acquitte pas : coupé plus tard, sans bloquer les autres salons du thread
+        QTimer::singleShot(CLOSE_TIMEOUT_MS, this, [this]()
+                           {
+            if (m_socket->state() != QTcpSocket::UnconnectedState) {
+                m_socket->abort();
+            } });
+    }
+}
+
+void ClientConnection::waitForClosed(QDeadlineTimer deadline)
+{
+    if (m_socket->state() != QTcpSocket::UnconnectedState &&
+        !m_socket->waitForDisconnected(int(qMax<qint64>(0, deadline.remainingTime()))))
+    {
+        m_socket->abort();
+    }
+}
+
+void ClientConnection::abort()
+{
+    releaseUdp();
+    m_socket->abort();
+}
+
+void ClientConnection::onReadyRead()
+{
+    if (m_decoding)
+    {
+        return; // Les octets restent dans le socket, repris par la boucle en cours
+    }
+    m_decoding = true;
+
+    do
+    {
+        m_decoder.readFrom(m_socket);
+
+        // Les trames sont des vues sur l'anneau de réception, valides jusqu'au prochain readFrom
+        QByteArrayView frame;
+        while (!m_paused)
+        {
+            const FrameDecoder::Status status = m_decoder.next(frame);
+            if (status == FrameDecoder::Status::NeedMore)
+            {
+                break;
+            }
+            if (status == FrameDecoder::Status::Oversized)
+            {
+                qWarning() << "[SERVER] Message trop volumineux de" << m_clientId;
+                m_decoding = false;
+                m_socket->disconnectFromHost();
+                return;
+            }
+            processFrame(frame);
+        }
+    } while (!m_paused && m_socket->bytesAvailable() > 0);
+
+    m_decoding = false;
+}
+
+void ClientConnection::processFrame(QByteArrayView frame)
+{
+    MessageType type;
+    QJsonObject content;
+    if (!m_session.decode(frame, type, content))
+    {
+        qWarning() << "[SERVER] Message invalide reçu de" << m_clientId;
+        return;
+    }
+
+    switch (type)
+    {
+    case MessageType::HELLO:
+    {
+        // Binaire si le client le propose et que le serveur n'est pas en mode debug JSON
+        const QStringList formats = content["formats"].toVariant().toStringList();
+        WireFormat chosen = WireFormat::Json;
+        if (Protocol::defaultFormat() == WireFormat::Binary &&
+            formats.contains(Protocol::wireFormatToString(WireFormat::Binary)))
+        {
+            chosen = WireFormat::Binary;
+        }
+
+        // Canal UDP proposé si le serveur en a un et que le client l'accepte
+        if (m_udpChannel && m_udpToken == 0 && content["udp"].toBool() && m_udpChannel->isBound())
+        {
+            m_udpToken = m_udpChannel->registerConnection(this);
+        }
+        const quint16 udpPort = m_udpToken != 0 ? m_udpChannel->port() : 0;
+
+        // La réponse part encore en JSON, le client bascule à sa réception
+        queueWrite(Protocol::createHelloReplyMessage(chosen, udpPort, m_udpToken), -1, true);
+        m_session.setFormat(chosen);
+        qDebug() << "[SERVER] Format négocié avec" << m_clientId << ":" << Protocol::wireFormatToString(chosen);
+        break;
+    }
+
+    case MessageType::USER_ALIAS:
+        break; // Enregistré par la session
+
+    case MessageType::UDP_BIND:
+        break; // N'a de sens que sur le canal UDP
+
+    case MessageType::PING:
+    case MessageType::PONG:
+    case MessageType::CLOCK_SYNC:
+        handleTransportMessage(type, content);
+        break;
+
+    default:
+        // Seuls les messages remontés sont copiés hors de l'anneau
+        emit messageReceived(type, content, Protocol::canonicalFrame(frame, type, content));
+        break;
+    }
+}
+
+void ClientConnection::handleTransportMessage(MessageType type, const QJsonObject &content)
+{
+    // Réponses par le même chemin que les autres messages éphémères (UDP si ouvert)
+    switch (type)
+    {
+    case MessageType::PING:
+        send(Protocol::createPongMessage(quint32(content["seq"].toInteger())));
+        break;
+
+    case MessageType::PONG:
+        if (m_linkStats.recordPong(quint32(content["seq"].toInteger()), ClockSync::nowUs()))
+        {
+            emit linkStatsChanged();
+        }
+        break;
+
+    case MessageType::CLOCK_SYNC:
+    {
+        // L'horloge monotone du serveur est l'horloge partagée de toutes les sessions
+        const qint64 receivedUs = ClockSync::nowUs();
+        send(Protocol::createClockSyncReplyMessage(content["t0"].toInteger(), receivedUs, ClockSync::nowUs()));
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
+void ClientConnection::queueWrite(const QByteArray &bytes, int cellKey, bool urgent)
+{
+    if (m_dropScheduled)
+    {
+        return; // Connexion condamnée : la file ne grossit plus
+    }
+
+    // Un état plus récent de la même cellule rend l'ancien GRID_UPDATE inutile. Le nouveau
+    // passe en fin de file : les révisions restent croissantes côté client. L'ancien est
+    // vidé sur place, sans décaler la file : l'index des cellules reste valable.
+    if (cellKey >= 0)
+    {
+        auto queued = m_queuedCells.find(cellKey);
+        if (queued != m_queuedCells.end())
+        {
+            QueuedFrame &previous = m_writeQueue[queued.value() - m_writeQueueBase];
+            m_queuedBytes -= previous.bytes.size();
+            previous.bytes.clear();
+            previous.cellKey = -1;
+            ++m_supersededFrames;
+            ++m_coalescedFrames;
+        }
+        m_queuedCells.insert(cellKey, m_writeQueueBase + m_writeQueue.size());
+    }
+
+    m_writeQueue.append({bytes, cellKey});
+    m_queuedBytes += bytes.size();
+    m_peakQueuedBytes = qMax(m_peakQueuedBytes, m_queuedBytes);
+
+    if (urgent)
+    {
+        // Part avec ce qui attendait déjà : l'ordre des trames est conservé
+        flushWrites();
+    }
+    else
+    {
+        scheduleFlush();
+    }
+}
+
+void ClientConnection::scheduleFlush()
+{
+    if (m_flushScheduled)
+    {
+        return;
+    }
+    m_flushScheduled = true;
+    // Exécuté après les événements déjà en file : une rafale (diffusion, tracé à la
+    // souris) ne donne qu'une écriture
+    QMetaObject::invokeMethod(this, &ClientConnection::flushWrites, Qt::QueuedConnection);
+}
+
+void ClientConnection::flushWrites()
+{
+    m_flushScheduled = false;
+    if (m_paused)
+    {
+        return; // Reprise par resume() sur le thread d'arrivée
+    }
+
+    // Le tampon interne du socket reste court ; le reste attend sous forme partagée.
+    // Les trames sont concaténées pour ne confier qu'un bloc au socket.
+    while (!m_writeQueue.isEmpty() && m_socket->bytesToWrite() < WRITE_HIGH_WATER)
+    {
+        const qint64 room = WRITE_HIGH_WATER - m_socket->bytesToWrite();
+        qsizetype count = 1;
+        qint64 size = m_writeQueue.constFirst().bytes.size();
+        while (count < m_writeQueue.size() && size + m_writeQueue.at(count).bytes.size() <= room)
+        {
+            size += m_writeQueue.at(count).bytes.size();
+            ++count;
+        }
+
+        QByteArray block;
+        if (count == 1)
+        {
+            block = m_writeQueue.constFirst().bytes; // Partagé, sans copie
+        }
+        else
+        {
+            block.reserve(size);
+            for (qsizetype i = 0; i < count; ++i)
+            {
+                block.append(m_writeQueue.at(i).bytes);
+            }
+        }
+
+        if (m_socket->write(block) < 0)
+        {
+            qWarning() << "[SERVER] Erreur d'écriture:" << m_socket->errorString();
+            dropQueuedFrames(m_writeQueue.size());
+            m_queuedBytes = 0;
+            return;
+        }
+        m_queuedBytes -= size;
+        dropQueuedFrames(count);
+    }
+
+    checkSendBudget();
+}
+
+void ClientConnection::dropQueuedFrames(qsizetype count)
+{
+    for (qsizetype i = 0; i < count; ++i)
+    {
+        const QueuedFrame &frame = m_writeQueue.at(i);
+        if (frame.cellKey >= 0)
+        {
+            m_queuedCells.remove(frame.cellKey);
+        }
+        else if (frame.bytes.isEmpty())
+        {
+            --m_supersededFrames;
+        }
+    }
+    m_writeQueue.remove(0, count);
+    m_writeQueueBase += count;
+}
+
+void ClientConnection::checkSendBudget()
+{
+    const bool overBudget = m_queuedBytes > m_limits.maxBytes || queuedMessages() > m_limits.maxMessages;
+    if (!overBudget)
+    {
+        m_overBudgetTimer.invalidate();
+        return;
+    }
+
+    if (!m_overBudgetTimer.isValid())
+    {
+        m_overBudgetTimer.start();
+        qDebug() << "[SERVER] File d'envoi au-delà du budget pour" << m_clientId << ":"
+                 << queuedMessages() << "messages," << m_queuedBytes << "octets";
+    }
+
+    const int factor = SendQueueLimits::HARD_LIMIT_FACTOR;
+    if (m_queuedBytes > factor * m_limits.maxBytes || queuedMessages() > factor * m_limits.maxMessages)
+    {
+        scheduleDrop("limite absolue de la file d'envoi atteinte");
+    }
+    else if (m_overBudgetTimer.elapsed() >= m_limits.overBudgetTimeoutMs)
+    {
+        scheduleDrop("file d'envoi au-delà du budget trop longtemps");
+    }
+}
+
+void ClientConnection::scheduleDrop(const char *reason)
+{
+    if (m_dropScheduled)
+    {
+        return;
+    }
+    m_dropScheduled = true;
+    qWarning() << "[SERVER] Client lent déconnecté:" << m_clientId << "-" << reason;
+
+    // Différé : l'appelant parcourt peut-être la liste des connexions de son propriétaire
+    QMetaObject::invokeMethod(this, [this]()
+                              { m_socket->abort(); }, Qt::QueuedConnection);
+}
+
+void ClientConnection::releaseUdp()
+{
+    if (m_udpChannel && m_udpToken != 0)
+    {
+        m_udpChannel->unregisterConnection(m_udpToken);
+    }
+    m_udpChannel = nullptr;
+    m_udpToken = 0;
+    m_udpBound = false;
+}
@@ -0,0 +1,37 @@
+#include "ClockSync.h"
+#include <chrono>
+
+qint64 ClockSync::nowUs() {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void ClockSync::reset() {
+    m_samples = {};
+    m_count = 0;
+    m_next = 0;
+    m_offsetUs = 0;
+    m_rttUs = 0;
+}
+
+void ClockSync::addSample(qint64 t0, qint64 t1, qint64 t2, qint64 t3) {
+    // Aller-retour réseau, hors temps de traitement du serveur
+    const qint64 rtt = (t3 - t0) - (t2 - t1);
+    if (rtt < 0) {
+        return; // Échantillon incohérent
+    }
+
+    m_samples[m_next] = {((t1 - t0) + (t2 - t3)) / 2, rtt};
+    m_next = (m_next + 1) % WINDOW;
+    m_count = qMin(m_count + 1, WINDOW);
+
+    // Filtre d'horloge : l'échantillon au plus court aller-retour a l'asymétrie minimale
+    const Sample* best = &m_samples[0];
+    for (int i = 1; i < m_count; ++i) {
+        if (m_samples[i].rttUs < best->rttUs) {
+            best = &m_samples[i];
+        }
+    }
+    m_offsetUs = best->offsetUs;
+    m_rttUs = best->rttUs;
+}
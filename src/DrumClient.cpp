@@ -1,11 +1,13 @@
 #include "DrumClient.h"
-#include <QDataStream>
 #include <QDebug>
+#include <QNetworkDatagram>
+#include <utility>
 #include "Protocol.h"
 
 
 DrumClient::DrumClient(QObject *parent)
-    : QObject(parent), m_socket(new QTcpSocket(this)), m_pingTimer(new QTimer(this)), m_serverPort(0)
+    : QObject(parent), m_socket(new QTcpSocket(this)), m_pingTimer(new QTimer(this)), m_clockSyncTimer(new QTimer(this)), m_serverPort(0),
+      m_udpSocket(new QUdpSocket(this)), m_udpBindTimer(new QTimer(this))
 {
     // Connexions des signaux du socket
     connect(m_socket, &QTcpSocket::connected, this, &DrumClient::onConnected);
@@ -14,9 +16,16 @@ DrumClient::DrumClient(QObject *parent)
     connect(m_socket, QOverload<QAbstractSocket::SocketError>::of(&QTcpSocket::errorOccurred),
             this, &DrumClient::onSocketError);
 
-    // Timer de ping pour maintenir la connexion
-    m_pingTimer->setInterval(30000); // 30 secondes
+    // Battement de cœur : mesure du lien et détection d'un serveur muet
+    m_pingTimer->setInterval(DEFAULT_HEARTBEAT_INTERVAL_MS);
     connect(m_pingTimer, &QTimer::timeout, this, &DrumClient::onPingTimer);
+
+    connect(m_clockSyncTimer, &QTimer::timeout, this, &DrumClient::onClockSyncTimer);
+
+    // Canal UDP : UDP_BIND répété jusqu'à l'accusé du serveur (datagrammes perdus, NAT)
+    connect(m_udpSocket, &QUdpSocket::readyRead, this, &DrumClient::onUdpDataReceived);
+    m_udpBindTimer->setInterval(UDP_BIND_INTERVAL_MS);
+    connect(m_udpBindTimer, &QTimer::timeout, this, &DrumClient::onUdpBindTimer);
 }
 
 DrumClient::~DrumClient()
@@ -51,6 +60,9 @@ void DrumClient::disconnectFromServer()
     }
 
     m_pingTimer->stop();
+    m_clockSyncTimer->stop();
+    flushOutgoing();
+    resetUdp();
 
     if (m_socket->state() != QTcpSocket::UnconnectedState)
     {
@@ -63,7 +75,7 @@ void DrumClient::disconnectFromServer()
         }
     }
 
-    m_buffer.clear();
+    m_decoder.clear();
 }
 
 bool DrumClient::isConnected() const
@@ -80,26 +92,74 @@ void DrumClient::sendMessage(const QByteArray &message)
         return;
     }
 
-    qint64 written = m_socket->write(message);
-    if (written != message.size())
+    // Messages éphémères : un datagramme dès que le canal UDP est ouvert
+    if (m_udpBound && Protocol::isTransient(message))
     {
-        qWarning() << "Erreur d'envoi de message:" << written << "/" << message.size() << "bytes envoyés";
-        emit errorOccurred("Erreur d'envoi de message");
+        sendDatagram(message);
+        return;
+    }
+
+    // Conversion au format négocié avec le serveur
+    m_outgoing.append(m_session.encode(message));
+
+    // Les trames d'un même tour (tracé à la souris, ajout de colonnes en série) partent
+    // ensemble ; les messages de mesure n'attendent pas, avec ce qui les précède
+    if (Protocol::isLatencyCritical(message))
+    {
+        flushOutgoing();
     }
-    else
+    else if (!m_flushScheduled)
     {
-        qDebug() << "Message envoyé au serveur:" << message.size() << "bytes";
+        m_flushScheduled = true;
+        QMetaObject::invokeMethod(this, &DrumClient::flushOutgoing, Qt::QueuedConnection);
+    }
+}
+
+void DrumClient::flushOutgoing()
+{
+    m_flushScheduled = false;
+    if (m_outgoing.isEmpty())
+    {
+        return;
+    }
+
+    const QByteArray block = std::exchange(m_outgoing, QByteArray());
+    if (!isConnected())
+    {
+        return; // Déconnecté entre l'envoi et la fin du tour
+    }
+
+    qint64 written = m_socket->write(block);
+    if (written != block.size())
+    {
+        qWarning() << "Erreur d'envoi de message:" << written << "/" << block.size() << "bytes envoyés";
+        emit errorOccurred("Erreur d'envoi de message");
     }
 }
 
 void DrumClient::onConnected()
 {
     qDebug() << "Connecté au serveur" << m_serverHost << ":" << m_serverPort;
+    m_linkStats.reset();
     m_pingTimer->start();
+    // Les écritures sont regroupées par tour de boucle : Nagle ne ferait que retarder les PING
+    m_socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    m_outgoing.clear(); // Trames d'une connexion précédente, encodées pour l'ancienne session
+    resetUdp();
+
+    // Nouvelle connexion : JSON jusqu'à la réponse du serveur à notre HELLO
+    m_session = WireSession();
+    sendMessage(Protocol::createHelloMessage());
 
     QByteArray request = Protocol::createRoomListRequestMessage();
     sendMessage(request);
 
+    // Synchronisation d'horloge : rafale de sondes pour une estimation rapide
+    m_clock.reset();
+    m_clockProbesSent = 0;
+    m_clockSyncTimer->start(CLOCK_SYNC_BURST_INTERVAL_MS);
+    onClockSyncTimer();
+
     emit connected();
 }
 
@@ -107,50 +167,47 @@ void DrumClient::onDisconnected()
 {
     qDebug() << "Déconnecté du serveur";
     m_pingTimer->stop();
-    m_buffer.clear();
+    m_clockSyncTimer->stop();
+    m_decoder.clear();
+    m_outgoing.clear();
+    resetUdp();
     emit disconnected();
 }
 
 void DrumClient::onDataReceived()
 {
-    QByteArray newData = m_socket->readAll();
-    m_buffer.append(newData);
-
-    qDebug() << "Données reçues du serveur:" << newData.size() << "bytes";
+    if (m_decoding)
+    {
+        return; // Réentrance (attente bloquante dans un gestionnaire) : la boucle en cours reprendra
+    }
+    m_decoding = true;
 
-    // Traitement des messages complets
-    while (m_buffer.size() >= 4)
+    do
     {
-        QDataStream stream(m_buffer);
-        stream.setByteOrder(QDataStream::BigEndian);
-
-        quint32 messageSize;
-        stream >> messageSize;
-
-        // Validation de la taille
-        if (messageSize > 1024 * 1024)
-        { // 1MB max
-            qWarning() << "Message trop volumineux reçu:" << messageSize << "bytes";
-            m_socket->disconnectFromHost();
-            return;
-        }
+        m_decoder.readFrom(m_socket);
 
-        if (m_buffer.size() >= 4 + messageSize)
+        // Traitement des messages complets, lus en place dans l'anneau de réception
+        QByteArrayView message;
+        for (;;)
         {
-            QByteArray message = m_buffer.mid(0, 4 + messageSize);
-            m_buffer.remove(0, 4 + messageSize);
-
-            qDebug() << "Message complet reçu:" << messageSize << "bytes";
+            const FrameDecoder::Status status = m_decoder.next(message);
+            if (status == FrameDecoder::Status::NeedMore)
+            {
+                // Message incomplet, attendre plus de données
+                break;
+            }
+            if (status == FrameDecoder::Status::Oversized)
+            {
+                qWarning() << "Message trop volumineux reçu, coupure de la connexion";
+                m_decoding = false;
+                m_socket->disconnectFromHost();
+                return;
+            }
             processMessage(message);
         }
-        else
-        {
-            // Message incomplet, attendre plus de données
-            qDebug() << "Message incomplet - attendu:" << (4 + messageSize)
-                     << "reçu:" << m_buffer.size();
-            break;
-        }
-    }
+    } while (m_socket->bytesAvailable() > 0);
+
+    m_decoding = false;
 }
 
 void DrumClient::onSocketError(QAbstractSocket::SocketError error)
@@ -183,20 +240,132 @@ void DrumClient::onSocketError(QAbstractSocket::SocketError error)
     emit errorOccurred(errorString);
 }
 
+void DrumClient::setHeartbeat(int intervalMs, int maxMissedPongs)
+{
+    m_pingTimer->setInterval(qMax(100, intervalMs));
+    m_maxMissedPongs = qMax(1, maxMissedPongs);
+}
+
 void DrumClient::onPingTimer()
 {
-    if (isConnected())
+    if (!isConnected())
+    {
+        return;
+    }
+
+    // Le socket peut rester "connecté" alors que le serveur ne répond plus
+    if (m_linkStats.missedPongs() >= m_maxMissedPongs)
+    {
+        qWarning() << "Serveur sans réponse après" << m_linkStats.missedPongs() << "PING, coupure de la connexion";
+        emit errorOccurred("Le serveur ne répond plus");
+        m_socket->abort(); // Émet disconnected
+        return;
+    }
+
+    // PONG perdus sur UDP : retour à TCP pour les messages éphémères, avant la coupure
+    if (m_udpBound && m_linkStats.missedPongs() >= qBound(1, m_maxMissedPongs - 1, UDP_FALLBACK_MISSED_PONGS))
+    {
+        m_udpBound = false;
+        qWarning() << "Canal UDP muet, repli sur TCP";
+    }
+
+    sendMessage(Protocol::createPingMessage(m_linkStats.recordPing(ClockSync::nowUs())));
+}
+
+void DrumClient::onClockSyncTimer()
+{
+    if (!isConnected())
+    {
+        return;
+    }
+
+    sendMessage(Protocol::createClockSyncRequestMessage(ClockSync::nowUs()));
+    if (++m_clockProbesSent == CLOCK_SYNC_BURST)
+    {
+        m_clockSyncTimer->setInterval(CLOCK_SYNC_INTERVAL_MS);
+    }
+}
+
+void DrumClient::openUdpChannel(const QJsonObject& helloReply)
+{
+    bool ok = false;
+    const quint64 token = helloReply["udpToken"].toString().toULongLong(&ok);
+    const int port = helloReply["udpPort"].toInt();
+    if (!ok || token == 0 || port <= 0 || port > 0xFFFF)
+    {
+        return; // Serveur sans canal UDP : tout reste sur TCP
+    }
+
+    if (!m_udpSocket->bind())
+    {
+        qWarning() << "Canal UDP indisponible:" << m_udpSocket->errorString();
+        return;
+    }
+
+    m_udpAddress = m_socket->peerAddress();
+    m_udpPort = quint16(port);
+    m_udpToken = token;
+    m_udpBindAttempts = 0;
+    m_udpBindTimer->start();
+    onUdpBindTimer();
+}
+
+void DrumClient::sendDatagram(const QByteArray& message)
+{
+    const QByteArray frame = m_session.encode(message);
+    if (Protocol::DATAGRAM_TOKEN_SIZE + frame.size() > Protocol::MAX_DATAGRAM_SIZE)
+    {
+        // Trop gros pour un datagramme sûr : repli ponctuel sur TCP
+        m_outgoing.append(frame);
+        flushOutgoing();
+        return;
+    }
+    m_udpSocket->writeDatagram(Protocol::createDatagram(m_udpToken, frame), m_udpAddress, m_udpPort);
+}
+
+void DrumClient::onUdpBindTimer()
+{
+    if (m_udpBound || m_udpToken == 0)
     {
-        // Vérifier que la connexion est toujours active
-        if (m_socket->state() != QTcpSocket::ConnectedState)
+        m_udpBindTimer->stop();
+        return;
+    }
+    if (m_udpBindAttempts++ >= UDP_BIND_ATTEMPTS)
+    {
+        // Pare-feu ou NAT qui filtre l'UDP : la session continue en TCP seul
+        qWarning() << "Pas de réponse du serveur sur UDP, TCP seul";
+        m_udpBindTimer->stop();
+        return;
+    }
+    sendDatagram(Protocol::createUdpBindMessage());
+}
+
+void DrumClient::onUdpDataReceived()
+{
+    while (m_udpSocket->hasPendingDatagrams())
+    {
+        const QNetworkDatagram datagram = m_udpSocket->receiveDatagram(Protocol::MAX_DATAGRAM_SIZE);
+        const QByteArray data = datagram.data();
+        quint64 token;
+        QByteArrayView frame;
+        if (m_udpToken == 0 || !Protocol::splitDatagram(data, token, frame) || token != m_udpToken)
         {
-            qWarning() << "Connexion perdue détectée par le ping timer";
-            onDisconnected();
+            continue; // Datagramme étranger ou d'une session précédente
         }
+        processMessage(frame);
     }
 }
 
-void DrumClient::processMessage(const QByteArray &data) {
+void DrumClient::resetUdp()
+{
+    m_udpBindTimer->stop();
+    m_udpSocket->close();
+    m_udpToken = 0;
+    m_udpPort = 0;
+    m_udpBound = false;
+}
+
+void DrumClient::processMessage(QByteArrayView data) {
     if (data.size() < 4) {
         qWarning() << "[CLIENT] Message trop court reçu";
         return;
@@ -205,44 +374,57 @@ void DrumClient::processMessage(const QByteArray &data) {
     MessageType type;
     QJsonObject content;
 
-    if (!Protocol::parseMessage(data, type, content)) {
+    if (!m_session.decode(data, type, content)) {
         qWarning() << "[CLIENT] Impossible de parser le message";
         return;
     }
 
-    qDebug() << "[CLIENT] Message reçu type:" << Protocol::messageTypeToString(type);
-
     switch (type) {
-    case MessageType::ROOM_LIST_RESPONSE: {
-        qDebug() << "[CLIENT] === DIAGNOSTIC ROOM_LIST_RESPONSE ===";
-        qDebug() << "[CLIENT] Contenu JSON complet reçu:" << QJsonDocument(content).toJson(QJsonDocument::Compact);
-        qDebug() << "[CLIENT] Clés disponibles dans content:" << content.keys();
-        qDebug() << "[CLIENT] Contient 'rooms':" << content.contains("rooms");
-
-        if (content.contains("rooms")) {
-            QJsonValue roomsValue = content["rooms"];
-            qDebug() << "[CLIENT] Type de 'rooms':" << (roomsValue.isArray() ? "Array" : "Autre");
-
-            if (roomsValue.isArray()) {
-                QJsonArray roomsArray = roomsValue.toArray();
-                qDebug() << "[CLIENT] Nombre de salles dans le JSON:" << roomsArray.size();
-
-                // Afficher chaque salle
-                for (int i = 0; i < roomsArray.size(); ++i) {
-                    QJsonObject room = roomsArray[i].toObject();
-                    qDebug() << "[CLIENT] Salle" << i << ":" << room["name"].toString()
-                             << "ID:" << room["id"].toString();
-                }
-
-                emit roomListReceived(roomsArray);
-            } else {
-                qWarning() << "[CLIENT] 'rooms' n'est pas un array";
-            }
-        } else {
-            qWarning() << "[CLIENT] Pas de clé 'rooms' dans le JSON";
+    case MessageType::HELLO: {
+        // Réponse du serveur : format retenu pour la suite de la connexion
+        WireFormat format;
+        if (Protocol::wireFormatFromString(content["format"].toString(), format)) {
+            m_session.setFormat(format);
+            qDebug() << "[CLIENT] Format de transport négocié:" << Protocol::wireFormatToString(format);
+        }
+        openUdpChannel(content);
+        return; // Message de transport, pas destiné à l'application
+    }
+    case MessageType::UDP_BIND:
+        // Accusé du serveur : notre adresse UDP est vérifiée
+        if (m_udpToken != 0 && !m_udpBound) {
+            m_udpBound = true;
+            m_udpBindTimer->stop();
+            qDebug() << "[CLIENT] Canal UDP ouvert pour les messages éphémères";
         }
+        return; // Message de transport
+    case MessageType::USER_ALIAS:
+        return; // Déjà enregistré par la session
+
+    case MessageType::PING:
+        sendMessage(Protocol::createPongMessage(quint32(content["seq"].toInteger())));
+        return; // Message de transport
 
-        qDebug() << "[CLIENT] === FIN DIAGNOSTIC ===";
+    case MessageType::PONG:
+        if (m_linkStats.recordPong(quint32(content["seq"].toInteger()), ClockSync::nowUs())) {
+            emit linkStatsChanged();
+        }
+        return; // Message de transport
+
+    case MessageType::CLOCK_SYNC: {
+        const qint64 t3 = ClockSync::nowUs();
+        m_clock.addSample(content["t0"].toInteger(), content["t1"].toInteger(),
+                          content["t2"].toInteger(), t3);
+        return; // Message de transport
+    }
+
+    case MessageType::ROOM_LIST_RESPONSE: {
+        const QJsonValue rooms = content["rooms"];
+        if (!rooms.isArray()) {
+            qWarning() << "[CLIENT] ROOM_LIST_RESPONSE sans tableau 'rooms'";
+            break;
+        }
+        emit roomListReceived(rooms.toArray());
         break;
     }
 
@@ -259,6 +441,12 @@ void DrumClient::processMessage(const QByteArray &data) {
         break;
     }
 
+    case MessageType::GRID_BATCH:
+        break; // Appliqué par l'application via messageReceived
+
+    case MessageType::PAD_HIT:
+        break; // Joué par l'application via messageReceived
+
     case MessageType::ROOM_INFO: {
         emit roomStateReceived(content);
         break;
@@ -267,7 +455,8 @@ void DrumClient::processMessage(const QByteArray &data) {
         qWarning() << "[CLIENT] Type de message non géré:" << static_cast<int>(type);
     }
 
-    emit messageReceived(data);
+    // Copie hors de l'anneau pour les abonnés
+    emit messageReceived(Protocol::canonicalFrame(data, type, content));
 }
 
 void DrumClient::joinRoom(const QString& roomId, const QString& userId, const QString& userName, const QString& password) {
@@ -1,18 +1,21 @@
 #include "DrumGrid.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
-#include <QHeaderView>
-#include <QTableWidgetItem>
 #include <QJsonArray>
 #include <QScrollBar>
+#include <QMenu>
 
 DrumGrid::DrumGrid(QWidget *parent)
-    : QWidget(parent), m_table(new QTableWidget(this)), m_scrollArea(new QScrollArea(this)), m_stepTimer(new QTimer(this)), m_instruments(8), m_steps(DEFAULT_STEPS), m_currentStep(0), m_tempo(120), m_playing(false)
+    : QWidget(parent), m_scrollArea(new QScrollArea(this)), m_model(new PatternModel(this)), m_view(new PatternView(m_model)), m_instruments(8), m_steps(DEFAULT_STEPS), m_currentStep(0), m_tempo(120), m_playing(false)
 {
+    // La grille n'est qu'une vue du modèle : toute modification passe par lui,
+    // la vue se repeint d'elle-même sur PatternModel::cellChanged
+    connect(m_model, &PatternModel::stepMaskChanged, this, &DrumGrid::stepMaskChanged);
+
     setupGrid();
 
     // Configuration du scroll area
-    m_scrollArea->setWidget(m_table);
+    m_scrollArea->setWidget(m_view);
     m_scrollArea->setWidgetResizable(false);
     m_scrollArea->setHorizontalScrollBarPolicy(Qt::ScrollBarAsNeeded);
     m_scrollArea->setVerticalScrollBarPolicy(Qt::ScrollBarAsNeeded);
@@ -21,11 +24,12 @@ DrumGrid::DrumGrid(QWidget *parent)
     layout->setContentsMargins(0, 0, 0, 0);
     layout->addWidget(m_scrollArea);
 
-    // Configuration du timer
-    connect(m_stepTimer, &QTimer::timeout, this, &DrumGrid::onStepTimer);
-
-    // Configuration de la table
-    connect(m_table, &QTableWidget::cellClicked, this, &DrumGrid::onCellClicked);
+    // Clics sur la vue
+    connect(m_view, &PatternView::cellClicked, this, &DrumGrid::onCellClicked);
+    connect(m_view, &PatternView::cellDragged, this, &DrumGrid::onCellDragged);
+    connect(m_view, &PatternView::dragFinished, this, &DrumGrid::onDragFinished);
+    connect(m_view, &PatternView::rowMenuRequested, this, &DrumGrid::onRowMenuRequested);
+    connect(m_view, &PatternView::rowHeaderClicked, this, &DrumGrid::instrumentTriggered);
 
     // Configuration des instruments par défaut
     QStringList defaultNames = {"Kick", "Snare", "Hi-Hat", "Open Hat",
@@ -38,70 +42,22 @@ void DrumGrid::applyGridUpdate(const GridCell &cell)
     setCellActive(cell.row, cell.col, cell.active, cell.userId);
 }
 
+void DrumGrid::applyGridBatch(const GridBatch &batch)
+{
+    // Une seule mise à jour de la vue pour tout le lot
+    m_model->applyBatch(batch);
+}
+
 void DrumGrid::setupGrid(int instruments, int steps)
 {
     m_instruments = qBound(MIN_INSTRUMENTS, instruments, MAX_INSTRUMENTS);
     m_steps = qBound(MIN_STEPS, steps, MAX_STEPS);
-    m_cellStates.clear();
-
-    m_table->setRowCount(m_instruments);
-    m_table->setColumnCount(m_steps);
-
-    // Style moderne pour la table
-    m_table->setStyleSheet(R"(
-        QTableWidget {
-            background: rgba(255, 255, 255, 0.02);
-            border: 2px solid rgba(255, 255, 255, 0.1);
-            border-radius: 10px;
-            gridline-color: rgba(255, 255, 255, 0.05);
-        }
-
-        QHeaderView::section {
-            background: rgba(255, 255, 255, 0.05);
-            color: #e2e8f0;
-            border: none;
-            padding: 8px;
-            font-weight: bold;
-        }
-
-        QTableWidget::item {
-            background: rgba(255, 255, 255, 0.03);
-            border: 1px solid rgba(255, 255, 255, 0.05);
-        }
-
-        QTableWidget::item:hover {
-            background: rgba(255, 255, 255, 0.08);
-            border: 1px solid rgba(59, 130, 246, 0.3);
-        }
-    )");
-
-    // Configuration de l'apparence
-    m_table->horizontalHeader()->setDefaultSectionSize(40);
-    m_table->verticalHeader()->setDefaultSectionSize(40);
-    m_table->horizontalHeader()->setSectionResizeMode(QHeaderView::Fixed);
-    m_table->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
-    m_table->setSelectionMode(QAbstractItemView::NoSelection);
-
-    // Headers des colonnes (numéros des steps)
-    for (int col = 0; col < m_steps; ++col)
-    {
-        m_table->setHorizontalHeaderItem(col, new QTableWidgetItem(QString::number(col + 1)));
-    }
-
-    // Initialisation des cellules
-    for (int row = 0; row < m_instruments; ++row)
-    {
-        for (int col = 0; col < m_steps; ++col)
-        {
-            QTableWidgetItem *item = new QTableWidgetItem("");
-            item->setFlags(Qt::ItemIsEnabled);
-            item->setTextAlignment(Qt::AlignCenter);
-            m_table->setItem(row, col, item);
-            updateCellAppearance(row, col);
-        }
-    }
+    m_model->clear();
+    m_model->resize(m_instruments, m_steps);
 
     updateTableSize();
+    m_view->update();
+    emitAllStepMasks();
     emit instrumentCountChanged(m_instruments);
 }
 
@@ -118,52 +74,11 @@ void DrumGrid::setInstrumentCount(int instrumentCount)
 
 void DrumGrid::resizeGridForInstruments()
 {
-    // Sauvegarder l'état actuel des cellules pour les instruments existants
-    QMap<QPair<int, int>, QPair<bool, QString>> oldStates = m_cellStates;
-
-    // Redimensionner la table
-    m_table->setRowCount(m_instruments);
-
-    // Nettoyer les états des cellules pour les lignes supprimées
-    if (m_instruments < m_table->rowCount())
-    {
-        for (auto it = m_cellStates.begin(); it != m_cellStates.end();)
-        {
-            if (it.key().first >= m_instruments)
-            {
-                it = m_cellStates.erase(it);
-            }
-            else
-            {
-                ++it;
-            }
-        }
-    }
-
-    // Initialiser les nouvelles cellules
-    for (int row = 0; row < m_instruments; ++row)
-    {
-        for (int col = 0; col < m_steps; ++col)
-        {
-            if (!m_table->item(row, col))
-            {
-                QTableWidgetItem *item = new QTableWidgetItem("");
-                item->setFlags(Qt::ItemIsEnabled);
-                item->setTextAlignment(Qt::AlignCenter);
-                m_table->setItem(row, col, item);
-            }
-            updateCellAppearance(row, col);
-        }
-    }
-
-    // Mettre à jour les headers verticaux avec les noms d'instruments
-    for (int i = 0; i < m_instruments; ++i)
-    {
-        QString name = (i < m_instrumentNames.size()) ? m_instrumentNames[i] : QString("Instrument %1").arg(i + 1);
-        m_table->setVerticalHeaderItem(i, new QTableWidgetItem(name));
-    }
+    // Le modèle efface les lignes supprimées ; la vue reprend ses dimensions
+    m_model->resize(m_instruments, m_steps);
 
     updateTableSize();
+    emitAllStepMasks();
 }
 
 void DrumGrid::addColumn()
@@ -172,22 +87,10 @@ void DrumGrid::addColumn()
         return;
 
     m_steps++;
-    m_table->setColumnCount(m_steps);
-
-    // Ajouter l'en-tête de la nouvelle colonne
-    m_table->setHorizontalHeaderItem(m_steps - 1, new QTableWidgetItem(QString::number(m_steps)));
-
-    // Initialiser les cellules de la nouvelle colonne
-    for (int row = 0; row < m_instruments; ++row)
-    {
-        QTableWidgetItem *item = new QTableWidgetItem("");
-        item->setFlags(Qt::ItemIsEnabled);
-        item->setTextAlignment(Qt::AlignCenter);
-        m_table->setItem(row, m_steps - 1, item);
-        updateCellAppearance(row, m_steps - 1);
-    }
+    m_model->resize(m_instruments, m_steps);
 
     updateTableSize();
+    emit stepMaskChanged(m_steps - 1, 0);
     emit columnCountChanged(m_steps); // AJOUTER CETTE LIGNE
     emit stepCountChanged(m_steps);
 }
@@ -197,15 +100,11 @@ void DrumGrid::removeColumn()
     if (m_steps <= MIN_STEPS)
         return;
 
-    // Supprimer les états des cellules de la dernière colonne
-    for (int row = 0; row < m_instruments; ++row)
-    {
-        QPair<int, int> key(row, m_steps - 1);
-        m_cellStates.remove(key);
-    }
+    // Supprimer les cellules de la dernière colonne
+    emit stepMaskChanged(m_steps - 1, 0);
 
     m_steps--;
-    m_table->setColumnCount(m_steps);
+    m_model->resize(m_instruments, m_steps);
 
     // Si le step actuel est au-delà de la nouvelle limite, le réinitialiser
     if (m_currentStep >= m_steps)
@@ -244,68 +143,21 @@ void DrumGrid::setStepCount(int steps)
 
 void DrumGrid::updateTableSize()
 {
-    // Calculer la taille optimale de la table
-    int tableWidth = m_table->verticalHeader()->width() +
-                     m_table->horizontalHeader()->length() +
-                     m_table->frameWidth() * 2;
-
-    int tableHeight = m_table->horizontalHeader()->height() +
-                      m_table->verticalHeader()->length() +
-                      m_table->frameWidth() * 2;
-
-    m_table->setFixedSize(tableWidth, tableHeight);
+    // La vue a une taille fixe déduite du modèle, le scroll area gère le reste
+    m_view->updateGeometryFromModel();
 
     // Ajuster la taille minimale du widget pour afficher au moins 8 colonnes
-    int minWidth = m_table->verticalHeader()->width() +
-                   (40 * qMin(8, m_steps)) +
-                   m_table->frameWidth() * 2 + 20; // +20 pour la scrollbar
+    int minWidth = PatternView::HEADER_WIDTH +
+                   (PatternView::CELL_SIZE * qMin(8, m_steps)) +
+                   m_scrollArea->frameWidth() * 2 + 20; // +20 pour la scrollbar
 
     setMinimumWidth(minWidth);
 }
 
 void DrumGrid::highlightCurrentStep()
 {
-    // Mise à jour de l'en-tête de colonne pour montrer le step actuel
-    for (int col = 0; col < m_steps; ++col)
-    {
-        QTableWidgetItem *header = m_table->horizontalHeaderItem(col);
-        if (header)
-        {
-            if (col == m_currentStep && m_playing)
-            {
-                header->setBackground(QBrush(QColor(239, 68, 68)));
-                header->setForeground(Qt::white);
-
-                // Animer les cellules actives du step courant
-                for (int row = 0; row < m_instruments; ++row)
-                {
-                    if (isCellActive(row, col))
-                    {
-                        QTableWidgetItem *item = m_table->item(row, col);
-                        if (item)
-                        {
-                            item->setFont(QFont("Arial", 20, QFont::Bold));
-                        }
-                    }
-                }
-            }
-            else
-            {
-                header->setBackground(QBrush());
-                header->setForeground(QColor(226, 232, 240));
-
-                // Restaurer la taille normale
-                for (int row = 0; row < m_instruments; ++row)
-                {
-                    QTableWidgetItem *item = m_table->item(row, col);
-                    if (item && !item->text().isEmpty())
-                    {
-                        item->setFont(QFont("Arial", 16, QFont::Bold));
-                    }
-                }
-            }
-        }
-    }
+    // Seules les colonnes quittée et atteinte par la tête de lecture sont repeintes
+    m_view->setPlayhead(m_playing ? m_currentStep : -1);
 }
 
 void DrumGrid::setInstrumentNames(const QStringList &names)
@@ -318,17 +170,8 @@ void DrumGrid::setInstrumentNames(const QStringList &names)
         setInstrumentCount(names.size());
     }
 
-    // Mise à jour des headers verticaux
-    for (int i = 0; i < qMin(names.size(), m_instruments); ++i)
-    {
-        m_table->setVerticalHeaderItem(i, new QTableWidgetItem(names[i]));
-    }
-
-    // Pour les instruments sans nom, utiliser un nom par défaut
-    for (int i = names.size(); i < m_instruments; ++i)
-    {
-        m_table->setVerticalHeaderItem(i, new QTableWidgetItem(QString("Instrument %1").arg(i + 1)));
-    }
+    // Pour les instruments sans nom, la vue utilise un nom par défaut
+    m_view->setInstrumentNames(names);
 }
 
 void DrumGrid::setPlaying(bool playing)
@@ -337,26 +180,17 @@ void DrumGrid::setPlaying(bool playing)
         return;
 
     m_playing = playing;
-
-    if (playing)
-    {
-        int interval = 60000 / (m_tempo * 4); // 16th notes
-        m_stepTimer->start(interval);
-    }
-    else
-    {
-        m_stepTimer->stop();
-    }
+    highlightCurrentStep();
+    emit playingChanged(playing);
 }
 
 void DrumGrid::setTempo(int bpm)
 {
+    if (m_tempo == bpm)
+        return;
+
     m_tempo = bpm;
-    if (m_playing)
-    {
-        int interval = 60000 / (bpm * 4);
-        m_stepTimer->setInterval(interval);
-    }
+    emit tempoChanged(bpm);
 }
 
 void DrumGrid::setCurrentStep(int step)
@@ -369,9 +203,10 @@ void DrumGrid::setCurrentStep(int step)
     // Auto-scroll pour suivre la lecture
     if (m_playing)
     {
-        int columnX = m_table->columnViewportPosition(m_currentStep);
-        int columnWidth = m_table->columnWidth(m_currentStep);
         QScrollBar *hScrollBar = m_scrollArea->horizontalScrollBar();
+        QRect column = m_view->columnRect(m_currentStep);
+        int columnX = column.x() - hScrollBar->value();
+        int columnWidth = column.width();
 
         if (columnX < 0)
         {
@@ -384,72 +219,42 @@ void DrumGrid::setCurrentStep(int step)
             hScrollBar->setValue(hScrollBar->value() + columnX + columnWidth - m_scrollArea->viewport()->width());
         }
     }
+}
 
-    // Déclenchement des instruments actifs
-    QList<int> activeInstruments;
-    for (int row = 0; row < m_instruments; ++row)
-    {
-        if (isCellActive(row, m_currentStep))
-        {
-            activeInstruments.append(row);
-        }
-    }
+quint64 DrumGrid::stepMask(int col) const
+{
+    return m_model->stepMask(col);
+}
 
-    if (!activeInstruments.isEmpty())
+void DrumGrid::emitAllStepMasks()
+{
+    for (int col = 0; col < m_steps; ++col)
     {
-        emit stepTriggered(m_currentStep, activeInstruments);
+        emit stepMaskChanged(col, stepMask(col));
     }
 }
 
 bool DrumGrid::isCellActive(int row, int col) const
 {
-    QPair<int, int> key(row, col);
-    return m_cellStates.value(key, {false, QString()}).first;
+    return m_model->isActive(row, col);
 }
 
 void DrumGrid::setCellActive(int row, int col, bool active, const QString &userId)
 {
-    if (col >= m_steps || row >= m_instruments)
-        return; // Protection contre les indices invalides
-
-    QPair<int, int> key(row, col);
-    m_cellStates[key] = {active, userId};
-    updateCellAppearance(row, col);
+    // Le modèle ignore les indices invalides et notifie apparence et masque
+    m_model->setCell(row, col, active, userId);
 }
 
 void DrumGrid::setUserColor(const QString &userId, const QColor &color)
 {
-    m_userColors[userId] = color;
-
-    // Mise à jour de toutes les cellules de cet utilisateur
-    for (auto it = m_cellStates.begin(); it != m_cellStates.end(); ++it)
-    {
-        if (it.value().second == userId)
-        {
-            updateCellAppearance(it.key().first, it.key().second);
-        }
-    }
+    // La vue ne repeint que les cellules de cet utilisateur
+    m_view->setUserColor(userId, color);
 }
 
 QJsonObject DrumGrid::getGridState() const
 {
     QJsonObject state;
-    QJsonArray cells;
-
-    for (auto it = m_cellStates.begin(); it != m_cellStates.end(); ++it)
-    {
-        if (it.value().first)
-        { // Seulement les cellules actives
-            QJsonObject cell;
-            cell["row"] = it.key().first;
-            cell["col"] = it.key().second;
-            cell["active"] = true;
-            cell["userId"] = it.value().second;
-            cells.append(cell);
-        }
-    }
-
-    state["cells"] = cells;
+    state["cells"] = m_model->activeCellsToJson(); // Seulement les cellules actives
     state["tempo"] = m_tempo;
     state["playing"] = m_playing;
     state["currentStep"] = m_currentStep;
@@ -462,7 +267,7 @@ QJsonObject DrumGrid::getGridState() const
 void DrumGrid::setGridState(const QJsonObject &state)
 {
     // Réinitialisation
-    m_cellStates.clear();
+    m_model->clear();
 
     // Charger le nombre de steps si présent
     if (state.contains("stepCount"))
@@ -476,17 +281,14 @@ void DrumGrid::setGridState(const QJsonObject &state)
         setInstrumentCount(state["instrumentCount"].toInt());
     }
 
-    // Chargement des cellules
-    QJsonArray cells = state["cells"].toArray();
-    for (const auto &cellValue : cells)
+    // Chargement des cellules (instantané compact du serveur ou format complet)
+    if (state.contains("owners"))
     {
-        QJsonObject cell = cellValue.toObject();
-        int row = cell["row"].toInt();
-        int col = cell["col"].toInt();
-        bool active = cell["active"].toBool();
-        QString userId = cell["userId"].toString();
-
-        setCellActive(row, col, active, userId);
+        m_model->loadCompactCells(state);
+    }
+    else
+    {
+        m_model->loadCells(state["cells"].toArray());
     }
 
     // Mise à jour des paramètres
@@ -499,6 +301,10 @@ void DrumGrid::setGridState(const QJsonObject &state)
     {
         setCurrentStep(state["currentStep"].toInt());
     }
+
+    // Les cellules effacées par la réinitialisation ne passent pas par setCellActive
+    m_view->update();
+    emitAllStepMasks();
 }
 
 void DrumGrid::onCellClicked(int row, int column)
@@ -508,46 +314,97 @@ void DrumGrid::onCellClicked(int row, int column)
 
     setCellActive(row, column, newState, QString()); // ID utilisateur sera défini par l'appelant
     emit cellClicked(row, column, newState);
-}
 
-void DrumGrid::onStepTimer()
-{
-    setCurrentStep(m_currentStep + 1);
+    // Début d'un éventuel tracé : les cellules survolées prennent le même état
+    m_strokeActive = newState;
+    m_stroke = GridBatch();
 }
 
-void DrumGrid::updateCellAppearance(int row, int col)
+void DrumGrid::onCellDragged(int row, int column)
 {
-    QTableWidgetItem *item = m_table->item(row, col);
-    if (!item)
+    if (isCellActive(row, column) == m_strokeActive)
         return;
 
-    QPair<int, int> key(row, col);
-    auto cellData = m_cellStates.value(key, {false, QString()});
-    bool active = cellData.first;
-    QString userId = cellData.second;
+    setCellActive(row, column, m_strokeActive, QString());
+    m_stroke.addCell(row, column, m_strokeActive);
+}
 
-    if (active)
+void DrumGrid::onDragFinished()
+{
+    // Le premier clic est déjà parti seul ; le reste du tracé forme un lot
+    if (!m_stroke.isEmpty())
     {
-        QColor color = m_userColors.value(userId, QColor(100, 150, 255));
-        // Ajouter un effet de lueur pour les cellules actives
-        QString colorStyle = QString(R"(
-            background: %1;
-            border: 2px solid %2;
-            border-radius: 4px;
-        )")
-                                 .arg(color.name(), color.lighter(150).name());
-
-        item->setBackground(QBrush(color));
-        item->setText("●");
-        item->setForeground(Qt::white);
-        item->setFont(QFont("Arial", 16, QFont::Bold));
+        emit batchEdited(m_stroke);
     }
-    else
+    m_stroke = GridBatch();
+}
+
+void DrumGrid::onRowMenuRequested(int row, const QPoint &globalPos)
+{
+    QMenu menu(this);
+    menu.addAction("Effacer la ligne", this, [this, row]()
+                   { clearRow(row); });
+    menu.addAction("Remplir (1 pas sur 4)", this, [this, row]()
+                   { fillRow(row, 4); });
+    menu.addSeparator();
+    menu.addAction("Copier la ligne", this, [this, row]()
+                   { copyRow(row); });
+    QAction *paste = menu.addAction("Coller la ligne", this, [this, row]()
+                                    { pasteRow(row); });
+    paste->setEnabled(m_hasRowClipboard);
+    menu.exec(globalPos);
+}
+
+quint64 DrumGrid::allStepsMask() const
+{
+    return (m_steps >= 64) ? ~quint64(0) : ((quint64(1) << m_steps) - 1);
+}
+
+void DrumGrid::applyLocalBatch(const GridBatch &batch)
+{
+    m_model->applyBatch(batch);
+    emit batchEdited(batch);
+}
+
+void DrumGrid::clearRow(int row)
+{
+    if (row < 0 || row >= m_instruments)
+        return;
+
+    GridBatch batch;
+    batch.masks.append({false, row, 0, allStepsMask()});
+    applyLocalBatch(batch);
+}
+
+void DrumGrid::fillRow(int row, int interval)
+{
+    if (row < 0 || row >= m_instruments || interval <= 0)
+        return;
+
+    quint64 set = 0;
+    for (int col = 0; col < m_steps; col += interval)
     {
-        item->setBackground(QBrush(QColor(255, 255, 255, 8)));
-        // Coloration alternée pour mieux visualiser les mesures
-        QColor bgColor = (col % 4 == 0) ? QColor(220, 220, 220) : QColor(240, 240, 240);
-        item->setBackground(QBrush(bgColor));
-        item->setText("");
+        set |= quint64(1) << col;
     }
+
+    GridBatch batch;
+    batch.masks.append({false, row, set, allStepsMask() & ~set});
+    applyLocalBatch(batch);
+}
+
+void DrumGrid::copyRow(int row)
+{
+    m_rowClipboard = m_model->rowMask(row);
+    m_hasRowClipboard = true;
+}
+
+void DrumGrid::pasteRow(int row)
+{
+    if (!m_hasRowClipboard || row < 0 || row >= m_instruments)
+        return;
+
+    const quint64 set = m_rowClipboard & allStepsMask();
+    GridBatch batch;
+    batch.masks.append({false, row, set, allStepsMask() & ~set});
+    applyLocalBatch(batch);
 }
@@ -1,18 +1,17 @@
 #include "DrumServer.h"
 #include "Protocol.h"
-#include <QDataStream>
 #include <QHostAddress>
 #include <QDebug>
 #include <QRandomGenerator>
 
 DrumServer::DrumServer(QObject *parent)
-    : QObject(parent), m_server(new QTcpServer(this)), m_pingTimer(new QTimer(this)),
-      m_roomManager(nullptr)
+    : QObject(parent), m_server(new QTcpServer(this)), m_outgoingIds(std::make_shared<Protocol::UserIdTable>()),
+      m_pingTimer(new QTimer(this)), m_udpChannel(new UdpChannel(this)), m_roomManager(nullptr)
 {
     connect(m_server, &QTcpServer::newConnection, this, &DrumServer::onNewConnection);
 
-    // Ping périodique pour détecter les déconnexions
-    m_pingTimer->setInterval(30000); // 30 secondes
+    // Battement de cœur des connexions du lobby (chaque fil de travail a le sien)
+    m_pingTimer->setInterval(DEFAULT_HEARTBEAT_INTERVAL_MS);
     connect(m_pingTimer, &QTimer::timeout, this, &DrumServer::onPingTimer);
 }
 
@@ -21,12 +20,40 @@ DrumServer::~DrumServer()
     stopListening();
 }
 
+template <typename Func>
+void DrumServer::onWorker(int index, Func &&func)
+{
+    // Exécuté dans le thread du fil, dans l'ordre des appels
+    QMetaObject::invokeMethod(m_workers[index], std::forward<Func>(func), Qt::QueuedConnection);
+}
+
+void DrumServer::setWorkerCount(int count)
+{
+    m_workerCount = qMax(0, count);
+}
+
+int DrumServer::workerIndexForRoom(const QString &roomId) const
+{
+    return m_roomWorker.value(roomId, -1);
+}
+
+void DrumServer::setUdpEnabled(bool enabled)
+{
+    m_udpEnabled = enabled;
+}
+
 bool DrumServer::startListening(quint16 port)
 {
     if (m_server->listen(QHostAddress::Any, port))
     {
+        // Un canal UDP indisponible n'empêche pas le démarrage : les clients restent en TCP
+        if (m_udpEnabled)
+        {
+            m_udpChannel->bind(m_server->serverPort());
+        }
+        startWorkers();
         m_pingTimer->start();
-        qDebug() << "Serveur démarré sur le port" << port;
+        qDebug() << "Serveur démarré sur le port" << port << "avec" << m_workers.size() << "fils de travail";
         return true;
     }
     else
@@ -40,21 +67,28 @@ void DrumServer::stopListening()
 {
     m_pingTimer->stop();
 
-    // Fermer toutes les connexions clients
-    for (auto *socket : m_clients)
+    // Les fils ferment leurs connexions pendant que le thread d'accueil ferme celles du lobby :
+    // une seule attente bornée pour tout le monde
+    const QList<ClientConnection *> lobby = m_lobby.values();
+    m_lobby.clear();
+    stopWorkers();
+    for (ClientConnection *connection : lobby)
     {
-        if (socket->state() != QTcpSocket::UnconnectedState)
-        {
-            socket->disconnectFromHost();
-            if (!socket->waitForDisconnected(3000))
-            {
-                socket->abort();
-            }
-        }
+        disconnect(connection, nullptr, this, nullptr);
+        connection->close();
+    }
+    const QDeadlineTimer deadline(ClientConnection::CLOSE_TIMEOUT_MS);
+    for (ClientConnection *connection : lobby)
+    {
+        connection->waitForClosed(deadline);
+        connection->deleteLater();
     }
+    joinWorkers();
+    m_udpChannel->close(); // Après les fils : plus aucune connexion ne l'utilise
 
-    m_clients.clear();
-    m_clientBuffers.clear();
+    m_home.clear();
+    m_pendingSends.clear();
+    m_linkStats.clear();
 
     if (m_server->isListening())
     {
@@ -68,111 +102,487 @@ bool DrumServer::isListening() const
     return m_server->isListening();
 }
 
+void DrumServer::startWorkers()
+{
+    const int count = m_workerCount > 0 ? m_workerCount : qMax(1, QThread::idealThreadCount());
+    for (int i = 0; i < count; ++i)
+    {
+        QThread *thread = new QThread(this);
+        thread->setObjectName(QString("RoomWorker-%1").arg(i));
+
+        RoomWorker *worker = new RoomWorker;
+        worker->moveToThread(thread);
+        connect(thread, &QThread::finished, worker, &QObject::deleteLater);
+
+        connect(worker, &RoomWorker::connectionReleased, this, &DrumServer::onConnectionReleased);
+        connect(worker, &RoomWorker::connectionClosed, this, &DrumServer::onWorkerConnectionClosed);
+        connect(worker, &RoomWorker::lobbyMessage, this, &DrumServer::onWorkerLobbyMessage);
+        connect(worker, &RoomWorker::linkStatsUpdated, this, &DrumServer::onWorkerLinkStats);
+        connect(worker, &RoomWorker::queueStatsUpdated, this, &DrumServer::onWorkerQueueStats);
+        connect(worker, &RoomWorker::clientTimedOut, this, &DrumServer::clientTimedOut);
+        connect(worker, &RoomWorker::hostMessage, this, &DrumServer::hostMessageReceived);
+
+        thread->start();
+        m_workerThreads.append(thread);
+        m_workers.append(worker);
+        m_workerRoomCounts.append(0);
+
+        const int intervalMs = m_heartbeatIntervalMs;
+        const int maxMissedPongs = m_maxMissedPongs;
+        const SendQueueLimits limits = m_sendQueueLimits;
+        onWorker(i, [worker, intervalMs, maxMissedPongs, limits]()
+                 {
+                 worker->setSendQueueLimits(limits);
+                 worker->start(intervalMs, maxMissedPongs); });
+    }
+
+    // Salons existants (hôte embarqué) : répartis dès maintenant
+    for (auto it = m_userRoom.constBegin(); it != m_userRoom.constEnd(); ++it)
+    {
+        if (it.key() == m_hostUserId)
+        {
+            const int index = workerForRoom(it.value());
+            RoomWorker *worker = m_workers[index];
+            const QString roomId = it.value();
+            onWorker(index, [worker, roomId]()
+                     { worker->setHostPresent(roomId, true); });
+        }
+    }
+}
+
+void DrumServer::stopWorkers()
+{
+    // Arrêts en parallèle : chaque fil ferme ses connexions puis quitte sa boucle
+    for (int i = 0; i < m_workers.size(); ++i)
+    {
+        RoomWorker *worker = m_workers[i];
+        onWorker(i, [worker]()
+                 {
+                 worker->shutdown();
+                 QThread::currentThread()->quit(); });
+    }
+}
+
+void DrumServer::joinWorkers()
+{
+    for (QThread *thread : std::as_const(m_workerThreads))
+    {
+        thread->wait();
+        delete thread; // Le fil lui-même est détruit à la fin de son thread
+    }
+
+    m_workerThreads.clear();
+    m_workers.clear();
+    m_workerRoomCounts.clear();
+    m_roomWorker.clear();
+}
+
+int DrumServer::workerForRoom(const QString &roomId)
+{
+    auto it = m_roomWorker.constFind(roomId);
+    if (it != m_roomWorker.constEnd())
+    {
+        return it.value();
+    }
+    if (m_workers.isEmpty())
+    {
+        return -1;
+    }
+
+    // Répartition : le fil qui porte le moins de salons
+    int best = 0;
+    for (int i = 1; i < m_workers.size(); ++i)
+    {
+        if (m_workerRoomCounts[i] < m_workerRoomCounts[best])
+        {
+            best = i;
+        }
+    }
+    ++m_workerRoomCounts[best];
+    m_roomWorker.insert(roomId, best);
+    return best;
+}
+
 void DrumServer::broadcastMessage(const QByteArray& message)
 {
-    for (QTcpSocket* socket : m_clients) {
-        if (socket && socket->state() == QAbstractSocket::ConnectedState) {
-            socket->write(message);
+    OutgoingFrame frame(message);
+    for (ClientConnection *connection : std::as_const(m_lobby))
+    {
+        if (connection->isConnected())
+        {
+            connection->send(frame);
         }
     }
 
-    if (m_hostWindow) {
-        m_hostWindow->onMessageReceived(message);
+    for (auto it = m_home.constBegin(); it != m_home.constEnd(); ++it)
+    {
+        if (it.value() == HOME_TRANSIT)
+        {
+            m_pendingSends[it.key()].append(message);
+        }
+    }
+
+    for (int i = 0; i < m_workers.size(); ++i)
+    {
+        RoomWorker *worker = m_workers[i];
+        onWorker(i, [worker, message]()
+                 { worker->broadcastToAll(message); });
+    }
+
+    emit hostMessageReceived(message);
+}
+
+void DrumServer::broadcastToRoom(const QString &roomId, const QByteArray &message)
+{
+    if (roomId.isEmpty())
+    {
+        broadcastMessage(message);
+        return;
+    }
+
+    // Messages de l'hôte embarqué : traités par le fil du salon, dans l'ordre d'émission
+    const int index = workerForRoom(roomId);
+    if (index < 0)
+    {
+        qWarning() << "[SERVER] Serveur arrêté, message de salon ignoré:" << roomId;
+        return;
     }
+    RoomWorker *worker = m_workers[index];
+    onWorker(index, [worker, roomId, message]()
+             { worker->broadcastToRoom(roomId, message); });
 }
 
+QJsonObject DrumServer::roomSnapshot(const QString &roomId)
+{
+    const int index = workerForRoom(roomId);
+    if (index < 0)
+    {
+        return QJsonObject();
+    }
 
-void DrumServer::sendMessageToClient(const QString &clientId, const QByteArray &message)
+    // Appel bloquant sans risque : un fil de travail n'attend jamais le thread d'accueil
+    RoomWorker *worker = m_workers[index];
+    QJsonObject snapshot;
+    QMetaObject::invokeMethod(worker, [worker, roomId, &snapshot]()
+                              { snapshot = worker->roomSnapshot(roomId); }, Qt::BlockingQueuedConnection);
+    return snapshot;
+}
+
+void DrumServer::adoptLobbyConnection(ClientConnection *connection)
+{
+    const QString clientId = connection->clientId();
+    connection->setParent(this);
+    connection->setOutgoingIdTable(m_outgoingIds);
+    connection->setSendQueueLimits(m_sendQueueLimits);
+    m_lobby[clientId] = connection;
+    m_home[clientId] = HOME_LOBBY;
+
+    connect(connection, &ClientConnection::messageReceived, this,
+            [this, clientId](MessageType type, const QJsonObject &content, const QByteArray &)
+            { processLobbyMessage(clientId, type, content); });
+    connect(connection, &ClientConnection::linkStatsChanged, this, [this, connection]()
+            {
+            m_linkStats[connection->clientId()] = connection->linkStats();
+            emit linkStatsUpdated(connection->clientId()); });
+    connect(connection, &ClientConnection::disconnected, this, [this, connection]()
+            {
+            qDebug() << "[SERVER] Client déconnecté:" << connection->clientId();
+            m_lobby.remove(connection->clientId());
+            connection->deleteLater();
+            releaseClientState(connection->clientId()); });
+
+    const QList<QByteArray> pending = m_pendingSends.take(clientId);
+    for (const QByteArray &message : pending)
+    {
+        connection->send(message);
+    }
+    connection->resume();
+}
+
+void DrumServer::placeConnection(ClientConnection *connection)
 {
-    qDebug() << "[DEBUG] === DIAGNOSTIC sendMessageToClient ===";
-    qDebug() << "[DEBUG] Tentative d'envoi à clientId =" << clientId;
-    qDebug() << "[DEBUG] Clients dans m_clients:" << m_clients.keys();
-    qDebug() << "[DEBUG] Client existe dans m_clients:" << m_clients.contains(clientId);
+    const QString clientId = connection->clientId();
+    if (!isListening() || !connection->isConnected() || !m_home.contains(clientId))
+    {
+        // Serveur arrêté ou client parti pendant la migration
+        connection->abort();
+        connection->deleteLater();
+        releaseClientState(clientId);
+        return;
+    }
 
-    if (!m_clients.contains(clientId))
+    const QString roomId = m_userRoom.value(userIdForClient(clientId));
+    const int index = roomId.isEmpty() ? -1 : workerForRoom(roomId);
+    if (index < 0)
     {
-        qWarning() << "[SERVER] Client non trouvé dans m_clients:" << clientId;
+        adoptLobbyConnection(connection);
         return;
     }
 
-    QTcpSocket *socket = m_clients[clientId];
-    qDebug() << "[DEBUG] Socket récupéré:" << (socket != nullptr);
+    m_home[clientId] = index;
+    connection->moveToThread(m_workerThreads[index]);
+
+    RoomWorker *worker = m_workers[index];
+    const QList<QByteArray> pending = m_pendingSends.take(clientId);
+    onWorker(index, [worker, connection, clientId, roomId, pending]()
+             {
+        worker->adoptConnection(connection, roomId);
+        for (const QByteArray &message : pending) {
+            worker->sendToClient(clientId, message);
+        } });
+    qDebug() << "[SERVER] Client" << clientId << "confié au fil" << index << "(salon" << roomId << ")";
+}
 
-    if (!socket)
+void DrumServer::rehome(const QString &clientId)
+{
+    auto it = m_home.find(clientId);
+    if (it == m_home.end() || it.value() == HOME_TRANSIT)
     {
-        qWarning() << "[SERVER] Socket null pour client:" << clientId;
+        return; // Inconnu, ou en migration : la destination est recalculée à l'arrivée
+    }
+
+    const QString roomId = m_userRoom.value(userIdForClient(clientId));
+    const int target = roomId.isEmpty() ? HOME_LOBBY : qMax(HOME_LOBBY, workerForRoom(roomId));
+    const int current = it.value();
+    if (target == current)
+    {
+        if (target != HOME_LOBBY)
+        {
+            // Changement de salon sur le même fil
+            RoomWorker *worker = m_workers[target];
+            onWorker(target, [worker, clientId, roomId]()
+                     { worker->assignRoom(clientId, roomId); });
+        }
         return;
     }
 
-    qDebug() << "[DEBUG] État du socket:" << socket->state();
-    qDebug() << "[DEBUG] ConnectedState =" << QAbstractSocket::ConnectedState;
+    it.value() = HOME_TRANSIT;
+    if (current == HOME_LOBBY)
+    {
+        ClientConnection *connection = m_lobby.take(clientId);
+        disconnect(connection, nullptr, this, nullptr);
+        connection->pause();
+        connection->setParent(nullptr);
+        // Différé : la connexion est peut-être en train de traiter la trame qui a déclenché le départ
+        QMetaObject::invokeMethod(this, [this, connection]()
+                                  { placeConnection(connection); }, Qt::QueuedConnection);
+    }
+    else
+    {
+        RoomWorker *worker = m_workers[current];
+        QThread *home = thread();
+        onWorker(current, [worker, clientId, home]()
+                 { worker->releaseConnection(clientId, home); });
+    }
+}
+
+void DrumServer::onConnectionReleased(ClientConnection *connection)
+{
+    placeConnection(connection);
+}
+
+void DrumServer::onWorkerConnectionClosed(const QString &clientId)
+{
+    qDebug() << "[SERVER] Client déconnecté:" << clientId;
+    releaseClientState(clientId);
+}
+
+void DrumServer::onWorkerLobbyMessage(const QString &clientId, const QByteArray &canonical)
+{
+    MessageType type;
+    QJsonObject content;
+    if (Protocol::parseMessage(canonical, type, content))
+    {
+        processLobbyMessage(clientId, type, content);
+    }
+}
+
+void DrumServer::onWorkerLinkStats(const QString &clientId, const LinkStats &stats)
+{
+    if (m_home.contains(clientId))
+    {
+        m_linkStats[clientId] = stats;
+        emit linkStatsUpdated(clientId);
+    }
+}
+
+void DrumServer::onWorkerQueueStats(const QString &clientId, const QJsonObject &stats)
+{
+    if (m_home.contains(clientId))
+    {
+        m_queueStats[clientId] = stats;
+    }
+}
 
-    if (socket->state() != QAbstractSocket::ConnectedState)
+void DrumServer::releaseClientState(const QString &clientId)
+{
+    if (!m_home.remove(clientId))
     {
-        qWarning() << "[SERVER] Client non connecté:" << clientId << "État:" << socket->state();
         return;
     }
+    m_pendingSends.remove(clientId);
+    m_linkStats.remove(clientId);
+    m_queueStats.remove(clientId);
+    m_userIdToClientId.remove(m_clientIdToUserId.take(clientId));
+    emit clientDisconnected(clientId);
+}
 
-    qint64 written = socket->write(message);
-    qDebug() << "[DEBUG] Bytes écrits:" << written << "/" << message.size();
+QString DrumServer::userIdForClient(const QString &clientId) const
+{
+    // Les salons créés via CREATE_ROOM utilisent l'ID client comme ID d'hôte
+    return m_clientIdToUserId.value(clientId, clientId);
+}
 
-    if (written != message.size())
+QString DrumServer::clientIdForUser(const QString &userId) const
+{
+    auto it = m_userIdToClientId.constFind(userId);
+    if (it != m_userIdToClientId.constEnd())
     {
-        qWarning() << "[SERVER] Erreur d'envoi partiel:" << written << "/" << message.size();
+        return it.value();
     }
-    else
+    return m_home.contains(userId) ? userId : QString();
+}
+
+void DrumServer::onUserJoinedRoom(const QString &roomId, const User &user)
+{
+    const QString previousRoom = m_userRoom.value(user.id);
+    if (!previousRoom.isEmpty() && previousRoom != roomId)
+    {
+        onUserLeftRoom(previousRoom, user.id);
+    }
+
+    m_userRoom[user.id] = roomId;
+    m_roomUsers[roomId].insert(user.id);
+
+    if (!m_hostUserId.isEmpty() && user.id == m_hostUserId && !m_workers.isEmpty())
+    {
+        const int index = workerForRoom(roomId);
+        RoomWorker *worker = m_workers[index];
+        onWorker(index, [worker, roomId]()
+                 { worker->setHostPresent(roomId, true); });
+    }
+
+    const QString clientId = clientIdForUser(user.id);
+    if (!clientId.isEmpty())
     {
-        qDebug() << "[SERVER] Message envoyé avec succès à" << clientId;
+        rehome(clientId);
     }
-    qDebug() << "[DEBUG] === FIN DIAGNOSTIC ===";
 }
 
-QStringList DrumServer::getConnectedClients() const
+void DrumServer::onUserLeftRoom(const QString &roomId, const QString &userId)
 {
-    QStringList connectedClients;
-    for (auto it = m_clients.begin(); it != m_clients.end(); ++it)
+    auto it = m_roomUsers.find(roomId);
+    if (it != m_roomUsers.end())
     {
-        if (it.value()->state() == QTcpSocket::ConnectedState)
+        it.value().remove(userId);
+        if (it.value().isEmpty())
         {
-            connectedClients.append(it.key());
+            m_roomUsers.erase(it);
         }
     }
-    return connectedClients;
+
+    if (m_userRoom.value(userId) == roomId)
+    {
+        m_userRoom.remove(userId);
+    }
+
+    if (!m_hostUserId.isEmpty() && userId == m_hostUserId && m_roomWorker.contains(roomId))
+    {
+        const int index = m_roomWorker.value(roomId);
+        RoomWorker *worker = m_workers[index];
+        onWorker(index, [worker, roomId]()
+                 { worker->setHostPresent(roomId, false); });
+    }
+
+    const QString clientId = clientIdForUser(userId);
+    if (!clientId.isEmpty())
+    {
+        rehome(clientId);
+    }
 }
 
-void DrumServer::onNewConnection()
+void DrumServer::onRoomDeleted(const QString &roomId)
 {
-    while (m_server->hasPendingConnections())
+    const QSet<QString> members = m_roomUsers.take(roomId);
+    for (const QString &userId : members)
     {
-        QTcpSocket *socket = m_server->nextPendingConnection();
-        QString clientId = generateClientId();
+        if (m_userRoom.value(userId) == roomId)
+        {
+            m_userRoom.remove(userId);
+        }
+    }
 
-        qDebug() << "[SERVER] === ENREGISTREMENT CLIENT ===";
-        qDebug() << "[SERVER] Nouveau client ID:" << clientId;
-        qDebug() << "[SERVER] Socket valide:" << (socket != nullptr);
-        qDebug() << "[SERVER] État initial du socket:" << socket->state();
+    // Les membres encore connectés retournent au lobby
+    for (const QString &userId : members)
+    {
+        const QString clientId = clientIdForUser(userId);
+        if (!clientId.isEmpty())
+        {
+            rehome(clientId);
+        }
+    }
 
-        m_clients[clientId] = socket;
-        m_socketToId[socket] = clientId;
+    auto it = m_roomWorker.find(roomId);
+    if (it != m_roomWorker.end())
+    {
+        const int index = it.value();
+        m_roomWorker.erase(it);
+        --m_workerRoomCounts[index];
+        RoomWorker *worker = m_workers[index];
+        onWorker(index, [worker, roomId]()
+                 { worker->removeRoom(roomId); });
+    }
+}
 
-        qDebug() << "[SERVER] Nouveau client connecté:" << clientId;
+void DrumServer::sendMessageToClient(const QString &clientId, const QByteArray &message)
+{
+    auto it = m_home.constFind(clientId);
+    if (it == m_home.constEnd())
+    {
+        qWarning() << "[SERVER] Client non trouvé:" << clientId;
+        return;
+    }
+
+    switch (it.value())
+    {
+    case HOME_LOBBY:
+        m_lobby.value(clientId)->send(message);
+        break;
+    case HOME_TRANSIT:
+        m_pendingSends[clientId].append(message);
+        break;
+    default:
+    {
+        RoomWorker *worker = m_workers[it.value()];
+        onWorker(it.value(), [worker, clientId, message]()
+                 { worker->sendToClient(clientId, message); });
+        break;
+    }
+    }
+}
 
-        // Connexion simple pour la réception de données
-        connect(socket, &QTcpSocket::readyRead, this, &DrumServer::onClientDataReceived);
+QStringList DrumServer::getConnectedClients() const
+{
+    return m_home.keys();
+}
 
-        connect(socket, &QTcpSocket::disconnected, this, [this, socket, clientId]()
-                {
-            qDebug() << "[SERVER] Client déconnecté:" << clientId;
-            m_clients.remove(clientId);
-            m_socketToId.remove(socket);
-            m_clientBuffers.remove(socket);
-            socket->deleteLater();
-            emit clientDisconnected(clientId); });
+void DrumServer::onNewConnection()
+{
+    while (m_server->hasPendingConnections())
+    {
+        QTcpSocket *socket = m_server->nextPendingConnection();
+        const QString clientId = generateClientId();
+
+        // JSON jusqu'au HELLO du client ; reste sur le thread d'accueil jusqu'à JOIN_ROOM
+        ClientConnection *connection = new ClientConnection(clientId, socket);
+        connection->setUdpChannel(m_udpChannel);
+        adoptLobbyConnection(connection);
+        qDebug() << "[SERVER] Nouveau client connecté:" << clientId;
 
         // Envoi initial de la liste des salles avec un délai
         QTimer::singleShot(100, this, [this, clientId]()
                            {
-            if (m_clients.contains(clientId)) {
+            if (m_home.contains(clientId)) {
                 sendInitialRoomList(clientId);
             } });
 
@@ -185,11 +595,10 @@ void DrumServer::sendInitialRoomList(const QString &clientId)
     if (!m_roomManager)
         return;
 
-    qDebug() << "[SERVER] Envoi initial de la liste des salles à" << clientId;
+    qDebug() << "[SERVER] Envoi de la liste des salles à" << clientId;
 
-    QList<Room *> publicRooms = m_roomManager->getPublicRooms();
     QJsonArray roomArray;
-    for (Room *room : publicRooms)
+    for (Room *room : m_roomManager->getPublicRooms())
     {
         if (room)
         {
@@ -197,8 +606,17 @@ void DrumServer::sendInitialRoomList(const QString &clientId)
         }
     }
 
-    QByteArray response = Protocol::createRoomListResponseMessage(roomArray);
-    sendMessageToClient(clientId, response);
+    sendMessageToClient(clientId, Protocol::createRoomListResponseMessage(roomArray));
+}
+
+void DrumServer::broadcastRoomList()
+{
+    QJsonArray roomArray;
+    for (Room *room : m_roomManager->getPublicRooms())
+    {
+        roomArray.append(room->toJson());
+    }
+    broadcastMessage(Protocol::createRoomListResponseMessage(roomArray));
 }
 
 QString DrumServer::generateClientId() const
@@ -206,196 +624,166 @@ QString DrumServer::generateClientId() const
     return QString::number(QRandomGenerator::global()->generate());
 }
 
-void DrumServer::onClientDisconnected()
+void DrumServer::onPingTimer()
 {
-    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
-    if (!socket)
-        return;
-
-    QString clientId = m_socketToId.value(socket, "");
-    if (clientId.isEmpty())
+    // Connexions du lobby : fermées, ou à moitié ouvertes (le pair ne répond plus)
+    QList<ClientConnection *> deadConnections;
+    for (ClientConnection *connection : std::as_const(m_lobby))
     {
-        qWarning() << "[SERVER] Socket inconnu pour message reçu";
-        return;
+        if (!connection->isConnected() || !connection->heartbeat(m_maxMissedPongs))
+        {
+            deadConnections.append(connection);
+            continue;
+        }
+        m_queueStats[connection->clientId()] = connection->queueStats();
     }
-    if (!clientId.isEmpty())
-    {
-        qDebug() << "Client déconnecté:" << clientId;
-
-        m_clients.remove(clientId);
-        m_clientBuffers.remove(socket);
 
-        emit clientDisconnected(clientId);
+    for (ClientConnection *connection : deadConnections)
+    {
+        const QString clientId = connection->clientId();
+        if (connection->isConnected())
+        {
+            qWarning() << "[SERVER] Client sans réponse après" << connection->linkStats().missedPongs()
+                       << "PING, éviction:" << clientId;
+            emit clientTimedOut(clientId);
+        }
+        m_lobby.remove(clientId);
+        disconnect(connection, nullptr, this, nullptr);
+        connection->abort();
+        connection->deleteLater();
+        releaseClientState(clientId);
     }
-
-    // Programmer la suppression du socket
-    socket->deleteLater();
 }
 
-void DrumServer::onClientDataReceived()
+void DrumServer::setHeartbeat(int intervalMs, int maxMissedPongs)
 {
-    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
-    if (!socket)
-        return;
+    m_heartbeatIntervalMs = qMax(100, intervalMs);
+    m_maxMissedPongs = qMax(1, maxMissedPongs);
+    m_pingTimer->setInterval(m_heartbeatIntervalMs);
 
-    QString clientId = m_socketToId.value(socket);
-    if (clientId.isEmpty())
+    for (int i = 0; i < m_workers.size(); ++i)
     {
-        qWarning() << "[SERVER] Socket sans ID client";
-        return;
+        RoomWorker *worker = m_workers[i];
+        const int interval = m_heartbeatIntervalMs;
+        const int missed = m_maxMissedPongs;
+        onWorker(i, [worker, interval, missed]()
+                 { worker->setHeartbeat(interval, missed); });
     }
+}
 
-    QByteArray &buffer = m_clientBuffers[socket];
-    buffer.append(socket->readAll());
+void DrumServer::setSendQueueLimits(qint64 maxBytes, int maxMessages, int overBudgetTimeoutMs)
+{
+    m_sendQueueLimits.maxBytes = qMax<qint64>(4 * 1024, maxBytes);
+    m_sendQueueLimits.maxMessages = qMax(16, maxMessages);
+    m_sendQueueLimits.overBudgetTimeoutMs = qMax(0, overBudgetTimeoutMs);
 
-    while (buffer.size() >= 4)
+    for (ClientConnection *connection : std::as_const(m_lobby))
     {
-        QDataStream stream(buffer);
-        stream.setByteOrder(QDataStream::BigEndian);
-        quint32 messageSize;
-        stream >> messageSize;
-
-        if (messageSize > 1024 * 1024)
-        {
-            qWarning() << "[SERVER] Message trop volumineux";
-            socket->disconnectFromHost();
-            return;
-        }
-
-        if (buffer.size() >= 4 + messageSize)
-        {
-            QByteArray message = buffer.mid(0, 4 + messageSize);
-            buffer.remove(0, 4 + messageSize);
-            processClientMessage(socket, message);
-        }
-        else
-        {
-            break;
-        }
+        connection->setSendQueueLimits(m_sendQueueLimits);
+    }
+    for (int i = 0; i < m_workers.size(); ++i)
+    {
+        RoomWorker *worker = m_workers[i];
+        const SendQueueLimits limits = m_sendQueueLimits;
+        onWorker(i, [worker, limits]()
+                 { worker->setSendQueueLimits(limits); });
     }
 }
 
-void DrumServer::onPingTimer()
+LinkStats DrumServer::linkStats(const QString &clientId) const
 {
-    // Vérification de l'état des connexions
-    QStringList disconnectedClients;
+    return m_linkStats.value(clientId);
+}
 
-    for (auto it = m_clients.begin(); it != m_clients.end(); ++it)
-    {
-        QTcpSocket *socket = it.value();
-        if (socket->state() != QTcpSocket::ConnectedState)
-        {
-            disconnectedClients.append(it.key());
-        }
-    }
+QJsonObject DrumServer::sendQueueStats(const QString &clientId) const
+{
+    return m_queueStats.value(clientId);
+}
 
-    // Nettoyage des clients déconnectés
-    for (const QString &clientId : disconnectedClients)
+QJsonObject DrumServer::linkStatsJson() const
+{
+    QJsonObject all;
+    for (auto it = m_linkStats.constBegin(); it != m_linkStats.constEnd(); ++it)
     {
-        qDebug() << "Nettoyage du client déconnecté:" << clientId;
-        QTcpSocket *socket = m_clients.take(clientId);
-        m_clientBuffers.remove(socket);
-        emit clientDisconnected(clientId);
-        socket->deleteLater();
+        all[it.key()] = it.value().toJson();
     }
-
-    if (!disconnectedClients.isEmpty())
+    for (auto it = m_queueStats.constBegin(); it != m_queueStats.constEnd(); ++it)
     {
-        qDebug() << "Clients connectés actuels:" << getConnectedClients().size();
+        QJsonObject client = all.value(it.key()).toObject();
+        client["queue"] = it.value();
+        all[it.key()] = client;
     }
+    return all;
 }
 
-void DrumServer::setHostWindow(MainWindow* window) {
-    m_hostWindow = window;
+void DrumServer::setHostUserId(const QString& userId) {
+    m_hostUserId = userId;
+
+    const QString roomId = m_userRoom.value(userId);
+    if (!roomId.isEmpty() && !m_workers.isEmpty())
+    {
+        const int index = workerForRoom(roomId);
+        RoomWorker *worker = m_workers[index];
+        onWorker(index, [worker, roomId]()
+                 { worker->setHostPresent(roomId, true); });
+    }
 }
 
 void DrumServer::setRoomManager(RoomManager *roomManager)
 {
     Q_ASSERT(roomManager != nullptr);
+    if (m_roomManager)
+    {
+        disconnect(m_roomManager, nullptr, this, nullptr);
+    }
     m_roomManager = roomManager;
-    qDebug() << "[SERVER] RoomManager partagé configuré";
-}
-
-void DrumServer::processClientMessage(QTcpSocket *socket, const QByteArray &message)
-{
-    QString clientId = m_clients.key(socket);
 
-    if (clientId.isEmpty())
+    // Index d'appartenance : état initial puis mises à jour par signaux
+    m_userRoom.clear();
+    m_roomUsers.clear();
+    for (Room *room : m_roomManager->getAllRooms())
     {
-        qWarning() << "[SERVER] Socket non enregistré";
-        return;
+        for (const User &user : room->getUsers())
+        {
+            onUserJoinedRoom(room->getId(), user);
+        }
     }
+    connect(m_roomManager, &RoomManager::userJoinedRoom, this, &DrumServer::onUserJoinedRoom);
+    connect(m_roomManager, &RoomManager::userLeftRoom, this, &DrumServer::onUserLeftRoom);
+    connect(m_roomManager, &RoomManager::roomDeleted, this, &DrumServer::onRoomDeleted);
 
-    MessageType type;
-    QJsonObject content;
-    if (!Protocol::parseMessage(message, type, content))
+    qDebug() << "[SERVER] RoomManager partagé configuré";
+}
+
+void DrumServer::processLobbyMessage(const QString &clientId, MessageType type, const QJsonObject &content)
+{
+    if (!m_roomManager)
     {
-        qWarning() << "[SERVER] Message invalide reçu de" << clientId;
+        qWarning() << "[SERVER] Aucun RoomManager configuré, message ignoré:" << Protocol::messageTypeToString(type);
         return;
     }
 
     switch (type)
     {
     case MessageType::ROOM_LIST_REQUEST:
-    {
         qDebug() << "[SERVER] Traitement ROOM_LIST_REQUEST pour" << clientId;
-
-        QList<Room *> publicRooms = m_roomManager->getPublicRooms();
-        QJsonArray roomArray;
-        for (Room *room : publicRooms)
-        {
-            if (room)
-            {
-                roomArray.append(room->toJson());
-            }
-        }
-
-        QByteArray response = Protocol::createRoomListResponseMessage(roomArray);
-
-        // UTILISER sendMessageToClient au lieu de l'autre méthode
-        sendMessageToClient(clientId, response);
+        sendInitialRoomList(clientId);
         break;
-    }
 
+    // Opérations de session hors salon : elles n'ont ni salon ni état versionné
+    // (pas de révision, absentes du journal). Elles sont ignorées plutôt que
+    // diffusées, ce qui les ferait fuir vers tous les salons de tous les fils.
     case MessageType::GRID_UPDATE:
-    {
-        qDebug() << "[SERVER] GRID_UPDATE reçu";
-        GridCell cell = GridCell::fromJson(content);
-        QByteArray broadcastMsg = Protocol::createGridUpdateMessage(cell);
-        broadcastMessage(broadcastMsg);
-        break;
-    }
-
+    case MessageType::GRID_BATCH:
     case MessageType::COLUMN_UPDATE:
-    {
-        qDebug() << "[SERVER] COLUMN_UPDATE reçu";
-        int columnCount = content["columnCount"].toInt();
-        QByteArray broadcastMsg = Protocol::createColumnUpdateMessage(columnCount);
-        broadcastMessage(broadcastMsg);
-        break;
-    }
-
+    case MessageType::TEMPO_CHANGE:
+    case MessageType::PLAY_STATE:
     case MessageType::INSTRUMENT_SYNC:
-    {
-        qDebug() << "[SERVER] INSTRUMENT_SYNC reçu";
-        QStringList instruments = content["instruments"].toVariant().toStringList();
-        QByteArray broadcastMsg = Protocol::createInstrumentSyncMessage(instruments);
-        broadcastMessage(broadcastMsg);
-        break;
-    }
-
+    case MessageType::PAD_HIT:
+    case MessageType::SYNC_REQUEST:
     case MessageType::SYNC_RESPONSE:
-    {
-        qDebug() << "[SERVER] SYNC_RESPONSE reçu (probablement COLUMN_UPDATE mal encodé)";
-        if (content.contains("columnCount")) {
-            int columnCount = content["columnCount"].toInt();
-            QByteArray broadcastMsg = Protocol::createColumnUpdateMessage(columnCount);
-            broadcastMessage(broadcastMsg);
-            qDebug() << "[SERVER] COLUMN_UPDATE broadcasté avec" << columnCount << "colonnes";
-        }
+        qWarning() << "[SERVER]" << Protocol::messageTypeToString(type) << "hors salon ignoré pour" << clientId;
         break;
-    }
-
 
     case MessageType::CREATE_ROOM:
     {
@@ -404,19 +792,15 @@ void DrumServer::processClientMessage(QTcpSocket *socket, const QByteArray &mess
         int maxUsers = content["maxUsers"].toInt(4);
         QString hostName = "Host";
 
+        // Le créateur devient membre : sa connexion part vers le fil du salon
         QString roomId = m_roomManager->createRoom(name, clientId, hostName, password);
-
-        // Diffusion à tous les clients
-        QList<Room *> publicRooms = m_roomManager->getPublicRooms();
-        QJsonArray roomArray;
-        for (Room *room : publicRooms)
+        if (Room *room = m_roomManager->getRoom(roomId))
         {
-            roomArray.append(room->toJson());
+            room->setMaxUsers(maxUsers);
         }
-        QByteArray broadcastMsg = Protocol::createRoomListResponseMessage(roomArray);
 
-        // UTILISER broadcastMessage au lieu de l'autre méthode
-        broadcastMessage(broadcastMsg);
+        // Diffusion à tous les clients
+        broadcastRoomList();
         break;
     }
     case MessageType::JOIN_ROOM:
@@ -431,8 +815,12 @@ void DrumServer::processClientMessage(QTcpSocket *socket, const QByteArray &mess
         {
             Room *room = m_roomManager->getRoom(roomId);
             m_clientIdToUserId[clientId] = userId;
+            m_userIdToClientId[userId] = clientId;
             QByteArray response = Protocol::createRoomInfoMessage(room->toJson());
             sendMessageToClient(clientId, response);
+
+            // La connexion rejoint le fil de travail du salon
+            rehome(clientId);
         }
         else
         {
@@ -447,20 +835,11 @@ void DrumServer::processClientMessage(QTcpSocket *socket, const QByteArray &mess
         QString userId = m_clientIdToUserId.value(clientId);
 
         qDebug() << "[SERVER] Traitement LEAVE_ROOM pour" << clientId << "de la salle" << roomId;
-        // Retirer l'utilisateur de la salle
+        // Retirer l'utilisateur de la salle (sa connexion revient au lobby)
         m_roomManager->leaveRoom(roomId, userId);
 
         // Diffuser la liste mise à jour des salons publics
-        QList<Room *> publicRooms = m_roomManager->getPublicRooms();
-        QJsonArray roomArray;
-        for (Room *room : publicRooms)
-        {
-            roomArray.append(room->toJson());
-        }
-        
-        QByteArray broadcastMsg = Protocol::createRoomListResponseMessage(roomArray);
-        broadcastMessage(broadcastMsg);
-
+        broadcastRoomList();
         break;
     }
 
@@ -469,53 +848,47 @@ void DrumServer::processClientMessage(QTcpSocket *socket, const QByteArray &mess
     }
 }
 
-QString DrumServer::getClientId(QTcpSocket *socket) const
-{
-    for (auto it = m_clients.begin(); it != m_clients.end(); ++it)
-    {
-        if (it.value() == socket)
-        {
-            return it.key();
-        }
-    }
-    return QString();
-}
-
 // Méthodes utilitaires supplémentaires
 
 int DrumServer::getClientCount() const
 {
-    return getConnectedClients().size();
+    return m_home.size();
 }
 
 bool DrumServer::hasClient(const QString &clientId) const
 {
-    return m_clients.contains(clientId) &&
-           m_clients[clientId]->state() == QTcpSocket::ConnectedState;
+    return m_home.contains(clientId);
 }
 
 void DrumServer::kickClient(const QString &clientId, const QString &reason)
 {
-    if (hasClient(clientId))
+    if (!hasClient(clientId))
     {
-        qDebug() << "Expulsion du client" << clientId << "raison:" << reason;
+        return;
+    }
+    qDebug() << "Expulsion du client" << clientId << "raison:" << reason;
 
-        // Optionnel : envoyer un message d'expulsion avant de déconnecter
-        if (!reason.isEmpty())
-        {
-            QByteArray kickMessage = Protocol::createErrorMessage(
-                QString("Vous avez été expulsé: %1").arg(reason));
-            sendMessageToClient(clientId, kickMessage);
-        }
+    const int home = m_home.value(clientId);
+    if (home >= 0)
+    {
+        RoomWorker *worker = m_workers[home];
+        onWorker(home, [worker, clientId, reason]()
+                 { worker->kickClient(clientId, reason); });
+        return;
+    }
+    if (home == HOME_TRANSIT)
+    {
+        qWarning() << "[SERVER] Expulsion impossible pendant la migration:" << clientId;
+        return;
+    }
 
-        // Forcer la déconnexion
-        QTcpSocket *socket = m_clients[clientId];
-        socket->disconnectFromHost();
-        if (!socket->waitForDisconnected(3000))
-        {
-            socket->abort();
-        }
+    ClientConnection *connection = m_lobby.value(clientId);
+    // Optionnel : envoyer un message d'expulsion avant de déconnecter
+    if (!reason.isEmpty())
+    {
+        connection->send(Protocol::createErrorMessage(QString("Vous avez été expulsé: %1").arg(reason)));
     }
+    connection->close();
 }
 
 QHostAddress DrumServer::getServerAddress() const
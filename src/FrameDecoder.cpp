@@ -0,0 +1,118 @@
+#include "FrameDecoder.h"
+#include <QIODevice>
+#include <QtEndian>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+qsizetype nextPowerOfTwo(qsizetype value) {
+    qsizetype result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+}
+
+FrameDecoder::FrameDecoder(quint32 maxFrameSize, qsizetype initialCapacity)
+    : m_ring(nextPowerOfTwo(qMax<qsizetype>(initialCapacity, 64)), Qt::Uninitialized),
+      m_maxFrameSize(maxFrameSize) {
+}
+
+qint64 FrameDecoder::readFrom(QIODevice* device) {
+    // Jamais plus d'une trame maximale en attente : le reste patiente dans le
+    // périphérique, et l'anneau ne grossit pas au rythme d'un pair qui inonde
+    const qsizetype limit = 4 + qsizetype(m_maxFrameSize);
+    qint64 total = 0;
+    for (;;) {
+        const qint64 available = qMin<qint64>(device->bytesAvailable(), limit - bufferedBytes());
+        if (available <= 0) {
+            break;
+        }
+        reserve(bufferedBytes() + qsizetype(available));
+
+        // Espace libre contigu à partir de la position d'écriture
+        const qsizetype index = indexOf(m_tail);
+        const qsizetype contiguous = qMin(m_ring.size() - index, m_ring.size() - bufferedBytes());
+        const qint64 read = device->read(m_ring.data() + index, qMin<qint64>(contiguous, available));
+        if (read <= 0) {
+            break;
+        }
+        m_tail += read;
+        total += read;
+    }
+    return total;
+}
+
+void FrameDecoder::append(QByteArrayView data) {
+    reserve(bufferedBytes() + data.size());
+
+    const qsizetype index = indexOf(m_tail);
+    const qsizetype first = qMin(data.size(), m_ring.size() - index);
+    std::memcpy(m_ring.data() + index, data.data(), size_t(first));
+    std::memcpy(m_ring.data(), data.data() + first, size_t(data.size() - first));
+    m_tail += data.size();
+}
+
+FrameDecoder::Status FrameDecoder::next(QByteArrayView& frame) {
+    if (bufferedBytes() < 4) {
+        return Status::NeedMore;
+    }
+
+    char header[4];
+    copyOut(m_head, header, 4);
+    const quint32 messageSize = qFromBigEndian<quint32>(header);
+    if (messageSize > m_maxFrameSize) {
+        return Status::Oversized;
+    }
+
+    const qsizetype frameSize = 4 + qsizetype(messageSize);
+    if (bufferedBytes() < frameSize) {
+        // La suite de la trame tiendra sans réallocation en cours de lecture
+        reserve(frameSize);
+        return Status::NeedMore;
+    }
+
+    const qsizetype index = indexOf(m_head);
+    if (index + frameSize <= m_ring.size()) {
+        frame = QByteArrayView(m_ring.constData() + index, frameSize);
+    } else {
+        m_scratch.resize(frameSize);
+        copyOut(m_head, m_scratch.data(), frameSize);
+        frame = QByteArrayView(m_scratch.constData(), frameSize);
+    }
+    m_head += frameSize;
+
+    // Tampon vidé : on repart du début, les trames suivantes ne seront pas coupées
+    if (m_head == m_tail) {
+        m_head = m_tail = 0;
+    }
+    return Status::Frame;
+}
+
+void FrameDecoder::clear() {
+    m_head = m_tail = 0;
+}
+
+void FrameDecoder::reserve(qsizetype needed) {
+    if (needed <= m_ring.size()) {
+        return;
+    }
+
+    // Agrandissement (rare) : le contenu est remis à plat au début du nouvel anneau
+    QByteArray grown(nextPowerOfTwo(needed), Qt::Uninitialized);
+    const qsizetype size = bufferedBytes();
+    copyOut(m_head, grown.data(), size);
+    m_ring = std::move(grown);
+    m_head = 0;
+    m_tail = size;
+}
+
+void FrameDecoder::copyOut(qint64 position, char* out, qsizetype size) const {
+    const qsizetype index = indexOf(position);
+    const qsizetype first = qMin(size, m_ring.size() - index);
+    std::memcpy(out, m_ring.constData() + index, size_t(first));
+    std::memcpy(out + first, m_ring.constData(), size_t(size - first));
+}
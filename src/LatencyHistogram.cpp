@@ -0,0 +1,84 @@
+#include "LatencyHistogram.h"
+#include <QtAlgorithms>
+#include <cmath>
+
+void LatencyHistogram::record(qint64 valueUs) {
+    valueUs = qMax<qint64>(0, valueUs);
+    ++m_buckets[bucketOf(quint64(valueUs))];
+    m_minUs = m_count ? qMin(m_minUs, valueUs) : valueUs;
+    m_maxUs = m_count ? qMax(m_maxUs, valueUs) : valueUs;
+    m_sumUs += valueUs;
+    ++m_count;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    if (!other.m_count) {
+        return;
+    }
+    for (int i = 0; i < BUCKETS; ++i) {
+        m_buckets[i] += other.m_buckets[i];
+    }
+    m_minUs = m_count ? qMin(m_minUs, other.m_minUs) : other.m_minUs;
+    m_maxUs = m_count ? qMax(m_maxUs, other.m_maxUs) : other.m_maxUs;
+    m_sumUs += other.m_sumUs;
+    m_count += other.m_count;
+}
+
+void LatencyHistogram::reset() {
+    *this = LatencyHistogram();
+}
+
+qint64 LatencyHistogram::percentileUs(double p) const {
+    if (!m_count) {
+        return -1;
+    }
+
+    // Rang du percentile, au moins la première valeur
+    const quint64 rank = qMax<quint64>(1, quint64(std::ceil(qBound(0.0, p, 100.0) / 100.0 * double(m_count))));
+    quint64 seen = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+        seen += m_buckets[i];
+        if (seen >= rank) {
+            // La classe peut déborder des valeurs réellement observées
+            return qBound(m_minUs, bucketUpperUs(i), m_maxUs);
+        }
+    }
+    return m_maxUs;
+}
+
+QJsonObject LatencyHistogram::toJson() const {
+    QJsonObject json;
+    json["count"] = qint64(m_count);
+    json["minUs"] = minUs();
+    json["meanUs"] = meanUs();
+    json["p50Us"] = percentileUs(50.0);
+    json["p90Us"] = percentileUs(90.0);
+    json["p99Us"] = percentileUs(99.0);
+    json["p999Us"] = percentileUs(99.9);
+    json["maxUs"] = maxUs();
+    return json;
+}
+
+int LatencyHistogram::bucketOf(quint64 valueUs) {
+    if (valueUs < quint64(SUB_BUCKETS)) {
+        return int(valueUs);
+    }
+
+    // Exposant du bit de poids fort, puis les SUB_BUCKET_BITS bits suivants
+    const int exponent = 63 - int(qCountLeadingZeroBits(valueUs));
+    if (exponent > MAX_EXPONENT) {
+        return BUCKETS - 1; // Saturation
+    }
+    const int sub = int((valueUs >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+    return SUB_BUCKETS * (exponent - SUB_BUCKET_BITS + 1) + sub;
+}
+
+qint64 LatencyHistogram::bucketUpperUs(int bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    const int exponent = bucket / SUB_BUCKETS - 1 + SUB_BUCKET_BITS;
+    const int sub = bucket % SUB_BUCKETS;
+    const int shift = exponent - SUB_BUCKET_BITS;
+    return ((qint64(SUB_BUCKETS + sub + 1)) << shift) - 1;
+}
@@ -0,0 +1,92 @@
+#include "LinkStats.h"
+#include <cmath>
+
+void LinkStats::reset() {
+    *this = LinkStats();
+}
+
+quint32 LinkStats::recordPing(qint64 nowUs) {
+    // Le PING précédent n'a pas eu de réponse avant celui-ci
+    if (m_count > 0 && m_probes[latestIndex()].rttUs < 0) {
+        ++m_missed;
+    }
+
+    Probe& probe = m_probes[m_next];
+    probe.sequence = m_nextSequence++;
+    probe.sentUs = nowUs;
+    probe.rttUs = -1;
+    m_next = (m_next + 1) % WINDOW;
+    m_count = qMin(m_count + 1, WINDOW);
+    return probe.sequence;
+}
+
+bool LinkStats::recordPong(quint32 sequence, qint64 nowUs) {
+    for (int i = 0; i < m_count; ++i) {
+        Probe& probe = m_probes[i];
+        if (probe.sequence != sequence) {
+            continue;
+        }
+        if (probe.rttUs >= 0) {
+            return false; // Doublon
+        }
+
+        probe.rttUs = qMax<qint64>(0, nowUs - probe.sentUs);
+        if (m_lastRttUs >= 0) {
+            // Gigue lissée comme dans RFC 3550 : J += (|D| - J) / 16
+            m_jitterUs += (std::abs(double(probe.rttUs - m_lastRttUs)) - m_jitterUs) / 16.0;
+        }
+        m_lastRttUs = probe.rttUs;
+        m_missed = 0;
+        return true;
+    }
+    return false;
+}
+
+int LinkStats::answeredCount() const {
+    int answered = 0;
+    for (int i = 0; i < m_count; ++i) {
+        if (m_probes[i].rttUs >= 0) {
+            ++answered;
+        }
+    }
+    return answered;
+}
+
+double LinkStats::meanRttUs() const {
+    qint64 total = 0;
+    int answered = 0;
+    for (int i = 0; i < m_count; ++i) {
+        if (m_probes[i].rttUs >= 0) {
+            total += m_probes[i].rttUs;
+            ++answered;
+        }
+    }
+    return answered > 0 ? double(total) / answered : -1.0;
+}
+
+double LinkStats::lossRatio() const {
+    // Le PING le plus récent peut encore recevoir sa réponse : il n'est pas compté
+    int considered = 0;
+    int lost = 0;
+    for (int i = 0; i < m_count; ++i) {
+        if (i == latestIndex() && m_probes[i].rttUs < 0) {
+            continue;
+        }
+        ++considered;
+        if (m_probes[i].rttUs < 0) {
+            ++lost;
+        }
+    }
+    return considered > 0 ? double(lost) / considered : 0.0;
+}
+
+QJsonObject LinkStats::toJson() const {
+    QJsonObject stats;
+    stats["rttMs"] = m_lastRttUs >= 0 ? m_lastRttUs / 1000.0 : -1.0;
+    stats["meanRttMs"] = meanRttUs() >= 0 ? meanRttUs() / 1000.0 : -1.0;
+    stats["jitterMs"] = m_jitterUs / 1000.0;
+    stats["loss"] = lossRatio();
+    stats["missedPongs"] = m_missed;
+    stats["samples"] = answeredCount();
+    return stats;
+}
@@ -0,0 +1,144 @@
+#include "LoadBot.h"
+#include "ClockSync.h"
+#include <QRandomGenerator>
+#include <QDebug>
+#include <cmath>
+
+LoadBot::LoadBot(int index, const QString &roomName, bool leader, int roomSize, QObject *parent)
+    : QObject(parent), m_client(new DrumClient(this)), m_editTimer(new QTimer(this)), m_index(index),
+      m_userId(QString("bot-%1").arg(index)), m_roomName(roomName), m_leader(leader), m_roomSize(roomSize),
+      m_active(GridCell::MAX_ROWS * GridCell::MAX_COLS)
+{
+    connect(m_client, &DrumClient::connected, this, &LoadBot::onConnected);
+    connect(m_client, &DrumClient::disconnected, this, &LoadBot::connectionLost);
+    connect(m_client, &DrumClient::roomListReceived, this, &LoadBot::onRoomListReceived);
+    connect(m_client, &DrumClient::roomStateReceived, this, &LoadBot::onRoomStateReceived);
+    connect(m_client, &DrumClient::gridCellUpdated, this, &LoadBot::onGridCellUpdated);
+
+    m_editTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_editTimer, &QTimer::timeout, this, &LoadBot::onEditTimer);
+    setEditRate(4.0);
+}
+
+void LoadBot::start(const QString &host, quint16 port)
+{
+    m_client->connectToServer(host, port);
+}
+
+void LoadBot::stop()
+{
+    m_editTimer->stop();
+    m_client->disconnectFromServer();
+}
+
+void LoadBot::setEditRate(double editsPerSecond)
+{
+    // 0 : le bot écoute sans rien modifier
+    if (editsPerSecond <= 0.0)
+    {
+        m_editTimer->stop();
+        m_editTimer->setInterval(0);
+        return;
+    }
+    m_editTimer->setInterval(qMax(1, int(std::lround(1000.0 / editsPerSecond))));
+}
+
+void LoadBot::setGridSize(int rows, int cols)
+{
+    m_rows = qBound(1, rows, GridCell::MAX_ROWS);
+    m_cols = qBound(1, cols, GridCell::MAX_COLS);
+}
+
+void LoadBot::onConnected()
+{
+    // La liste des salons est déjà demandée par le client à la connexion
+    if (m_leader && !m_roomRequested)
+    {
+        m_roomRequested = true;
+        m_client->sendMessage(Protocol::createCreateRoomMessage(m_roomName, QString(), m_roomSize));
+    }
+}
+
+void LoadBot::onRoomListReceived(const QJsonArray &rooms)
+{
+    if (m_inRoom || (m_roomRequested && !m_leader))
+    {
+        return;
+    }
+
+    for (const QJsonValue &value : rooms)
+    {
+        const QJsonObject room = value.toObject();
+        if (room["name"].toString() != m_roomName)
+        {
+            continue;
+        }
+
+        if (m_leader)
+        {
+            // Le créateur est déjà membre : son salon est publié
+            enterRoom();
+        }
+        else
+        {
+            m_roomRequested = true;
+            m_client->joinRoom(room["id"].toString(), m_userId, m_userId);
+        }
+        return;
+    }
+}
+
+void LoadBot::onRoomStateReceived(const QJsonObject &state)
+{
+    Q_UNUSED(state);
+    if (!m_inRoom && m_roomRequested)
+    {
+        enterRoom();
+    }
+}
+
+void LoadBot::enterRoom()
+{
+    m_inRoom = true;
+    if (m_editTimer->interval() > 0)
+    {
+        // Phase aléatoire : les bots d'un salon n'envoient pas tous au même instant
+        QTimer::singleShot(QRandomGenerator::global()->bounded(m_editTimer->interval() + 1), this, [this]()
+                           {
+            if (m_inRoom && m_client->isConnected())
+                m_editTimer->start(); });
+    }
+    emit joinedRoom();
+}
+
+void LoadBot::onGridCellUpdated(const GridCell &cell)
+{
+    const qint64 receivedUs = ClockSync::nowUs();
+    if (cell.isValid())
+    {
+        m_active.setBit(cell.row * GridCell::MAX_COLS + cell.col, cell.active);
+    }
+    emit gridUpdateReceived(cell, receivedUs);
+}
+
+void LoadBot::onEditTimer()
+{
+    if (!m_client->isConnected())
+    {
+        m_editTimer->stop();
+        return;
+    }
+
+    QRandomGenerator *random = QRandomGenerator::global();
+    GridCell cell;
+    cell.row = random->bounded(m_rows);
+    cell.col = random->bounded(m_cols);
+    const int key = cell.row * GridCell::MAX_COLS + cell.col;
+    cell.active = !m_active.testBit(key);
+    cell.userId = m_userId;
+
+    m_active.setBit(key, cell.active);
+    m_sentAtUs.insert(key, ClockSync::nowUs());
+    ++m_editsSent;
+    m_client->sendMessage(Protocol::createGridUpdateMessage(cell));
+}
@@ -4,12 +4,15 @@
 #include "UserListWidget.h"
 
 #include <QTimer>
+#include <QSignalBlocker>
 #include "DrumServer.h"
 #include <QJsonArray>
 #include <QJsonObject>
 #include "Protocol.h"
 #include "DrumClient.h"
 #include "Room.h"
+#include "ClockSync.h"
+#include "OfflineRenderer.h"
 
 #include <QMenuBar>
 #include <QToolBar>
@@ -17,6 +20,7 @@
 #include <QMessageBox>
 #include <QUuid>
 #include <QInputDialog>
+#include <QFileDialog>
 #include <QGraphicsDropShadowEffect>
 #include <QPropertyAnimation>
 #include <QPixmap>
@@ -124,10 +128,16 @@ MainWindow::MainWindow(QWidget *parent)
 
         // Connexions audio - APRÈS création des boutons
         qDebug() << "Début connexions audio...";
-        connect(m_drumGrid, &DrumGrid::stepTriggered, this, [this](int step, const QList<int> &instruments)
-                { m_audioEngine->playMultipleInstruments(instruments); });
+        // Le transport tourne dans le rendu audio : la grille lui pousse son état
+        // et ne reçoit en retour que les notifications de step pour l'affichage
+        connect(m_drumGrid, &DrumGrid::playingChanged, m_audioEngine, &AudioEngine::setPlaying);
+        connect(m_drumGrid, &DrumGrid::tempoChanged, m_audioEngine, &AudioEngine::setTempo);
+        connect(m_drumGrid, &DrumGrid::stepCountChanged, m_audioEngine, &AudioEngine::setStepCount);
+        connect(m_drumGrid, &DrumGrid::stepMaskChanged, m_audioEngine, &AudioEngine::setStepMask);
+        connect(m_audioEngine, &AudioEngine::stepAdvanced, m_drumGrid, &DrumGrid::setCurrentStep);
         connect(m_drumGrid, &DrumGrid::cellClicked, this, &MainWindow::onGridCellClicked);
-        connect(m_drumGrid, &DrumGrid::stepTriggered, this, &MainWindow::onStepTriggered);
+        connect(m_drumGrid, &DrumGrid::batchEdited, this, &MainWindow::onGridBatchEdited);
+        connect(m_drumGrid, &DrumGrid::instrumentTriggered, this, &MainWindow::onInstrumentTriggered);
         qDebug() << "Connexions audio terminées";
 
         // Connexion pour la mise à jour dynamique des instruments
@@ -141,6 +151,16 @@ MainWindow::MainWindow(QWidget *parent)
             statusBar()->showMessage(QString("Instruments chargés: %1").arg(newCount), 3000); });
         qDebug() << "Connexion instruments terminée";
 
+        // Progression du chargement parallèle des samples (la grille reste utilisable)
+        connect(m_audioEngine, &AudioEngine::loadingProgress, this, [this](int loaded, int total)
+                { statusBar()->showMessage(QString("Chargement des samples: %1/%2").arg(loaded).arg(total)); });
+        connect(m_audioEngine, &AudioEngine::loadingFinished, this, [this](int loaded, bool cancelled)
+                {
+            if (cancelled)
+                statusBar()->showMessage(QString("Chargement annulé (%1 samples chargés)").arg(loaded), 3000);
+            else
+                statusBar()->showMessage(QString("Samples chargés: %1").arg(loaded), 3000); });
+
         // Connexion pour gérer l'avertissement de limite atteinte
         qDebug() << "Connexion limite instruments...";
         connect(m_audioEngine, &AudioEngine::maxInstrumentsReached, this,
@@ -196,6 +216,7 @@ MainWindow::MainWindow(QWidget *parent)
         connect(m_networkManager, &NetworkManager::connectionEstablished, this, &MainWindow::onConnectionEstablished);
         connect(m_networkManager, &NetworkManager::connectionLost, this, &MainWindow::onConnectionLost);
         connect(m_networkManager, &NetworkManager::errorOccurred, this, &MainWindow::onNetworkError);
+        connect(m_networkManager, &NetworkManager::linkStatsChanged, this, &MainWindow::onLinkStatsChanged);
         qDebug() << "Connexions réseau terminées";
 
         // Configuration de la fenêtre principale
@@ -223,7 +244,7 @@ MainWindow::MainWindow(QWidget *parent)
         // Configuration audio
         qDebug() << "Chargement samples audio...";
         m_audioEngine->loadSamples();
-        qDebug() << "Samples audio chargés";
+        qDebug() << "Chargement des samples lancé";
 
         // Configuration client
         qDebug() << "Configuration client réseau...";
@@ -341,7 +362,7 @@ void MainWindow::onColumnCountChanged(int newCount)
     QByteArray message = Protocol::createColumnUpdateMessage(newCount);
 
     if (m_networkManager->isServer())
-        m_networkManager->broadcastMessage(message);
+        m_networkManager->broadcastToRoom(m_currentRoomId, message);
     else if (m_networkManager->isClientConnected())
         m_networkManager->sendMessage(message);
 }
@@ -651,18 +672,46 @@ void MainWindow::setupMenus()
     fileMenu->addAction("&Nouveau", QKeySequence::New, [this]() { /* TODO */ });
     fileMenu->addAction("&Ouvrir", QKeySequence::Open, [this]() { /* TODO */ });
     fileMenu->addAction("&Sauvegarder", QKeySequence::Save, [this]() { /* TODO */ });
+    fileMenu->addAction("&Exporter en WAV...", this, &MainWindow::exportPatternToWav);
+    fileMenu->addAction("Exporter les &pistes séparées...", this, &MainWindow::exportStemsToWav);
     fileMenu->addSeparator();
     fileMenu->addAction("&Quitter", QKeySequence::Quit, this, &QWidget::close);
 
     // Menu Audio
     QMenu *audioMenu = menuBar()->addMenu("&Audio");
     audioMenu->addAction("&Recharger les samples", this, &MainWindow::reloadAudioSamples);
+    audioMenu->addAction("&Annuler le chargement", m_audioEngine, &AudioEngine::cancelLoading);
+    audioMenu->addSeparator();
+    QAction *chokeHiHats = audioMenu->addAction("&Étouffer les charlestons entre eux");
+    chokeHiHats->setCheckable(true);
+    chokeHiHats->setChecked(m_audioEngine->autoChokeHiHats());
+    connect(chokeHiHats, &QAction::toggled, m_audioEngine, &AudioEngine::setAutoChokeHiHats);
 }
 
 void MainWindow::setupStatusBar()
 {
     statusBar()->setObjectName("statusBar");
     statusBar()->showMessage("Bienvenue dans DrumBox Multiplayer !");
+
+    // Voix du mixeur, relevées périodiquement (le pic couvre tout l'intervalle)
+    m_voiceStatsLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(m_voiceStatsLabel);
+    QTimer *voiceStatsTimer = new QTimer(this);
+    connect(voiceStatsTimer, &QTimer::timeout, this, &MainWindow::updateVoiceStats);
+    voiceStatsTimer->start(VOICE_STATS_INTERVAL_MS);
+    updateVoiceStats();
+}
+
+void MainWindow::updateVoiceStats()
+{
+    const QJsonObject stats = m_audioEngine->voiceStats();
+    m_voiceStatsLabel->setText(QString("Voix %1/%2 (pic %3)")
+                                   .arg(stats["active"].toInt())
+                                   .arg(stats["slots"].toInt())
+                                   .arg(stats["peak"].toInt()));
+    m_voiceStatsLabel->setToolTip(QString("Voix remplacées : %1\nVoix étouffées : %2")
+                                      .arg(stats["stolen"].toInteger())
+                                      .arg(stats["choked"].toInteger()));
 }
 
 void MainWindow::onRoomListReceived(const QJsonArray &roomsArray)
@@ -1201,6 +1250,12 @@ void MainWindow::switchToGameMode()
     setWindowTitle(QString("DrumBox Multiplayer - %1").arg(m_userListWidget->findChild<QLabel *>()->text()));
     updateRoomDisplay();
 
+    // Un client (re)joignant un salon récupère ce qu'il a manqué
+    if (m_networkManager->isClientConnected())
+    {
+        syncGridWithNetwork();
+    }
+
     // Animation de transition
     QPropertyAnimation *animation = new QPropertyAnimation(m_stackedWidget, "geometry");
     animation->setDuration(300);
@@ -1212,16 +1267,26 @@ void MainWindow::switchToGameMode()
 void MainWindow::onPlayPauseClicked()
 {
     m_isPlaying = !m_isPlaying;
+
+    // En session, tout le monde démarre au même instant de l'horloge partagée
+    const bool networked = m_networkManager->isServerRunning() || m_networkManager->isClientConnected();
+    qint64 startAt = -1;
+    if (networked && m_isPlaying)
+    {
+        startAt = m_networkManager->sharedClockUs() + PLAY_START_LEAD_US;
+        m_audioEngine->syncTransport(m_networkManager->sharedToLocalUs(startAt), 0.0, m_drumGrid->getTempo());
+    }
+
     m_drumGrid->setPlaying(m_isPlaying);
     updatePlayButton();
 
     // Synchronisation réseau
-    if (m_networkManager->isServerRunning() || m_networkManager->isClientConnected())
+    if (networked)
     {
-        QByteArray message = Protocol::createPlayStateMessage(m_isPlaying);
+        QByteArray message = Protocol::createPlayStateMessage(m_isPlaying, startAt, 0.0);
         if (m_networkManager->isServer())
         {
-            m_networkManager->broadcastMessage(message);
+            m_networkManager->broadcastToRoom(m_currentRoomId, message);
         }
         else
         {
@@ -1235,6 +1300,7 @@ void MainWindow::onStopClicked()
     m_isPlaying = false;
     m_drumGrid->setPlaying(false);
     m_drumGrid->setCurrentStep(0);
+    m_audioEngine->resetTransport(0);
     updatePlayButton();
 
     // Synchronisation réseau
@@ -1243,7 +1309,7 @@ void MainWindow::onStopClicked()
         QByteArray message = Protocol::createPlayStateMessage(false);
         if (m_networkManager->isServer())
         {
-            m_networkManager->broadcastMessage(message);
+            m_networkManager->broadcastToRoom(m_currentRoomId, message);
         }
         else
         {
@@ -1259,10 +1325,20 @@ void MainWindow::onTempoChanged(int bpm)
     // Synchronisation réseau
     if (m_networkManager->isServerRunning() || m_networkManager->isClientConnected())
     {
-        QByteArray message = Protocol::createTempoMessage(bpm);
+        // En lecture, le nouveau tempo part de la position courante, datée sur l'horloge partagée
+        qint64 at = -1;
+        double step = 0.0;
+        if (m_isPlaying)
+        {
+            const qint64 now = ClockSync::nowUs();
+            step = m_audioEngine->transportPosition(now);
+            at = m_networkManager->localToSharedUs(now);
+            m_audioEngine->syncTransport(now, step, bpm);
+        }
+        QByteArray message = Protocol::createTempoMessage(bpm, at, step);
         if (m_networkManager->isServer())
         {
-            m_networkManager->broadcastMessage(message);
+            m_networkManager->broadcastToRoom(m_currentRoomId, message);
         }
         else
         {
@@ -1287,14 +1363,38 @@ void MainWindow::onGridCellClicked(int row, int col, bool active)
 
     QByteArray message = Protocol::createGridUpdateMessage(cell);
     if (m_networkManager->isServer())
-        m_networkManager->broadcastMessage(message);
+        m_networkManager->broadcastToRoom(m_currentRoomId, message);
+    else if (m_networkManager->isClientConnected())
+        m_networkManager->sendMessage(message);
     else
+        m_roomRevision = -1; // Modification locale hors ligne : instantané complet au retour
+}
+
+void MainWindow::onGridBatchEdited(const GridBatch &batch)
+{
+    // Tracé ou opération de ligne : une seule trame, quel que soit le nombre de cellules
+    GridBatch owned = batch;
+    owned.userId = m_currentUserId;
+
+    QByteArray message = Protocol::createGridBatchMessage(owned);
+    if (m_networkManager->isServer())
+        m_networkManager->broadcastToRoom(m_currentRoomId, message);
+    else if (m_networkManager->isClientConnected())
         m_networkManager->sendMessage(message);
+    else
+        m_roomRevision = -1;
 }
 
-void MainWindow::onStepTriggered(int step, const QList<int> &activeInstruments)
+void MainWindow::onInstrumentTriggered(int instrument)
 {
-    // L'AudioEngine gère déjà la lecture via la connexion directe
+    // Jouée tout de suite en local ; les autres membres l'entendent à réception
+    m_audioEngine->playInstrument(instrument);
+
+    QByteArray message = Protocol::createPadHitMessage(instrument, m_currentUserId);
+    if (m_networkManager->isServer())
+        m_networkManager->broadcastToRoom(m_currentRoomId, message);
+    else if (m_networkManager->isClientConnected())
+        m_networkManager->sendMessage(message);
 }
 
 void MainWindow::reloadAudioSamples()
@@ -1304,10 +1404,10 @@ void MainWindow::reloadAudioSamples()
     if (m_audioEngine->loadSamples())
     {
         int newCount = m_audioEngine->getInstrumentCount();
-        statusBar()->showMessage(QString("Samples rechargés: %1 instruments (était %2)").arg(newCount).arg(previousCount), 3000);
+        statusBar()->showMessage(QString("Rechargement de %1 instruments (était %2)...").arg(newCount).arg(previousCount));
 
         // Log détaillé
-        qDebug() << "Rechargement terminé:";
+        qDebug() << "Rechargement lancé:";
         qDebug() << "  - Instruments précédents:" << previousCount;
         qDebug() << "  - Nouveaux instruments:" << newCount;
         qDebug() << "  - Limite actuelle:" << (m_audioEngine->getMaxInstruments() == 0 ? "Illimitée" : QString::number(m_audioEngine->getMaxInstruments()));
@@ -1318,6 +1418,79 @@ void MainWindow::reloadAudioSamples()
     }
 }
 
+void MainWindow::exportPatternToWav()
+{
+    bool ok = false;
+    const int loops = QInputDialog::getInt(this, "Exporter en WAV", "Nombre de boucles :", 4, 1, 256, 1, &ok);
+    if (!ok)
+        return;
+
+    const QString filePath = QFileDialog::getSaveFileName(this, "Exporter en WAV", "motif.wav", "Fichiers WAV (*.wav)");
+    if (filePath.isEmpty())
+        return;
+
+    // Rendu hors ligne avec les samples déjà chargés, sans passer par la carte son
+    OfflineRenderer renderer;
+    renderer.setSamples(m_audioEngine->currentSamples());
+    renderer.setChokeGroups(m_audioEngine->chokeGroups());
+    renderer.setGridState(m_drumGrid->getGridState());
+    renderer.setLoops(loops);
+    renderer.setGain(m_audioEngine->getVolume());
+
+    OfflineRenderer::Result result;
+    QString error;
+    if (!renderer.renderToFile(filePath, &result, &error))
+    {
+        QMessageBox::warning(this, "Exporter en WAV", error);
+        return;
+    }
+
+    statusBar()->showMessage(QString("Exporté : %1 s de son en %2 ms (%3× le temps réel)")
+                                 .arg(result.durationSeconds(), 0, 'f', 1)
+                                 .arg(result.elapsedUs / 1000)
+                                 .arg(result.realtimeFactor(), 0, 'f', 0),
+                             5000);
+}
+
+void MainWindow::exportStemsToWav()
+{
+    bool ok = false;
+    const int loops = QInputDialog::getInt(this, "Exporter les pistes séparées", "Nombre de boucles :", 4, 1, 256, 1, &ok);
+    if (!ok)
+        return;
+
+    const QString directory = QFileDialog::getExistingDirectory(this, "Dossier des pistes");
+    if (directory.isEmpty())
+        return;
+
+    // Une piste par instrument utilisé, rendues en parallèle
+    OfflineRenderer renderer;
+    renderer.setSamples(m_audioEngine->currentSamples());
+    renderer.setChokeGroups(m_audioEngine->chokeGroups());
+    renderer.setGridState(m_drumGrid->getGridState());
+    renderer.setLoops(loops);
+    renderer.setGain(m_audioEngine->getVolume());
+
+    QVector<OfflineRenderer::StemResult> stems;
+    OfflineRenderer::Result total;
+    QString error;
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    const bool exported = renderer.renderStems(directory, m_audioEngine->getInstrumentNames(), &stems, &total, &error);
+    QApplication::restoreOverrideCursor();
+
+    if (!exported)
+    {
+        QMessageBox::warning(this, "Exporter les pistes séparées", error);
+        return;
+    }
+
+    statusBar()->showMessage(QString("%1 pistes exportées en %2 ms (%3× le temps réel)")
+                                 .arg(stems.size())
+                                 .arg(total.elapsedUs / 1000)
+                                 .arg(total.realtimeFactor(), 0, 'f', 0),
+                             5000);
+}
+
 // Méthodes réseau
 void MainWindow::onStartServerClicked()
 {
@@ -1336,7 +1509,9 @@ void MainWindow::onStartServerClicked()
         if (m_networkManager->getServer())
         {
             m_networkManager->getServer()->setRoomManager(m_roomManager);
-            m_networkManager->getServer()->setHostWindow(this);
+            connect(m_networkManager->getServer(), &DrumServer::hostMessageReceived,
+                    this, &MainWindow::onMessageReceived, Qt::UniqueConnection);
+            m_networkManager->getServer()->setHostUserId(m_currentUserId);
             qDebug() << "[MAINWINDOW] RoomManager et host window partagés avec le serveur";
         }
 
@@ -1393,6 +1568,14 @@ void MainWindow::onDisconnectClicked()
 // Gestion des salons
 void MainWindow::onCreateRoomRequested(const QString &name, const QString &password, int maxUsers)
 {
+    // Connecté à un serveur (dédié ou hébergé ailleurs) : c'est lui qui crée le salon
+    if (m_networkManager->isClientConnected())
+    {
+        m_networkManager->sendMessage(Protocol::createCreateRoomMessage(name, password, maxUsers));
+        statusBar()->showMessage(QString("Création du salon \"%1\" demandée au serveur").arg(name), 3000);
+        return;
+    }
+
     if (!m_networkManager->isServerRunning())
     {
         if (!m_networkManager->startServer(m_portSpin->value()))
@@ -1404,7 +1587,7 @@ void MainWindow::onCreateRoomRequested(const QString &name, const QString &passw
         if (m_networkManager->getServer())
         {
             m_networkManager->getServer()->setRoomManager(m_roomManager);
-            // m_networkManager->getServer()->setHostWindow(this);
+            // Pas de hostMessageReceived ici : messageReceived du NetworkManager suffit
             qDebug() << "[MAINWINDOW] RoomManager et host window partagés avec le serveur (auto)";
         }
     }
@@ -1421,6 +1604,9 @@ void MainWindow::onCreateRoomRequested(const QString &name, const QString &passw
 
     updateRoomDisplay();
 
+    // La grille de l'hôte devient l'état initial (révisionné) du salon
+    syncGridWithNetwork();
+
     // onRefreshRoomsRequested();
     // // Rejoindre automatiquement la salle créée
     // onJoinRoomRequested(roomId, password);
@@ -1438,6 +1624,16 @@ void MainWindow::onJoinRoomRequested(const QString &roomId, const QString &passw
             Room *room = m_roomManager->getRoom(roomId);
             m_userListWidget->setCurrentRoom(roomId, room->getName());
             switchToGameMode();
+
+            // L'état du salon tenu par le serveur fait foi
+            if (m_networkManager->getServer())
+            {
+                const QJsonObject snapshot = m_networkManager->getServer()->roomSnapshot(roomId);
+                if (!snapshot.isEmpty())
+                {
+                    handleNetworkMessage(MessageType::SYNC_RESPONSE, snapshot);
+                }
+            }
             statusBar()->showMessage(QString("Rejoint le salon '%1'").arg(room->getName()));
         }
         else
@@ -1595,6 +1791,37 @@ void MainWindow::onNetworkError(const QString &error)
     updateNetworkStatus();
 }
 
+void MainWindow::onLinkStatsChanged()
+{
+    // Résumé d'une mesure de lien : "RTT 12.3 ms, gigue 0.8 ms, perte 0 %"
+    auto describe = [](const QJsonObject &stats)
+    {
+        return QString("RTT %1 ms, gigue %2 ms, perte %3 %")
+            .arg(stats["rttMs"].toDouble(), 0, 'f', 1)
+            .arg(stats["jitterMs"].toDouble(), 0, 'f', 1)
+            .arg(stats["loss"].toDouble() * 100.0, 0, 'f', 0);
+    };
+
+    const QJsonObject stats = m_networkManager->linkStats();
+    if (m_networkManager->isServerRunning())
+    {
+        QStringList lines;
+        for (auto it = stats.constBegin(); it != stats.constEnd(); ++it)
+        {
+            lines << QString("%1 : %2").arg(it.key().left(8), describe(it.value().toObject()));
+        }
+        m_networkStatusLabel->setToolTip(lines.join('\n'));
+    }
+    else if (m_networkManager->isClientConnected() && stats["rttMs"].toDouble() >= 0)
+    {
+        m_networkStatusLabel->setText(QString("Connecté à %1:%2 (%3 ms)")
+                                          .arg(m_serverAddressEdit->text())
+                                          .arg(m_portSpin->value())
+                                          .arg(qRound(stats["rttMs"].toDouble())));
+        m_networkStatusLabel->setToolTip(describe(stats));
+    }
+}
+
 // Méthodes utilitaires
 
 void MainWindow::updatePlayButton()
@@ -1630,6 +1857,10 @@ void MainWindow::updateNetworkStatus()
     }
 
     m_networkStatusLabel->setText(status);
+    if (!connected)
+    {
+        m_networkStatusLabel->setToolTip(QString());
+    }
     m_disconnectBtn->setEnabled(connected);
     m_portSpin->setEnabled(!connected);
 }
@@ -1649,7 +1880,7 @@ void MainWindow::updateRoomDisplay()
             // Mettre à jour les couleurs des utilisateurs dans la grille
             for (const User &user : room->getUsers())
             {
-                m_drumGrid->setUserColor(user.id, user.color);
+                m_drumGrid->setUserColor(user.id, QColor(user.color));
             }
         }
     }
@@ -1663,16 +1894,40 @@ void MainWindow::syncGridWithNetwork()
         QJsonObject gridState = m_drumGrid->getGridState();
         gridState["instrumentNames"] = QJsonArray::fromStringList(m_audioEngine->getInstrumentNames());
         QByteArray message = Protocol::createSyncResponseMessage(gridState);
-        m_networkManager->broadcastMessage(message);
+        m_networkManager->broadcastToRoom(m_currentRoomId, message);
     }
     else if (m_networkManager->isClientConnected())
     {
-        // Le client demande une synchronisation
-        QByteArray message = Protocol::createSyncRequestMessage();
+        // Le client annonce sa dernière révision : le serveur ne renvoie que ce qui manque
+        if (m_revisionRoomId != m_currentRoomId)
+        {
+            m_revisionRoomId = m_currentRoomId;
+            m_roomRevision = -1;
+        }
+        QByteArray message = Protocol::createSyncRequestMessage(m_roomRevision, m_roomEpoch);
         m_networkManager->sendMessage(message);
     }
 }
 
+void MainWindow::applySharedTransport(const QJsonObject &data, int bpm)
+{
+    // `at` est daté sur l'horloge partagée ; le mixeur travaille en horloge locale
+    if (data.contains("at"))
+    {
+        const qint64 anchorUs = m_networkManager->sharedToLocalUs(data["at"].toInteger());
+        m_audioEngine->syncTransport(anchorUs, data["step"].toDouble(), bpm);
+    }
+}
+
+void MainWindow::noteRoomRevision(const QJsonObject &data)
+{
+    // Les opérations relayées par le serveur portent leur révision
+    if (data.contains("rev") && m_revisionRoomId == m_currentRoomId)
+    {
+        m_roomRevision = data["rev"].toInteger();
+    }
+}
+
 void MainWindow::handleNetworkMessage(MessageType type, const QJsonObject &data)
 {
     switch (type)
@@ -1716,7 +1971,7 @@ void MainWindow::handleNetworkMessage(MessageType type, const QJsonObject &data)
                 // Notifier les autres utilisateurs
                 User user = room->getUser(userId);
                 QByteArray userJoinedMsg = Protocol::createUserJoinedMessage(user);
-                m_networkManager->broadcastMessage(userJoinedMsg);
+                m_networkManager->broadcastToRoom(roomId, userJoinedMsg);
             }
             else
             {
@@ -1731,6 +1986,7 @@ void MainWindow::handleNetworkMessage(MessageType type, const QJsonObject &data)
     {
         int columnCount = data["columnCount"].toInt();
         m_drumGrid->setStepCount(columnCount);
+        noteRoomRevision(data);
         break;
     }
 
@@ -1744,7 +2000,7 @@ void MainWindow::handleNetworkMessage(MessageType type, const QJsonObject &data)
             if (m_roomManager->leaveRoom(roomId, userId))
             {
                 QByteArray userLeftMsg = Protocol::createUserLeftMessage(userId);
-                m_networkManager->broadcastMessage(userLeftMsg);
+                m_networkManager->broadcastToRoom(roomId, userLeftMsg);
             }
         }
         break;
@@ -1807,23 +2063,54 @@ void MainWindow::handleNetworkMessage(MessageType type, const QJsonObject &data)
     {
         GridCell cell = GridCell::fromJson(data);
         m_drumGrid->setCellActive(cell.row, cell.col, cell.active, cell.userId);
+        noteRoomRevision(data);
+        break;
+    }
+
+    case MessageType::GRID_BATCH:
+    {
+        GridBatch batch;
+        if (GridBatch::fromJson(data, batch))
+        {
+            m_drumGrid->applyGridBatch(batch);
+        }
+        noteRoomRevision(data);
         break;
     }
 
+    case MessageType::PAD_HIT:
+        // Frappe en direct d'un autre membre ; notre propre frappe a déjà été jouée
+        if (data["userId"].toString() != m_currentUserId)
+        {
+            m_audioEngine->playInstrument(data["instrument"].toInt());
+        }
+        break;
+
     case MessageType::TEMPO_CHANGE:
     {
         int bpm = data["bpm"].toInt();
-        m_tempoSpin->setValue(bpm);
+        {
+            // Changement distant : ne pas le rediffuser via onTempoChanged
+            QSignalBlocker blocker(m_tempoSpin);
+            m_tempoSpin->setValue(bpm);
+        }
         m_drumGrid->setTempo(bpm);
+        applySharedTransport(data, bpm);
+        noteRoomRevision(data);
         break;
     }
 
     case MessageType::PLAY_STATE:
     {
         bool playing = data["playing"].toBool();
+        if (playing)
+        {
+            applySharedTransport(data, m_drumGrid->getTempo());
+        }
         m_isPlaying = playing;
         m_drumGrid->setPlaying(playing);
         updatePlayButton();
+        noteRoomRevision(data);
         break;
     }
 
@@ -1841,9 +2128,31 @@ void MainWindow::handleNetworkMessage(MessageType type, const QJsonObject &data)
 
     case MessageType::SYNC_RESPONSE:
     {
+        if (data.contains("revision"))
+        {
+            m_revisionRoomId = m_currentRoomId;
+            m_roomRevision = data["revision"].toInteger();
+            m_roomEpoch = quint32(data["epoch"].toInteger());
+        }
+
+        // Fin d'un rattrapage : les opérations manquantes ont déjà été appliquées
+        if (data["delta"].toBool())
+        {
+            break;
+        }
+
         m_drumGrid->setGridState(data);
-        m_tempoSpin->setValue(data["tempo"].toInt(120));
+        {
+            QSignalBlocker blocker(m_tempoSpin);
+            m_tempoSpin->setValue(data["tempo"].toInt(120));
+        }
         m_isPlaying = data["playing"].toBool(false);
+        if (m_isPlaying)
+        {
+            // Arrivée en cours de lecture : reprise à la phase commune
+            applySharedTransport(data, m_drumGrid->getTempo());
+        }
+        m_drumGrid->setPlaying(m_isPlaying);
         updatePlayButton();
 
         // Mettre à jour les instruments si présents
@@ -1880,6 +2189,7 @@ void MainWindow::handleNetworkMessage(MessageType type, const QJsonObject &data)
         m_drumGrid->setInstrumentCount(instrumentCount);
 
         statusBar()->showMessage(QString("Instruments synchronisés: %1").arg(instrumentCount), 2000);
+        noteRoomRevision(data);
         break;
     }
 
@@ -0,0 +1,244 @@
+#include "MixKernels.h"
+#include <algorithm>
+
+// SSE2 requis à la compilation (toujours vrai en x86-64), AVX2 testé à l'exécution
+#if defined(Q_PROCESSOR_X86) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define MIXKERNELS_X86 1
+#include <immintrin.h>
+#if defined(Q_CC_MSVC) && !defined(Q_CC_CLANG)
+#include <intrin.h>
+#define MIXKERNELS_TARGET_AVX2
+#else
+#define MIXKERNELS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+
+// ----------------------------------------------------------------------------
+// Scalaire (référence, et fin de bloc des versions vectorielles)
+// ----------------------------------------------------------------------------
+
+void mixScalar(float* out, const float* in, qint64 count) {
+    for (qint64 n = 0; n < count; ++n) {
+        out[n] += in[n];
+    }
+}
+
+void mixStereoScalar(float* out, const float* in, qint64 frames, float left, float right) {
+    for (qint64 frame = 0; frame < frames; ++frame) {
+        out[frame * 2] += in[frame * 2] * left;
+        out[frame * 2 + 1] += in[frame * 2 + 1] * right;
+    }
+}
+
+void gainRampScalar(float* buffer, qint64 frames, float from, float step) {
+    float gain = from;
+    for (qint64 frame = 0; frame < frames; ++frame) {
+        buffer[frame * 2] *= gain;
+        buffer[frame * 2 + 1] *= gain;
+        gain += step;
+    }
+}
+
+void toInt16Scalar(qint16* out, const float* in, qint64 count) {
+    for (qint64 n = 0; n < count; ++n) {
+        out[n] = qint16(std::clamp(in[n], -1.0f, 1.0f) * 32767.0f);
+    }
+}
+
+#ifdef MIXKERNELS_X86
+
+// ----------------------------------------------------------------------------
+// SSE2
+// ----------------------------------------------------------------------------
+
+void mixSse2(float* out, const float* in, qint64 count) {
+    qint64 n = 0;
+    for (; n + 8 <= count; n += 8) {
+        const __m128 a = _mm_add_ps(_mm_loadu_ps(out + n), _mm_loadu_ps(in + n));
+        const __m128 b = _mm_add_ps(_mm_loadu_ps(out + n + 4), _mm_loadu_ps(in + n + 4));
+        _mm_storeu_ps(out + n, a);
+        _mm_storeu_ps(out + n + 4, b);
+    }
+    mixScalar(out + n, in + n, count - n);
+}
+
+void mixStereoSse2(float* out, const float* in, qint64 frames, float left, float right) {
+    // Deux frames stéréo par registre : gains (l, r, l, r)
+    const __m128 gains = _mm_setr_ps(left, right, left, right);
+    qint64 frame = 0;
+    for (; frame + 4 <= frames; frame += 4) {
+        float* p = out + frame * 2;
+        const float* q = in + frame * 2;
+        const __m128 a = _mm_add_ps(_mm_loadu_ps(p), _mm_mul_ps(_mm_loadu_ps(q), gains));
+        const __m128 b = _mm_add_ps(_mm_loadu_ps(p + 4), _mm_mul_ps(_mm_loadu_ps(q + 4), gains));
+        _mm_storeu_ps(p, a);
+        _mm_storeu_ps(p + 4, b);
+    }
+    mixStereoScalar(out + frame * 2, in + frame * 2, frames - frame, left, right);
+}
+
+void gainRampSse2(float* buffer, qint64 frames, float from, float step) {
+    // Deux frames stéréo par registre : gains (g, g, g+s, g+s)
+    __m128 gain = _mm_setr_ps(from, from, from + step, from + step);
+    const __m128 increment = _mm_set1_ps(2.0f * step);
+    qint64 frame = 0;
+    for (; frame + 2 <= frames; frame += 2) {
+        float* p = buffer + frame * 2;
+        _mm_storeu_ps(p, _mm_mul_ps(_mm_loadu_ps(p), gain));
+        gain = _mm_add_ps(gain, increment);
+    }
+    gainRampScalar(buffer + frame * 2, frames - frame, from + float(frame) * step, step);
+}
+
+void toInt16Sse2(qint16* out, const float* in, qint64 count) {
+    const __m128 low = _mm_set1_ps(-1.0f);
+    const __m128 high = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(32767.0f);
+    qint64 n = 0;
+    for (; n + 8 <= count; n += 8) {
+        const __m128 a = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + n), low), high), scale);
+        const __m128 b = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + n + 4), low), high), scale);
+        const __m128i packed = _mm_packs_epi32(_mm_cvttps_epi32(a), _mm_cvttps_epi32(b));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + n), packed);
+    }
+    toInt16Scalar(out + n, in + n, count - n);
+}
+
+// ----------------------------------------------------------------------------
+// AVX2 (détecté à l'exécution)
+// ----------------------------------------------------------------------------
+
+MIXKERNELS_TARGET_AVX2 void mixAvx2(float* out, const float* in, qint64 count) {
+    qint64 n = 0;
+    for (; n + 16 <= count; n += 16) {
+        const __m256 a = _mm256_add_ps(_mm256_loadu_ps(out + n), _mm256_loadu_ps(in + n));
+        const __m256 b = _mm256_add_ps(_mm256_loadu_ps(out + n + 8), _mm256_loadu_ps(in + n + 8));
+        _mm256_storeu_ps(out + n, a);
+        _mm256_storeu_ps(out + n + 8, b);
+    }
+    _mm256_zeroupper();
+    mixSse2(out + n, in + n, count - n);
+}
+
+MIXKERNELS_TARGET_AVX2 void mixStereoAvx2(float* out, const float* in, qint64 frames, float left, float right) {
+    // Quatre frames stéréo par registre
+    const __m256 gains = _mm256_setr_ps(left, right, left, right, left, right, left, right);
+    qint64 frame = 0;
+    for (; frame + 8 <= frames; frame += 8) {
+        float* p = out + frame * 2;
+        const float* q = in + frame * 2;
+        const __m256 a = _mm256_add_ps(_mm256_loadu_ps(p), _mm256_mul_ps(_mm256_loadu_ps(q), gains));
+        const __m256 b = _mm256_add_ps(_mm256_loadu_ps(p + 8), _mm256_mul_ps(_mm256_loadu_ps(q + 8), gains));
+        _mm256_storeu_ps(p, a);
+        _mm256_storeu_ps(p + 8, b);
+    }
+    _mm256_zeroupper();
+    mixStereoSse2(out + frame * 2, in + frame * 2, frames - frame, left, right);
+}
+
+MIXKERNELS_TARGET_AVX2 void gainRampAvx2(float* buffer, qint64 frames, float from, float step) {
+    // Quatre frames stéréo par registre
+    __m256 gain = _mm256_setr_ps(from, from, from + step, from + step,
+                                 from + 2.0f * step, from + 2.0f * step,
+                                 from + 3.0f * step, from + 3.0f * step);
+    const __m256 increment = _mm256_set1_ps(4.0f * step);
+    qint64 frame = 0;
+    for (; frame + 4 <= frames; frame += 4) {
+        float* p = buffer + frame * 2;
+        _mm256_storeu_ps(p, _mm256_mul_ps(_mm256_loadu_ps(p), gain));
+        gain = _mm256_add_ps(gain, increment);
+    }
+    _mm256_zeroupper();
+    gainRampScalar(buffer + frame * 2, frames - frame, from + float(frame) * step, step);
+}
+
+MIXKERNELS_TARGET_AVX2 void toInt16Avx2(qint16* out, const float* in, qint64 count) {
+    const __m256 low = _mm256_set1_ps(-1.0f);
+    const __m256 high = _mm256_set1_ps(1.0f);
+    const __m256 scale = _mm256_set1_ps(32767.0f);
+    qint64 n = 0;
+    for (; n + 16 <= count; n += 16) {
+        const __m256 a = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(in + n), low), high), scale);
+        const __m256 b = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(in + n + 8), low), high), scale);
+        // packs travaille par voie de 128 bits : on remet les quadruplets dans l'ordre
+        const __m256i packed = _mm256_packs_epi32(_mm256_cvttps_epi32(a), _mm256_cvttps_epi32(b));
+        const __m256i ordered = _mm256_permute4x64_epi64(packed, 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + n), ordered);
+    }
+    _mm256_zeroupper();
+    toInt16Sse2(out + n, in + n, count - n);
+}
+
+bool cpuHasAvx2() {
+#if defined(Q_CC_MSVC) && !defined(Q_CC_CLANG)
+    int info[4] = {};
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+        return false; // Registres YMM non sauvegardés par le système
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // MIXKERNELS_X86
+
+struct Kernels {
+    void (*mix)(float*, const float*, qint64);
+    void (*mixStereo)(float*, const float*, qint64, float, float);
+    void (*gainRamp)(float*, qint64, float, float);
+    void (*toInt16)(qint16*, const float*, qint64);
+    const char* name;
+};
+
+Kernels selectKernels() {
+#ifdef MIXKERNELS_X86
+    if (cpuHasAvx2()) {
+        return {mixAvx2, mixStereoAvx2, gainRampAvx2, toInt16Avx2, "avx2"};
+    }
+    return {mixSse2, mixStereoSse2, gainRampSse2, toInt16Sse2, "sse2"};
+#else
+    return {mixScalar, mixStereoScalar, gainRampScalar, toInt16Scalar, "scalar"};
+#endif
+}
+
+// Choisi à l'initialisation statique : jamais de détection sur le thread audio
+const Kernels s_kernels = selectKernels();
+
+} // namespace
+
+namespace MixKernels {
+
+void mix(float* out, const float* in, qint64 count) {
+    s_kernels.mix(out, in, count);
+}
+
+void mixStereo(float* out, const float* in, qint64 frames, float left, float right) {
+    s_kernels.mixStereo(out, in, frames, left, right);
+}
+
+void applyGainRamp(float* buffer, qint64 frames, float from, float to) {
+    const float step = frames > 0 ? (to - from) / float(frames) : 0.0f;
+    s_kernels.gainRamp(buffer, frames, from, step);
+}
+
+void floatToInt16(qint16* out, const float* in, qint64 count) {
+    s_kernels.toInt16(out, in, count);
+}
+
+const char* implementationName() {
+    return s_kernels.name;
+}
+
+} // namespace MixKernels
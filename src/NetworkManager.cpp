@@ -1,6 +1,7 @@
 #include "NetworkManager.h"
 #include "DrumServer.h"
 #include "DrumClient.h"
+#include "ClockSync.h"
 #include <QDebug>
 
 NetworkManager::NetworkManager(QObject* parent)
@@ -39,6 +40,7 @@ bool NetworkManager::startServer(quint16 port) {
                 emit messageReceived(msg);
             });
     connect(m_server, &DrumServer::errorOccurred, this, &NetworkManager::errorOccurred);
+    connect(m_server, &DrumServer::linkStatsUpdated, this, &NetworkManager::linkStatsChanged);
 
     if (m_server->startListening(port)) {
         m_isServer = true;
@@ -86,6 +88,7 @@ bool NetworkManager::connectToServer(const QString& host, quint16 port) {
     connect(m_client, &DrumClient::disconnected, this, &NetworkManager::connectionLost);
     connect(m_client, &DrumClient::messageReceived, this, &NetworkManager::messageReceived);
     connect(m_client, &DrumClient::errorOccurred, this, &NetworkManager::errorOccurred);
+    connect(m_client, &DrumClient::linkStatsChanged, this, &NetworkManager::linkStatsChanged);
 
     return m_client->connectToServer(host, port);
 }
@@ -118,3 +121,30 @@ void NetworkManager::broadcastMessage(const QByteArray& message) {
         qWarning() << "Tentative de diffusion sans serveur actif";
     }
 }
+
+void NetworkManager::broadcastToRoom(const QString& roomId, const QByteArray& message) {
+    if (m_server && m_server->isListening()) {
+        m_server->broadcastToRoom(roomId, message);
+    } else {
+        qWarning() << "Tentative de diffusion sans serveur actif";
+    }
+}
+
+qint64 NetworkManager::sharedClockUs() const {
+    return localToSharedUs(ClockSync::nowUs());
+}
+
+qint64 NetworkManager::sharedToLocalUs(qint64 sharedUs) const {
+    return (m_client && !m_isServer) ? m_client->clock().toLocalUs(sharedUs) : sharedUs;
+}
+
+qint64 NetworkManager::localToSharedUs(qint64 localUs) const {
+    return (m_client && !m_isServer) ? m_client->clock().toSharedUs(localUs) : localUs;
+}
+
+QJsonObject NetworkManager::linkStats() const {
+    if (m_server && m_isServer) {
+        return m_server->linkStatsJson();
+    }
+    return m_client ? m_client->linkStats().toJson() : QJsonObject();
+}
@@ -0,0 +1,334 @@
+#include "OfflineRenderer.h"
+#include "AudioMixer.h"
+#include "MixKernels.h"
+#include "PatternModel.h"
+#include <QDir>
+#include <QFile>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QThreadPool>
+#include <QtEndian>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+static_assert(OfflineRenderer::MAX_STEPS == AudioMixer::MAX_STEPS, "Masques de steps incompatibles");
+
+double OfflineRenderer::Result::durationSeconds() const {
+    return double(frames) / SampleBuffer::SAMPLE_RATE;
+}
+
+double OfflineRenderer::Result::realtimeFactor() const {
+    return elapsedUs > 0 ? durationSeconds() * 1e6 / double(elapsedUs) : 0.0;
+}
+
+void OfflineRenderer::setGridState(const QJsonObject& state) {
+    // Même lecture que DrumGrid::setGridState, sans widget
+    PatternModel model;
+    model.resize(state.value("instrumentCount").toInt(PatternModel::MAX_INSTRUMENTS),
+                 state.value("stepCount").toInt(16));
+    if (state.contains("owners")) {
+        model.loadCompactCells(state);
+    } else {
+        model.loadCells(state["cells"].toArray());
+    }
+
+    m_stepCount = qMax(1, model.stepCount());
+    m_instrumentCount = model.instrumentCount();
+    m_stepMasks.fill(0);
+    for (int step = 0; step < m_stepCount; ++step) {
+        m_stepMasks[step] = model.stepMask(step);
+    }
+
+    if (state.contains("tempo")) {
+        setTempo(state["tempo"].toDouble());
+    }
+}
+
+void OfflineRenderer::setTempo(double bpm) {
+    if (bpm > 0.0) {
+        m_bpm = bpm;
+    }
+}
+
+qint64 OfflineRenderer::loopFrames() const {
+    // Doubles-croches : 4 steps par temps, comme le transport du mixeur
+    const double framesPerStep = SampleBuffer::SAMPLE_RATE * 60.0 / (m_bpm * 4.0);
+    return qint64(std::llround(m_stepCount * framesPerStep));
+}
+
+bool OfflineRenderer::parseFormat(const QString& name, WavFormat* format) {
+    const QString key = name.trimmed().toLower();
+    if (key == "16" || key == "int16" || key == "s16") {
+        *format = WavFormat::Int16;
+    } else if (key == "24" || key == "int24" || key == "s24") {
+        *format = WavFormat::Int24;
+    } else if (key == "float" || key == "f32" || key == "32f") {
+        *format = WavFormat::Float32;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool OfflineRenderer::renderToFile(const QString& filePath, Result* result, QString* errorString) const {
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (errorString) {
+            *errorString = QString("Impossible d'écrire %1: %2").arg(filePath, file.errorString());
+        }
+        return false;
+    }
+    return render(&file, result, errorString);
+}
+
+bool OfflineRenderer::render(QIODevice* device, Result* result, QString* errorString) const {
+    if (!device || !device->isWritable() || device->isSequential()) {
+        if (errorString) {
+            *errorString = "Sortie WAV non modifiable (l'en-tête est réécrit à la fin)";
+        }
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Le thread courant joue à la fois le GUI (commandes) et le thread audio (rendu)
+    auto mixer = std::make_unique<AudioMixer>();
+    if (m_soloInstrument >= 0) {
+        mixer->setSample(m_soloInstrument, m_samples.value(m_soloInstrument));
+    } else {
+        mixer->setSamples(m_samples);
+    }
+    for (int instrumentId = 0; instrumentId < m_chokeGroups.size(); ++instrumentId) {
+        mixer->setChokeGroup(instrumentId, m_chokeGroups[instrumentId]);
+    }
+    mixer->setMasterGain(m_gain);
+    mixer->setStepCount(m_stepCount);
+    const quint64 instrumentMask = m_soloInstrument >= 0 ? quint64(1) << m_soloInstrument : ~quint64(0);
+    for (int step = 0; step < m_stepCount; ++step) {
+        mixer->setStepMask(step, m_stepMasks[step] & instrumentMask);
+    }
+    mixer->setTempo(m_bpm);
+    mixer->resetTransport(0);
+    mixer->setPlaying(true);
+
+    const qint64 headerPos = device->pos();
+    if (device->write(wavHeader(m_format, 0)) < 0) {
+        if (errorString) {
+            *errorString = device->errorString();
+        }
+        return false;
+    }
+
+    std::vector<float> block(BLOCK_FRAMES * SampleBuffer::CHANNELS);
+    QByteArray encoded;
+    const qint64 patternFrames = loopFrames() * m_loops;
+    const qint64 maxFrames = patternFrames + (m_includeTail ? qint64(MAX_TAIL_SECONDS) * SampleBuffer::SAMPLE_RATE : 0);
+    qint64 frames = 0;
+
+    while (frames < maxFrames) {
+        qint64 chunk = qMin<qint64>(BLOCK_FRAMES, maxFrames - frames);
+        if (frames < patternFrames) {
+            // Le dernier bloc du motif s'arrête pile sur la fin de la boucle
+            chunk = qMin(chunk, patternFrames - frames);
+        } else {
+            if (frames == patternFrames) {
+                mixer->setPlaying(false); // Plus de nouveaux steps, les voix finissent de sonner
+            }
+            if (mixer->activeVoiceCount() == 0) {
+                break;
+            }
+        }
+
+        mixer->render(block.data(), chunk);
+        encode(block.data(), chunk, encoded);
+        if (device->write(encoded) != encoded.size()) {
+            if (errorString) {
+                *errorString = device->errorString();
+            }
+            return false;
+        }
+        frames += chunk;
+    }
+
+    const qint64 dataBytes = frames * SampleBuffer::CHANNELS * bytesPerSample(m_format);
+    const qint64 endPos = device->pos();
+    if (!device->seek(headerPos) || device->write(wavHeader(m_format, dataBytes)) < 0 || !device->seek(endPos)) {
+        if (errorString) {
+            *errorString = device->errorString();
+        }
+        return false;
+    }
+
+    if (result) {
+        result->frames = frames;
+        result->elapsedUs = timer.nsecsElapsed() / 1000;
+    }
+    return true;
+}
+
+QString OfflineRenderer::stemFileName(int instrumentId, const QString& name) {
+    // "03 - Hi-Hat.wav" : ordre de la grille, caractères sûrs pour tous les systèmes
+    QString safeName;
+    for (const QChar c : name.trimmed()) {
+        safeName += (c.isLetterOrNumber() || c == ' ' || c == '-' || c == '_') ? c : QChar('_');
+    }
+    if (safeName.isEmpty()) {
+        safeName = QString("Instrument %1").arg(instrumentId + 1);
+    }
+    return QString("%1 - %2.wav").arg(instrumentId + 1, 2, 10, QChar('0')).arg(safeName);
+}
+
+bool OfflineRenderer::renderStems(const QString& directory, const QStringList& instrumentNames,
+                                  QVector<StemResult>* stems, Result* total, QString* errorString) const {
+    QDir dir(directory);
+    if (!dir.exists() && !dir.mkpath(".")) {
+        if (errorString) {
+            *errorString = QString("Impossible de créer le dossier %1").arg(directory);
+        }
+        return false;
+    }
+
+    // Les lignes vides ne produisent pas de fichier
+    quint64 usedRows = 0;
+    for (int step = 0; step < m_stepCount; ++step) {
+        usedRows |= m_stepMasks[step];
+    }
+    QVector<StemResult> results;
+    for (quint64 bits = usedRows; bits; bits &= bits - 1) {
+        const int row = qCountTrailingZeroBits(bits);
+        if (m_instrumentCount > 0 && row >= m_instrumentCount) {
+            break;
+        }
+        StemResult stem;
+        stem.instrumentId = row;
+        stem.filePath = dir.filePath(stemFileName(row, instrumentNames.value(row)));
+        results.append(stem);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Chaque tâche a son propre mixeur ; les samples (immuables) ne sont que lus.
+    // Les résultats sont écrits dans des éléments distincts, réservés d'avance.
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+    StemResult* stemResults = results.data();
+    for (int i = 0; i < results.size(); ++i) {
+        StemResult* target = stemResults + i;
+        pool.start([this, target]() {
+            OfflineRenderer stem = *this;
+            stem.m_soloInstrument = target->instrumentId;
+            stem.renderToFile(target->filePath, &target->result, &target->errorString);
+        });
+    }
+    pool.waitForDone();
+
+    bool ok = true;
+    qint64 frames = 0;
+    for (const StemResult& stem : std::as_const(results)) {
+        frames += stem.result.frames;
+        if (!stem.errorString.isEmpty()) {
+            if (ok && errorString) {
+                *errorString = stem.errorString;
+            }
+            ok = false;
+        }
+    }
+
+    if (total) {
+        total->frames = frames;
+        total->elapsedUs = timer.nsecsElapsed() / 1000;
+    }
+    if (stems) {
+        *stems = results;
+    }
+    return ok;
+}
+
+int OfflineRenderer::bytesPerSample(WavFormat format) {
+    switch (format) {
+    case WavFormat::Int16:
+        return 2;
+    case WavFormat::Int24:
+        return 3;
+    case WavFormat::Float32:
+        return 4;
+    }
+    return 2;
+}
+
+void OfflineRenderer::encode(const float* input, qint64 frames, QByteArray& output) const {
+    const qint64 count = frames * SampleBuffer::CHANNELS;
+    output.resize(count * bytesPerSample(m_format));
+
+    switch (m_format) {
+    case WavFormat::Int16: {
+        auto* out = reinterpret_cast<qint16*>(output.data());
+        MixKernels::floatToInt16(out, input, count);
+        qToLittleEndian<qint16>(out, count, out);
+        break;
+    }
+    case WavFormat::Int24: {
+        uchar* out = reinterpret_cast<uchar*>(output.data());
+        for (qint64 n = 0; n < count; ++n) {
+            const qint32 value = qint32(std::clamp(input[n], -1.0f, 1.0f) * 8388607.0f);
+            out[0] = uchar(value);
+            out[1] = uchar(value >> 8);
+            out[2] = uchar(value >> 16);
+            out += 3;
+        }
+        break;
+    }
+    case WavFormat::Float32:
+        // Pas d'écrêtage : le flottant garde les crêtes au-delà de 0 dBFS
+        qToLittleEndian<float>(input, count, output.data());
+        break;
+    }
+}
+
+QByteArray OfflineRenderer::wavHeader(WavFormat format, qint64 dataBytes) {
+    const bool isFloat = format == WavFormat::Float32;
+    const quint16 bits = quint16(bytesPerSample(format) * 8);
+    const quint16 blockAlign = quint16(bytesPerSample(format) * SampleBuffer::CHANNELS);
+    // WAVE_FORMAT_IEEE_FLOAT : bloc fmt étendu (cbSize) et bloc fact obligatoires
+    const quint32 fmtSize = isFloat ? 18 : 16;
+    const quint32 factSize = isFloat ? 12 : 0;
+    // Au-delà de 4 Gio, les tailles sont plafonnées (les lecteurs lisent jusqu'à la fin du fichier)
+    const quint32 dataSize = quint32(qMin<qint64>(dataBytes, 0xFFFFFF00LL));
+
+    QByteArray header;
+    auto append32 = [&header](quint32 value) {
+        const quint32 le = qToLittleEndian(value);
+        header.append(reinterpret_cast<const char*>(&le), 4);
+    };
+    auto append16 = [&header](quint16 value) {
+        const quint16 le = qToLittleEndian(value);
+        header.append(reinterpret_cast<const char*>(&le), 2);
+    };
+
+    header.append("RIFF", 4);
+    append32(4 + (8 + fmtSize) + factSize + 8 + dataSize);
+    header.append("WAVE", 4);
+
+    header.append("fmt ", 4);
+    append32(fmtSize);
+    append16(isFloat ? 3 : 1);
+    append16(SampleBuffer::CHANNELS);
+    append32(SampleBuffer::SAMPLE_RATE);
+    append32(quint32(SampleBuffer::SAMPLE_RATE) * blockAlign);
+    append16(blockAlign);
+    append16(bits);
+    if (isFloat) {
+        append16(0);
+        header.append("fact", 4);
+        append32(4);
+        append32(dataSize / blockAlign);
+    }
+
+    header.append("data", 4);
+    append32(dataSize);
+    return header;
+}
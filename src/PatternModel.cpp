@@ -0,0 +1,235 @@
+#include "PatternModel.h"
+#include <QDebug>
+
+PatternModel::PatternModel(QObject* parent)
+    : QObject(parent)
+    , m_ownerIds{QString()} // Index 0 réservé : pas de propriétaire
+    , m_instruments(MAX_INSTRUMENTS)
+    , m_steps(MAX_STEPS)
+{
+}
+
+void PatternModel::resize(int instruments, int steps) {
+    m_instruments = qBound(0, instruments, MAX_INSTRUMENTS);
+    m_steps = qBound(0, steps, MAX_STEPS);
+
+    const quint64 rowMask = (m_instruments == 64) ? ~quint64(0) : ((quint64(1) << m_instruments) - 1);
+    for (int col = 0; col < MAX_STEPS; ++col) {
+        m_masks[col] = (col < m_steps) ? (m_masks[col] & rowMask) : 0;
+    }
+}
+
+void PatternModel::clear() {
+    m_masks.fill(0);
+    m_owners.fill(0);
+}
+
+bool PatternModel::isActive(int row, int col) const {
+    if (!inRange(row, col)) {
+        return false;
+    }
+    return (m_masks[col] >> row) & 1;
+}
+
+quint64 PatternModel::stepMask(int col) const {
+    return (col >= 0 && col < m_steps) ? m_masks[col] : 0;
+}
+
+quint64 PatternModel::rowMask(int row) const {
+    if (row < 0 || row >= m_instruments) {
+        return 0;
+    }
+    quint64 mask = 0;
+    for (int col = 0; col < m_steps; ++col) {
+        mask |= ((m_masks[col] >> row) & 1) << col;
+    }
+    return mask;
+}
+
+QString PatternModel::owner(int row, int col) const {
+    if (!isActive(row, col)) {
+        return QString();
+    }
+    return m_ownerIds.value(m_owners[cellIndex(row, col)]);
+}
+
+bool PatternModel::writeCell(int row, int col, bool active, quint16 owner) {
+    if (!inRange(row, col)) {
+        return false;
+    }
+
+    const quint64 bit = quint64(1) << row;
+    const bool wasActive = m_masks[col] & bit;
+    quint16& cellOwner = m_owners[cellIndex(row, col)];
+    if (wasActive == active && cellOwner == owner) {
+        return false;
+    }
+
+    cellOwner = owner;
+    if (active) {
+        m_masks[col] |= bit;
+    } else {
+        m_masks[col] &= ~bit;
+    }
+    return true;
+}
+
+template <typename F>
+void PatternModel::writeCells(F writes) {
+    const std::array<quint64, MAX_STEPS> before = m_masks;
+    if (!writes()) {
+        return;
+    }
+
+    // Une seule invalidation de la vue ; l'audio ne reçoit que les steps modifiés
+    emit cellsChanged();
+    for (int col = 0; col < m_steps; ++col) {
+        if (m_masks[col] != before[col]) {
+            emit stepMaskChanged(col, m_masks[col]);
+        }
+    }
+}
+
+void PatternModel::setCell(int row, int col, bool active, const QString& userId) {
+    if (!inRange(row, col)) {
+        return;
+    }
+
+    const quint64 before = m_masks[col];
+    if (!writeCell(row, col, active, active ? internOwner(userId) : 0)) {
+        return;
+    }
+
+    emit cellChanged(row, col);
+    if (m_masks[col] != before) {
+        emit stepMaskChanged(col, m_masks[col]);
+    }
+}
+
+void PatternModel::applyBatch(const GridBatch& batch) {
+    const quint16 owner = internOwner(batch.userId);
+    writeCells([&]() {
+        bool changed = false;
+        for (const GridBatch::Mask& mask : batch.masks) {
+            const int limit = mask.column ? m_instruments : m_steps;
+            for (int bit = 0; bit < limit; ++bit) {
+                const quint64 flag = quint64(1) << bit;
+                const int row = mask.column ? bit : mask.index;
+                const int col = mask.column ? mask.index : bit;
+                if (mask.clear & flag) {
+                    changed |= writeCell(row, col, false, 0);
+                }
+                if (mask.set & flag) {
+                    changed |= writeCell(row, col, true, owner);
+                }
+            }
+        }
+        for (quint16 packed : batch.cells) {
+            const bool active = GridBatch::cellActive(packed);
+            changed |= writeCell(GridBatch::cellRow(packed), GridBatch::cellCol(packed), active, active ? owner : 0);
+        }
+        return changed;
+    });
+}
+
+quint16 PatternModel::internOwner(const QString& userId) {
+    if (userId.isEmpty()) {
+        return 0;
+    }
+
+    auto it = m_ownerIndex.constFind(userId);
+    if (it != m_ownerIndex.constEnd()) {
+        return it.value();
+    }
+
+    // Table jamais purgée : sa taille suit le nombre d'utilisateurs rencontrés
+    if (m_ownerIds.size() > 0xFFFF) {
+        qWarning() << "Table des propriétaires pleine, cellule sans propriétaire";
+        return 0;
+    }
+
+    const quint16 index = quint16(m_ownerIds.size());
+    m_ownerIds.append(userId);
+    m_ownerIndex.insert(userId, index);
+    return index;
+}
+
+QJsonArray PatternModel::activeCellsToJson() const {
+    QJsonArray cells;
+    for (int col = 0; col < m_steps; ++col) {
+        for (quint64 bits = m_masks[col]; bits; bits &= bits - 1) {
+            const int row = qCountTrailingZeroBits(bits);
+            QJsonObject cell;
+            cell["row"] = row;
+            cell["col"] = col;
+            cell["active"] = true;
+            cell["userId"] = m_ownerIds.value(m_owners[cellIndex(row, col)]);
+            cells.append(cell);
+        }
+    }
+    return cells;
+}
+
+void PatternModel::loadCells(const QJsonArray& cells) {
+    writeCells([&]() {
+        bool changed = false;
+        for (const auto& cellValue : cells) {
+            const QJsonObject cell = cellValue.toObject();
+            const bool active = cell["active"].toBool();
+            changed |= writeCell(cell["row"].toInt(), cell["col"].toInt(), active,
+                                 active ? internOwner(cell["userId"].toString()) : 0);
+        }
+        return changed;
+    });
+}
+
+QJsonObject PatternModel::compactCellsToJson() const {
+    // Seuls les propriétaires encore présents dans la grille sont transmis
+    QJsonArray owners;
+    QHash<quint16, int> ownerRefs;
+    QJsonArray cells;
+    for (int col = 0; col < m_steps; ++col) {
+        for (quint64 bits = m_masks[col]; bits; bits &= bits - 1) {
+            const int row = qCountTrailingZeroBits(bits);
+            const quint16 owner = m_owners[cellIndex(row, col)];
+            int ref = 0;
+            if (owner != 0) {
+                auto it = ownerRefs.constFind(owner);
+                if (it == ownerRefs.constEnd()) {
+                    owners.append(m_ownerIds[owner]);
+                    it = ownerRefs.insert(owner, int(owners.size()));
+                }
+                ref = it.value();
+            }
+            cells.append(qint64(row) | (qint64(col) << 6) | (qint64(ref) << 12));
+        }
+    }
+
+    QJsonObject compact;
+    compact["owners"] = owners;
+    compact["cells"] = cells;
+    return compact;
+}
+
+void PatternModel::loadCompactCells(const QJsonObject& compact) {
+    // Références de l'instantané -> index locaux, internés une fois chacun
+    const QJsonArray owners = compact["owners"].toArray();
+    QVector<quint16> localOwners(owners.size() + 1, 0);
+    for (qsizetype i = 0; i < owners.size(); ++i) {
+        localOwners[i + 1] = internOwner(owners.at(i).toString());
+    }
+
+    writeCells([&]() {
+        bool changed = false;
+        for (const auto& cellValue : compact["cells"].toArray()) {
+            const qint64 packed = cellValue.toInteger(-1);
+            if (packed < 0) {
+                continue;
+            }
+            const qint64 ref = packed >> 12;
+            const quint16 owner = (ref > 0 && ref < localOwners.size()) ? localOwners[ref] : 0;
+            changed |= writeCell(int(packed & 0x3F), int((packed >> 6) & 0x3F), true, owner);
+        }
+        return changed;
+    });
+}
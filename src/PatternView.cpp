@@ -0,0 +1,303 @@
+#include "PatternView.h"
+#include <QPainter>
+#include <QPaintEvent>
+#include <QMouseEvent>
+#include <QContextMenuEvent>
+
+PatternView::PatternView(PatternModel *model, QWidget *parent)
+    : QWidget(parent), m_model(model), m_headerFont("Arial", 10, QFont::Bold)
+{
+    // Une cellule modifiée ne repeint que son propre rectangle
+    connect(m_model, &PatternModel::cellChanged, this, &PatternView::onCellChanged);
+    // Modification groupée : une seule invalidation pour toute la grille
+    connect(m_model, &PatternModel::cellsChanged, this, [this]()
+            { update(); });
+
+    setAttribute(Qt::WA_StaticContents);
+    updateGeometryFromModel();
+}
+
+void PatternView::updateGeometryFromModel()
+{
+    if (m_playhead >= m_model->stepCount())
+    {
+        m_playhead = -1;
+    }
+    setFixedSize(sizeHint());
+    update();
+}
+
+void PatternView::setInstrumentNames(const QStringList &names)
+{
+    m_instrumentNames = names;
+    update(QRect(0, HEADER_HEIGHT, HEADER_WIDTH, m_model->instrumentCount() * CELL_SIZE));
+}
+
+void PatternView::setUserColor(const QString &userId, const QColor &color)
+{
+    if (m_userColors.value(userId) == color)
+        return;
+
+    m_userColors[userId] = color;
+
+    // Les pixmaps sont indexés par couleur : seules les cellules de cet utilisateur changent
+    m_model->forEachCellOwnedBy(userId, [this](int row, int col)
+                                { update(cellRect(row, col)); });
+}
+
+void PatternView::setPlayhead(int step)
+{
+    if (step >= m_model->stepCount())
+    {
+        step = -1;
+    }
+    if (step == m_playhead)
+        return;
+
+    const int previous = m_playhead;
+    m_playhead = step;
+
+    // Seules l'ancienne et la nouvelle colonne sont invalidées
+    if (previous >= 0)
+    {
+        update(columnRect(previous));
+    }
+    if (m_playhead >= 0)
+    {
+        update(columnRect(m_playhead));
+    }
+}
+
+QRect PatternView::cellRect(int row, int col) const
+{
+    return QRect(HEADER_WIDTH + col * CELL_SIZE, HEADER_HEIGHT + row * CELL_SIZE, CELL_SIZE, CELL_SIZE);
+}
+
+QRect PatternView::columnRect(int col) const
+{
+    return QRect(HEADER_WIDTH + col * CELL_SIZE, 0, CELL_SIZE,
+                 HEADER_HEIGHT + m_model->instrumentCount() * CELL_SIZE);
+}
+
+QSize PatternView::sizeHint() const
+{
+    return QSize(HEADER_WIDTH + m_model->stepCount() * CELL_SIZE,
+                 HEADER_HEIGHT + m_model->instrumentCount() * CELL_SIZE);
+}
+
+void PatternView::onCellChanged(int row, int col)
+{
+    update(cellRect(row, col));
+}
+
+QString PatternView::instrumentName(int row) const
+{
+    return (row < m_instrumentNames.size()) ? m_instrumentNames[row] : QString("Instrument %1").arg(row + 1);
+}
+
+void PatternView::paintEvent(QPaintEvent *event)
+{
+    // Le cache est rendu à la résolution de l'écran courant
+    const qreal ratio = devicePixelRatioF();
+    if (!qFuzzyCompare(ratio, m_cacheRatio))
+    {
+        m_pixmapCache.clear();
+        m_cacheRatio = ratio;
+    }
+
+    QPainter painter(this);
+    const QRect dirty = event->rect();
+    const int steps = m_model->stepCount();
+    const int instruments = m_model->instrumentCount();
+
+    // Plage de colonnes et de lignes touchées par la zone à repeindre
+    const int firstCol = (qMax(dirty.left(), HEADER_WIDTH) - HEADER_WIDTH) / CELL_SIZE;
+    const int lastCol = qMin(steps - 1, (dirty.right() - HEADER_WIDTH) / CELL_SIZE);
+    const int firstRow = (qMax(dirty.top(), HEADER_HEIGHT) - HEADER_HEIGHT) / CELL_SIZE;
+    const int lastRow = qMin(instruments - 1, (dirty.bottom() - HEADER_HEIGHT) / CELL_SIZE);
+    const bool colsVisible = dirty.right() >= HEADER_WIDTH && firstCol <= lastCol;
+    const bool rowsVisible = dirty.bottom() >= HEADER_HEIGHT && firstRow <= lastRow;
+
+    painter.setFont(m_headerFont);
+
+    // En-têtes des colonnes (numéros des steps)
+    if (dirty.top() < HEADER_HEIGHT && colsVisible)
+    {
+        for (int col = firstCol; col <= lastCol; ++col)
+        {
+            const QRect header(HEADER_WIDTH + col * CELL_SIZE, 0, CELL_SIZE, HEADER_HEIGHT);
+            if (col == m_playhead)
+            {
+                painter.fillRect(header, QColor(239, 68, 68));
+                painter.setPen(Qt::white);
+            }
+            else
+            {
+                painter.fillRect(header, QColor(255, 255, 255, 13));
+                painter.setPen(QColor(226, 232, 240));
+            }
+            painter.drawText(header, Qt::AlignCenter, QString::number(col + 1));
+        }
+    }
+
+    // En-têtes des lignes (noms des instruments)
+    if (dirty.left() < HEADER_WIDTH && rowsVisible)
+    {
+        painter.setPen(QColor(226, 232, 240));
+        for (int row = firstRow; row <= lastRow; ++row)
+        {
+            const QRect header(0, HEADER_HEIGHT + row * CELL_SIZE, HEADER_WIDTH, CELL_SIZE);
+            painter.fillRect(header, QColor(255, 255, 255, 13));
+            painter.drawText(header.adjusted(8, 0, -8, 0), Qt::AlignVCenter | Qt::AlignLeft,
+                             painter.fontMetrics().elidedText(instrumentName(row), Qt::ElideRight, header.width() - 16));
+        }
+    }
+
+    if (!colsVisible || !rowsVisible)
+        return;
+
+    // Cellules : une copie de pixmap chacune, en parcourant les masques de step
+    const QColor defaultColor(100, 150, 255);
+    for (int col = firstCol; col <= lastCol; ++col)
+    {
+        const quint64 mask = m_model->stepMask(col);
+        const CellKind emptyKind = (col % 4 == 0) ? CellKind::EmptyBeat : CellKind::Empty;
+        const CellKind activeKind = (col == m_playhead) ? CellKind::ActivePlaying : CellKind::Active;
+
+        for (int row = firstRow; row <= lastRow; ++row)
+        {
+            const QPoint topLeft(HEADER_WIDTH + col * CELL_SIZE, HEADER_HEIGHT + row * CELL_SIZE);
+            if ((mask >> row) & 1)
+            {
+                const QColor color = m_userColors.value(m_model->owner(row, col), defaultColor);
+                painter.drawPixmap(topLeft, cellPixmap(activeKind, color));
+            }
+            else
+            {
+                painter.drawPixmap(topLeft, cellPixmap(emptyKind, QColor()));
+            }
+        }
+    }
+}
+
+bool PatternView::cellAt(const QPoint &pos, int &row, int &col) const
+{
+    if (pos.x() < HEADER_WIDTH || pos.y() < HEADER_HEIGHT)
+        return false;
+
+    col = (pos.x() - HEADER_WIDTH) / CELL_SIZE;
+    row = (pos.y() - HEADER_HEIGHT) / CELL_SIZE;
+    return row < m_model->instrumentCount() && col < m_model->stepCount();
+}
+
+int PatternView::headerRowAt(const QPoint &pos) const
+{
+    if (pos.x() < 0 || pos.x() >= HEADER_WIDTH || pos.y() < HEADER_HEIGHT)
+        return -1;
+
+    const int row = (pos.y() - HEADER_HEIGHT) / CELL_SIZE;
+    return row < m_model->instrumentCount() ? row : -1;
+}
+
+void PatternView::mousePressEvent(QMouseEvent *event)
+{
+    if (event->button() != Qt::LeftButton)
+    {
+        QWidget::mousePressEvent(event);
+        return;
+    }
+
+    int row, col;
+    if (cellAt(event->position().toPoint(), row, col))
+    {
+        m_dragCell = row * PatternModel::MAX_STEPS + col;
+        emit cellClicked(row, col);
+    }
+    else if ((row = headerRowAt(event->position().toPoint())) >= 0)
+    {
+        emit rowHeaderClicked(row);
+    }
+}
+
+void PatternView::mouseMoveEvent(QMouseEvent *event)
+{
+    int row, col;
+    if (m_dragCell < 0 || !(event->buttons() & Qt::LeftButton) || !cellAt(event->position().toPoint(), row, col))
+    {
+        QWidget::mouseMoveEvent(event);
+        return;
+    }
+
+    // Un signal par cellule traversée, pas par mouvement de souris
+    const int cell = row * PatternModel::MAX_STEPS + col;
+    if (cell != m_dragCell)
+    {
+        m_dragCell = cell;
+        emit cellDragged(row, col);
+    }
+}
+
+void PatternView::mouseReleaseEvent(QMouseEvent *event)
+{
+    if (event->button() == Qt::LeftButton && m_dragCell >= 0)
+    {
+        m_dragCell = -1;
+        emit dragFinished();
+        return;
+    }
+    QWidget::mouseReleaseEvent(event);
+}
+
+void PatternView::contextMenuEvent(QContextMenuEvent *event)
+{
+    const int row = headerRowAt(event->pos());
+    if (row >= 0)
+    {
+        emit rowMenuRequested(row, event->globalPos());
+        return;
+    }
+    QWidget::contextMenuEvent(event);
+}
+
+const QPixmap &PatternView::cellPixmap(CellKind kind, const QColor &color)
+{
+    const quint64 key = (quint64(kind) << 32) | color.rgba();
+    auto it = m_pixmapCache.find(key);
+    if (it == m_pixmapCache.end())
+    {
+        it = m_pixmapCache.insert(key, renderCell(kind, color));
+    }
+    return it.value();
+}
+
+QPixmap PatternView::renderCell(CellKind kind, const QColor &color) const
+{
+    QPixmap pixmap(QSize(CELL_SIZE, CELL_SIZE) * m_cacheRatio);
+    pixmap.setDevicePixelRatio(m_cacheRatio);
+
+    QPainter painter(&pixmap);
+    const QRect rect(0, 0, CELL_SIZE, CELL_SIZE);
+
+    switch (kind)
+    {
+    case CellKind::Empty:
+    case CellKind::EmptyBeat:
+        // Coloration alternée pour mieux visualiser les mesures
+        painter.fillRect(rect, (kind == CellKind::EmptyBeat) ? QColor(220, 220, 220) : QColor(240, 240, 240));
+        break;
+    case CellKind::Active:
+    case CellKind::ActivePlaying:
+        painter.fillRect(rect, color);
+        painter.setPen(Qt::white);
+        painter.setFont(QFont("Arial", (kind == CellKind::ActivePlaying) ? 20 : 16, QFont::Bold));
+        painter.drawText(rect, Qt::AlignCenter, QStringLiteral("●"));
+        break;
+    }
+
+    // Trait de grille sur les bords droit et bas
+    painter.setPen(QColor(0, 0, 0, 20));
+    painter.drawLine(rect.topRight(), rect.bottomRight());
+    painter.drawLine(rect.bottomLeft(), rect.bottomRight());
+
+    return pixmap;
+}
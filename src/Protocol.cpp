@@ -3,37 +3,315 @@
 #include <QJsonDocument>
 #include <QIODevice>
 #include <QDataStream>
+#include <QtEndian>
+#include <QCborValue>
+#include <QCborMap>
+#include <atomic>
+
+namespace {
+
+// Layouts compacts : octet de type seul ; CBOR_FLAG signale un corps CBOR générique
+constexpr quint8 CBOR_FLAG = 0x80;
+
+// Référence d'identifiant utilisateur : 0 = chaîne en ligne, n + 1 = index n
+// défini au préalable sur la connexion par un message USER_ALIAS
+constexpr quint64 USER_REF_INLINE = 0;
+
+void writeVarint(QByteArray& out, quint64 value) {
+    while (value >= 0x80) {
+        out.append(char((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+bool readVarint(const char*& p, const char* end, quint64& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (p >= end) return false;
+        const quint8 byte = quint8(*p++);
+        value |= quint64(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+// Zigzag : les petits entiers négatifs restent sur un octet
+void writeSigned(QByteArray& out, qint64 value) {
+    writeVarint(out, (quint64(value) << 1) ^ quint64(value >> 63));
+}
+
+bool readSigned(const char*& p, const char* end, qint64& value) {
+    quint64 raw;
+    if (!readVarint(p, end, raw)) return false;
+    value = qint64(raw >> 1) ^ -qint64(raw & 1);
+    return true;
+}
+
+void writeString(QByteArray& out, const QString& str) {
+    const QByteArray utf8 = str.toUtf8();
+    writeVarint(out, quint64(utf8.size()));
+    out.append(utf8);
+}
+
+bool readString(const char*& p, const char* end, QString& str) {
+    quint64 size;
+    if (!readVarint(p, end, size) || size > quint64(end - p)) return false;
+    str = QString::fromUtf8(p, qsizetype(size));
+    p += size;
+    return true;
+}
+
+void writeUserId(QByteArray& out, const QString& userId, Protocol::UserIdTable* table) {
+    const int index = table ? table->intern(userId) : -1;
+    if (index < 0) {
+        writeVarint(out, USER_REF_INLINE);
+        writeString(out, userId);
+        return;
+    }
+    writeVarint(out, quint64(index) + 1);
+}
+
+bool readUserId(const char*& p, const char* end, QString& userId, const Protocol::UserIdTable* table) {
+    quint64 ref;
+    if (!readVarint(p, end, ref)) return false;
+
+    if (ref == USER_REF_INLINE) {
+        return readString(p, end, userId);
+    }
+
+    const quint64 index = ref - 1;
+    if (!table || index >= quint64(table->ids.size()) || table->ids[qsizetype(index)].isEmpty()) {
+        return false; // Index jamais défini sur cette connexion
+    }
+    userId = table->ids[qsizetype(index)];
+    return true;
+}
+
+bool hasExactKeys(const QJsonObject& data, std::initializer_list<const char*> keys) {
+    if (data.size() != qsizetype(keys.size())) return false;
+    for (const char* key : keys) {
+        if (!data.contains(QLatin1String(key))) return false;
+    }
+    return true;
+}
+
+bool isInt(const QJsonValue& value) {
+    return value.isDouble() && value.toDouble() == double(value.toInteger());
+}
+
+// Comme hasExactKeys, en tolérant la révision "rev" posée par le serveur
+// sur les opérations de session (varint final du layout compact)
+bool hasLayoutKeys(const QJsonObject& data, std::initializer_list<const char*> keys) {
+    const QJsonValue rev = data.value(QLatin1String("rev"));
+    if (rev.isUndefined()) return hasExactKeys(data, keys);
+    if (!isInt(rev) || rev.toInteger() < 0 || data.size() != qsizetype(keys.size()) + 1) return false;
+    for (const char* key : keys) {
+        if (!data.contains(QLatin1String(key))) return false;
+    }
+    return true;
+}
+
+void writeRevision(QByteArray& out, const QJsonObject& data) {
+    const QJsonValue rev = data.value(QLatin1String("rev"));
+    if (!rev.isUndefined()) {
+        writeVarint(out, quint64(rev.toInteger()));
+    }
+}
+
+bool readRevision(const char*& p, const char* end, QJsonObject& content) {
+    if (p == end) return true; // Révision absente
+    quint64 rev;
+    if (!readVarint(p, end, rev)) return false;
+    content["rev"] = qint64(rev);
+    return true;
+}
+
+std::atomic<WireFormat>& defaultFormatStorage() {
+    static std::atomic<WireFormat> format(
+        qEnvironmentVariable("BEEBEE_WIRE_FORMAT").compare("json", Qt::CaseInsensitive) == 0
+            ? WireFormat::Json : WireFormat::Binary);
+    return format;
+}
+
+} // namespace
+
+int Protocol::UserIdTable::intern(const QString& userId) {
+    auto it = indices.constFind(userId);
+    if (it != indices.constEnd()) {
+        return int(it.value());
+    }
+    if (indices.size() >= MAX_INTERNED_USER_IDS) {
+        return -1;
+    }
+
+    const quint32 index = quint32(ids.size());
+    indices.insert(userId, index);
+    ids.append(userId);
+    return int(index);
+}
+
+bool Protocol::UserIdTable::define(quint32 index, const QString& userId) {
+    if (index >= quint32(MAX_INTERNED_USER_IDS) || userId.isEmpty()) {
+        return false;
+    }
+    if (index >= quint32(ids.size())) {
+        ids.resize(index + 1);
+    }
+    ids[index] = userId;
+    indices.insert(userId, index);
+    return true;
+}
 
 QByteArray Protocol::createMessage(MessageType type, const QJsonObject& data) {
+    return encodeMessage(type, data, defaultFormat());
+}
+
+QByteArray Protocol::encodeMessage(MessageType type, const QJsonObject& data,
+                                   WireFormat format, UserIdTable* outIds) {
+    if (format == WireFormat::Binary) {
+        return frameBody(encodeBinaryBody(type, data, outIds));
+    }
+
     QJsonObject message;
     message["type"] = messageTypeToString(type);
     message["data"] = data;
     message["timestamp"] = QDateTime::currentMSecsSinceEpoch();
 
     QJsonDocument doc(message);
-    QByteArray jsonData = doc.toJson(QJsonDocument::Compact);
+    return frameBody(doc.toJson(QJsonDocument::Compact));
+}
 
+QByteArray Protocol::frameBody(const QByteArray& body) {
     // Préfixe avec la taille du message pour le parsing
     QByteArray result;
+    result.reserve(4 + body.size());
     QDataStream stream(&result, QIODevice::WriteOnly);
     stream.setByteOrder(QDataStream::BigEndian);
-    stream << static_cast<quint32>(jsonData.size());
-    result.append(jsonData);
+    stream << static_cast<quint32>(body.size());
+    result.append(body);
 
     return result;
 }
 
-bool Protocol::parseMessage(const QByteArray& data, MessageType& type, QJsonObject& content) {
+QByteArray Protocol::encodeBinaryBody(MessageType type, const QJsonObject& data, UserIdTable* outIds) {
+    QByteArray body;
+    body.reserve(16);
+    body.append(char(BINARY_MAGIC));
+
+    // Layouts compacts pour les messages fréquents, uniquement si le contenu
+    // correspond exactement (sinon repli CBOR pour ne rien perdre)
+    switch (type) {
+    case MessageType::GRID_UPDATE:
+        if (hasLayoutKeys(data, {"row", "col", "active", "userId"})
+            && isInt(data["row"]) && isInt(data["col"]) && data["active"].isBool()
+            && data["userId"].isString()) {
+            body.append(char(type));
+            writeSigned(body, data["row"].toInteger());
+            writeSigned(body, data["col"].toInteger());
+            body.append(char(data["active"].toBool() ? 1 : 0));
+            writeUserId(body, data["userId"].toString(), outIds);
+            writeRevision(body, data);
+            return body;
+        }
+        break;
+    case MessageType::GRID_BATCH: {
+        // Layout compact seulement si la relecture redonne exactement le même contenu
+        GridBatch batch;
+        QJsonObject withoutRevision = data;
+        withoutRevision.remove(QLatin1String("rev"));
+        if (hasLayoutKeys(data, {"userId", "cells", "masks"}) && GridBatch::fromJson(data, batch)
+            && batch.toJson() == withoutRevision) {
+            body.append(char(type));
+            writeUserId(body, batch.userId, outIds);
+            writeVarint(body, quint64(batch.cells.size()));
+            for (quint16 packed : std::as_const(batch.cells)) {
+                writeVarint(body, packed);
+            }
+            writeVarint(body, quint64(batch.masks.size()));
+            for (const GridBatch::Mask& mask : std::as_const(batch.masks)) {
+                writeVarint(body, quint64(mask.index) | (mask.column ? 0x40 : 0));
+                writeVarint(body, mask.set);
+                writeVarint(body, mask.clear);
+            }
+            writeRevision(body, data);
+            return body;
+        }
+        break;
+    }
+    case MessageType::TEMPO_CHANGE:
+        if (hasLayoutKeys(data, {"bpm"}) && isInt(data["bpm"])) {
+            body.append(char(type));
+            writeSigned(body, data["bpm"].toInteger());
+            writeRevision(body, data);
+            return body;
+        }
+        break;
+    case MessageType::COLUMN_UPDATE:
+        if (hasLayoutKeys(data, {"columnCount"}) && isInt(data["columnCount"])) {
+            body.append(char(type));
+            writeSigned(body, data["columnCount"].toInteger());
+            writeRevision(body, data);
+            return body;
+        }
+        break;
+    case MessageType::PLAY_STATE:
+        if (hasLayoutKeys(data, {"playing"}) && data["playing"].isBool()) {
+            body.append(char(type));
+            body.append(char(data["playing"].toBool() ? 1 : 0));
+            writeRevision(body, data);
+            return body;
+        }
+        break;
+    case MessageType::USER_ALIAS:
+        if (hasExactKeys(data, {"index", "userId"}) && isInt(data["index"]) && data["userId"].isString()) {
+            body.append(char(type));
+            writeVarint(body, quint64(data["index"].toInteger()));
+            writeString(body, data["userId"].toString());
+            return body;
+        }
+        break;
+    case MessageType::PING:
+    case MessageType::PONG:
+        if (hasExactKeys(data, {"seq"}) && isInt(data["seq"]) && data["seq"].toInteger() >= 0) {
+            body.append(char(type));
+            writeVarint(body, quint64(data["seq"].toInteger()));
+            return body;
+        }
+        break;
+    case MessageType::PAD_HIT:
+        // Identifiant toujours en ligne : le datagramme peut devancer l'USER_ALIAS envoyé sur TCP
+        if (hasExactKeys(data, {"instrument", "userId"}) && isInt(data["instrument"]) &&
+            data["instrument"].toInteger() >= 0 && data["userId"].isString()) {
+            body.append(char(type));
+            writeVarint(body, quint64(data["instrument"].toInteger()));
+            writeUserId(body, data["userId"].toString(), nullptr);
+            return body;
+        }
+        break;
+    default:
+        break;
+    }
+
+    body.append(char(quint8(type) | CBOR_FLAG));
+    body.append(QCborValue::fromJsonValue(data).toCbor());
+    return body;
+}
+
+bool Protocol::parseMessage(QByteArrayView data, MessageType& type, QJsonObject& content,
+                            const UserIdTable* inIds) {
     if (data.size() < 4) return false;
 
-    QDataStream stream(data);
-    stream.setByteOrder(QDataStream::BigEndian);
-    quint32 messageSize;
-    stream >> messageSize;
+    const quint32 messageSize = qFromBigEndian<quint32>(data.data());
+    if (data.size() < 4 + qsizetype(messageSize)) return false;
 
-    if (data.size() < 4 + messageSize) return false;
+    const char* body = data.data() + 4;
+    if (messageSize > 0 && quint8(body[0]) == BINARY_MAGIC) {
+        return parseBinaryBody(body, messageSize, type, content, inIds);
+    }
 
-    QByteArray jsonData = data.mid(4, messageSize);
+    // Vue sur les octets reçus, sans copie
+    const QByteArray jsonData = QByteArray::fromRawData(body, messageSize);
 
     QJsonParseError error;
     QJsonDocument doc = QJsonDocument::fromJson(jsonData, &error);
@@ -50,6 +328,354 @@ bool Protocol::parseMessage(const QByteArray& data, MessageType& type, QJsonObje
     return true;
 }
 
+bool Protocol::parseBinaryBody(const char* body, qsizetype size, MessageType& type,
+                               QJsonObject& content, const UserIdTable* inIds) {
+    if (size < 2) return false;
+
+    const char* p = body + 2;
+    const char* end = body + size;
+    const quint8 typeByte = quint8(body[1]);
+    const quint8 typeValue = typeByte & ~CBOR_FLAG;
+    if (typeValue > quint8(MessageType::PAD_HIT)) return false;
+    type = static_cast<MessageType>(typeValue);
+
+    if (typeByte & CBOR_FLAG) {
+        QCborParserError error;
+        const QCborValue value = QCborValue::fromCbor(QByteArray::fromRawData(p, end - p), &error);
+        if (error.error != QCborError::NoError || !value.isMap()) return false;
+        content = value.toJsonValue().toObject();
+        return true;
+    }
+
+    content = QJsonObject();
+    switch (type) {
+    case MessageType::GRID_UPDATE: {
+        qint64 row, col;
+        QString userId;
+        if (!readSigned(p, end, row) || !readSigned(p, end, col) || p >= end) return false;
+        const bool active = *p++ != 0;
+        if (!readUserId(p, end, userId, inIds)) return false;
+        content["row"] = row;
+        content["col"] = col;
+        content["active"] = active;
+        content["userId"] = userId;
+        if (!readRevision(p, end, content)) return false;
+        break;
+    }
+    case MessageType::GRID_BATCH: {
+        GridBatch batch;
+        quint64 count;
+        if (!readUserId(p, end, batch.userId, inIds) || !readVarint(p, end, count)
+            || count > quint64(GridBatch::MAX_CELLS)) return false;
+        batch.cells.reserve(qsizetype(count));
+        for (quint64 i = 0; i < count; ++i) {
+            quint64 packed;
+            if (!readVarint(p, end, packed) || packed > 0x1FFF) return false;
+            batch.cells.append(quint16(packed));
+        }
+        if (!readVarint(p, end, count) || count > quint64(GridBatch::MAX_MASKS)) return false;
+        batch.masks.reserve(qsizetype(count));
+        for (quint64 i = 0; i < count; ++i) {
+            quint64 header;
+            GridBatch::Mask mask;
+            if (!readVarint(p, end, header) || header > 0x7F
+                || !readVarint(p, end, mask.set) || !readVarint(p, end, mask.clear)) return false;
+            mask.column = header & 0x40;
+            mask.index = int(header & 0x3F);
+            batch.masks.append(mask);
+        }
+        content = batch.toJson();
+        if (!readRevision(p, end, content)) return false;
+        break;
+    }
+    case MessageType::TEMPO_CHANGE: {
+        qint64 bpm;
+        if (!readSigned(p, end, bpm)) return false;
+        content["bpm"] = bpm;
+        if (!readRevision(p, end, content)) return false;
+        break;
+    }
+    case MessageType::COLUMN_UPDATE: {
+        qint64 columnCount;
+        if (!readSigned(p, end, columnCount)) return false;
+        content["columnCount"] = columnCount;
+        if (!readRevision(p, end, content)) return false;
+        break;
+    }
+    case MessageType::PLAY_STATE:
+        if (p >= end) return false;
+        content["playing"] = *p++ != 0;
+        if (!readRevision(p, end, content)) return false;
+        break;
+    case MessageType::USER_ALIAS: {
+        quint64 index;
+        QString userId;
+        if (!readVarint(p, end, index) || !readString(p, end, userId)) return false;
+        content["index"] = qint64(index);
+        content["userId"] = userId;
+        break;
+    }
+    case MessageType::PING:
+    case MessageType::PONG: {
+        quint64 sequence;
+        if (!readVarint(p, end, sequence)) return false;
+        content["seq"] = qint64(sequence);
+        break;
+    }
+    case MessageType::PAD_HIT: {
+        quint64 instrument;
+        QString userId;
+        if (!readVarint(p, end, instrument) || !readUserId(p, end, userId, inIds)) return false;
+        content["instrument"] = qint64(instrument);
+        content["userId"] = userId;
+        break;
+    }
+    default:
+        return false; // Pas de layout compact pour ce type
+    }
+
+    return p == end;
+}
+
+WireFormat Protocol::frameFormat(QByteArrayView frame) {
+    return (frame.size() > 4 && quint8(frame.at(4)) == BINARY_MAGIC) ? WireFormat::Binary : WireFormat::Json;
+}
+
+bool Protocol::carriesUserId(QByteArrayView frame) {
+    // Seuls les layouts compacts de GRID_UPDATE et GRID_BATCH contiennent un identifiant internable
+    if (frameFormat(frame) != WireFormat::Binary || frame.size() <= 5) {
+        return false;
+    }
+    const quint8 type = quint8(frame.at(5));
+    return type == quint8(MessageType::GRID_UPDATE) || type == quint8(MessageType::GRID_BATCH);
+}
+
+namespace {
+
+bool peekType(QByteArrayView frame, MessageType& type) {
+    if (Protocol::frameFormat(frame) == WireFormat::Binary) {
+        if (frame.size() <= 5) {
+            return false;
+        }
+        type = MessageType(quint8(frame.at(5)) & ~CBOR_FLAG);
+        return true;
+    }
+    // JSON (mode debug) : le coût du décodage n'importe pas
+    QJsonObject content;
+    return Protocol::parseMessage(frame, type, content);
+}
+
+}
+
+bool Protocol::isLatencyCritical(QByteArrayView frame) {
+    MessageType type;
+    if (!peekType(frame, type)) {
+        return false;
+    }
+    return type == MessageType::PING || type == MessageType::PONG || type == MessageType::CLOCK_SYNC;
+}
+
+bool Protocol::isTransient(QByteArrayView frame) {
+    MessageType type;
+    if (!peekType(frame, type)) {
+        return false;
+    }
+    return type == MessageType::PING || type == MessageType::PONG || type == MessageType::CLOCK_SYNC ||
+           type == MessageType::UDP_BIND || type == MessageType::PAD_HIT;
+}
+
+QByteArray Protocol::createDatagram(quint64 token, const QByteArray& frame) {
+    QByteArray datagram(DATAGRAM_TOKEN_SIZE, Qt::Uninitialized);
+    qToBigEndian<quint64>(token, datagram.data());
+    datagram.append(frame);
+    return datagram;
+}
+
+bool Protocol::splitDatagram(QByteArrayView datagram, quint64& token, QByteArrayView& frame) {
+    if (datagram.size() < DATAGRAM_TOKEN_SIZE + 4) {
+        return false;
+    }
+    token = qFromBigEndian<quint64>(datagram.data());
+    frame = datagram.sliced(DATAGRAM_TOKEN_SIZE);
+    // Une seule trame par datagramme, sans octet superflu
+    return qFromBigEndian<quint32>(frame.data()) == quint32(frame.size() - 4);
+}
+
+WireFormat Protocol::defaultFormat() {
+    return defaultFormatStorage().load(std::memory_order_relaxed);
+}
+
+void Protocol::setDefaultFormat(WireFormat format) {
+    defaultFormatStorage().store(format, std::memory_order_relaxed);
+}
+
+QString Protocol::wireFormatToString(WireFormat format) {
+    return format == WireFormat::Binary ? "binary" : "json";
+}
+
+QByteArray Protocol::createUserAliasMessage(quint32 index, const QString& userId) {
+    QJsonObject data;
+    data["index"] = qint64(index);
+    data["userId"] = userId;
+    // N'existe qu'en binaire : seules les sessions binaires internent les identifiants
+    return encodeMessage(MessageType::USER_ALIAS, data, WireFormat::Binary);
+}
+
+bool Protocol::wireFormatFromString(const QString& str, WireFormat& format) {
+    if (str == "binary") { format = WireFormat::Binary; return true; }
+    if (str == "json") { format = WireFormat::Json; return true; }
+    return false;
+}
+
+QByteArray Protocol::createHelloMessage() {
+    QJsonArray formats;
+    if (defaultFormat() == WireFormat::Binary) {
+        formats.append(wireFormatToString(WireFormat::Binary));
+    }
+    formats.append(wireFormatToString(WireFormat::Json));
+
+    QJsonObject data;
+    data["version"] = PROTOCOL_VERSION;
+    data["formats"] = formats;
+    data["udp"] = true; // Accepte le canal d'événements éphémères
+    // Toujours en JSON : le pair ne connaît pas encore nos formats
+    return encodeMessage(MessageType::HELLO, data, WireFormat::Json);
+}
+
+QByteArray Protocol::createHelloReplyMessage(WireFormat chosen, quint16 udpPort, quint64 udpToken) {
+    QJsonObject data;
+    data["version"] = PROTOCOL_VERSION;
+    data["format"] = wireFormatToString(chosen);
+    if (udpPort != 0 && udpToken != 0) {
+        data["udpPort"] = udpPort;
+        // Chaîne : un double JSON ne représente pas tous les entiers 64 bits
+        data["udpToken"] = QString::number(udpToken);
+    }
+    return encodeMessage(MessageType::HELLO, data, WireFormat::Json);
+}
+
+bool OutgoingFrame::parse() {
+    if (m_parseState == 0) {
+        m_parseState = Protocol::parseMessage(m_canonical, m_type, m_content) ? 1 : -1;
+    }
+    return m_parseState > 0;
+}
+
+int OutgoingFrame::gridCellKey() {
+    if (!parse() || m_type != MessageType::GRID_UPDATE) {
+        return -1;
+    }
+    const GridCell cell = GridCell::fromJson(m_content);
+    return cell.isValid() ? cell.row * GridCell::MAX_COLS + cell.col : -1;
+}
+
+QByteArray OutgoingFrame::encoded(WireFormat format, Protocol::UserIdTable* outIds, int* userIdIndex) {
+    if (userIdIndex) {
+        *userIdIndex = -1;
+    }
+
+    if (format == WireFormat::Json) {
+        if (Protocol::frameFormat(m_canonical) == WireFormat::Json) {
+            return m_canonical;
+        }
+        if (m_json.isEmpty() && parse()) {
+            m_json = Protocol::encodeMessage(m_type, m_content, WireFormat::Json);
+        }
+        return m_json.isEmpty() ? m_canonical : m_json;
+    }
+
+    // Binaire sans identifiant à interner : les octets canoniques sont réutilisés tels quels
+    const bool binary = Protocol::frameFormat(m_canonical) == WireFormat::Binary;
+    if (binary && (!outIds || !Protocol::carriesUserId(m_canonical))) {
+        return m_canonical;
+    }
+
+    if (m_binary.isEmpty() || m_binaryTable != outIds) {
+        if (!parse()) {
+            return m_canonical;
+        }
+        m_binary = Protocol::encodeMessage(m_type, m_content, WireFormat::Binary, outIds);
+        m_binaryTable = outIds;
+        m_userIdIndex = -1;
+        if (outIds && (m_type == MessageType::GRID_UPDATE || m_type == MessageType::GRID_BATCH)) {
+            auto it = outIds->indices.constFind(m_content["userId"].toString());
+            if (it != outIds->indices.constEnd()) {
+                m_userIdIndex = int(it.value());
+            }
+        }
+    }
+
+    if (userIdIndex) {
+        *userIdIndex = m_userIdIndex;
+    }
+    return m_binary;
+}
+
+WireSession::WireSession()
+    : m_outIds(std::make_shared<Protocol::UserIdTable>())
+{
+}
+
+void WireSession::setOutgoingIdTable(std::shared_ptr<Protocol::UserIdTable> table) {
+    m_outIds = std::move(table);
+    m_sentAliases.clear();
+}
+
+QByteArray WireSession::encode(const QByteArray& frame) {
+    OutgoingFrame outgoing(frame);
+    return encode(outgoing);
+}
+
+QByteArray WireSession::encode(OutgoingFrame& frame, bool* definesAlias) {
+    if (definesAlias) {
+        *definesAlias = false;
+    }
+    if (m_format == WireFormat::Json) {
+        return frame.encoded(WireFormat::Json, nullptr);
+    }
+
+    int userIdIndex = -1;
+    QByteArray bytes = frame.encoded(WireFormat::Binary, m_outIds.get(), &userIdIndex);
+
+    // Premier usage de cet index sur la connexion : la définition précède le message
+    if (userIdIndex >= 0 && !m_sentAliases.contains(quint32(userIdIndex))) {
+        m_sentAliases.insert(quint32(userIdIndex));
+        if (definesAlias) {
+            *definesAlias = true;
+        }
+        return Protocol::createUserAliasMessage(quint32(userIdIndex), m_outIds->ids[userIdIndex]) + bytes;
+    }
+    return bytes;
+}
+
+bool WireSession::decode(QByteArrayView frame, MessageType& type, QJsonObject& content,
+                         QByteArray* canonical) {
+    if (!Protocol::parseMessage(frame, type, content, &m_inIds)) {
+        return false;
+    }
+
+    if (type == MessageType::USER_ALIAS) {
+        // Message de transport : mis à jour de la table, rien à transmettre à l'application
+        if (!m_inIds.define(quint32(content["index"].toInteger()), content["userId"].toString())) {
+            return false;
+        }
+        if (canonical) {
+            canonical->clear();
+        }
+        return true;
+    }
+
+    if (canonical) {
+        *canonical = Protocol::canonicalFrame(frame, type, content);
+    }
+    return true;
+}
+
+QByteArray Protocol::canonicalFrame(QByteArrayView frame, MessageType type, const QJsonObject& content) {
+    // Les références internées n'ont de sens que sur la connexion d'origine
+    return carriesUserId(frame) ? encodeMessage(type, content, WireFormat::Binary) : frame.toByteArray();
+}
+
 QByteArray Protocol::createColumnUpdateMessage(int columnCount) {
     QJsonObject data;
     data["columnCount"] = columnCount;
@@ -67,9 +693,76 @@ QByteArray Protocol::createGridUpdateMessage(const GridCell& cell) {
     return createMessage(MessageType::GRID_UPDATE, cell.toJson());
 }
 
-QByteArray Protocol::createTempoMessage(int bpm) {
+QByteArray Protocol::createGridBatchMessage(const GridBatch& batch) {
+    return createMessage(MessageType::GRID_BATCH, batch.toJson());
+}
+
+QJsonObject GridBatch::toJson() const {
+    QJsonArray cellArray;
+    for (quint16 packed : cells) {
+        cellArray.append(int(packed));
+    }
+
+    QJsonArray maskArray;
+    for (const Mask& mask : masks) {
+        QJsonObject entry;
+        entry[mask.column ? "col" : "row"] = mask.index;
+        // Les 64 bits passent tels quels (entier signé en JSON)
+        entry["set"] = qint64(mask.set);
+        entry["clear"] = qint64(mask.clear);
+        maskArray.append(entry);
+    }
+
+    QJsonObject obj;
+    obj["userId"] = userId;
+    obj["cells"] = cellArray;
+    obj["masks"] = maskArray;
+    return obj;
+}
+
+bool GridBatch::fromJson(const QJsonObject& obj, GridBatch& batch) {
+    const QJsonArray cellArray = obj["cells"].toArray();
+    const QJsonArray maskArray = obj["masks"].toArray();
+    if (!obj["userId"].isString() || cellArray.size() > MAX_CELLS || maskArray.size() > MAX_MASKS) {
+        return false;
+    }
+
+    batch = GridBatch();
+    batch.userId = obj["userId"].toString();
+
+    batch.cells.reserve(cellArray.size());
+    for (const auto& value : cellArray) {
+        const qint64 packed = value.toInteger(-1);
+        if (packed < 0 || packed > 0x1FFF) {
+            return false;
+        }
+        batch.cells.append(quint16(packed));
+    }
+
+    batch.masks.reserve(maskArray.size());
+    for (const auto& value : maskArray) {
+        const QJsonObject entry = value.toObject();
+        Mask mask;
+        mask.column = entry.contains("col");
+        mask.index = entry[mask.column ? "col" : "row"].toInt(-1);
+        const int limit = mask.column ? GridCell::MAX_COLS : GridCell::MAX_ROWS;
+        if (mask.index < 0 || mask.index >= limit) {
+            return false;
+        }
+        mask.set = quint64(entry["set"].toInteger());
+        mask.clear = quint64(entry["clear"].toInteger());
+        batch.masks.append(mask);
+    }
+    return !batch.isEmpty();
+}
+
+QByteArray Protocol::createTempoMessage(int bpm, qint64 at, double step) {
     QJsonObject data;
     data["bpm"] = bpm;
+    if (at >= 0) {
+        data["at"] = at;
+        data["step"] = step;
+    }
     return createMessage(MessageType::TEMPO_CHANGE, data);
 }
 
@@ -83,25 +776,79 @@ QByteArray Protocol::createJoinRoomMessage(const QString& roomId, const QString&
 }
 
 
-QByteArray Protocol::createPlayStateMessage(bool playing) {
+QByteArray Protocol::createPlayStateMessage(bool playing, qint64 at, double step) {
     QJsonObject data;
     data["playing"] = playing;
+    if (at >= 0) {
+        data["at"] = at;
+        data["step"] = step;
+    }
     return createMessage(MessageType::PLAY_STATE, data);
 }
 
+QByteArray Protocol::createPingMessage(quint32 sequence) {
+    QJsonObject data;
+    data["seq"] = qint64(sequence);
+    return createMessage(MessageType::PING, data);
+}
+
+QByteArray Protocol::createPongMessage(quint32 sequence) {
+    QJsonObject data;
+    data["seq"] = qint64(sequence);
+    return createMessage(MessageType::PONG, data);
+}
+
+QByteArray Protocol::createUdpBindMessage() {
+    return createMessage(MessageType::UDP_BIND, QJsonObject());
+}
+
+QByteArray Protocol::createPadHitMessage(int instrument, const QString& userId) {
+    QJsonObject data;
+    data["instrument"] = instrument;
+    data["userId"] = userId;
+    return createMessage(MessageType::PAD_HIT, data);
+}
+
+QByteArray Protocol::createClockSyncRequestMessage(qint64 t0) {
+    QJsonObject data;
+    data["t0"] = t0;
+    return createMessage(MessageType::CLOCK_SYNC, data);
+}
+
+QByteArray Protocol::createClockSyncReplyMessage(qint64 t0, qint64 t1, qint64 t2) {
+    QJsonObject data;
+    data["t0"] = t0;
+    data["t1"] = t1;
+    data["t2"] = t2;
+    return createMessage(MessageType::CLOCK_SYNC, data);
+}
+
 QByteArray Protocol::createRoomInfoRequestMessage(const QJsonObject& data) {
     return createMessage(MessageType::ROOM_INFO_REQUEST, data);
 }
 
 
-QByteArray Protocol::createSyncRequestMessage() {
-    return createMessage(MessageType::SYNC_REQUEST, QJsonObject());
+QByteArray Protocol::createSyncRequestMessage(qint64 sinceRevision, quint32 epoch) {
+    QJsonObject data;
+    if (sinceRevision >= 0) {
+        data["revision"] = sinceRevision;
+        data["epoch"] = qint64(epoch);
+    }
+    return createMessage(MessageType::SYNC_REQUEST, data);
 }
 
 QByteArray Protocol::createSyncResponseMessage(const QJsonObject& gridState) {
     return createMessage(MessageType::SYNC_RESPONSE, gridState);
 }
 
+QByteArray Protocol::createSyncDeltaEndMessage(qint64 revision, quint32 epoch) {
+    QJsonObject data;
+    data["revision"] = revision;
+    data["epoch"] = qint64(epoch);
+    data["delta"] = true;
+    return createMessage(MessageType::SYNC_RESPONSE, data);
+}
+
 // Nouvelles méthodes pour les messages de rooms
 QByteArray Protocol::createCreateRoomMessage(const QString& name, const QString& password, int maxUsers) {
     QJsonObject data;
@@ -132,9 +879,6 @@ QByteArray Protocol::createRoomListResponseMessage(const QJsonArray& rooms) {
     QJsonObject data;
     data["rooms"] = rooms;
 
-    qDebug() << "[PROTOCOL] Création ROOM_LIST_RESPONSE avec" << rooms.size() << "salles";
-    qDebug() << "[PROTOCOL] Contenu JSON:" << QJsonDocument(data).toJson(QJsonDocument::Compact);
-
     return createMessage(MessageType::ROOM_LIST_RESPONSE, data);
 }
 
@@ -194,6 +938,14 @@ QString Protocol::messageTypeToString(MessageType type) {
     case MessageType::CHAT_MESSAGE: return "CHAT_MESSAGE";
     case MessageType::USER_INFO: return "USER_INFO";
     case MessageType::ERROR_MESSAGE: return "ERROR_MESSAGE";
+    case MessageType::HELLO: return "HELLO";
+    case MessageType::USER_ALIAS: return "USER_ALIAS";
+    case MessageType::CLOCK_SYNC: return "CLOCK_SYNC";
+    case MessageType::PING: return "PING";
+    case MessageType::PONG: return "PONG";
+    case MessageType::GRID_BATCH: return "GRID_BATCH";
+    case MessageType::UDP_BIND: return "UDP_BIND";
+    case MessageType::PAD_HIT: return "PAD_HIT";
     default: return "UNKNOWN";
     }
 }
@@ -219,5 +971,13 @@ MessageType Protocol::stringToMessageType(const QString& str) {
     if (str == "CHAT_MESSAGE") return MessageType::CHAT_MESSAGE;
     if (str == "USER_INFO") return MessageType::USER_INFO;
     if (str == "ERROR_MESSAGE") return MessageType::ERROR_MESSAGE;
+    if (str == "HELLO") return MessageType::HELLO;
+    if (str == "USER_ALIAS") return MessageType::USER_ALIAS;
+    if (str == "CLOCK_SYNC") return MessageType::CLOCK_SYNC;
+    if (str == "PING") return MessageType::PING;
+    if (str == "PONG") return MessageType::PONG;
+    if (str == "GRID_BATCH") return MessageType::GRID_BATCH;
+    if (str == "UDP_BIND") return MessageType::UDP_BIND;
+    if (str == "PAD_HIT") return MessageType::PAD_HIT;
     return static_cast<MessageType>(-1);
 }
@@ -20,7 +20,7 @@ bool Room::addUser(const User& user) {
     }
 
     User newUser = user;
-    if (newUser.color == QColor()) {
+    if (newUser.color.isEmpty()) {
         newUser.color = generateUserColor();
     }
 
@@ -105,29 +105,29 @@ void Room::selectNewHost() {
     }
 }
 
-QColor Room::generateUserColor() const {
+QString Room::generateUserColor() const {
     // Couleurs prédéfinies pour les utilisateurs
-    static const QList<QColor> colors = {
-        QColor(255, 100, 100), // Rouge
-        QColor(100, 255, 100), // Vert
-        QColor(100, 100, 255), // Bleu
-        QColor(255, 255, 100), // Jaune
-        QColor(255, 100, 255), // Magenta
-        QColor(100, 255, 255), // Cyan
-        QColor(255, 150, 100), // Orange
-        QColor(150, 100, 255)  // Violet
+    static const QStringList colors = {
+        "#ff6464", // Rouge
+        "#64ff64", // Vert
+        "#6464ff", // Bleu
+        "#ffff64", // Jaune
+        "#ff64ff", // Magenta
+        "#64ffff", // Cyan
+        "#ff9664", // Orange
+        "#9664ff"  // Violet
     };
 
     // Utiliser des couleurs non prises (sans QSet)
-    QList<QColor> usedColors;
+    QStringList usedColors;
     for (const User& user : m_users) {
         usedColors.append(user.color);
     }
 
-    for (const QColor& color : colors) {
+    for (const QString& color : colors) {
         bool isUsed = false;
-        for (const QColor& usedColor : usedColors) {
-            if (color == usedColor) {
+        for (const QString& usedColor : usedColors) {
+            if (color.compare(usedColor, Qt::CaseInsensitive) == 0) {
                 isUsed = true;
                 break;
             }
@@ -137,12 +137,12 @@ QColor Room::generateUserColor() const {
         }
     }
 
-    // Si toutes les couleurs sont prises, générer une couleur aléatoire
-    return QColor::fromHsv(
-        QRandomGenerator::global()->bounded(360),
-        200 + QRandomGenerator::global()->bounded(56),
-        200 + QRandomGenerator::global()->bounded(56)
-        );
+    // Si toutes les couleurs sont prises, générer une couleur claire aléatoire
+    auto channel = []() { return QRandomGenerator::global()->bounded(100, 256); };
+    return QString("#%1%2%3")
+        .arg(channel(), 2, 16, QLatin1Char('0'))
+        .arg(channel(), 2, 16, QLatin1Char('0'))
+        .arg(channel(), 2, 16, QLatin1Char('0'));
 }
 
 QJsonObject Room::toJson() const {
@@ -0,0 +1,194 @@
+#include "RoomState.h"
+#include <QJsonArray>
+#include <QRandomGenerator>
+
+namespace {
+constexpr int DEFAULT_INSTRUMENTS = 8;
+constexpr int DEFAULT_STEPS = 16;
+}
+
+RoomState::RoomState(QObject* parent)
+    : QObject(parent)
+    , m_pattern(new PatternModel(this))
+    , m_epoch(QRandomGenerator::global()->generate())
+{
+    m_pattern->resize(DEFAULT_INSTRUMENTS, DEFAULT_STEPS);
+}
+
+bool RoomState::isStateOp(MessageType type) {
+    switch (type) {
+    case MessageType::GRID_UPDATE:
+    case MessageType::GRID_BATCH:
+    case MessageType::COLUMN_UPDATE:
+    case MessageType::TEMPO_CHANGE:
+    case MessageType::PLAY_STATE:
+    case MessageType::INSTRUMENT_SYNC:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool RoomState::isInGrid(int row, int col) const {
+    return row >= 0 && row < m_pattern->instrumentCount() && col >= 0 && col < m_pattern->stepCount();
+}
+
+bool RoomState::isValidOp(MessageType type, const QJsonObject& content) const {
+    switch (type) {
+    case MessageType::GRID_UPDATE: {
+        const GridCell cell = GridCell::fromJson(content);
+        return cell.isValid() && isInGrid(cell.row, cell.col) && content["active"].isBool();
+    }
+    case MessageType::GRID_BATCH: {
+        GridBatch batch;
+        if (!GridBatch::fromJson(content, batch)) {
+            return false;
+        }
+        // Les bits au-delà de la grille sont ignorés à l'application, pas les index
+        for (const GridBatch::Mask& mask : std::as_const(batch.masks)) {
+            const int limit = mask.column ? m_pattern->stepCount() : m_pattern->instrumentCount();
+            if (mask.index >= limit) {
+                return false;
+            }
+        }
+        for (quint16 packed : std::as_const(batch.cells)) {
+            if (!isInGrid(GridBatch::cellRow(packed), GridBatch::cellCol(packed))) {
+                return false;
+            }
+        }
+        return true;
+    }
+    case MessageType::COLUMN_UPDATE: {
+        const int columnCount = content["columnCount"].toInt(-1);
+        return columnCount > 0 && columnCount <= GridCell::MAX_COLS;
+    }
+    case MessageType::TEMPO_CHANGE: {
+        const int bpm = content["bpm"].toInt(-1);
+        return bpm > 0 && bpm <= 999;
+    }
+    case MessageType::PLAY_STATE:
+        return content["playing"].isBool();
+    case MessageType::INSTRUMENT_SYNC:
+        return content["instruments"].isArray() && content["instruments"].toArray().size() <= GridCell::MAX_ROWS;
+    case MessageType::PAD_HIT: {
+        const int instrument = content["instrument"].toInt(-1);
+        return instrument >= 0 && instrument < m_pattern->instrumentCount() && content["userId"].isString();
+    }
+    default:
+        return false;
+    }
+}
+
+QByteArray RoomState::commit(MessageType type, const QJsonObject& content) {
+    apply(type, content);
+
+    QJsonObject stamped = content;
+    stamped["rev"] = ++m_revision;
+    const QByteArray frame = Protocol::createMessage(type, stamped);
+
+    m_log.append({m_revision, frame});
+    if (m_log.size() > MAX_LOG_OPS) {
+        m_log.removeFirst();
+    }
+    return frame;
+}
+
+void RoomState::apply(MessageType type, const QJsonObject& content) {
+    switch (type) {
+    case MessageType::GRID_UPDATE: {
+        const GridCell cell = GridCell::fromJson(content);
+        m_pattern->setCell(cell.row, cell.col, cell.active, cell.userId);
+        break;
+    }
+    case MessageType::GRID_BATCH: {
+        GridBatch batch;
+        if (GridBatch::fromJson(content, batch)) {
+            m_pattern->applyBatch(batch);
+        }
+        break;
+    }
+    case MessageType::COLUMN_UPDATE:
+        m_pattern->resize(m_pattern->instrumentCount(), content["columnCount"].toInt());
+        break;
+    case MessageType::TEMPO_CHANGE:
+        m_tempo = content["bpm"].toInt(m_tempo);
+        if (content.contains("at")) {
+            m_transportAt = content["at"].toInteger();
+            m_transportStep = content["step"].toDouble();
+        }
+        break;
+    case MessageType::PLAY_STATE:
+        m_playing = content["playing"].toBool();
+        m_transportAt = m_playing ? content["at"].toInteger(-1) : -1;
+        m_transportStep = content["step"].toDouble();
+        break;
+    case MessageType::INSTRUMENT_SYNC:
+        m_instrumentNames = content["instruments"].toVariant().toStringList();
+        m_pattern->resize(qMax(1, int(m_instrumentNames.size())), m_pattern->stepCount());
+        break;
+    default:
+        break;
+    }
+}
+
+void RoomState::loadSnapshot(const QJsonObject& snapshot) {
+    m_pattern->clear();
+    m_pattern->resize(snapshot["instrumentCount"].toInt(m_pattern->instrumentCount()),
+                      snapshot["stepCount"].toInt(m_pattern->stepCount()));
+
+    // Instantané compact (serveur) ou état complet de DrumGrid::getGridState (hôte)
+    if (snapshot.contains("owners")) {
+        m_pattern->loadCompactCells(snapshot);
+    } else {
+        m_pattern->loadCells(snapshot["cells"].toArray());
+    }
+
+    m_tempo = snapshot["tempo"].toInt(m_tempo);
+    m_playing = snapshot["playing"].toBool(m_playing);
+    m_transportAt = m_playing ? snapshot["at"].toInteger(-1) : -1;
+    m_transportStep = snapshot["step"].toDouble();
+    if (snapshot.contains("instrumentNames")) {
+        m_instrumentNames = snapshot["instrumentNames"].toVariant().toStringList();
+    }
+
+    // Les opérations antérieures ne peuvent plus être rejouées par-dessus
+    ++m_revision;
+    m_log.clear();
+}
+
+bool RoomState::framesSince(qint64 since, quint32 epoch, QList<QByteArray>& frames) const {
+    if (epoch != m_epoch || since < 0 || since > m_revision) {
+        return false;
+    }
+
+    // Le journal couvre les révisions ]base, m_revision]
+    const qint64 base = m_log.isEmpty() ? m_revision : m_log.constFirst().revision - 1;
+    if (since < base) {
+        return false;
+    }
+
+    frames.clear();
+    frames.reserve(qsizetype(m_revision - since));
+    for (qsizetype i = qsizetype(since - base); i < m_log.size(); ++i) {
+        frames.append(m_log[i].frame);
+    }
+    return true;
+}
+
+QJsonObject RoomState::snapshot() const {
+    QJsonObject state = m_pattern->compactCellsToJson();
+    state["revision"] = m_revision;
+    state["epoch"] = qint64(m_epoch);
+    state["tempo"] = m_tempo;
+    state["playing"] = m_playing;
+    if (m_playing && m_transportAt >= 0) {
+        state["at"] = m_transportAt;
+        state["step"] = m_transportStep;
+    }
+    state["stepCount"] = m_pattern->stepCount();
+    state["instrumentCount"] = m_pattern->instrumentCount();
+    if (!m_instrumentNames.isEmpty()) {
+        state["instrumentNames"] = QJsonArray::fromStringList(m_instrumentNames);
+    }
+    return state;
+}
@@ -0,0 +1,417 @@
+#include "RoomWorker.h"
+#include <QDebug>
+
+RoomWorker::RoomWorker(QObject *parent)
+    : QObject(parent), m_outgoingIds(std::make_shared<Protocol::UserIdTable>()), m_pingTimer(new QTimer(this))
+{
+    connect(m_pingTimer, &QTimer::timeout, this, &RoomWorker::onPingTimer);
+}
+
+void RoomWorker::start(int heartbeatIntervalMs, int maxMissedPongs)
+{
+    setHeartbeat(heartbeatIntervalMs, maxMissedPongs);
+    m_pingTimer->start();
+}
+
+void RoomWorker::shutdown()
+{
+    m_pingTimer->stop();
+
+    // Toutes les fermetures sont lancées, puis une seule attente bornée pour l'ensemble
+    const QList<ClientConnection *> connections = m_connections.values();
+    for (ClientConnection *connection : connections)
+    {
+        disconnect(connection, nullptr, this, nullptr);
+        connection->close();
+    }
+    const QDeadlineTimer deadline(ClientConnection::CLOSE_TIMEOUT_MS);
+    for (ClientConnection *connection : connections)
+    {
+        connection->waitForClosed(deadline);
+        delete connection;
+    }
+    m_connections.clear();
+    m_connectionRoom.clear();
+
+    for (const RoomSlot &slot : std::as_const(m_rooms))
+    {
+        delete slot.state;
+    }
+    m_rooms.clear();
+}
+
+void RoomWorker::adoptConnection(ClientConnection *connection, const QString &roomId)
+{
+    const QString clientId = connection->clientId();
+    if (!connection->isConnected())
+    {
+        // Déconnecté pendant la migration
+        delete connection;
+        emit connectionClosed(clientId);
+        return;
+    }
+
+    connection->setParent(this);
+    connection->setOutgoingIdTable(m_outgoingIds);
+    connection->setSendQueueLimits(m_sendQueueLimits);
+    m_connections[clientId] = connection;
+
+    connect(connection, &ClientConnection::messageReceived, this,
+            [this, connection](MessageType type, const QJsonObject &content, const QByteArray &canonical)
+            { onConnectionMessage(connection, type, content, canonical); });
+    connect(connection, &ClientConnection::linkStatsChanged, this, [this, connection]()
+            { emit linkStatsUpdated(connection->clientId(), connection->linkStats()); });
+    connect(connection, &ClientConnection::disconnected, this, [this, connection]()
+            { closeConnection(connection); });
+
+    assignRoom(clientId, roomId);
+    connection->resume();
+}
+
+void RoomWorker::assignRoom(const QString &clientId, const QString &roomId)
+{
+    ClientConnection *connection = m_connections.value(clientId);
+    if (!connection)
+    {
+        return;
+    }
+
+    const QString previousRoom = m_connectionRoom.value(clientId);
+    if (!previousRoom.isEmpty() && previousRoom != roomId)
+    {
+        auto previous = m_rooms.find(previousRoom);
+        if (previous != m_rooms.end())
+        {
+            previous->members.remove(connection);
+        }
+    }
+    m_connectionRoom[clientId] = roomId;
+    openRoom(roomId).members.insert(connection);
+}
+
+RoomWorker::RoomSlot &RoomWorker::openRoom(const QString &roomId)
+{
+    // L'état naît avec le salon ; un salon supprimé dont des membres partent encore reste sans état
+    auto it = m_rooms.find(roomId);
+    if (it == m_rooms.end())
+    {
+        it = m_rooms.insert(roomId, RoomSlot());
+        it->state = new RoomState(this);
+    }
+    return *it;
+}
+
+void RoomWorker::releaseConnection(const QString &clientId, QThread *target)
+{
+    ClientConnection *connection = m_connections.value(clientId);
+    if (!connection)
+    {
+        return; // Déjà fermée : connectionClosed a été émis
+    }
+
+    detach(connection);
+    connection->pause();
+    connection->setParent(nullptr);
+    connection->moveToThread(target);
+    emit connectionReleased(connection);
+}
+
+void RoomWorker::detach(ClientConnection *connection)
+{
+    const QString clientId = connection->clientId();
+    disconnect(connection, nullptr, this, nullptr);
+    m_connections.remove(clientId);
+
+    const QString roomId = m_connectionRoom.take(clientId);
+    auto it = m_rooms.find(roomId);
+    if (it != m_rooms.end())
+    {
+        it->members.remove(connection);
+        if (it->members.isEmpty() && !it->state && !it->hostPresent)
+        {
+            m_rooms.erase(it); // Salon supprimé dont le dernier membre vient de partir
+        }
+    }
+}
+
+void RoomWorker::closeConnection(ClientConnection *connection)
+{
+    const QString clientId = connection->clientId();
+    detach(connection);
+    connection->deleteLater();
+    emit connectionClosed(clientId);
+}
+
+void RoomWorker::sendToClient(const QString &clientId, const QByteArray &message)
+{
+    if (ClientConnection *connection = m_connections.value(clientId))
+    {
+        connection->send(message);
+    }
+}
+
+void RoomWorker::kickClient(const QString &clientId, const QString &reason)
+{
+    ClientConnection *connection = m_connections.value(clientId);
+    if (!connection)
+    {
+        return;
+    }
+
+    if (!reason.isEmpty())
+    {
+        connection->send(Protocol::createErrorMessage(QString("Vous avez été expulsé: %1").arg(reason)));
+    }
+    connection->close();
+}
+
+void RoomWorker::broadcastToAll(const QByteArray &message)
+{
+    OutgoingFrame frame(message);
+    for (ClientConnection *connection : std::as_const(m_connections))
+    {
+        if (connection->isConnected())
+        {
+            connection->send(frame);
+        }
+    }
+}
+
+void RoomWorker::broadcastToRoom(const QString &roomId, const QByteArray &message)
+{
+    MessageType type;
+    QJsonObject content;
+    if (Protocol::parseMessage(message, type, content))
+    {
+        if (RoomState::isStateOp(type))
+        {
+            publishRoomOp(roomId, type, content);
+            return;
+        }
+        if (type == MessageType::SYNC_RESPONSE && !content["delta"].toBool())
+        {
+            // Instantané complet de l'hôte : il remplace l'état du salon
+            RoomState *state = roomState(roomId);
+            if (!state)
+            {
+                qWarning() << "[WORKER] Instantané de l'hôte pour un salon inconnu ignoré:" << roomId;
+                return;
+            }
+            state->loadSnapshot(content);
+            deliverToRoom(roomId, Protocol::createSyncResponseMessage(state->snapshot()));
+            return;
+        }
+    }
+
+    deliverToRoom(roomId, message);
+}
+
+void RoomWorker::setHostPresent(const QString &roomId, bool present)
+{
+    if (present)
+    {
+        openRoom(roomId).hostPresent = true;
+        return;
+    }
+
+    auto it = m_rooms.find(roomId);
+    if (it != m_rooms.end())
+    {
+        it->hostPresent = false;
+        if (it->members.isEmpty() && !it->state)
+        {
+            m_rooms.erase(it);
+        }
+    }
+}
+
+void RoomWorker::setHeartbeat(int intervalMs, int maxMissedPongs)
+{
+    m_pingTimer->setInterval(qMax(100, intervalMs));
+    m_maxMissedPongs = qMax(1, maxMissedPongs);
+}
+
+void RoomWorker::setSendQueueLimits(const SendQueueLimits &limits)
+{
+    m_sendQueueLimits = limits;
+    for (ClientConnection *connection : std::as_const(m_connections))
+    {
+        connection->setSendQueueLimits(limits);
+    }
+}
+
+void RoomWorker::removeRoom(const QString &roomId)
+{
+    auto it = m_rooms.find(roomId);
+    if (it == m_rooms.end())
+    {
+        return;
+    }
+    delete it->state;
+    it->state = nullptr;
+
+    // Des membres peuvent encore être en cours de migration vers le lobby
+    if (it->members.isEmpty())
+    {
+        m_rooms.erase(it);
+    }
+}
+
+QJsonObject RoomWorker::roomSnapshot(const QString &roomId)
+{
+    const RoomState *state = roomState(roomId);
+    return state ? state->snapshot() : QJsonObject();
+}
+
+void RoomWorker::onPingTimer()
+{
+    QList<ClientConnection *> deadConnections;
+    for (ClientConnection *connection : std::as_const(m_connections))
+    {
+        if (!connection->isConnected() || !connection->heartbeat(m_maxMissedPongs))
+        {
+            deadConnections.append(connection);
+            continue;
+        }
+        emit queueStatsUpdated(connection->clientId(), connection->queueStats());
+    }
+
+    for (ClientConnection *connection : deadConnections)
+    {
+        if (connection->isConnected())
+        {
+            qWarning() << "[WORKER] Client sans réponse après" << connection->linkStats().missedPongs()
+                       << "PING, éviction:" << connection->clientId();
+            emit clientTimedOut(connection->clientId());
+        }
+        closeConnection(connection);
+        connection->abort();
+    }
+}
+
+void RoomWorker::onConnectionMessage(ClientConnection *connection, MessageType type,
+                                     const QJsonObject &content, const QByteArray &canonical)
+{
+    const QString roomId = m_connectionRoom.value(connection->clientId());
+    // Nul si le salon a été supprimé pendant que ce message était en route
+    RoomState *state = roomState(roomId);
+
+    switch (type)
+    {
+    // Opérations de session : estampillées une seule fois par l'état du salon puis partagées
+    case MessageType::GRID_UPDATE:
+    case MessageType::GRID_BATCH:
+    case MessageType::COLUMN_UPDATE:
+    case MessageType::TEMPO_CHANGE:
+    case MessageType::PLAY_STATE:
+    case MessageType::INSTRUMENT_SYNC:
+        if (!state || !state->isValidOp(type, content))
+        {
+            qWarning() << "[WORKER]" << Protocol::messageTypeToString(type) << "invalide ou hors salon de" << connection->clientId();
+            break;
+        }
+        publishRoomOp(roomId, type, content);
+        break;
+
+    // Frappe en direct : relayée aux autres membres sans passer par l'état du salon
+    case MessageType::PAD_HIT:
+        if (!state || !state->isValidOp(type, content))
+        {
+            qWarning() << "[WORKER] PAD_HIT invalide ou hors salon de" << connection->clientId();
+            break;
+        }
+        deliverToRoom(roomId, canonical, connection);
+        break;
+
+    case MessageType::SYNC_REQUEST:
+        if (state)
+        {
+            sendRoomSync(connection, state, content);
+        }
+        break;
+
+    case MessageType::SYNC_RESPONSE:
+        // Anciens clients : COLUMN_UPDATE envoyé sous forme de SYNC_RESPONSE
+        if (content.contains("columnCount"))
+        {
+            QJsonObject column;
+            column["columnCount"] = content["columnCount"].toInt();
+            if (state && state->isValidOp(MessageType::COLUMN_UPDATE, column))
+            {
+                publishRoomOp(roomId, MessageType::COLUMN_UPDATE, column);
+            }
+        }
+        break;
+
+    // Trafic de lobby : le RoomManager reste sur le thread d'accueil
+    case MessageType::ROOM_LIST_REQUEST:
+    case MessageType::CREATE_ROOM:
+    case MessageType::JOIN_ROOM:
+    case MessageType::LEAVE_ROOM:
+        emit lobbyMessage(connection->clientId(), canonical);
+        break;
+
+    default:
+        qWarning() << "[WORKER] Type de message non géré:" << static_cast<int>(type);
+    }
+}
+
+void RoomWorker::publishRoomOp(const QString &roomId, MessageType type, const QJsonObject &content)
+{
+    RoomState *state = roomState(roomId);
+    if (!state)
+    {
+        qWarning() << "[WORKER]" << Protocol::messageTypeToString(type) << "pour un salon inconnu ignoré:" << roomId;
+        return;
+    }
+    // Une seule trame estampillée par opération, partagée par le journal et tous les destinataires
+    deliverToRoom(roomId, state->commit(type, content));
+}
+
+void RoomWorker::deliverToRoom(const QString &roomId, const QByteArray &message, ClientConnection *except)
+{
+    auto it = m_rooms.constFind(roomId);
+    if (it == m_rooms.constEnd())
+    {
+        return;
+    }
+
+    OutgoingFrame frame(message);
+    for (ClientConnection *connection : it->members)
+    {
+        if (connection != except && connection->isConnected())
+        {
+            connection->send(frame);
+        }
+    }
+
+    if (it->hostPresent)
+    {
+        emit hostMessage(message);
+    }
+}
+
+void RoomWorker::sendRoomSync(ClientConnection *connection, const RoomState *state, const QJsonObject &request)
+{
+    QList<QByteArray> frames;
+    if (state->framesSince(request["revision"].toInteger(-1), quint32(request["epoch"].toInteger()), frames))
+    {
+        // Rattrapage : les trames du journal sont renvoyées telles quelles
+        for (const QByteArray &bytes : frames)
+        {
+            connection->send(bytes);
+        }
+        connection->send(Protocol::createSyncDeltaEndMessage(state->revision(), state->epoch()));
+        qDebug() << "[WORKER] Synchronisation différentielle pour" << connection->clientId() << ":" << frames.size() << "opérations";
+        return;
+    }
+
+    connection->send(Protocol::createSyncResponseMessage(state->snapshot()));
+    qDebug() << "[WORKER] Instantané envoyé à" << connection->clientId() << "(révision" << state->revision() << ")";
+}
+
+RoomState *RoomWorker::roomState(const QString &roomId) const
+{
+    auto it = m_rooms.constFind(roomId);
+    return it != m_rooms.constEnd() ? it->state : nullptr;
+}
@@ -0,0 +1,128 @@
+#include "SampleCache.h"
+#include <QFileInfo>
+#include <QCoreApplication>
+#include <QDir>
+#include <QSaveFile>
+#include <QDateTime>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QDebug>
+#include <cstring>
+
+SampleCache::SampleCache(const QString& cacheDir)
+    : m_cacheDir(cacheDir)
+    , m_enabled(true)
+{
+    if (m_cacheDir.isEmpty()) {
+        m_cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/samples";
+    }
+}
+
+SampleBufferPtr SampleCache::load(const QString& filePath, QString* errorString) const {
+    QFileInfo source(filePath);
+    if (!source.exists()) {
+        if (errorString) {
+            *errorString = QString("Fichier non trouvé: %1").arg(filePath);
+        }
+        return nullptr;
+    }
+
+    if (!m_enabled) {
+        return SampleDecoder::decodeFile(filePath, errorString);
+    }
+
+    const QString cachePath = cacheFilePath(source);
+    if (SampleBufferPtr cached = mapCacheFile(cachePath, source)) {
+        return cached;
+    }
+
+    // Absent ou invalide : décodage complet puis écriture du cache
+    SampleBufferPtr sample = SampleDecoder::decodeFile(filePath, errorString);
+    if (sample && !writeCacheFile(cachePath, source, *sample)) {
+        qWarning() << "Impossible d'écrire le cache pour" << source.fileName();
+    }
+    return sample;
+}
+
+QString SampleCache::cacheFilePath(const QFileInfo& source) const {
+    // Toute modification du fichier source change la clé : pas d'invalidation explicite
+    const QByteArray key = source.absoluteFilePath().toUtf8()
+                           + '|' + QByteArray::number(source.lastModified().toMSecsSinceEpoch())
+                           + '|' + QByteArray::number(source.size());
+    const QByteArray hash = QCryptographicHash::hash(key, QCryptographicHash::Sha1).toHex();
+    return m_cacheDir + "/" + QString::fromLatin1(hash) + ".pcm";
+}
+
+SampleBufferPtr SampleCache::mapCacheFile(const QString& cachePath, const QFileInfo& source) const {
+    auto file = std::make_unique<QFile>(cachePath);
+    if (!file->exists() || !file->open(QIODevice::ReadOnly)) {
+        return nullptr;
+    }
+
+    CacheHeader header;
+    if (file->read(reinterpret_cast<char*>(&header), sizeof(header)) != qint64(sizeof(header))) {
+        return nullptr;
+    }
+
+    const bool valid = std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0
+                       && header.version == FORMAT_VERSION
+                       && header.sampleRate == quint32(SampleBuffer::SAMPLE_RATE)
+                       && header.channels == quint32(SampleBuffer::CHANNELS)
+                       && header.sourceMtime == source.lastModified().toMSecsSinceEpoch()
+                       && header.sourceSize == source.size()
+                       && header.frameCount > 0;
+    const qint64 dataBytes = header.frameCount * SampleBuffer::CHANNELS * qint64(sizeof(float));
+    if (!valid || file->size() != DATA_OFFSET + dataBytes) {
+        qWarning() << "Cache invalide ignoré:" << cachePath;
+        return nullptr;
+    }
+
+    uchar* data = file->map(DATA_OFFSET, dataBytes);
+    if (!data) {
+        return nullptr;
+    }
+
+    // Pré-chargement des pages : le thread audio ne doit jamais subir de défaut de page
+    volatile uchar sink = 0;
+    for (qint64 offset = 0; offset < dataBytes; offset += 4096) {
+        sink ^= data[offset];
+    }
+    Q_UNUSED(sink)
+
+    // Chargé sur le pool, libéré sur le thread principal (ramasse-miettes du mixeur) :
+    // le QFile lui est confié dès maintenant pour être détruit dans son propre thread
+    if (QCoreApplication* app = QCoreApplication::instance()) {
+        file->moveToThread(app->thread());
+    }
+
+    return SampleBuffer::fromMappedFile(source.filePath(), std::move(file),
+                                        reinterpret_cast<const float*>(data), header.frameCount);
+}
+
+bool SampleCache::writeCacheFile(const QString& cachePath, const QFileInfo& source, const SampleBuffer& sample) const {
+    if (!QDir().mkpath(m_cacheDir)) {
+        return false;
+    }
+
+    CacheHeader header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = FORMAT_VERSION;
+    header.sampleRate = SampleBuffer::SAMPLE_RATE;
+    header.channels = SampleBuffer::CHANNELS;
+    header.frameCount = sample.frameCount();
+    header.sourceMtime = source.lastModified().toMSecsSinceEpoch();
+    header.sourceSize = source.size();
+
+    QByteArray headerBlock(DATA_OFFSET, '\0');
+    std::memcpy(headerBlock.data(), &header, sizeof(header));
+
+    // Écriture atomique : un cache partiellement écrit n'est jamais visible
+    QSaveFile file(cachePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    const qint64 dataBytes = sample.frameCount() * SampleBuffer::CHANNELS * qint64(sizeof(float));
+    file.write(headerBlock);
+    file.write(reinterpret_cast<const char*>(sample.frames()), dataBytes);
+    return file.commit();
+}
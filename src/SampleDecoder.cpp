@@ -0,0 +1,160 @@
+#include "SampleDecoder.h"
+#include <QAudioDecoder>
+#include <QAudioBuffer>
+#include <QAudioFormat>
+#include <QEventLoop>
+#include <QTimer>
+#include <QUrl>
+#include <QFileInfo>
+#include <QThread>
+#include <QDebug>
+
+SampleBufferPtr SampleBuffer::fromPcm(const QString& filePath, QVector<float> pcm) {
+    std::shared_ptr<SampleBuffer> sample(new SampleBuffer());
+    sample->m_filePath = filePath;
+    sample->m_pcm = std::move(pcm);
+    sample->m_data = sample->m_pcm.constData();
+    sample->m_frameCount = sample->m_pcm.size() / CHANNELS;
+    return sample;
+}
+
+SampleBufferPtr SampleBuffer::fromMappedFile(const QString& filePath, std::unique_ptr<QFile> file,
+                                             const float* data, qint64 frameCount) {
+    std::shared_ptr<SampleBuffer> sample(new SampleBuffer());
+    sample->m_filePath = filePath;
+    sample->m_file = std::move(file);
+    sample->m_data = data;
+    sample->m_frameCount = frameCount;
+    return sample;
+}
+
+SampleBuffer::~SampleBuffer() {
+    // Le QFile appartient au thread principal : s'il n'est pas le dernier propriétaire
+    // du sample (chargement annulé sur le pool), la fermeture et le démappage lui reviennent
+    if (m_file && m_file->thread() != QThread::currentThread()) {
+        m_file.release()->deleteLater();
+    }
+}
+
+SampleBufferPtr SampleDecoder::decodeFile(const QString& filePath, QString* errorString) {
+    if (!QFileInfo::exists(filePath)) {
+        if (errorString) {
+            *errorString = QString("Fichier non trouvé: %1").arg(filePath);
+        }
+        return nullptr;
+    }
+
+    // QAudioDecoder est asynchrone : on attend la fin dans une boucle locale
+    QAudioDecoder decoder;
+    QEventLoop loop;
+    QVector<float> interleaved;
+    int sourceRate = 0;
+    QString error;
+
+    QObject::connect(&decoder, &QAudioDecoder::bufferReady, &loop, [&]() {
+        while (decoder.bufferAvailable()) {
+            appendBuffer(decoder.read(), interleaved, sourceRate);
+        }
+    });
+    QObject::connect(&decoder, &QAudioDecoder::finished, &loop, &QEventLoop::quit);
+    QObject::connect(&decoder, QOverload<QAudioDecoder::Error>::of(&QAudioDecoder::error),
+                     &loop, [&](QAudioDecoder::Error) {
+                         error = decoder.errorString();
+                         loop.quit();
+                     });
+
+    QTimer::singleShot(DECODE_TIMEOUT_MS, &loop, [&]() {
+        error = "Timeout de décodage";
+        loop.quit();
+    });
+
+    decoder.setSource(QUrl::fromLocalFile(filePath));
+    decoder.start();
+    loop.exec();
+    decoder.stop();
+
+    if (!error.isEmpty() || interleaved.isEmpty() || sourceRate <= 0) {
+        if (errorString) {
+            *errorString = error.isEmpty() ? QString("Aucune donnée audio décodée") : error;
+        }
+        return nullptr;
+    }
+
+    SampleBufferPtr sample = SampleBuffer::fromPcm(
+        filePath, resample(interleaved, sourceRate, SampleBuffer::SAMPLE_RATE));
+
+    qDebug() << "Sample décodé:" << QFileInfo(filePath).fileName()
+             << sample->frameCount() << "frames @" << SampleBuffer::SAMPLE_RATE << "Hz";
+    return sample;
+}
+
+void SampleDecoder::appendBuffer(const QAudioBuffer& buffer, QVector<float>& interleaved, int& sourceRate) {
+    if (!buffer.isValid()) {
+        return;
+    }
+
+    const QAudioFormat format = buffer.format();
+    const int channels = format.channelCount();
+    const qsizetype frames = buffer.frameCount();
+    if (channels <= 0 || frames <= 0) {
+        return;
+    }
+
+    if (sourceRate == 0) {
+        sourceRate = format.sampleRate();
+    }
+
+    // Conversion vers float stéréo (mono dupliqué, canaux supplémentaires ignorés)
+    auto sampleAt = [&](qsizetype index) -> float {
+        switch (format.sampleFormat()) {
+        case QAudioFormat::UInt8:
+            return (buffer.constData<quint8>()[index] - 128) / 128.0f;
+        case QAudioFormat::Int16:
+            return buffer.constData<qint16>()[index] / 32768.0f;
+        case QAudioFormat::Int32:
+            return buffer.constData<qint32>()[index] / 2147483648.0f;
+        case QAudioFormat::Float:
+            return buffer.constData<float>()[index];
+        default:
+            return 0.0f;
+        }
+    };
+
+    const qsizetype offset = interleaved.size();
+    interleaved.resize(offset + frames * SampleBuffer::CHANNELS);
+    float* out = interleaved.data() + offset;
+
+    for (qsizetype frame = 0; frame < frames; ++frame) {
+        const qsizetype base = frame * channels;
+        const float left = sampleAt(base);
+        const float right = (channels > 1) ? sampleAt(base + 1) : left;
+        out[frame * 2] = left;
+        out[frame * 2 + 1] = right;
+    }
+}
+
+QVector<float> SampleDecoder::resample(const QVector<float>& input, int sourceRate, int targetRate) {
+    if (sourceRate == targetRate) {
+        return input;
+    }
+
+    // Interpolation linéaire : suffisante pour des one-shots de batterie
+    const qint64 inFrames = input.size() / SampleBuffer::CHANNELS;
+    const qint64 outFrames = inFrames * targetRate / sourceRate;
+    const double step = double(sourceRate) / double(targetRate);
+
+    QVector<float> output(outFrames * SampleBuffer::CHANNELS);
+    for (qint64 frame = 0; frame < outFrames; ++frame) {
+        const double position = frame * step;
+        const qint64 index = qint64(position);
+        const float fraction = float(position - index);
+        const qint64 next = qMin(index + 1, inFrames - 1);
+
+        for (int channel = 0; channel < SampleBuffer::CHANNELS; ++channel) {
+            const float a = input[index * SampleBuffer::CHANNELS + channel];
+            const float b = input[next * SampleBuffer::CHANNELS + channel];
+            output[frame * SampleBuffer::CHANNELS + channel] = a + (b - a) * fraction;
+        }
+    }
+    return output;
+}
@@ -0,0 +1,103 @@
+#include "UdpChannel.h"
+#include "ClientConnection.h"
+#include "Protocol.h"
+#include <QNetworkDatagram>
+#include <QRandomGenerator>
+#include <QThread>
+#include <QDebug>
+
+UdpChannel::UdpChannel(QObject *parent)
+    : QObject(parent), m_socket(new QUdpSocket(this))
+{
+    connect(m_socket, &QUdpSocket::readyRead, this, &UdpChannel::onReadyRead);
+}
+
+bool UdpChannel::bind(quint16 port)
+{
+    if (!m_socket->bind(QHostAddress::Any, port))
+    {
+        qWarning() << "[UDP] Impossible d'ouvrir le canal UDP:" << m_socket->errorString();
+        return false;
+    }
+    qDebug() << "[UDP] Canal des événements éphémères ouvert sur le port" << m_socket->localPort();
+    return true;
+}
+
+void UdpChannel::close()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_connections.clear();
+    }
+    m_socket->close();
+}
+
+bool UdpChannel::isBound() const
+{
+    return m_socket->state() == QAbstractSocket::BoundState;
+}
+
+quint16 UdpChannel::port() const
+{
+    return m_socket->localPort();
+}
+
+quint64 UdpChannel::registerConnection(ClientConnection *connection)
+{
+    QMutexLocker locker(&m_mutex);
+    // Le jeton authentifie l'expéditeur : il doit être imprévisible
+    quint64 token;
+    do
+    {
+        token = QRandomGenerator::system()->generate64();
+    } while (token == 0 || m_connections.contains(token));
+    m_connections.insert(token, connection);
+    return token;
+}
+
+void UdpChannel::unregisterConnection(quint64 token)
+{
+    QMutexLocker locker(&m_mutex);
+    m_connections.remove(token);
+}
+
+void UdpChannel::send(const QHostAddress &address, quint16 port, const QByteArray &datagram)
+{
+    if (QThread::currentThread() == thread())
+    {
+        m_socket->writeDatagram(datagram, address, port);
+        return;
+    }
+    // Le socket appartient au thread d'accueil
+    QMetaObject::invokeMethod(this, [this, address, port, datagram]()
+                              { m_socket->writeDatagram(datagram, address, port); }, Qt::QueuedConnection);
+}
+
+void UdpChannel::onReadyRead()
+{
+    while (m_socket->hasPendingDatagrams())
+    {
+        const QNetworkDatagram datagram = m_socket->receiveDatagram(Protocol::MAX_DATAGRAM_SIZE);
+        quint64 token;
+        QByteArrayView frame;
+        const QByteArray data = datagram.data();
+        if (!Protocol::splitDatagram(data, token, frame))
+        {
+            continue; // Datagramme tronqué ou étranger : ignoré sans bruit
+        }
+
+        // Sous verrou : la connexion ne peut pas être détruite avant que l'appel soit
+        // posté ; s'il l'est ensuite, Qt abandonne l'appel avec elle
+        QMutexLocker locker(&m_mutex);
+        ClientConnection *connection = m_connections.value(token);
+        if (!connection)
+        {
+            continue;
+        }
+        const QHostAddress address = datagram.senderAddress();
+        const quint16 port = quint16(datagram.senderPort());
+        const QByteArray bytes = frame.toByteArray();
+        QMetaObject::invokeMethod(connection, [connection, address, port, bytes]()
+                                  { connection->receiveDatagram(address, port, bytes); }, Qt::QueuedConnection);
+    }
+}
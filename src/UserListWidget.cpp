@@ -137,7 +137,7 @@ void UserListWidget::updateUserList(const QList<User>& users) {
 
         // Couleur de l'utilisateur
         QPixmap colorPixmap(16, 16);
-        colorPixmap.fill(user.color);
+        colorPixmap.fill(QColor(user.color));
         item->setIcon(QIcon(colorPixmap));
 
         // Style selon le statut
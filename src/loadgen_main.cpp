@@ -0,0 +1,348 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QLoggingCategory>
+#include <QProcess>
+#include <QTemporaryFile>
+#include <QThread>
+#include <QTimer>
+#include <QDebug>
+#include <csignal>
+#include "LoadBot.h"
+#include "LatencyHistogram.h"
+#include "ClockSync.h"
+
+// Générateur de charge : N clients simulés contre un serveur (en local, sur la
+// boucle locale), pour suivre les régressions et dimensionner les machines.
+// Mesure la latence de propagation d'une modification (envoi par un bot ->
+// réception par les autres membres du salon), l'écho vers l'émetteur, le débit
+// et la mémoire résidente du serveur.
+
+namespace {
+
+void requestQuit(int) {
+    QCoreApplication::quit();
+}
+
+// Mémoire résidente d'un processus en Kio (Linux, /proc), -1 si indisponible
+qint64 residentKb(const QString& pid) {
+    QFile status(QString("/proc/%1/status").arg(pid));
+    if (!status.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    for (const QByteArray& line : status.readAll().split('\n')) {
+        if (line.startsWith("VmRSS:")) {
+            return line.mid(6).trimmed().split(' ').value(0).toLongLong();
+        }
+    }
+    return -1;
+}
+
+struct Counters {
+    quint64 edits = 0;
+    quint64 updates = 0;
+};
+
+// Même charge contre un serveur à un seul fil de travail, puis à un fil par cœur.
+// Chaque mesure est une exécution complète du générateur (serveur relancé), dont
+// le résumé JSON est relu ; le débit doit croître presque linéairement avec les fils.
+int runScaling(const QStringList& arguments, const QString& outputPath) {
+    QStringList childArguments = arguments.mid(1);
+    childArguments.removeAll("--scaling");
+    const int cores = qMax(1, QThread::idealThreadCount());
+
+    QJsonArray runs;
+    for (int workers : {1, cores}) {
+        QTemporaryFile output;
+        if (!output.open()) {
+            qCritical() << "Impossible de créer le fichier de résumé temporaire";
+            return 1;
+        }
+        output.close();
+
+        qInfo() << "[LOADGEN] Mesure avec" << workers << "fil(s) de travail côté serveur";
+        QProcess child;
+        child.setProcessChannelMode(QProcess::ForwardedChannels);
+        child.start(QCoreApplication::applicationFilePath(),
+                    childArguments + QStringList{"--server-workers", QString::number(workers),
+                                                 "--output", output.fileName()});
+        if (!child.waitForFinished(-1) || child.exitStatus() != QProcess::NormalExit || child.exitCode() != 0) {
+            qCritical() << "Échec de la mesure avec" << workers << "fil(s):" << child.errorString();
+            return 1;
+        }
+
+        QFile summary(output.fileName());
+        if (!summary.open(QIODevice::ReadOnly)) {
+            qCritical() << "Résumé introuvable pour" << workers << "fil(s)";
+            return 1;
+        }
+        QJsonObject run = QJsonDocument::fromJson(summary.readAll()).object();
+        run["workers"] = workers;
+        runs.append(run);
+    }
+
+    const QJsonObject single = runs.first().toObject();
+    const QJsonObject all = runs.last().toObject();
+    auto ratio = [](double value, double reference) { return reference > 0 ? value / reference : 0.0; };
+    QJsonObject json;
+    json["cores"] = cores;
+    json["runs"] = runs;
+    json["editsSpeedup"] = ratio(all["editsConfirmedPerSec"].toDouble(), single["editsConfirmedPerSec"].toDouble());
+    json["updatesSpeedup"] = ratio(all["updatesPerSec"].toDouble(), single["updatesPerSec"].toDouble());
+
+    for (const QJsonValue& value : std::as_const(runs)) {
+        const QJsonObject run = value.toObject();
+        qInfo().noquote() << QString("[LOADGEN] %1 fil(s) : %2 modif/s validées, %3 màj/s, propagation p99=%4 µs")
+                                 .arg(run["workers"].toInt())
+                                 .arg(run["editsConfirmedPerSec"].toDouble(), 0, 'f', 1)
+                                 .arg(run["updatesPerSec"].toDouble(), 0, 'f', 1)
+                                 .arg(run["propagation"].toObject()["p99Us"].toInteger());
+    }
+    qInfo().noquote() << QString("[LOADGEN] Accélération sur %1 cœurs : x%2 (modifications), x%3 (mises à jour)")
+                             .arg(cores)
+                             .arg(json["editsSpeedup"].toDouble(), 0, 'f', 2)
+                             .arg(json["updatesSpeedup"].toDouble(), 0, 'f', 2);
+
+    if (!outputPath.isEmpty()) {
+        QFile output(outputPath);
+        const QByteArray document = QJsonDocument(json).toJson(QJsonDocument::Indented);
+        if (!output.open(QIODevice::WriteOnly) || output.write(document) != document.size()) {
+            qWarning() << "Impossible d'écrire le résumé:" << outputPath;
+        }
+    }
+    return 0;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("beebee-loadgen");
+    app.setApplicationVersion("1.0.0");
+    app.setOrganizationName("BeTeam");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Générateur de charge BeeBee : clients simulés et mesures réseau");
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    QCommandLineOption hostOption("host", "Adresse du serveur.", "host", "127.0.0.1");
+    QCommandLineOption portOption({"p", "port"}, "Port du serveur.", "port", "8888");
+    QCommandLineOption clientsOption({"n", "clients"}, "Nombre de clients simulés.", "n", "16");
+    QCommandLineOption roomSizeOption("room-size", "Clients par salon (2 - 8, meneur compris).", "n", "4");
+    QCommandLineOption rateOption("edit-rate", "Modifications par seconde et par client (0 : écoute seule).", "hz", "4");
+    QCommandLineOption rowsOption("rows", "Lignes modifiées par les bots.", "n", "8");
+    QCommandLineOption colsOption("cols", "Colonnes modifiées par les bots.", "n", "16");
+    QCommandLineOption rampOption("ramp-ms", "Délai entre deux connexions, en millisecondes.", "ms", "20");
+    QCommandLineOption joinTimeoutOption("join-timeout", "Attente maximale de l'entrée des bots dans leur salon, en secondes.", "s", "30");
+    QCommandLineOption durationOption({"d", "duration"}, "Durée de la mesure, en secondes.", "s", "30");
+    QCommandLineOption reportOption("report-interval", "Intervalle des relevés intermédiaires, en secondes (0 : aucun).", "s", "5");
+    QCommandLineOption pidOption("server-pid", "PID du serveur, pour relever sa mémoire résidente.", "pid");
+    QCommandLineOption spawnOption("spawn-server", "Lance ce binaire beebee-server sur le port choisi pour la durée du test.", "path");
+    QCommandLineOption serverWorkersOption("server-workers", "Fils de travail du serveur lancé par --spawn-server (0 : un par cœur).", "n", "0");
+    QCommandLineOption scalingOption("scaling", "Mesure deux fois, serveur à un fil puis à un fil par cœur, et compare les débits (avec --spawn-server).");
+    QCommandLineOption outputOption({"o", "output"}, "Écrit le résumé JSON final dans ce fichier.", "file");
+    parser.addOptions({hostOption, portOption, clientsOption, roomSizeOption, rateOption, rowsOption, colsOption,
+                       rampOption, joinTimeoutOption, durationOption, reportOption, pidOption, spawnOption,
+                       serverWorkersOption, scalingOption, outputOption});
+    parser.process(app);
+
+    if (parser.isSet(scalingOption)) {
+        if (!parser.isSet(spawnOption)) {
+            qCritical() << "--scaling demande --spawn-server : le serveur est relancé pour chaque mesure";
+            return 1;
+        }
+        return runScaling(app.arguments(), parser.value(outputOption));
+    }
+
+    bool ok = false;
+    const quint16 port = parser.value(portOption).toUShort(&ok);
+    if (!ok || port == 0) {
+        qCritical() << "Port invalide:" << parser.value(portOption);
+        return 1;
+    }
+    const QString host = parser.value(hostOption);
+    const int clientCount = qMax(1, parser.value(clientsOption).toInt());
+    // Room::setMaxUsers borne la taille des salons
+    const int roomSize = qBound(2, parser.value(roomSizeOption).toInt(), 8);
+    const double editRate = parser.value(rateOption).toDouble();
+    const int durationS = qMax(1, parser.value(durationOption).toInt());
+    const int reportS = qMax(0, parser.value(reportOption).toInt());
+
+    // Les traces de chaque client noieraient les relevés
+    QLoggingCategory::setFilterRules("default.debug=false");
+
+    // Serveur lancé par le test : mesure reproductible, arrêté avec lui
+    QProcess serverProcess;
+    QString serverPid = parser.value(pidOption);
+    if (parser.isSet(spawnOption)) {
+        serverProcess.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        serverProcess.start(parser.value(spawnOption), {"--port", QString::number(port), "--stats-interval", "0",
+                                                        "--workers", parser.value(serverWorkersOption)});
+        if (!serverProcess.waitForStarted(5000)) {
+            qCritical() << "Impossible de lancer le serveur:" << serverProcess.errorString();
+            return 1;
+        }
+        serverPid = QString::number(serverProcess.processId());
+    }
+
+    // Un nom de salon propre à l'exécution : pas de collision avec un test précédent
+    const QString runTag = QString::number(QCoreApplication::applicationPid());
+    QVector<LoadBot*> bots;
+    QHash<QString, LoadBot*> botsByUser;
+    for (int i = 0; i < clientCount; ++i) {
+        const int group = i / roomSize;
+        const bool leader = (i % roomSize) == 0;
+        const int size = qMin(roomSize, clientCount - group * roomSize);
+        LoadBot* bot = new LoadBot(i, QString("loadgen-%1-%2").arg(runTag).arg(group), leader, qMax(2, size), &app);
+        bot->setEditRate(editRate);
+        bot->setGridSize(parser.value(rowsOption).toInt(), parser.value(colsOption).toInt());
+        bots.append(bot);
+        botsByUser.insert(bot->userId(), bot);
+    }
+
+    LatencyHistogram propagation; // Émetteur -> autres membres du salon
+    LatencyHistogram echo;        // Émetteur -> émetteur (opération validée par le serveur)
+    Counters total;
+    Counters lastReport;
+    int joined = 0;
+    int disconnects = 0;
+    bool measuring = false;
+    QElapsedTimer measureTimer;
+    QElapsedTimer reportTimer;
+    quint64 editsAtStart = 0;
+
+    auto editsSent = [&]() {
+        quint64 edits = 0;
+        for (LoadBot* bot : std::as_const(bots)) {
+            edits += bot->editsSent();
+        }
+        return edits;
+    };
+
+    auto summary = [&]() {
+        const double elapsedS = measuring ? measureTimer.elapsed() / 1000.0 : 0.0;
+        QJsonObject json;
+        json["clients"] = clientCount;
+        json["roomSize"] = roomSize;
+        json["joined"] = joined;
+        json["disconnects"] = disconnects;
+        json["editRate"] = editRate;
+        json["elapsedS"] = elapsedS;
+        json["edits"] = qint64(total.edits);
+        json["updatesReceived"] = qint64(total.updates);
+        json["editsPerSec"] = elapsedS > 0 ? total.edits / elapsedS : 0.0;
+        json["updatesPerSec"] = elapsedS > 0 ? total.updates / elapsedS : 0.0;
+        // Modifications revenues à leur émetteur : traitées de bout en bout par le serveur
+        json["editsConfirmedPerSec"] = elapsedS > 0 ? echo.count() / elapsedS : 0.0;
+        json["propagation"] = propagation.toJson();
+        json["echo"] = echo.toJson();
+        json["serverRssKb"] = serverPid.isEmpty() ? -1 : residentKb(serverPid);
+        json["loadgenRssKb"] = residentKb("self");
+        return json;
+    };
+
+    auto report = [&]() {
+        total.edits = editsSent() - editsAtStart;
+        const double intervalS = qMax<qint64>(1, reportTimer.restart()) / 1000.0;
+        qInfo().noquote() << QString("[LOADGEN] %1 s : %2 modif/s, %3 màj/s, propagation p50=%4 µs p99=%5 µs max=%6 µs, RSS serveur=%7 Kio")
+                                 .arg(measureTimer.elapsed() / 1000)
+                                 .arg((total.edits - lastReport.edits) / intervalS, 0, 'f', 1)
+                                 .arg((total.updates - lastReport.updates) / intervalS, 0, 'f', 1)
+                                 .arg(propagation.percentileUs(50.0))
+                                 .arg(propagation.percentileUs(99.0))
+                                 .arg(propagation.maxUs())
+                                 .arg(serverPid.isEmpty() ? -1 : residentKb(serverPid));
+        lastReport = total;
+    };
+
+    QTimer reportTicker;
+    QObject::connect(&reportTicker, &QTimer::timeout, report);
+
+    auto startMeasure = [&]() {
+        if (measuring) {
+            return;
+        }
+        measuring = true;
+        if (joined < clientCount) {
+            qWarning() << "[LOADGEN] Seuls" << joined << "bots sur" << clientCount << "sont dans leur salon";
+        }
+        qInfo() << "[LOADGEN] Mesure pendant" << durationS << "s";
+        editsAtStart = editsSent();
+        measureTimer.start();
+        reportTimer.start();
+        if (reportS > 0) {
+            reportTicker.start(reportS * 1000);
+        }
+        QTimer::singleShot(durationS * 1000, &app, &QCoreApplication::quit);
+    };
+
+    for (LoadBot* bot : std::as_const(bots)) {
+        QObject::connect(bot, &LoadBot::joinedRoom, [&]() {
+            if (++joined == clientCount) {
+                startMeasure();
+            }
+        });
+        QObject::connect(bot, &LoadBot::connectionLost, [&]() {
+            ++disconnects;
+        });
+        QObject::connect(bot, &LoadBot::gridUpdateReceived, [&, bot](const GridCell& cell, qint64 receivedUs) {
+            if (!measuring) {
+                return;
+            }
+            LoadBot* sender = botsByUser.value(cell.userId);
+            const qint64 sentUs = sender ? sender->sentAtUs(cell.row, cell.col) : -1;
+            if (sentUs < 0) {
+                return;
+            }
+            // Dernier envoi sur la cellule : une cellule rebasculée avant la réception
+            // de la précédente sous-estime la latence (rare à ces cadences)
+            (sender == bot ? echo : propagation).record(receivedUs - sentUs);
+            ++total.updates;
+        });
+    }
+
+    // Connexions étalées : la rafale d'acceptations ne fausse pas la mesure.
+    // Un serveur lancé par le test a le temps d'ouvrir son port.
+    const int startDelayMs = parser.isSet(spawnOption) ? 500 : 0;
+    const int rampMs = qMax(0, parser.value(rampOption).toInt());
+    for (int i = 0; i < bots.size(); ++i) {
+        LoadBot* bot = bots[i];
+        QTimer::singleShot(startDelayMs + i * rampMs, bot, [bot, host, port]() { bot->start(host, port); });
+    }
+    const int joinTimeoutMs = qMax(1, parser.value(joinTimeoutOption).toInt()) * 1000;
+    QTimer::singleShot(startDelayMs + bots.size() * rampMs + joinTimeoutMs, &app, startMeasure);
+
+    std::signal(SIGINT, requestQuit);
+    std::signal(SIGTERM, requestQuit);
+
+    qInfo() << "[LOADGEN]" << clientCount << "clients vers" << host << ":" << port
+            << "-" << (clientCount + roomSize - 1) / roomSize << "salons," << editRate << "modif/s par client";
+    const int result = app.exec();
+
+    total.edits = editsSent() - editsAtStart;
+    const QJsonObject json = summary();
+    for (LoadBot* bot : std::as_const(bots)) {
+        bot->stop();
+    }
+
+    const QByteArray document = QJsonDocument(json).toJson(QJsonDocument::Indented);
+    qInfo().noquote() << document;
+    if (parser.isSet(outputOption)) {
+        QFile output(parser.value(outputOption));
+        if (!output.open(QIODevice::WriteOnly) || output.write(document) != document.size()) {
+            qWarning() << "Impossible d'écrire le résumé:" << parser.value(outputOption);
+        }
+    }
+
+    if (serverProcess.state() != QProcess::NotRunning) {
+        serverProcess.terminate();
+        if (!serverProcess.waitForFinished(3000)) {
+            serverProcess.kill();
+        }
+    }
+    return result;
+}
@@ -0,0 +1,175 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+#include <QDebug>
+#include "AudioEngine.h"
+#include "OfflineRenderer.h"
+#include "SampleCache.h"
+
+// Rendu hors ligne : motif (état de DrumGrid::getGridState() enregistré en
+// JSON) + dossier de samples -> fichier WAV, sans périphérique audio et aussi
+// vite que possible. Affiche la vitesse de rendu en multiple du temps réel ;
+// --repeat répète le rendu pour une mesure stable. Avec --stems, une piste
+// par instrument utilisé, rendues en parallèle.
+
+namespace {
+
+// Mêmes IDs d'instruments que l'application : tri naturel des noms nettoyés
+QVector<SampleBufferPtr> loadSamples(const QString& directory, QStringList* names, int* failures) {
+    SampleCache cache;
+    QVector<SampleBufferPtr> samples;
+    *failures = 0;
+    for (const auto& entry : AudioEngine::listSampleFiles(QDir(directory))) {
+        names->append(entry.first);
+        QString error;
+        SampleBufferPtr sample = cache.load(entry.second.filePath(), &error);
+        if (!sample) {
+            qWarning().noquote() << "[RENDER] Sample ignoré (silencieux):" << entry.second.fileName() << "-" << error;
+            ++*failures;
+        }
+        samples.append(sample);
+    }
+    return samples;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("beebee-render");
+    app.setApplicationVersion("1.0.0");
+    app.setOrganizationName("BeTeam");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Rendu hors ligne d'un motif BeeBee vers un fichier WAV");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("motif", "Motif JSON (état de la grille : cells, stepCount, tempo).");
+
+    QCommandLineOption samplesOption({"s", "samples"}, "Dossier des samples.", "dossier", "samples");
+    QCommandLineOption outputOption({"o", "output"}, "Fichier WAV produit.", "fichier", "motif.wav");
+    QCommandLineOption loopsOption({"l", "loops"}, "Nombre de boucles du motif.", "n", "4");
+    QCommandLineOption formatOption({"f", "format"}, "Format des échantillons : 16, 24 ou float.", "format", "16");
+    QCommandLineOption tempoOption("bpm", "Tempo imposé (sinon celui du motif).", "bpm");
+    QCommandLineOption gainOption("gain", "Gain global (comme le volume de l'application).", "gain", "0.7");
+    QCommandLineOption noTailOption("no-tail", "Coupe net à la fin de la dernière boucle.");
+    QCommandLineOption repeatOption("repeat", "Répète le rendu n fois (mesure de vitesse).", "n", "1");
+    QCommandLineOption chokeOption("choke-hihats", "Les charlestons (d'après leur nom) s'étouffent entre eux.");
+    QCommandLineOption stemsOption("stems", "Une piste WAV par instrument utilisé dans ce dossier (au lieu de --output).", "dossier");
+    parser.addOptions({samplesOption, outputOption, loopsOption, formatOption, tempoOption,
+                       gainOption, noTailOption, repeatOption, chokeOption, stemsOption});
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 1) {
+        parser.showHelp(1);
+    }
+
+    const QString patternPath = parser.positionalArguments().first();
+    QFile patternFile(patternPath);
+    if (!patternFile.open(QIODevice::ReadOnly)) {
+        qCritical().noquote() << "Motif illisible:" << patternPath << "-" << patternFile.errorString();
+        return 1;
+    }
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(patternFile.readAll(), &parseError);
+    if (!document.isObject()) {
+        qCritical().noquote() << "Motif JSON invalide:" << parseError.errorString();
+        return 1;
+    }
+
+    OfflineRenderer::WavFormat format;
+    if (!OfflineRenderer::parseFormat(parser.value(formatOption), &format)) {
+        qCritical() << "Format inconnu:" << parser.value(formatOption);
+        return 1;
+    }
+
+    QElapsedTimer loadTimer;
+    loadTimer.start();
+    int failures = 0;
+    QStringList names;
+    const QVector<SampleBufferPtr> samples = loadSamples(parser.value(samplesOption), &names, &failures);
+    if (samples.isEmpty()) {
+        qWarning().noquote() << "[RENDER] Aucun sample dans" << parser.value(samplesOption) << "- rendu silencieux";
+    }
+    qInfo().noquote() << QString("[RENDER] %1 samples chargés en %2 ms (%3 en échec)")
+                             .arg(samples.size()).arg(loadTimer.elapsed()).arg(failures);
+
+    OfflineRenderer renderer;
+    renderer.setSamples(samples);
+    if (parser.isSet(chokeOption)) {
+        QVector<int> chokeGroups;
+        for (const QString& name : std::as_const(names)) {
+            chokeGroups.append(AudioEngine::defaultChokeGroup(name));
+        }
+        renderer.setChokeGroups(chokeGroups);
+    }
+    renderer.setGridState(document.object());
+    if (parser.isSet(tempoOption)) {
+        renderer.setTempo(parser.value(tempoOption).toDouble());
+    }
+    renderer.setLoops(parser.value(loopsOption).toInt());
+    renderer.setFormat(format);
+    renderer.setIncludeTail(!parser.isSet(noTailOption));
+    renderer.setGain(parser.value(gainOption).toFloat());
+
+    // Chaque passe réécrit les mêmes fichiers ; la meilleure donne le débit du rendu
+    const int repeat = qMax(1, parser.value(repeatOption).toInt());
+
+    if (parser.isSet(stemsOption)) {
+        QVector<OfflineRenderer::StemResult> stems;
+        OfflineRenderer::Result best;
+        for (int pass = 0; pass < repeat; ++pass) {
+            OfflineRenderer::Result total;
+            QString error;
+            if (!renderer.renderStems(parser.value(stemsOption), names, &stems, &total, &error)) {
+                qCritical().noquote() << "Échec du rendu des pistes:" << error;
+                return 1;
+            }
+            if (pass == 0 || total.elapsedUs < best.elapsedUs) {
+                best = total;
+            }
+        }
+
+        for (const OfflineRenderer::StemResult& stem : std::as_const(stems)) {
+            qInfo().noquote() << QString("[RENDER] %1 (%2 s)").arg(stem.filePath).arg(stem.result.durationSeconds(), 0, 'f', 2);
+        }
+        qInfo().noquote() << QString("[RENDER] %1 pistes en %2 ms sur %3 threads : %4× le temps réel au total")
+                                 .arg(stems.size())
+                                 .arg(best.elapsedUs / 1000.0, 0, 'f', 1)
+                                 .arg(qMin<int>(stems.size(), QThread::idealThreadCount()))
+                                 .arg(best.realtimeFactor(), 0, 'f', 0);
+        return 0;
+    }
+
+    OfflineRenderer::Result best;
+    double totalFactor = 0.0;
+    for (int pass = 0; pass < repeat; ++pass) {
+        OfflineRenderer::Result result;
+        QString error;
+        if (!renderer.renderToFile(parser.value(outputOption), &result, &error)) {
+            qCritical().noquote() << "Échec du rendu:" << error;
+            return 1;
+        }
+        totalFactor += result.realtimeFactor();
+        if (pass == 0 || result.elapsedUs < best.elapsedUs) {
+            best = result;
+        }
+    }
+
+    qInfo().noquote() << QString("[RENDER] %1 : %2 steps à %3 bpm, %4 s de son")
+                             .arg(parser.value(outputOption))
+                             .arg(renderer.stepCount())
+                             .arg(renderer.tempo())
+                             .arg(best.durationSeconds(), 0, 'f', 2);
+    qInfo().noquote() << QString("[RENDER] Meilleur rendu %1 ms : %2× le temps réel (moyenne %3× sur %4 passes)")
+                             .arg(best.elapsedUs / 1000.0, 0, 'f', 1)
+                             .arg(best.realtimeFactor(), 0, 'f', 0)
+                             .arg(totalFactor / repeat, 0, 'f', 0)
+                             .arg(repeat);
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTimer>
+#include <QDebug>
+#include <csignal>
+#include "DrumServer.h"
+#include "RoomManager.h"
+
+// Serveur dédié : QtCore + QtNetwork uniquement, sans affichage ni périphérique audio.
+// Le RoomManager et l'état versionné de chaque salon (RoomState) vivent ici ;
+// toutes les interfaces sont des clients comme les autres.
+
+namespace {
+void requestQuit(int) {
+    QCoreApplication::quit();
+}
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("beebee-server");
+    app.setApplicationVersion("1.0.0");
+    app.setOrganizationName("BeTeam");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Serveur dédié BeeBee (sans interface graphique)");
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    QCommandLineOption portOption({"p", "port"}, "Port d'écoute TCP.", "port", "8888");
+    QCommandLineOption workersOption("workers", "Fils de travail des salons (0 : un par cœur).", "n", "0");
+    QCommandLineOption heartbeatOption("heartbeat-ms", "Intervalle des PING, en millisecondes.", "ms", "2000");
+    QCommandLineOption missedOption("max-missed-pongs", "PING sans réponse avant éviction d'un client.", "n", "5");
+    QCommandLineOption statsOption("stats-interval", "Intervalle du journal de métriques, en secondes (0 : désactivé).", "s", "60");
+    QCommandLineOption queueBytesOption("send-queue-kb", "Budget de la file d'envoi par client, en Kio.", "kb", "1024");
+    QCommandLineOption queueMessagesOption("send-queue-messages", "Budget de la file d'envoi par client, en messages.", "n", "4096");
+    QCommandLineOption slowOption("slow-client-ms", "Durée tolérée au-delà du budget avant déconnexion, en millisecondes.", "ms", "5000");
+    QCommandLineOption noUdpOption("no-udp", "Désactive le canal UDP des événements éphémères (tout passe par TCP).");
+    parser.addOptions({portOption, workersOption, heartbeatOption, missedOption, statsOption,
+                       queueBytesOption, queueMessagesOption, slowOption, noUdpOption});
+    parser.process(app);
+
+    bool ok = false;
+    const quint16 port = parser.value(portOption).toUShort(&ok);
+    if (!ok || port == 0) {
+        qCritical() << "Port invalide:" << parser.value(portOption);
+        return 1;
+    }
+
+    RoomManager roomManager;
+    DrumServer server;
+    server.setRoomManager(&roomManager);
+    server.setWorkerCount(parser.value(workersOption).toInt());
+    server.setHeartbeat(parser.value(heartbeatOption).toInt(), parser.value(missedOption).toInt());
+    server.setSendQueueLimits(parser.value(queueBytesOption).toLongLong() * 1024,
+                              parser.value(queueMessagesOption).toInt(),
+                              parser.value(slowOption).toInt());
+    server.setUdpEnabled(!parser.isSet(noUdpOption));
+
+    QObject::connect(&server, &DrumServer::clientConnected, [](const QString &clientId) {
+        qInfo() << "[SERVER] Client connecté:" << clientId;
+    });
+    QObject::connect(&server, &DrumServer::clientDisconnected, [](const QString &clientId) {
+        qInfo() << "[SERVER] Client déconnecté:" << clientId;
+    });
+    QObject::connect(&server, &DrumServer::clientTimedOut, [](const QString &clientId) {
+        qWarning() << "[SERVER] Client évincé (battement de cœur):" << clientId;
+    });
+    QObject::connect(&server, &DrumServer::errorOccurred, [](const QString &error) {
+        qWarning() << "[SERVER] Erreur:" << error;
+    });
+
+    if (!server.startListening(port)) {
+        return 1;
+    }
+    qInfo() << "Serveur dédié en écoute sur le port" << port;
+
+    // Métriques périodiques : charge et qualité des liens
+    QTimer statsTimer;
+    const int statsSeconds = parser.value(statsOption).toInt();
+    if (statsSeconds > 0) {
+        QObject::connect(&statsTimer, &QTimer::timeout, [&]() {
+            qInfo().noquote() << QString("[METRICS] salons=%1 clients=%2")
+                                     .arg(roomManager.getRoomCount())
+                                     .arg(server.getClientCount());
+            qInfo().noquote() << "[METRICS] liens:"
+                              << QJsonDocument(server.linkStatsJson()).toJson(QJsonDocument::Compact);
+        });
+        statsTimer.start(statsSeconds * 1000);
+    }
+
+    std::signal(SIGINT, requestQuit);
+    std::signal(SIGTERM, requestQuit);
+
+    const int result = app.exec();
+    server.stopListening();
+    return result;
+}
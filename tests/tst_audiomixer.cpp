@@ -0,0 +1,278 @@
+#include <QtTest>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QTimer>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+#include "AudioMixer.h"
+
+/**
+ * @brief Rendu du mixeur sans sortie audio : steps à la frame près, pool de voix
+ * Le mixeur est piloté comme par OfflineRenderer (render() appelé directement,
+ * les commandes étant appliquées au début de chaque bloc).
+ */
+class TestAudioMixer : public QObject {
+    Q_OBJECT
+
+private slots:
+    void stepsLandOnExactFrames_data();
+    void stepsLandOnExactFrames();
+    void outputIndependentOfBlockSize();
+    void stolenVoiceFadesOut();
+    void fadeReserveIsBounded();
+    void chokeGroupFadesPreviousVoice();
+    void instrumentGainAndPan();
+    void stepJitterUnderGuiLoad();
+
+private:
+    static SampleBufferPtr constantSample(float value, qint64 frames);
+    static std::vector<float> renderFrames(AudioMixer& mixer, qint64 frames, qint64 blockFrames);
+    static void startSequence(AudioMixer& mixer, double bpm);
+    // Écart quadratique moyen et écart maximal des intervalles successifs à la période `periodUs`
+    static void intervalJitter(const QList<double>& timesUs, double periodUs, double& stddevUs, double& maxUs);
+};
+
+SampleBufferPtr TestAudioMixer::constantSample(float value, qint64 frames) {
+    return SampleBuffer::fromPcm(QString(), QVector<float>(frames * SampleBuffer::CHANNELS, value));
+}
+
+std::vector<float> TestAudioMixer::renderFrames(AudioMixer& mixer, qint64 frames, qint64 blockFrames) {
+    std::vector<float> output(size_t(frames * SampleBuffer::CHANNELS));
+    for (qint64 done = 0; done < frames; done += blockFrames) {
+        mixer.render(output.data() + done * SampleBuffer::CHANNELS, qMin(blockFrames, frames - done));
+    }
+    return output;
+}
+
+void TestAudioMixer::startSequence(AudioMixer& mixer, double bpm) {
+    // Impulsion d'une frame sur chaque step : chaque déclenchement se voit dans la sortie
+    mixer.setMasterGain(1.0f);
+    mixer.setSample(0, constantSample(1.0f, 1));
+    mixer.setStepCount(16);
+    for (int step = 0; step < 16; ++step) {
+        mixer.setStepMask(step, 1);
+    }
+    mixer.setTempo(bpm);
+    mixer.setPlaying(true);
+}
+
+void TestAudioMixer::stepsLandOnExactFrames_data() {
+    QTest::addColumn<double>("bpm");
+    QTest::newRow("120") << 120.0; // 6000 frames par step
+    QTest::newRow("137") << 137.0; // Pas entier de frames par step
+    QTest::newRow("173.5") << 173.5;
+}
+
+void TestAudioMixer::stepsLandOnExactFrames() {
+    QFETCH(double, bpm);
+    AudioMixer mixer;
+    startSequence(mixer, bpm);
+
+    const double framesPerStep = SampleBuffer::SAMPLE_RATE * 60.0 / (bpm * 4.0);
+    const int steps = 40;
+    const std::vector<float> output = renderFrames(mixer, qint64(framesPerStep * steps), AudioMixer::PERIOD_FRAMES);
+
+    QList<qint64> onsets;
+    for (size_t frame = 0; frame < output.size() / 2; ++frame) {
+        if (output[frame * 2] > 0.5f) {
+            onsets.append(qint64(frame));
+        }
+    }
+    QCOMPARE(onsets.size(), steps);
+
+    // Chaque step tombe sur la frame qui suit sa position exacte : aucune dérive cumulée
+    for (int k = 0; k < onsets.size(); ++k) {
+        const double exact = k * framesPerStep;
+        QVERIFY2(onsets[k] >= exact - 1e-6 && onsets[k] < exact + 1.0,
+                 qPrintable(QString("step %1 : frame %2, attendu %3").arg(k).arg(onsets[k]).arg(exact)));
+    }
+}
+
+void TestAudioMixer::outputIndependentOfBlockSize() {
+    // La taille des périodes du périphérique ne doit pas déplacer les steps
+    AudioMixer small;
+    AudioMixer large;
+    startSequence(small, 137.0);
+    startSequence(large, 137.0);
+
+    const qint64 frames = SampleBuffer::SAMPLE_RATE * 3;
+    const std::vector<float> a = renderFrames(small, frames, 64);
+    const std::vector<float> b = renderFrames(large, frames, 1000);
+    QVERIFY(a == b);
+}
+
+void TestAudioMixer::stolenVoiceFadesOut() {
+    AudioMixer mixer;
+    mixer.setMasterGain(1.0f);
+    mixer.setSample(0, constantSample(0.01f, SampleBuffer::SAMPLE_RATE));
+    for (int i = 0; i < AudioMixer::MAX_VOICES; ++i) {
+        mixer.trigger(0);
+    }
+    renderFrames(mixer, 16, 16);
+    QCOMPARE(mixer.activeVoiceCount(), AudioMixer::MAX_VOICES);
+
+    // Pool plein : la voix la plus ancienne s'éteint en fondu au lieu d'être écrasée
+    mixer.trigger(0);
+    const std::vector<float> output = renderFrames(mixer, 2 * AudioMixer::FADE_FRAMES, 2 * AudioMixer::FADE_FRAMES);
+    QCOMPARE(mixer.stolenVoiceCount(), quint64(1));
+    QCOMPARE(mixer.activeVoiceCount(), AudioMixer::MAX_VOICES);
+
+    // 128 voix audibles plus la voix remplacée, encore à plein gain sur la première frame
+    QVERIFY(qAbs(output[0] - 1.29f) < 1e-4f);
+    QVERIFY(qAbs(output[output.size() - 2] - 1.28f) < 1e-4f);
+    // Descente linéaire : aucun saut plus grand qu'un pas de fondu (pas de clic)
+    const float maxStep = 0.01f / AudioMixer::FADE_FRAMES + 1e-5f;
+    for (size_t frame = 1; frame < output.size() / 2; ++frame) {
+        QVERIFY2(qAbs(output[frame * 2] - output[(frame - 1) * 2]) <= maxStep,
+                 qPrintable(QString("saut à la frame %1").arg(frame)));
+    }
+}
+
+void TestAudioMixer::fadeReserveIsBounded() {
+    AudioMixer mixer;
+    mixer.setSample(0, constantSample(0.01f, SampleBuffer::SAMPLE_RATE));
+    const int extra = AudioMixer::FADE_RESERVE + 8;
+    for (int i = 0; i < AudioMixer::MAX_VOICES + extra; ++i) {
+        mixer.trigger(0);
+    }
+
+    // Réserve épuisée : les fondus les plus avancés cèdent leur emplacement
+    renderFrames(mixer, 1, 1);
+    QCOMPARE(mixer.stolenVoiceCount(), quint64(extra));
+    QCOMPARE(mixer.activeVoiceCount(), AudioMixer::VOICE_SLOTS);
+
+    renderFrames(mixer, AudioMixer::FADE_FRAMES, AudioMixer::FADE_FRAMES);
+    QCOMPARE(mixer.activeVoiceCount(), AudioMixer::MAX_VOICES);
+}
+
+void TestAudioMixer::chokeGroupFadesPreviousVoice() {
+    AudioMixer mixer;
+    mixer.setSample(0, constantSample(0.5f, SampleBuffer::SAMPLE_RATE));
+    mixer.setSample(1, constantSample(0.25f, SampleBuffer::SAMPLE_RATE));
+    mixer.setChokeGroup(0, 1);
+    mixer.setChokeGroup(1, 1);
+
+    mixer.trigger(0);
+    renderFrames(mixer, 32, 32);
+    mixer.trigger(1);
+    renderFrames(mixer, AudioMixer::FADE_FRAMES, AudioMixer::FADE_FRAMES);
+
+    QCOMPARE(mixer.chokedVoiceCount(), quint64(1));
+    QCOMPARE(mixer.stolenVoiceCount(), quint64(0));
+    QCOMPARE(mixer.activeVoiceCount(), 1);
+}
+
+void TestAudioMixer::instrumentGainAndPan() {
+    AudioMixer mixer;
+    mixer.setMasterGain(1.0f);
+    mixer.setSample(0, constantSample(0.5f, 1024));
+    mixer.setSample(1, constantSample(0.5f, 1024));
+    mixer.setInstrumentMix(0, 1.0f, -1.0f); // Tout à gauche
+    mixer.setInstrumentMix(1, 0.5f, 0.5f);  // Moitié du volume, vers la droite
+
+    mixer.trigger(0);
+    std::vector<float> output = renderFrames(mixer, 300, 300);
+    QCOMPARE(output[0], 0.5f);
+    QCOMPARE(output[1], 0.0f);
+
+    mixer.trigger(1);
+    output = renderFrames(mixer, 300, 300);
+    QCOMPARE(output[0], 0.5f + 0.5f * 0.25f); // Balance : la gauche baisse de moitié
+    QCOMPARE(output[1], 0.5f * 0.5f);
+}
+
+void TestAudioMixer::intervalJitter(const QList<double>& timesUs, double periodUs, double& stddevUs, double& maxUs) {
+    double sumSquares = 0.0;
+    maxUs = 0.0;
+    for (qsizetype k = 1; k < timesUs.size(); ++k) {
+        const double deviation = (timesUs[k] - timesUs[k - 1]) - periodUs;
+        sumSquares += deviation * deviation;
+        maxUs = qMax(maxUs, qAbs(deviation));
+    }
+    stddevUs = timesUs.size() > 1 ? std::sqrt(sumSquares / double(timesUs.size() - 1)) : 0.0;
+}
+
+void TestAudioMixer::stepJitterUnderGuiLoad() {
+    // Ancienne horloge (QTimer du thread GUI, comme l'ancien DrumGrid) contre le transport
+    // du mixeur, pendant que le thread GUI est occupé par une charge synthétique
+    constexpr double BPM = 137.0;
+    constexpr int STEPS = 48;
+    const double stepUs = 60e6 / (BPM * 4.0);
+
+    AudioMixer mixer;
+    startSequence(mixer, BPM);
+
+    QElapsedTimer clock;
+    clock.start();
+    QList<double> timerUs;
+    QTimer stepTimer;
+    connect(&stepTimer, &QTimer::timeout, [&]() {
+        timerUs.append(clock.nsecsElapsed() / 1000.0);
+    });
+
+    // Repeints et mises en page simulés : toutes les 10 ms, 0 à 12 ms de calcul
+    QRandomGenerator random(2);
+    QTimer loadTimer;
+    connect(&loadTimer, &QTimer::timeout, [&]() {
+        const qint64 busyNs = qint64(random.bounded(12)) * 1000 * 1000;
+        QElapsedTimer busy;
+        busy.start();
+        while (busy.nsecsElapsed() < busyNs) {
+        }
+    });
+
+    // Périphérique simulé : une période rendue à chaque échéance. L'instant audible d'un
+    // step est sa frame de départ sur l'horloge du périphérique, quel que soit le retard du rendu.
+    std::vector<qint64> onsetFrames;
+    std::atomic<bool> audioDone{false};
+    std::thread audio([&] {
+        std::vector<float> output(AudioMixer::PERIOD_FRAMES * SampleBuffer::CHANNELS);
+        const auto start = std::chrono::steady_clock::now();
+        qint64 frame = 0;
+        while (onsetFrames.size() < size_t(STEPS)) {
+            mixer.render(output.data(), AudioMixer::PERIOD_FRAMES);
+            for (int i = 0; i < AudioMixer::PERIOD_FRAMES; ++i) {
+                if (output[i * 2] > 0.5f) {
+                    onsetFrames.push_back(frame + i);
+                }
+            }
+            frame += AudioMixer::PERIOD_FRAMES;
+            std::this_thread::sleep_until(start + std::chrono::nanoseconds(frame * 1000000000LL / SampleBuffer::SAMPLE_RATE));
+        }
+        audioDone.store(true, std::memory_order_release);
+    });
+
+    stepTimer.start(int(60000 / (BPM * 4))); // Intervalle entier, comme l'ancien séquenceur
+    loadTimer.start(10);
+    QTRY_VERIFY_WITH_TIMEOUT(audioDone.load(std::memory_order_acquire) && timerUs.size() >= STEPS, 30000);
+    stepTimer.stop();
+    loadTimer.stop();
+    audio.join();
+
+    QList<double> mixerUs;
+    for (qint64 frame : onsetFrames) {
+        mixerUs.append(frame * 1e6 / SampleBuffer::SAMPLE_RATE);
+    }
+    timerUs.resize(STEPS);
+
+    double timerStddev = 0.0;
+    double timerMax = 0.0;
+    double mixerStddev = 0.0;
+    double mixerMax = 0.0;
+    intervalJitter(timerUs, stepUs, timerStddev, timerMax);
+    intervalJitter(mixerUs, stepUs, mixerStddev, mixerMax);
+    qInfo().noquote() << QString("Gigue des steps sous charge GUI (%1 steps à %2 BPM) : QTimer écart moyen %3 µs, max %4 µs ; "
+                                 "mixeur écart moyen %5 µs, max %6 µs")
+                             .arg(STEPS).arg(BPM)
+                             .arg(timerStddev, 0, 'f', 0).arg(timerMax, 0, 'f', 0)
+                             .arg(mixerStddev, 0, 'f', 1).arg(mixerMax, 0, 'f', 1);
+
+    // Le transport ne dévie jamais de plus d'une frame, quelle que soit la charge du GUI
+    QVERIFY(mixerMax <= 1e6 / SampleBuffer::SAMPLE_RATE + 1e-3);
+}
+
+QTEST_GUILESS_MAIN(TestAudioMixer)
+#include "tst_audiomixer.moc"
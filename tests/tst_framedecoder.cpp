@@ -0,0 +1,193 @@
+#include <QtTest>
+#include <QtEndian>
+#include <QBuffer>
+#include <QRandomGenerator>
+#include "FrameDecoder.h"
+
+/**
+ * @brief Découpage des trames sur l'anneau : fragments, bouclage, agrandissement
+ */
+class TestFrameDecoder : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void wholeFrames();
+    void byteByByte();
+    void frameAcrossRingEnd();
+    void growsForLargeFrame();
+    void oversizedFrame();
+    void readCappedAtOneFrame();
+    void randomFragments();
+    void benchmarkRandomFragments();
+
+private:
+    static QByteArray frame(const QByteArray& payload);
+    static QByteArray payloadAt(int index);
+    static QList<QByteArray> drain(FrameDecoder& decoder);
+
+    // 100 000 petites trames et leur découpage en fragments de 1 à 300 octets
+    QByteArray m_stream;
+    QList<qsizetype> m_fragments;
+    static constexpr int FRAME_COUNT = 100000;
+};
+
+QByteArray TestFrameDecoder::frame(const QByteArray& payload) {
+    QByteArray data(4, Qt::Uninitialized);
+    qToBigEndian<quint32>(quint32(payload.size()), data.data());
+    return data + payload;
+}
+
+QByteArray TestFrameDecoder::payloadAt(int index) {
+    // Tailles variées (0 à 40 octets), contenu propre à chaque trame
+    return QByteArray::number(index).repeated(index % 7);
+}
+
+QList<QByteArray> TestFrameDecoder::drain(FrameDecoder& decoder) {
+    QList<QByteArray> payloads;
+    QByteArrayView view;
+    while (decoder.next(view) == FrameDecoder::Status::Frame) {
+        payloads.append(view.sliced(4).toByteArray());
+    }
+    return payloads;
+}
+
+void TestFrameDecoder::initTestCase() {
+    for (int i = 0; i < FRAME_COUNT; ++i) {
+        m_stream += frame(payloadAt(i));
+    }
+    QRandomGenerator random(17);
+    for (qsizetype done = 0; done < m_stream.size();) {
+        const qsizetype size = qMin<qsizetype>(random.bounded(1, 301), m_stream.size() - done);
+        m_fragments.append(size);
+        done += size;
+    }
+}
+
+void TestFrameDecoder::wholeFrames() {
+    FrameDecoder decoder;
+    decoder.append(frame("a") + frame("") + frame("ccc"));
+    QCOMPARE(drain(decoder), (QList<QByteArray>{"a", "", "ccc"}));
+    QCOMPARE(decoder.bufferedBytes(), qsizetype(0));
+}
+
+void TestFrameDecoder::byteByByte() {
+    FrameDecoder decoder;
+    const QByteArray data = frame("hello") + frame("world");
+    QList<QByteArray> payloads;
+    for (char byte : data) {
+        decoder.append(QByteArrayView(&byte, 1));
+        payloads += drain(decoder);
+    }
+    QCOMPARE(payloads, (QList<QByteArray>{"hello", "world"}));
+}
+
+void TestFrameDecoder::frameAcrossRingEnd() {
+    // Anneau de 64 octets : la troisième trame (en-tête compris) est coupée par sa fin
+    FrameDecoder decoder(1024, 64);
+    decoder.append(frame(QByteArray(40, 'x')) + frame(QByteArray(14, 'y')));
+
+    QByteArrayView view;
+    QCOMPARE(decoder.next(view), FrameDecoder::Status::Frame);
+    QCOMPARE(view.sliced(4).toByteArray(), QByteArray(40, 'x'));
+
+    // Écriture à la position 62 : 2 octets en fin d'anneau, le reste au début
+    decoder.append(frame(QByteArray(26, 'z')));
+    QCOMPARE(decoder.capacity(), qsizetype(64));
+    QCOMPARE(drain(decoder), (QList<QByteArray>{QByteArray(14, 'y'), QByteArray(26, 'z')}));
+    QCOMPARE(decoder.capacity(), qsizetype(64));
+}
+
+void TestFrameDecoder::growsForLargeFrame() {
+    FrameDecoder decoder(1024 * 1024, 64);
+    const QByteArray payload(5000, 'L');
+    const QByteArray data = frame(payload);
+    decoder.append(QByteArrayView(data).first(100));
+
+    QByteArrayView view;
+    QCOMPARE(decoder.next(view), FrameDecoder::Status::NeedMore);
+    QVERIFY(decoder.capacity() >= data.size()); // Réservé dès l'en-tête lu
+    decoder.append(QByteArrayView(data).sliced(100));
+    QCOMPARE(drain(decoder), QList<QByteArray>{payload});
+}
+
+void TestFrameDecoder::oversizedFrame() {
+    FrameDecoder decoder(16);
+    decoder.append(frame(QByteArray(17, 'o')));
+    QByteArrayView view;
+    QCOMPARE(decoder.next(view), FrameDecoder::Status::Oversized);
+}
+
+void TestFrameDecoder::readCappedAtOneFrame() {
+    // Un pair inonde : le périphérique a bien plus d'octets qu'une trame maximale
+    FrameDecoder decoder(16, 64);
+    QByteArray stream;
+    for (int i = 0; i < 1000; ++i) {
+        stream += frame(QByteArray(12, char('a' + i % 26)));
+    }
+    QBuffer device(&stream);
+    QVERIFY(device.open(QIODevice::ReadOnly));
+
+    QCOMPARE(decoder.readFrom(&device), qint64(20));
+    QCOMPARE(decoder.readFrom(&device), qint64(0)); // Rien de plus tant que rien n'est extrait
+
+    // Lecture et extraction alternées, comme dans les boucles des sockets
+    int received = 0;
+    do {
+        decoder.readFrom(&device);
+        QVERIFY(decoder.bufferedBytes() <= 20);
+        received += drain(decoder).size();
+    } while (device.bytesAvailable() > 0);
+    QCOMPARE(received, 1000);
+    QCOMPARE(decoder.capacity(), qsizetype(64));
+
+    // Préfixe valide suivi d'un corps qui n'arrive jamais en entier : l'anneau reste borné
+    FrameDecoder slow(16, 64);
+    QByteArray partial = frame(QByteArray(16, 's')).first(10) + QByteArray(4096, 'x');
+    QBuffer slowDevice(&partial);
+    QVERIFY(slowDevice.open(QIODevice::ReadOnly));
+    slow.readFrom(&slowDevice);
+    QCOMPARE(slow.bufferedBytes(), qsizetype(20));
+    QCOMPARE(slow.capacity(), qsizetype(64));
+}
+
+void TestFrameDecoder::randomFragments() {
+    FrameDecoder decoder(1024, 256);
+    int received = 0;
+    qsizetype offset = 0;
+    for (qsizetype size : std::as_const(m_fragments)) {
+        decoder.append(QByteArrayView(m_stream).sliced(offset, size));
+        offset += size;
+
+        QByteArrayView view;
+        while (decoder.next(view) == FrameDecoder::Status::Frame) {
+            if (view.sliced(4).toByteArray() != payloadAt(received)) {
+                QFAIL(qPrintable(QString("trame %1 altérée").arg(received)));
+            }
+            ++received;
+        }
+    }
+    QCOMPARE(received, int(FRAME_COUNT));
+    QCOMPARE(decoder.bufferedBytes(), qsizetype(0));
+}
+
+void TestFrameDecoder::benchmarkRandomFragments() {
+    int received = 0;
+    QBENCHMARK {
+        FrameDecoder decoder(1024, 256);
+        received = 0;
+        qsizetype offset = 0;
+        for (qsizetype size : std::as_const(m_fragments)) {
+            decoder.append(QByteArrayView(m_stream).sliced(offset, size));
+            offset += size;
+            QByteArrayView view;
+            while (decoder.next(view) == FrameDecoder::Status::Frame) {
+                ++received;
+            }
+        }
+    }
+    QCOMPARE(received, int(FRAME_COUNT));
+}
+
+QTEST_GUILESS_MAIN(TestFrameDecoder)
+#include "tst_framedecoder.moc"
@@ -0,0 +1,172 @@
+#include <QtTest>
+#include <QRandomGenerator>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <vector>
+#include "MixKernels.h"
+#include "SampleDecoder.h"
+
+/**
+ * @brief Noyaux SIMD retenus à l'exécution comparés à une version scalaire
+ * Toutes les longueurs de 0 à 70 et un départ décalé d'un float couvrent les
+ * fins de bloc et les accès non alignés.
+ */
+class TestMixKernels : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void mix();
+    void mixStereo();
+    void gainRamp();
+    void floatToInt16();
+    void benchmarkMixStereo_data();
+    void benchmarkMixStereo();
+
+private:
+    std::vector<float> randomBuffer(qsizetype size, float range);
+    static void mixVoices(std::vector<float>& out, const std::vector<float>& in, int frames, bool vectorized);
+
+    QRandomGenerator m_random{22};
+    static constexpr int MAX_LENGTH = 70;
+    static constexpr int VOICES = 64;
+};
+
+std::vector<float> TestMixKernels::randomBuffer(qsizetype size, float range) {
+    std::vector<float> buffer(size_t(size));
+    for (float& value : buffer) {
+        value = float(m_random.generateDouble() * 2.0 - 1.0) * range;
+    }
+    return buffer;
+}
+
+void TestMixKernels::initTestCase() {
+    qInfo() << "Noyaux de mixage :" << MixKernels::implementationName();
+}
+
+void TestMixKernels::mix() {
+    for (int offset = 0; offset < 2; ++offset) {
+        for (int count = 0; count <= MAX_LENGTH; ++count) {
+            std::vector<float> out = randomBuffer(count + offset, 1.0f);
+            const std::vector<float> in = randomBuffer(count + offset, 1.0f);
+            std::vector<float> expected = out;
+            for (int n = offset; n < count + offset; ++n) {
+                expected[n] += in[n];
+            }
+            MixKernels::mix(out.data() + offset, in.data() + offset, count);
+            QVERIFY2(out == expected, qPrintable(QString("décalage %1, %2 échantillons").arg(offset).arg(count)));
+        }
+    }
+}
+
+void TestMixKernels::mixStereo() {
+    for (int offset = 0; offset < 2; ++offset) {
+        for (int frames = 0; frames <= MAX_LENGTH; ++frames) {
+            std::vector<float> out = randomBuffer(frames * 2 + offset, 1.0f);
+            const std::vector<float> in = randomBuffer(frames * 2 + offset, 1.0f);
+            std::vector<float> expected = out;
+            for (int frame = 0; frame < frames; ++frame) {
+                expected[offset + frame * 2] += in[offset + frame * 2] * 0.25f;
+                expected[offset + frame * 2 + 1] += in[offset + frame * 2 + 1] * 0.75f;
+            }
+            MixKernels::mixStereo(out.data() + offset, in.data() + offset, frames, 0.25f, 0.75f);
+            // Tolérance d'un arrondi : le compilateur peut fusionner la référence en FMA
+            for (size_t n = 0; n < out.size(); ++n) {
+                QVERIFY2(qAbs(out[n] - expected[n]) <= 1e-6f,
+                         qPrintable(QString("décalage %1, %2 frames, indice %3").arg(offset).arg(frames).arg(n)));
+            }
+        }
+    }
+}
+
+void TestMixKernels::gainRamp() {
+    for (int offset = 0; offset < 2; ++offset) {
+        for (int frames = 0; frames <= MAX_LENGTH; ++frames) {
+            std::vector<float> buffer = randomBuffer(frames * 2 + offset, 1.0f);
+            std::vector<float> expected = buffer;
+            const float from = 0.2f;
+            const float to = 0.9f;
+            for (int frame = 0; frame < frames; ++frame) {
+                const float gain = from + (to - from) * float(frame) / float(frames);
+                expected[offset + frame * 2] *= gain;
+                expected[offset + frame * 2 + 1] *= gain;
+            }
+            MixKernels::applyGainRamp(buffer.data() + offset, frames, from, to);
+            // Le gain vectoriel est recalculé par registre, le scalaire cumulé : écart d'arrondi seulement
+            for (size_t n = 0; n < buffer.size(); ++n) {
+                QVERIFY2(qAbs(buffer[n] - expected[n]) <= 1e-5f,
+                         qPrintable(QString("décalage %1, %2 frames, indice %3").arg(offset).arg(frames).arg(n)));
+            }
+        }
+    }
+}
+
+void TestMixKernels::floatToInt16() {
+    for (int offset = 0; offset < 2; ++offset) {
+        for (int count = 0; count <= MAX_LENGTH; ++count) {
+            // Au-delà de [-1, 1] pour vérifier la saturation
+            const std::vector<float> in = randomBuffer(count + offset, 1.5f);
+            std::vector<qint16> out(size_t(count + offset), 0);
+            std::vector<qint16> expected = out;
+            for (int n = offset; n < count + offset; ++n) {
+                expected[n] = qint16(std::clamp(in[n], -1.0f, 1.0f) * 32767.0f);
+            }
+            MixKernels::floatToInt16(out.data() + offset, in.data() + offset, count);
+            QVERIFY2(out == expected, qPrintable(QString("décalage %1, %2 échantillons").arg(offset).arg(count)));
+        }
+    }
+}
+
+void TestMixKernels::mixVoices(std::vector<float>& out, const std::vector<float>& in, int frames, bool vectorized) {
+    for (int voice = 0; voice < VOICES; ++voice) {
+        if (vectorized) {
+            MixKernels::mixStereo(out.data(), in.data(), frames, 0.5f, 0.8f);
+        } else {
+            for (int frame = 0; frame < frames; ++frame) {
+                out[frame * 2] += in[frame * 2] * 0.5f;
+                out[frame * 2 + 1] += in[frame * 2 + 1] * 0.8f;
+            }
+        }
+    }
+}
+
+void TestMixKernels::benchmarkMixStereo_data() {
+    QTest::addColumn<bool>("vectorized");
+    QTest::addColumn<int>("frames");
+    // Tailles de période courantes, des clients à faible latence aux plus modestes
+    for (int frames : {64, 128, 256}) {
+        QTest::addRow("scalaire %d", frames) << false << frames;
+        QTest::addRow("%s %d", MixKernels::implementationName(), frames) << true << frames;
+    }
+}
+
+void TestMixKernels::benchmarkMixStereo() {
+    QFETCH(bool, vectorized);
+    QFETCH(int, frames);
+    std::vector<float> out(size_t(frames) * 2, 0.0f);
+    const std::vector<float> in = randomBuffer(frames * 2, 1.0f);
+
+    QBENCHMARK {
+        mixVoices(out, in, frames, vectorized);
+    }
+
+    // Voix mixées par milliseconde, et combien tiennent dans le temps réel d'une période
+    QElapsedTimer timer;
+    timer.start();
+    qint64 voices = 0;
+    do {
+        mixVoices(out, in, frames, vectorized);
+        voices += VOICES;
+    } while (timer.nsecsElapsed() < 100 * 1000 * 1000);
+    const double voicesPerMs = double(voices) * 1e6 / double(timer.nsecsElapsed());
+    const double periodMs = frames * 1000.0 / SampleBuffer::SAMPLE_RATE;
+    qInfo().noquote() << QString("%1, %2 frames : %3 voix/ms, %4 voix par période de %5 ms")
+                             .arg(vectorized ? MixKernels::implementationName() : "scalaire")
+                             .arg(frames)
+                             .arg(voicesPerMs, 0, 'f', 0)
+                             .arg(voicesPerMs * periodMs, 0, 'f', 0)
+                             .arg(periodMs, 0, 'f', 2);
+}
+
+QTEST_GUILESS_MAIN(TestMixKernels)
+#include "tst_mixkernels.moc"
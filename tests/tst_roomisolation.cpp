@@ -0,0 +1,296 @@
+#include <QtTest>
+#include <QTcpSocket>
+#include <QtEndian>
+#include <memory>
+#include <vector>
+#include "DrumServer.h"
+#include "RoomManager.h"
+
+/**
+ * @brief Client TCP minimal : envoie des trames JSON et garde tout ce qu'il reçoit
+ */
+class Peer : public QObject {
+    Q_OBJECT
+
+public:
+    explicit Peer(const QString& userId) : m_userId(userId) {
+        connect(&m_socket, &QTcpSocket::readyRead, this, &Peer::readFrames);
+    }
+
+    void connectTo(quint16 port) { m_socket.connectToHost(QHostAddress::LocalHost, port); }
+    bool isConnected() const { return m_socket.state() == QAbstractSocket::ConnectedState; }
+    const QString& userId() const { return m_userId; }
+
+    void send(const QByteArray& message) { m_socket.write(message); }
+    void join(const QString& roomId) { send(Protocol::createJoinRoomMessage(roomId, m_userId, m_userId, QString())); }
+    void setCell(int row, int col) { send(Protocol::createGridUpdateMessage(GridCell{row, col, true, m_userId})); }
+    void hitPad(int instrument) { send(Protocol::createPadHitMessage(instrument, m_userId)); }
+    void createRoom(const QString& name) { send(Protocol::createCreateRoomMessage(name, QString(), 8)); }
+
+    // Identifiant du salon `name` d'après la dernière liste reçue, vide s'il n'y figure pas
+    QString roomIdByName(const QString& name) const {
+        for (auto it = m_received.crbegin(); it != m_received.crend(); ++it) {
+            if (it->first != MessageType::ROOM_LIST_RESPONSE) {
+                continue;
+            }
+            for (const QJsonValue& room : it->second["rooms"].toArray()) {
+                if (room["name"].toString() == name) {
+                    return room["id"].toString();
+                }
+            }
+            break;
+        }
+        return QString();
+    }
+
+    qint64 bytesReceived() const { return m_bytesReceived; }
+    void resetCounters() {
+        m_received.clear();
+        m_bytesReceived = 0;
+    }
+
+    // Messages reçus de ce type (et de cet auteur, si précisé)
+    int count(MessageType type, const QString& userId = QString()) const {
+        int n = 0;
+        for (const auto& [receivedType, content] : m_received) {
+            if (receivedType == type && (userId.isEmpty() || content["userId"].toString() == userId)) {
+                ++n;
+            }
+        }
+        return n;
+    }
+
+private slots:
+    void readFrames() {
+        const QByteArray bytes = m_socket.readAll();
+        m_bytesReceived += bytes.size();
+        m_buffer.append(bytes);
+        while (m_buffer.size() >= 4) {
+            const qsizetype size = 4 + qFromBigEndian<quint32>(m_buffer.constData());
+            if (m_buffer.size() < size) {
+                break;
+            }
+            MessageType type;
+            QJsonObject content;
+            if (Protocol::parseMessage(QByteArrayView(m_buffer).first(size), type, content)) {
+                m_received.append({type, content});
+            }
+            m_buffer.remove(0, size);
+        }
+    }
+
+private:
+    QString m_userId;
+    QTcpSocket m_socket;
+    QByteArray m_buffer;
+    QList<QPair<MessageType, QJsonObject>> m_received;
+    qint64 m_bytesReceived = 0;
+};
+
+/**
+ * @brief Isolation des salons répartis sur plusieurs fils de travail
+ * Deux salons portés par deux fils différents : aucune opération d'un salon
+ * n'atteint les membres de l'autre, y compris après la migration d'une
+ * connexion du lobby vers un fil puis d'un fil à l'autre.
+ */
+class TestRoomIsolation : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void roomsOnDifferentWorkersStayIsolated();
+    void migratedClientLeavesPreviousRoom();
+    void editBytesStayInSenderRoom();
+
+private:
+    void joinAndSettle(Peer& peer, const QString& roomId);
+    static void waitForEcho(Peer& peer, int cells);
+
+    RoomManager* m_rooms = nullptr;
+    DrumServer* m_server = nullptr;
+    QString m_roomA;
+    QString m_roomB;
+};
+
+void TestRoomIsolation::initTestCase() {
+    // Sans HELLO, les connexions du serveur restent en JSON : le client de test aussi
+    Protocol::setDefaultFormat(WireFormat::Json);
+}
+
+void TestRoomIsolation::init() {
+    m_rooms = new RoomManager(this);
+    m_roomA = m_rooms->createRoom("Salon A", "host-a", "Hôte A");
+    m_roomB = m_rooms->createRoom("Salon B", "host-b", "Hôte B");
+
+    m_server = new DrumServer(this);
+    m_server->setRoomManager(m_rooms);
+    m_server->setWorkerCount(2);
+    m_server->setUdpEnabled(false);
+    m_server->setHeartbeat(60000, 3); // Les clients de test ne répondent pas aux PING
+    QVERIFY(m_server->startListening(0));
+}
+
+void TestRoomIsolation::cleanup() {
+    delete m_server;
+    m_server = nullptr;
+    delete m_rooms;
+    m_rooms = nullptr;
+}
+
+void TestRoomIsolation::joinAndSettle(Peer& peer, const QString& roomId) {
+    if (!peer.isConnected()) {
+        peer.connectTo(m_server->getServerPort());
+        QTRY_VERIFY(peer.isConnected());
+    }
+
+    // ROOM_INFO précède le départ vers le fil du salon : les opérations envoyées
+    // ensuite sont traitées par ce fil, une fois la connexion arrivée
+    const int infos = peer.count(MessageType::ROOM_INFO);
+    peer.join(roomId);
+    QTRY_COMPARE(peer.count(MessageType::ROOM_INFO), infos + 1);
+}
+
+void TestRoomIsolation::waitForEcho(Peer& peer, int cells) {
+    // L'auteur reçoit aussi sa propre opération, estampillée par l'état du salon
+    QTRY_COMPARE(peer.count(MessageType::GRID_UPDATE, peer.userId()), cells);
+}
+
+void TestRoomIsolation::roomsOnDifferentWorkersStayIsolated() {
+    Peer alice("alice");
+    Peer carol("carol");
+    Peer bob("bob");
+    joinAndSettle(alice, m_roomA);
+    joinAndSettle(carol, m_roomA);
+    joinAndSettle(bob, m_roomB);
+
+    // Répartition au moins chargé : un salon par fil
+    const int workerA = m_server->workerIndexForRoom(m_roomA);
+    const int workerB = m_server->workerIndexForRoom(m_roomB);
+    QVERIFY(workerA >= 0 && workerB >= 0);
+    QVERIFY(workerA != workerB);
+
+    alice.hitPad(1);
+    alice.setCell(0, 0);
+    bob.hitPad(2);
+    bob.setCell(1, 1);
+    waitForEcho(alice, 1);
+    waitForEcho(bob, 1);
+    QTRY_COMPARE(carol.count(MessageType::GRID_UPDATE, "alice"), 1);
+    QTRY_COMPARE(carol.count(MessageType::PAD_HIT, "alice"), 1);
+
+    // Second tour sur chaque fil : une fuite du premier aurait eu le temps d'arriver
+    alice.setCell(2, 2);
+    bob.setCell(3, 3);
+    waitForEcho(alice, 2);
+    waitForEcho(bob, 2);
+
+    QCOMPARE(alice.count(MessageType::GRID_UPDATE, "bob"), 0);
+    QCOMPARE(alice.count(MessageType::PAD_HIT, "bob"), 0);
+    QCOMPARE(carol.count(MessageType::GRID_UPDATE, "bob"), 0);
+    QCOMPARE(carol.count(MessageType::PAD_HIT, "bob"), 0);
+    QCOMPARE(bob.count(MessageType::GRID_UPDATE, "alice"), 0);
+    QCOMPARE(bob.count(MessageType::PAD_HIT, "alice"), 0);
+}
+
+void TestRoomIsolation::migratedClientLeavesPreviousRoom() {
+    Peer alice("alice");
+    Peer carol("carol");
+    Peer bob("bob");
+    joinAndSettle(alice, m_roomA);
+    joinAndSettle(carol, m_roomA);
+    joinAndSettle(bob, m_roomB);
+    QVERIFY(m_server->workerIndexForRoom(m_roomA) != m_server->workerIndexForRoom(m_roomB));
+
+    // Carol passe directement du fil du salon A à celui du salon B
+    carol.setCell(0, 1);
+    waitForEcho(carol, 1);
+    joinAndSettle(carol, m_roomB);
+    carol.setCell(0, 2);
+    waitForEcho(carol, 2);
+    QTRY_COMPARE(bob.count(MessageType::GRID_UPDATE, "carol"), 1);
+    QTRY_COMPARE(alice.count(MessageType::GRID_UPDATE, "carol"), 1); // Seulement l'opération d'avant le départ
+
+    alice.setCell(4, 4);
+    alice.hitPad(3);
+    alice.setCell(5, 5);
+    waitForEcho(alice, 2);
+    bob.setCell(6, 6);
+    waitForEcho(bob, 1);
+    QTRY_COMPARE(carol.count(MessageType::GRID_UPDATE, "bob"), 1);
+
+    // Plus rien du salon A chez Carol, plus rien de Carol dans le salon A
+    QCOMPARE(carol.count(MessageType::GRID_UPDATE, "alice"), 0);
+    QCOMPARE(carol.count(MessageType::PAD_HIT, "alice"), 0);
+    QCOMPARE(alice.count(MessageType::GRID_UPDATE, "carol"), 1);
+    QCOMPARE(alice.count(MessageType::GRID_UPDATE, "bob"), 0);
+    QCOMPARE(bob.count(MessageType::GRID_UPDATE, "alice"), 0);
+}
+
+void TestRoomIsolation::editBytesStayInSenderRoom() {
+    // 50 salons de 8 clients : le premier de chaque salon le crée, les 7 autres le rejoignent
+    constexpr int ROOMS = 50;
+    constexpr int USERS = 8;
+    std::vector<std::vector<std::unique_ptr<Peer>>> rooms(ROOMS);
+    for (int r = 0; r < ROOMS; ++r) {
+        for (int u = 0; u < USERS; ++u) {
+            rooms[r].push_back(std::make_unique<Peer>(QString("r%1-u%2").arg(r).arg(u)));
+            rooms[r].back()->connectTo(m_server->getServerPort());
+        }
+        for (const auto& peer : rooms[r]) {
+            QTRY_VERIFY(peer->isConnected());
+        }
+
+        const QString name = QString("Salon %1").arg(r);
+        Peer& creator = *rooms[r].front();
+        creator.createRoom(name);
+        QTRY_VERIFY(!creator.roomIdByName(name).isEmpty());
+        const QString roomId = creator.roomIdByName(name);
+        for (int u = 1; u < USERS; ++u) {
+            rooms[r][u]->join(roomId);
+        }
+        for (int u = 1; u < USERS; ++u) {
+            QTRY_COMPARE(rooms[r][u]->count(MessageType::ROOM_INFO), 1);
+        }
+    }
+
+    // Liste initiale des salons (100 ms après chaque connexion) arrivée partout
+    QTest::qWait(300);
+    for (const auto& room : rooms) {
+        for (const auto& peer : room) {
+            peer->resetCounters();
+        }
+    }
+
+    Peer& sender = *rooms[0][1];
+    sender.setCell(0, 0);
+    for (const auto& peer : rooms[0]) {
+        QTRY_COMPARE(peer->count(MessageType::GRID_UPDATE, sender.userId()), 1);
+    }
+    QTest::qWait(100); // Une fuite vers un autre fil aurait eu le temps d'arriver
+
+    qint64 roomBytes = 0;
+    for (const auto& peer : rooms[0]) {
+        roomBytes += peer->bytesReceived();
+    }
+    qint64 otherBytes = 0;
+    for (int r = 1; r < ROOMS; ++r) {
+        for (const auto& peer : rooms[r]) {
+            otherBytes += peer->bytesReceived();
+            QCOMPARE(peer->count(MessageType::GRID_UPDATE), 0);
+        }
+    }
+
+    // Diffusion globale : chacune des 400 connexions aurait reçu la même trame
+    const qint64 perRecipient = roomBytes / USERS;
+    qInfo().noquote() << QString("Une modification, %1 salons de %2 : %3 octets écrits (%4 par destinataire), "
+                                 "%5 octets en diffusion globale")
+                             .arg(ROOMS).arg(USERS).arg(roomBytes + otherBytes).arg(perRecipient)
+                             .arg(perRecipient * ROOMS * USERS);
+    QCOMPARE(otherBytes, qint64(0));
+    QVERIFY(roomBytes > 0);
+}
+
+QTEST_GUILESS_MAIN(TestRoomIsolation)
+#include "tst_roomisolation.moc"
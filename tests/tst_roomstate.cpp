@@ -0,0 +1,150 @@
+#include <QtTest>
+#include "RoomState.h"
+
+/**
+ * @brief État versionné d'un salon : rattrapage par le journal ou instantané,
+ * et validation des opérations contre les dimensions courantes de la grille
+ */
+class TestRoomState : public QObject {
+    Q_OBJECT
+
+private slots:
+    void deltaReturnsMissingOps();
+    void upToDateClientGetsNothing();
+    void truncatedLogFallsBackToSnapshot();
+    void foreignOrFutureRevisionFallsBack();
+    void snapshotResetsLog();
+    void opsValidatedAgainstLiveGrid();
+    void batchValidatedAgainstLiveGrid();
+
+private:
+    static QJsonObject cell(int row, int col);
+    static qint64 revisionOf(const QByteArray& frame);
+};
+
+QJsonObject TestRoomState::cell(int row, int col) {
+    return GridCell{row, col, true, "alice"}.toJson();
+}
+
+qint64 TestRoomState::revisionOf(const QByteArray& frame) {
+    MessageType type;
+    QJsonObject content;
+    return Protocol::parseMessage(frame, type, content) ? content["rev"].toInteger(-1) : -1;
+}
+
+void TestRoomState::deltaReturnsMissingOps() {
+    RoomState state;
+    for (int i = 0; i < 5; ++i) {
+        state.commit(MessageType::GRID_UPDATE, cell(0, i));
+    }
+    QCOMPARE(state.revision(), qint64(5));
+
+    QList<QByteArray> frames;
+    QVERIFY(state.framesSince(2, state.epoch(), frames));
+    QCOMPARE(frames.size(), 3);
+    QCOMPARE(revisionOf(frames[0]), qint64(3));
+    QCOMPARE(revisionOf(frames[2]), qint64(5));
+}
+
+void TestRoomState::upToDateClientGetsNothing() {
+    RoomState state;
+    state.commit(MessageType::TEMPO_CHANGE, QJsonObject{{"bpm", 100}});
+    QList<QByteArray> frames{"stale"};
+    QVERIFY(state.framesSince(state.revision(), state.epoch(), frames));
+    QVERIFY(frames.isEmpty());
+}
+
+void TestRoomState::truncatedLogFallsBackToSnapshot() {
+    RoomState state;
+    const int ops = RoomState::MAX_LOG_OPS + 10;
+    for (int i = 0; i < ops; ++i) {
+        state.commit(MessageType::TEMPO_CHANGE, QJsonObject{{"bpm", 60 + i % 100}});
+    }
+
+    // Le journal ne garde que les MAX_LOG_OPS dernières révisions : ]10, 522]
+    QList<QByteArray> frames;
+    QVERIFY(state.framesSince(10, state.epoch(), frames));
+    QCOMPARE(frames.size(), RoomState::MAX_LOG_OPS);
+    QCOMPARE(revisionOf(frames.first()), qint64(11));
+    QVERIFY(!state.framesSince(9, state.epoch(), frames));
+    QVERIFY(!state.framesSince(0, state.epoch(), frames));
+}
+
+void TestRoomState::foreignOrFutureRevisionFallsBack() {
+    RoomState state;
+    state.commit(MessageType::PLAY_STATE, QJsonObject{{"playing", true}});
+    QList<QByteArray> frames;
+    QVERIFY(!state.framesSince(0, state.epoch() + 1, frames)); // Autre époque (salon recréé)
+    QVERIFY(!state.framesSince(state.revision() + 1, state.epoch(), frames));
+    QVERIFY(!state.framesSince(-1, state.epoch(), frames)); // Premier SYNC_REQUEST
+}
+
+void TestRoomState::snapshotResetsLog() {
+    RoomState state;
+    state.commit(MessageType::GRID_UPDATE, cell(1, 1));
+    const qint64 before = state.revision();
+
+    RoomState host;
+    host.commit(MessageType::GRID_UPDATE, cell(2, 3));
+    state.loadSnapshot(host.snapshot());
+
+    // Les opérations antérieures ne peuvent plus être rejouées : instantané obligatoire
+    QList<QByteArray> frames;
+    QVERIFY(state.revision() > before);
+    QVERIFY(!state.framesSince(before, state.epoch(), frames));
+    QVERIFY(state.framesSince(state.revision(), state.epoch(), frames));
+    QCOMPARE(state.snapshot()["stepCount"].toInt(), host.snapshot()["stepCount"].toInt());
+}
+
+void TestRoomState::opsValidatedAgainstLiveGrid() {
+    RoomState state; // 8 instruments x 16 steps à la création
+    QVERIFY(state.isValidOp(MessageType::GRID_UPDATE, cell(7, 15)));
+    QVERIFY(!state.isValidOp(MessageType::GRID_UPDATE, cell(8, 0)));
+    QVERIFY(!state.isValidOp(MessageType::GRID_UPDATE, cell(0, 16)));
+    QVERIFY(!state.isValidOp(MessageType::PAD_HIT, QJsonObject{{"instrument", 8}, {"userId", "alice"}}));
+
+    state.commit(MessageType::COLUMN_UPDATE, QJsonObject{{"columnCount", 32}});
+    QVERIFY(state.isValidOp(MessageType::GRID_UPDATE, cell(0, 31)));
+    QVERIFY(!state.isValidOp(MessageType::GRID_UPDATE, cell(0, 32)));
+
+    QStringList names;
+    for (int i = 0; i < 12; ++i) {
+        names << QString("Instrument %1").arg(i);
+    }
+    state.commit(MessageType::INSTRUMENT_SYNC, QJsonObject{{"instruments", QJsonArray::fromStringList(names)}});
+    QVERIFY(state.isValidOp(MessageType::GRID_UPDATE, cell(11, 0)));
+    QVERIFY(state.isValidOp(MessageType::PAD_HIT, QJsonObject{{"instrument", 11}, {"userId", "alice"}}));
+    QVERIFY(!state.isValidOp(MessageType::GRID_UPDATE, cell(12, 0)));
+
+    // Réduction de la grille : les anciennes cellules deviennent invalides
+    state.commit(MessageType::COLUMN_UPDATE, QJsonObject{{"columnCount", 8}});
+    QVERIFY(!state.isValidOp(MessageType::GRID_UPDATE, cell(0, 8)));
+}
+
+void TestRoomState::batchValidatedAgainstLiveGrid() {
+    RoomState state;
+    GridBatch batch;
+    batch.userId = "alice";
+    batch.addCell(7, 15, true);
+    QVERIFY(state.isValidOp(MessageType::GRID_BATCH, batch.toJson()));
+
+    GridBatch outside = batch;
+    outside.addCell(9, 0, true);
+    QVERIFY(!state.isValidOp(MessageType::GRID_BATCH, outside.toJson()));
+
+    GridBatch rowMask;
+    rowMask.userId = "alice";
+    rowMask.masks.append({false, 8, 0x1, 0});
+    QVERIFY(!state.isValidOp(MessageType::GRID_BATCH, rowMask.toJson()));
+    rowMask.masks[0].index = 7;
+    rowMask.masks[0].set = ~quint64(0); // Bits au-delà de la grille : ignorés à l'application
+    QVERIFY(state.isValidOp(MessageType::GRID_BATCH, rowMask.toJson()));
+
+    GridBatch columnMask;
+    columnMask.userId = "alice";
+    columnMask.masks.append({true, 16, 0x1, 0});
+    QVERIFY(!state.isValidOp(MessageType::GRID_BATCH, columnMask.toJson()));
+}
+
+QTEST_GUILESS_MAIN(TestRoomState)
+#include "tst_roomstate.moc"
@@ -0,0 +1,239 @@
+#include <QtTest>
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+#include "SpscQueue.h"
+#include "AudioMixer.h"
+
+// Allocations et libérations comptées sur le thread marqué comme thread audio
+namespace {
+thread_local bool t_audioThread = false;
+std::atomic<int> s_audioAllocations{0};
+std::atomic<int> s_audioFrees{0};
+}
+
+void* operator new(std::size_t size) {
+    if (t_audioThread) {
+        s_audioAllocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    if (p && t_audioThread) {
+        s_audioFrees.fetch_add(1, std::memory_order_relaxed);
+    }
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    operator delete(p);
+}
+
+/**
+ * @brief File sans verrou GUI -> audio : ordre, capacité, et thread audio sans allocation
+ */
+class TestSpscQueue : public QObject {
+    Q_OBJECT
+
+private slots:
+    void lockFree();
+    void fullAndEmpty();
+    void orderedTransfer();
+    void ownershipTransfer();
+    void mixerAudioThreadNeverAllocates();
+    void retiredSamplesNeverFreedOnAudioThread();
+};
+
+void TestSpscQueue::lockFree() {
+    // Aucun verrou caché dans les atomiques : pas d'inversion de priorité possible
+    QVERIFY(std::atomic<quint32>::is_always_lock_free);
+    QVERIFY(std::atomic<qint64>::is_always_lock_free);
+    QVERIFY(std::atomic<double>::is_always_lock_free);
+}
+
+void TestSpscQueue::fullAndEmpty() {
+    SpscQueue<std::unique_ptr<int>, 4> queue;
+    QVERIFY(queue.isEmpty());
+    for (int i = 0; i < 4; ++i) {
+        QVERIFY(queue.push(std::make_unique<int>(i)));
+    }
+
+    // File pleine : la valeur n'est pas consommée
+    auto extra = std::make_unique<int>(4);
+    QVERIFY(!queue.push(std::move(extra)));
+    QVERIFY(extra);
+    QCOMPARE(*extra, 4);
+
+    std::unique_ptr<int> value;
+    for (int i = 0; i < 4; ++i) {
+        QVERIFY(queue.pop(value));
+        QCOMPARE(*value, i);
+    }
+    QVERIFY(!queue.pop(value));
+    QVERIFY(queue.isEmpty());
+}
+
+void TestSpscQueue::orderedTransfer() {
+    // Producteur et consommateur sur deux threads, la file pleine ou vide en permanence
+    constexpr quint64 COUNT = 2000000;
+    SpscQueue<quint64, 1024> queue;
+    std::thread producer([&queue] {
+        for (quint64 i = 0; i < COUNT; ++i) {
+            while (!queue.push(quint64(i))) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    quint64 expected = 0;
+    quint64 value = 0;
+    bool ordered = true;
+    while (expected < COUNT) {
+        if (!queue.pop(value)) {
+            std::this_thread::yield();
+            continue;
+        }
+        ordered = ordered && value == expected;
+        ++expected;
+    }
+    producer.join();
+
+    QVERIFY(ordered);
+    QVERIFY(queue.isEmpty());
+}
+
+void TestSpscQueue::ownershipTransfer() {
+    constexpr int COUNT = 100000;
+    SpscQueue<std::shared_ptr<int>, 64> queue;
+    std::thread producer([&queue] {
+        for (int i = 0; i < COUNT; ++i) {
+            auto value = std::make_shared<int>(i);
+            while (!queue.push(std::move(value))) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    // Chaque objet arrive une fois, seul propriétaire : l'emplacement ne garde rien
+    int received = 0;
+    bool owned = true;
+    std::shared_ptr<int> value;
+    while (received < COUNT) {
+        if (!queue.pop(value)) {
+            std::this_thread::yield();
+            continue;
+        }
+        owned = owned && *value == received && value.use_count() == 1;
+        ++received;
+    }
+    producer.join();
+    QVERIFY(owned);
+}
+
+void TestSpscQueue::mixerAudioThreadNeverAllocates() {
+    AudioMixer mixer;
+    auto sample = [](float value) {
+        return SampleBuffer::fromPcm(QString(), QVector<float>(4800 * SampleBuffer::CHANNELS, value));
+    };
+    for (int instrument = 0; instrument < 4; ++instrument) {
+        mixer.setSample(instrument, sample(0.1f));
+    }
+    mixer.setTempo(180.0);
+    mixer.setPlaying(true);
+
+    std::atomic<bool> stop{false};
+    std::atomic<int> blocks{0};
+    std::thread audio([&] {
+        std::vector<float> output(AudioMixer::PERIOD_FRAMES * SampleBuffer::CHANNELS);
+        t_audioThread = true;
+        while (!stop.load(std::memory_order_acquire)) {
+            mixer.render(output.data(), AudioMixer::PERIOD_FRAMES);
+            blocks.fetch_add(1, std::memory_order_relaxed);
+        }
+        t_audioThread = false;
+    });
+
+    // Le GUI inonde la file : frappes, gain, tempo, steps et remplacements de samples
+    int step = 0;
+    for (int i = 0; i < 50000; ++i) {
+        mixer.trigger(i % 4);
+        if (i % 7 == 0) {
+            mixer.setMasterGain(0.5f + float(i % 10) * 0.05f);
+        }
+        if (i % 13 == 0) {
+            mixer.setStepMask(i % 16, quint64(i) & 0xF);
+        }
+        if (i % 101 == 0) {
+            mixer.setTempo(90.0 + i % 80);
+        }
+        if (i % 50 == 0) {
+            mixer.setSample(i % 4, sample(float(i % 9) * 0.01f));
+        }
+        mixer.takeLatestStep(step);
+        mixer.collectGarbage();
+        if (i % 64 == 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    // Quelques blocs de plus : toutes les commandes envoyées sont appliquées
+    const int sentAt = blocks.load(std::memory_order_relaxed);
+    while (blocks.load(std::memory_order_relaxed) < sentAt + 4) {
+        std::this_thread::yield();
+    }
+    stop.store(true, std::memory_order_release);
+    audio.join();
+    mixer.collectGarbage();
+
+    QVERIFY(blocks.load() > 4);
+    QCOMPARE(s_audioAllocations.load(), 0);
+    QCOMPARE(s_audioFrees.load(), 0);
+}
+
+void TestSpscQueue::retiredSamplesNeverFreedOnAudioThread() {
+    // Sortie arrêtée : le GUI remplace en rafale un sample qui joue, sans que
+    // le thread audio ne vide la file ni que le GUI ne relève quoi que ce soit
+    constexpr int REPLACEMENTS = 400;
+    AudioMixer mixer;
+    for (int i = 0; i < REPLACEMENTS; ++i) {
+        mixer.trigger(0);
+        mixer.setSample(0, SampleBuffer::fromPcm(QString(), QVector<float>(4800 * SampleBuffer::CHANNELS, 0.1f)));
+    }
+
+    // Au-delà de la capacité de la file de retour, les remplacements sont refusés
+    const int accepted = 256;
+    QCOMPARE(mixer.droppedCommands(), quint64(REPLACEMENTS - accepted));
+
+    // Le thread audio applique tout d'un bloc : liste d'attente saturée, voix
+    // coupées, file de retour remplie jusqu'au dernier emplacement
+    auto renderOnAudioThread = [&mixer] {
+        std::thread audio([&mixer] {
+            std::vector<float> output(AudioMixer::PERIOD_FRAMES * SampleBuffer::CHANNELS);
+            t_audioThread = true;
+            mixer.render(output.data(), AudioMixer::PERIOD_FRAMES);
+            t_audioThread = false;
+        });
+        audio.join();
+    };
+    renderOnAudioThread();
+    QCOMPARE(s_audioFrees.load(), 0);
+
+    // Le GUI relève : de nouveau de la place pour les samples suivants
+    mixer.collectGarbage();
+    mixer.setSample(0, SampleBufferPtr());
+    renderOnAudioThread();
+    mixer.collectGarbage();
+    QCOMPARE(mixer.droppedCommands(), quint64(REPLACEMENTS - accepted));
+    QCOMPARE(s_audioAllocations.load(), 0);
+    QCOMPARE(s_audioFrees.load(), 0);
+}
+
+QTEST_GUILESS_MAIN(TestSpscQueue)
+#include "tst_spscqueue.moc"
@@ -0,0 +1,120 @@
+#include <QtTest>
+#include <QRandomGenerator>
+#include "Protocol.h"
+#include "LatencyHistogram.h"
+
+/**
+ * @brief Canal UDP des événements éphémères : datagrammes et simulation de perte
+ * La simulation compare, sur un lien à 2 % de perte, la latence frappe ->
+ * affichage d'un flux TCP (retransmission et blocage en tête de file) et du
+ * canal UDP (un événement perdu est simplement omis).
+ */
+class TestUdpChannel : public QObject {
+    Q_OBJECT
+
+private slots:
+    void datagramRoundTrip();
+    void malformedDatagrams();
+    void transientMessages();
+    void lossSimulation();
+
+private:
+    struct LinkResult {
+        LatencyHistogram latency;
+        int lost = 0;
+    };
+    static LinkResult simulateLink(bool ordered, double lossRate, quint32 seed);
+};
+
+void TestUdpChannel::datagramRoundTrip() {
+    const QByteArray frame = Protocol::createPadHitMessage(3, "alice");
+    const QByteArray datagram = Protocol::createDatagram(0x0123456789abcdefULL, frame);
+    QVERIFY(datagram.size() <= Protocol::MAX_DATAGRAM_SIZE);
+
+    quint64 token = 0;
+    QByteArrayView view;
+    QVERIFY(Protocol::splitDatagram(datagram, token, view));
+    QCOMPARE(token, 0x0123456789abcdefULL);
+    QCOMPARE(view.toByteArray(), frame);
+
+    MessageType type;
+    QJsonObject content;
+    QVERIFY(Protocol::parseMessage(view, type, content));
+    QCOMPARE(type, MessageType::PAD_HIT);
+    QCOMPARE(content["instrument"].toInt(), 3);
+    QCOMPARE(content["userId"].toString(), QString("alice"));
+}
+
+void TestUdpChannel::malformedDatagrams() {
+    const QByteArray datagram = Protocol::createDatagram(42, Protocol::createPingMessage(7));
+    quint64 token = 0;
+    QByteArrayView view;
+
+    // Tronqué, suivi d'octets en trop, ou réduit au jeton : rejeté
+    QVERIFY(!Protocol::splitDatagram(QByteArrayView(datagram).chopped(1), token, view));
+    QVERIFY(!Protocol::splitDatagram(datagram + QByteArray(1, '\0'), token, view));
+    QVERIFY(!Protocol::splitDatagram(QByteArrayView(datagram).first(Protocol::DATAGRAM_TOKEN_SIZE), token, view));
+    QVERIFY(!Protocol::splitDatagram(QByteArrayView(), token, view));
+}
+
+void TestUdpChannel::transientMessages() {
+    // Seuls les messages sans effet sur l'état partagé peuvent se perdre
+    QVERIFY(Protocol::isTransient(Protocol::createPingMessage(1)));
+    QVERIFY(Protocol::isTransient(Protocol::createPongMessage(1)));
+    QVERIFY(Protocol::isTransient(Protocol::createPadHitMessage(0, "bob")));
+    QVERIFY(!Protocol::isTransient(Protocol::createGridUpdateMessage({1, 2, true, "bob"})));
+    QVERIFY(!Protocol::isTransient(Protocol::createTempoMessage(128)));
+    QVERIFY(!Protocol::isTransient(Protocol::createPlayStateMessage(true)));
+}
+
+TestUdpChannel::LinkResult TestUdpChannel::simulateLink(bool ordered, double lossRate, quint32 seed) {
+    // Une frappe toutes les 10 ms pendant une minute, 20 ms de trajet ; TCP
+    // retransmet un segment perdu après 200 ms (RTO minimal de Linux)
+    constexpr qint64 INTERVAL_US = 10000;
+    constexpr qint64 DELAY_US = 20000;
+    constexpr qint64 RTO_US = 200000;
+    constexpr int EVENTS = 6000;
+
+    QRandomGenerator random(seed);
+    LinkResult result;
+    qint64 lastDelivery = 0;
+    for (int i = 0; i < EVENTS; ++i) {
+        const qint64 sent = i * INTERVAL_US;
+        qint64 arrival = sent + DELAY_US;
+        if (!ordered) {
+            if (random.generateDouble() < lossRate) {
+                ++result.lost;
+                continue;
+            }
+            result.latency.record(arrival - sent);
+            continue;
+        }
+
+        // Flux ordonné : chaque perte coûte un RTO, et bloque tout ce qui suit
+        while (random.generateDouble() < lossRate) {
+            arrival += RTO_US;
+        }
+        lastDelivery = qMax(lastDelivery, arrival);
+        result.latency.record(lastDelivery - sent);
+    }
+    return result;
+}
+
+void TestUdpChannel::lossSimulation() {
+    const LinkResult tcp = simulateLink(true, 0.02, 19);
+    const LinkResult udp = simulateLink(false, 0.02, 19);
+    qInfo().noquote() << "TCP, 2 % de perte :" << QJsonDocument(tcp.latency.toJson()).toJson(QJsonDocument::Compact);
+    qInfo().noquote() << "UDP, 2 % de perte :" << QJsonDocument(udp.latency.toJson()).toJson(QJsonDocument::Compact)
+                      << udp.lost << "événements perdus";
+
+    // UDP : latence constante, environ 2 % d'événements omis
+    QVERIFY(udp.latency.percentileUs(99) <= 22000);
+    QVERIFY(udp.lost > 60 && udp.lost < 180);
+    // TCP : rien ne se perd, mais la queue de latence prend les retransmissions
+    QCOMPARE(tcp.latency.count(), quint64(6000));
+    QVERIFY(tcp.latency.percentileUs(99) >= 200000);
+    QVERIFY(tcp.latency.meanUs() > 2.0 * udp.latency.meanUs());
+}
+
+QTEST_GUILESS_MAIN(TestUdpChannel)
+#include "tst_udpchannel.moc"